@@ -65,11 +65,50 @@ typedef struct cc_include_dirs {
     int64 count, capacity;
 } cc_include_dirs;
 
+/// @brief Broad, overlapping classes of C token kinds, as listed alongside each kind in `tokens.inc`.
+/// @details Keyword classes describe the keyword's role in every standard; whether it is a keyword in the current one is a separate question.
+typedef enum cc_token_class {
+    CC_TKC_NONE = 0,
+    CC_TKC_KEYWORD = 1 << 0,
+    CC_TKC_DIRECTIVE = 1 << 1,
+    CC_TKC_TRIVIA = 1 << 2,
+    CC_TKC_LITERAL = 1 << 3,
+    CC_TKC_TYPE_SPECIFIER = 1 << 4,
+    CC_TKC_TYPE_QUALIFIER = 1 << 5,
+    CC_TKC_STORAGE_CLASS = 1 << 6,
+    CC_TKC_BINARY_OPERATOR = 1 << 7,
+    CC_TKC_PREFIX_OPERATOR = 1 << 8,
+    CC_TKC_ASSIGNMENT = 1 << 9,
+    CC_TKC_STATEMENT_START = 1 << 10,
+} cc_token_class;
+
 typedef enum cc_token_kind {
-#define CC_TOKEN(Name) LY_TK_##Name,
+#define CC_TOKEN(Name, Classes) CC_TK_##Name,
 #include <cc/tokens.inc>
+    CC_TK_COUNT,
 } cc_token_kind;
 
+/// @brief The `cc_token_class` bits of every C token kind, indexed by kind.
+CHOIR_API const uint16 cc_token_kind_classes[CC_TK_COUNT];
+
+/// @brief Returns true if this token kind belongs to any of the given classes.
+static inline bool cc_token_kind_has_class(cc_token_kind kind, cc_token_class classes) {
+    assert(kind >= 0 && kind < CC_TK_COUNT && "invalid C token kind");
+    return 0 != (cc_token_kind_classes[kind] & classes);
+}
+
+static inline bool cc_token_kind_is_keyword(cc_token_kind kind) { return cc_token_kind_has_class(kind, CC_TKC_KEYWORD); }
+static inline bool cc_token_kind_is_directive(cc_token_kind kind) { return cc_token_kind_has_class(kind, CC_TKC_DIRECTIVE); }
+static inline bool cc_token_kind_is_trivia(cc_token_kind kind) { return cc_token_kind_has_class(kind, CC_TKC_TRIVIA); }
+static inline bool cc_token_kind_is_literal(cc_token_kind kind) { return cc_token_kind_has_class(kind, CC_TKC_LITERAL); }
+static inline bool cc_token_kind_is_type_specifier(cc_token_kind kind) { return cc_token_kind_has_class(kind, CC_TKC_TYPE_SPECIFIER); }
+static inline bool cc_token_kind_is_type_qualifier(cc_token_kind kind) { return cc_token_kind_has_class(kind, CC_TKC_TYPE_QUALIFIER); }
+static inline bool cc_token_kind_is_storage_class(cc_token_kind kind) { return cc_token_kind_has_class(kind, CC_TKC_STORAGE_CLASS); }
+static inline bool cc_token_kind_is_binary_operator(cc_token_kind kind) { return cc_token_kind_has_class(kind, CC_TKC_BINARY_OPERATOR); }
+static inline bool cc_token_kind_is_prefix_operator(cc_token_kind kind) { return cc_token_kind_has_class(kind, CC_TKC_PREFIX_OPERATOR); }
+static inline bool cc_token_kind_is_assignment(cc_token_kind kind) { return cc_token_kind_has_class(kind, CC_TKC_ASSIGNMENT); }
+static inline bool cc_token_kind_is_statement_start(cc_token_kind kind) { return cc_token_kind_has_class(kind, CC_TKC_STATEMENT_START); }
+
 typedef struct cc_token {
     struct cc_token* next;
     /// @brief The beginning of this token's text, its "lexeme", in the C source.
@@ -38,6 +38,14 @@ extern "C" {
 #    define CHOIR_USE_DLOPEN
 #endif
 
+#if defined(_WIN32) || (defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+#    define CHOIR_LITTLE_ENDIAN
+#endif
+
+#if !defined(CHOIR_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#    define CHOIR_USE_SSE2
+#endif
+
 #if defined(CHOIR_BUILD_AS_DLL)
 #    if defined(CHOIR_LIB)
 #        define CHOIR_API __declspec(dllexport)
@@ -157,6 +165,8 @@ CHOIR_API ch_allocator ch_general_purpose_allocator(void);
 
 typedef struct ch_arena_block {
     void* memory;
+    // the arena's block size, or the size of a single allocation which was too large for it.
+    int64 size;
     int64 consumed;
 } ch_arena_block;
 
@@ -166,34 +176,243 @@ typedef struct ch_arena_blocks {
     int64 count, capacity;
 } ch_arena_blocks;
 
+// Arenas only ever free everything at once. Reallocating the most recent allocation grows it in place when there is room,
+// and allocations larger than a block get a block of their own, so growable arrays can live in an arena too.
 typedef struct ch_arena {
     ch_allocator allocator;
     ch_arena_blocks blocks;
     int64 block_size;
+    // the most recent allocation from the newest block, which can be grown in place.
+    void* last_allocation;
 } ch_arena;
 
 CHOIR_API void ch_arena_init(ch_arena* arena, ch_allocator allocator, int64 block_size);
 CHOIR_API void* ch_arena_alloc(ch_arena* arena, int64 size);
+CHOIR_API void* ch_arena_realloc(ch_arena* arena, void* memory, int64 size);
 CHOIR_API void ch_arena_deinit(ch_arena* arena);
 CHOIR_API ch_allocator ch_arena_allocator(ch_arena* arena);
 
+// Runs `job` once for each index in [0, job_count), in no particular order.
+typedef void (*ch_job_fn)(void* userdata, int64 index);
+
+// A fixed set of worker threads which the calling thread joins while running jobs.
+// The general purpose allocator may be shared between jobs; arenas and contexts may not.
+typedef struct ch_thread_pool {
+    ch_allocator allocator;
+    int64 thread_count;
+    struct ch_thread_pool_state* state;
+} ch_thread_pool;
+
+// The number of processors available to this process, or 1 if it cannot be determined.
+CHOIR_API int64 ch_processor_count(void);
+
+// Starts `thread_count - 1` workers, since the thread calling `ch_thread_pool_run` does work too.
+CHOIR_API void ch_thread_pool_init(ch_thread_pool* pool, ch_allocator allocator, int64 thread_count);
+// Runs every job to completion before returning.
+CHOIR_API void ch_thread_pool_run(ch_thread_pool* pool, int64 job_count, ch_job_fn job, void* userdata);
+CHOIR_API void ch_thread_pool_deinit(ch_thread_pool* pool);
+
+// A lock for state shared between jobs, kept opaque so this header does not depend on a threads library.
+typedef struct ch_mutex {
+    ch_allocator allocator;
+    struct ch_mutex_state* state;
+} ch_mutex;
+
+CHOIR_API void ch_mutex_init(ch_mutex* mutex, ch_allocator allocator);
+CHOIR_API void ch_mutex_deinit(ch_mutex* mutex);
+CHOIR_API void ch_mutex_lock(ch_mutex* mutex);
+CHOIR_API void ch_mutex_unlock(ch_mutex* mutex);
+
+// An append-only array stored in fixed-size chunks which are never moved or freed until the array is.
+// Items can therefore be read from any thread while others append, as long as appending is serialized and an index is only
+// handed to other threads after the item it refers to has been written.
+typedef struct ch_stable_array {
+    ch_allocator allocator;
+    int64 item_size;
+    // items per chunk is 1 << chunk_shift.
+    int chunk_shift;
+    int64 max_chunk_count;
+    // allocated up front with room for every chunk, so that it never moves either.
+    void** chunks;
+    int64 count;
+} ch_stable_array;
+
+CHOIR_API void ch_stable_array_init(ch_stable_array* array, ch_allocator allocator, int64 item_size, int chunk_shift, int64 max_chunk_count);
+CHOIR_API void ch_stable_array_deinit(ch_stable_array* array);
+// Appends `count` items, which always end up contiguous in a single chunk, and returns the index of the first.
+// When they do not fit in what is left of the last chunk, the rest of it is skipped. `items` may be NULL to append zeroed items.
+CHOIR_API int64 ch_stable_array_push(ch_stable_array* array, const void* items, int64 count);
+
+static inline void* ch_stable_array_get(ch_stable_array* array, int64 index) {
+    int64 mask = (cast(int64) 1 << array->chunk_shift) - 1;
+    return cast(char*) array->chunks[index >> array->chunk_shift] + (index & mask) * array->item_size;
+}
+
+// The number of 64-bit words in a wide integer, enough for the widest integer type any front end supports (256 bits).
+#define CH_WIDE_INT_WORDS 4
+
+// A fixed-width unsigned integer stored as little-endian 64-bit words, for values which do not fit in 64 bits.
+typedef struct ch_wide_int {
+    uint64 words[CH_WIDE_INT_WORDS];
+} ch_wide_int;
+
+CHOIR_API ch_wide_int ch_wide_int_from_uint64(uint64 value);
+// Computes `value * multiplier + addend` in place, returning false if the result does not fit.
+CHOIR_API bool ch_wide_int_mul_add(ch_wide_int* value, uint32 multiplier, uint32 addend);
+
+// The signed operations treat a wide integer as two's complement, and return false when the exact result does not fit.
+CHOIR_API ch_wide_int ch_wide_int_from_int64(int64 value);
+CHOIR_API bool ch_wide_int_is_negative(ch_wide_int value);
+// Returns true, storing the value in `out_value`, if the value fits in a signed 64-bit integer.
+CHOIR_API bool ch_wide_int_to_int64(ch_wide_int value, int64* out_value);
+CHOIR_API int ch_wide_int_compare(ch_wide_int lhs, ch_wide_int rhs);
+CHOIR_API bool ch_wide_int_negate(ch_wide_int value, ch_wide_int* out_result);
+CHOIR_API bool ch_wide_int_add(ch_wide_int lhs, ch_wide_int rhs, ch_wide_int* out_result);
+CHOIR_API bool ch_wide_int_sub(ch_wide_int lhs, ch_wide_int rhs, ch_wide_int* out_result);
+CHOIR_API bool ch_wide_int_mul(ch_wide_int lhs, ch_wide_int rhs, ch_wide_int* out_result);
+// Truncating division, as in C. `rhs` must not be zero.
+CHOIR_API bool ch_wide_int_div_rem(ch_wide_int lhs, ch_wide_int rhs, ch_wide_int* out_quotient, ch_wide_int* out_remainder);
+// Shifts left by `count` bits, which must be less than the width, failing if any bit which differs from the sign is shifted out.
+CHOIR_API bool ch_wide_int_shl(ch_wide_int value, int64 count, ch_wide_int* out_result);
+// Shifts right by `count` bits, which must be less than the width, copying the sign bit in.
+CHOIR_API ch_wide_int ch_wide_int_shr(ch_wide_int value, int64 count);
+CHOIR_API ch_wide_int ch_wide_int_and(ch_wide_int lhs, ch_wide_int rhs);
+CHOIR_API ch_wide_int ch_wide_int_or(ch_wide_int lhs, ch_wide_int rhs);
+CHOIR_API ch_wide_int ch_wide_int_xor(ch_wide_int lhs, ch_wide_int rhs);
+CHOIR_API ch_wide_int ch_wide_int_not(ch_wide_int value);
+
+// Writes the UTF-8 encoding of a code point to `buffer`, which must hold at least 4 bytes, and returns the number of bytes written.
+CHOIR_API int ch_utf8_encode(uint32 code_point, char* buffer);
+// Decodes the UTF-8 sequence at the start of `text`, returning the number of bytes it occupies, or 0 if it is malformed.
+CHOIR_API int ch_utf8_decode(const char* text, int64 length, uint32* out_code_point);
+
+// Returns the length of the longest prefix of `text` which is valid UTF-8; this equals `length` if all of it is.
+CHOIR_API int64 ch_utf8_validate(const char* text, int64 length);
+
+// Unicode identifier classification, per UAX #31.
+CHOIR_API bool ch_unicode_is_xid_start(uint32 code_point);
+CHOIR_API bool ch_unicode_is_xid_continue(uint32 code_point);
+
+// Hashes `length` bytes of `data`. Fast on long inputs, with every input bit affecting every bit of the result.
+// The result depends on the byte order of the machine, so it should not be compared across machines.
+CHOIR_API uint64 ch_hash(const void* data, int64 length, uint64 seed);
+
+// The whole of a file, mapped read-only into memory instead of being read.
+// Pages are only loaded as they are touched, and are shared with every other process mapping the same file.
+typedef struct ch_mapped_file {
+    const void* data;
+    int64 size;
+} ch_mapped_file;
+
+// Maps a file, returning false if it cannot be opened or mapped. An empty file maps to NULL data of size 0.
+CHOIR_API bool ch_file_map(ch_mapped_file* file, const char* path);
+CHOIR_API void ch_file_unmap(ch_mapped_file* file);
+
+// An interned string. Equal text always interns to the same atom, so names can be compared and hashed as integers.
+// Atoms are numbered densely from 0, which is always the empty string.
+typedef uint32 ch_atom;
+
+typedef struct ch_atom_info {
+    // a NUL-terminated copy of the text, owned by the table.
+    const char* text;
+    int64 length;
+    uint64 hash;
+} ch_atom_info;
+
+typedef struct ch_atom_infos {
+    ch_allocator allocator;
+    ch_atom_info* items;
+    int64 count, capacity;
+} ch_atom_infos;
+
+typedef struct ch_atom_slot {
+    // the low bits of the text's hash, so most mismatches are rejected without touching the text.
+    uint32 hash;
+    // 0 marks an empty slot; the empty string is never stored in the slots.
+    ch_atom atom;
+} ch_atom_slot;
+
+// Interns strings into atoms with an open-addressing table of atom ids, kept at most half full so probe sequences stay short.
+typedef struct ch_atom_table {
+    ch_allocator allocator;
+    ch_arena text_arena;
+    // indexed by atom.
+    ch_atom_infos atoms;
+    ch_atom_slot* slots;
+    // always a power of two.
+    int64 slot_count;
+} ch_atom_table;
+
+CHOIR_API void ch_atom_table_init(ch_atom_table* table, ch_allocator allocator);
+CHOIR_API void ch_atom_table_deinit(ch_atom_table* table);
+// Returns the atom for `text`, interning a copy of it if it has not been seen before.
+CHOIR_API ch_atom ch_atom_intern(ch_atom_table* table, const char* text, int64 length);
+// Finds the atom for `text` without interning it, returning false if it has never been interned.
+CHOIR_API bool ch_atom_find(ch_atom_table* table, const char* text, int64 length, ch_atom* out_atom);
+CHOIR_API ch_atom_info ch_atom_get(ch_atom_table* table, ch_atom atom);
+
 typedef struct ch_string {
     ch_allocator allocator;
     char* items;
     int64 count, capacity;
 } ch_string;
 
+// The scalar types whose size and alignment depend on the target.
+typedef enum ch_target_type {
+    CH_TT_POINTER,
+    // `size_t`, which is also the size of Laye's `int`.
+    CH_TT_SIZE,
+    CH_TT_C_BOOL,
+    CH_TT_C_CHAR,
+    CH_TT_C_SHORT,
+    CH_TT_C_INT,
+    CH_TT_C_LONG,
+    CH_TT_C_LONG_LONG,
+    CH_TT_C_FLOAT,
+    CH_TT_C_DOUBLE,
+    CH_TT_C_LONG_DOUBLE,
+    CH_TT_COUNT,
+} ch_target_type;
+
+// A size and alignment, both in bytes.
+typedef struct ch_layout {
+    ch_size size;
+    ch_align align;
+} ch_layout;
+
+// A description of a target, one row of the table in `targets.inc`.
 typedef struct ch_target {
-    ch_size size_of_pointer;
-    ch_align align_of_pointer;
+    const char* name;
+    bool is_char_signed;
+    ch_layout layouts[CH_TT_COUNT];
 } ch_target;
 
+// Returns the target with the given name, or NULL if there is none.
+CHOIR_API const ch_target* ch_target_find(const char* name);
+// Returns the target matching the host, or the first target if the host is not one of them.
+CHOIR_API const ch_target* ch_target_host(void);
+
 typedef struct ch_source {
     const char* name;
     const char* text;
     int64 length;
+    // Set once the text has been checked for valid UTF-8, so lexers only ever do it once per source.
+    bool is_utf8_validated;
+    // Edits applied to validated text leave only the bytes they touched to check, from `unvalidated_begin` up to `unvalidated_end`.
+    int64 unvalidated_begin;
+    int64 unvalidated_end;
+    // The hash of the text when it was released, so reloading it can tell whether the file still holds the same text.
+    uint64 released_hash;
 } ch_source;
 
+// A single contiguous replacement within a source text, as reported by an editor.
+typedef struct ch_source_edit {
+    int64 offset;
+    int64 removed_length;
+    const char* inserted_text;
+    int64 inserted_length;
+} ch_source_edit;
+
 typedef struct ch_sources {
     ch_allocator allocator;
     ch_source* items;
@@ -233,10 +452,14 @@ typedef struct ch_diagnostics {
 
 typedef struct ch_context {
     ch_allocator allocator;
-    ch_target* target;
+    // the host's target until set otherwise.
+    const ch_target* target;
     ch_string_store string_store;
 
     bool has_issued_diagnostics;
+    // When set, diagnostics are only queued until `ch_diag_flush` is called, rather than printed as soon as another is reported.
+    // This lets work done on other threads report its diagnostics later, in a deterministic order.
+    bool defer_diagnostics;
     ch_diagnostics queued_diagnostics;
 } ch_context;
 
@@ -248,10 +471,30 @@ typedef struct ch_args {
     int dummy;
 } ch_args;
 
+// Replaces the source text with a copy, allocated with `allocator`, that has the edit applied.
+// The previous text is not freed, since tokens may still refer to it. Text which was validated stays validated but for the code points
+// the edit touched, so validating it again costs as much as the edit rather than the whole text.
+CHOIR_API void ch_source_apply_edit(ch_source* source, ch_source_edit edit, ch_allocator allocator);
+// Checks that the source text is valid UTF-8, reporting an error at the first invalid byte if it is not.
+// The check only runs the first time this is called for a given text; later calls only check what edits have touched since, and
+// return true if that is valid, so invalid text elsewhere is only ever reported once.
+CHOIR_API bool ch_source_validate_utf8(ch_context* context, ch_source* source);
+// Forgets the source text, which the caller is about to free. The name and length are kept, so locations in the source stay meaningful.
+CHOIR_API void ch_source_release(ch_source* source);
+// Reads a released source's text back from the file it is named after, such as to show a late diagnostic in context.
+// Returns false, leaving the text released, if the file cannot be read or no longer holds the same text.
+// The text is allocated with `allocator`, and the caller frees it once it is done with it.
+CHOIR_API bool ch_source_reload(ch_source* source, ch_allocator allocator);
+
 CHOIR_API void ch_context_init(ch_context* context, ch_allocator allocator);
 CHOIR_API void ch_context_deinit(ch_context* context);
 
 CHOIR_API void ch_diag_flush(ch_context* context);
+// Moves every diagnostic queued in `from` to the end of the queue in `context`.
+// Both contexts must share an allocator, since the messages are not copied.
+CHOIR_API void ch_diag_merge(ch_context* context, ch_context* from);
+// Drops every queued diagnostic without reporting it, for work whose diagnostics turned out not to matter.
+CHOIR_API void ch_diag_discard(ch_context* context);
 CHOIR_API void ch_diag(ch_context* context, ch_diagnostic_kind kind, ch_location location, const char* format, ...);
 
 CHOIR_API int choir_main(int argc, char** argv);
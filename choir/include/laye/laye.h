@@ -9,17 +9,66 @@ extern "C" {
 #include <choir/config.h>
 #include <laye/macros.h>
 
+/// @brief Broad, overlapping classes of Laye token kinds, as listed alongside each kind in `tokens.inc`.
+/// @details These answer the questions a parser asks of every token ("could this start a statement?") with a single table load.
+typedef enum ly_token_class {
+    LY_TKC_NONE = 0,
+    LY_TKC_KEYWORD = 1 << 0,
+    LY_TKC_SIZED_KEYWORD = 1 << 1,
+    LY_TKC_TRIVIA = 1 << 2,
+    LY_TKC_LITERAL = 1 << 3,
+    LY_TKC_TYPE_KEYWORD = 1 << 4,
+    LY_TKC_BINARY_OPERATOR = 1 << 5,
+    LY_TKC_PREFIX_OPERATOR = 1 << 6,
+    LY_TKC_ASSIGNMENT = 1 << 7,
+    LY_TKC_STATEMENT_START = 1 << 8,
+    LY_TKC_DECLARATION_START = 1 << 9,
+} ly_token_class;
+
 /// @brief Describes the kind of a Laye source text token.
 /// @ref ly_token
 typedef enum ly_token_kind {
-#define LY_TOKEN(Name)   LY_TK_##Name,
-#define LY_TOKEN_MISSING LY_TK_MISSING = 256,
+#define LY_TOKEN(Name, Classes) LY_TK_##Name,
+#define LY_TOKEN_MISSING        LY_TK_MISSING = 256,
 #include <laye/tokens.inc>
+    LY_TK_COUNT,
 } ly_token_kind;
 
 /// @brief Returns the name of the enum constant associated with this Laye token kind.
 CHOIR_API const char* ly_token_kind_name_get(ly_token_kind kind);
 
+/// @brief The `ly_token_class` bits of every Laye token kind, indexed by kind.
+CHOIR_API const uint16 ly_token_kind_classes[LY_TK_COUNT];
+
+/// @brief Returns true if this token kind belongs to any of the given classes.
+static inline bool ly_token_kind_has_class(ly_token_kind kind, ly_token_class classes) {
+    assert(kind >= 0 && kind < LY_TK_COUNT && "invalid Laye token kind");
+    return 0 != (ly_token_kind_classes[kind] & classes);
+}
+
+static inline bool ly_token_kind_is_keyword(ly_token_kind kind) { return ly_token_kind_has_class(kind, LY_TKC_KEYWORD); }
+static inline bool ly_token_kind_is_sized_keyword(ly_token_kind kind) { return ly_token_kind_has_class(kind, LY_TKC_SIZED_KEYWORD); }
+static inline bool ly_token_kind_is_trivia(ly_token_kind kind) { return ly_token_kind_has_class(kind, LY_TKC_TRIVIA); }
+static inline bool ly_token_kind_is_literal(ly_token_kind kind) { return ly_token_kind_has_class(kind, LY_TKC_LITERAL); }
+static inline bool ly_token_kind_is_type_keyword(ly_token_kind kind) { return ly_token_kind_has_class(kind, LY_TKC_TYPE_KEYWORD); }
+static inline bool ly_token_kind_is_binary_operator(ly_token_kind kind) { return ly_token_kind_has_class(kind, LY_TKC_BINARY_OPERATOR); }
+static inline bool ly_token_kind_is_prefix_operator(ly_token_kind kind) { return ly_token_kind_has_class(kind, LY_TKC_PREFIX_OPERATOR); }
+static inline bool ly_token_kind_is_assignment(ly_token_kind kind) { return ly_token_kind_has_class(kind, LY_TKC_ASSIGNMENT); }
+static inline bool ly_token_kind_is_statement_start(ly_token_kind kind) { return ly_token_kind_has_class(kind, LY_TKC_STATEMENT_START); }
+static inline bool ly_token_kind_is_declaration_start(ly_token_kind kind) { return ly_token_kind_has_class(kind, LY_TKC_DECLARATION_START); }
+
+/// @brief How tightly a binary operator holds on to the operands either side of it.
+/// @details Derived from the precedence and associativity listed for each operator in `operators.inc`.
+/// A left-associative operator binds tighter to its right, and a right-associative one tighter to its left, so comparing the right power of a pending operator to the left power of the next one decides which of the two gets the operand between them.
+/// Kinds which are not binary operators have a binding power of 0 on both sides.
+typedef struct ly_binding_power {
+    uint8 left;
+    uint8 right;
+} ly_binding_power;
+
+/// @brief The binding power of every Laye token kind as a binary operator, indexed by kind.
+CHOIR_API const ly_binding_power ly_token_kind_binding_powers[LY_TK_COUNT];
+
 /// @brief
 typedef struct ly_token {
     struct ly_token* next;
@@ -28,7 +77,9 @@ typedef struct ly_token {
     /// This means that the lifetime of source text is expected to be as long as the lifetime of tokens.
     /// Usually, we should not need source information (or tokens) after a full semantic analysis pass has completed, since by the time we're generating code for the program all user errors should be gone (and we should be past any place an LSP should care about).
     /// With that said, I have found it useful to emit diagnostics with source location information even past semantic analysis, since that can help pinpoint what context triggers an ICE diagnostic.
-    /// Maybe source text, and by extension tokens and their lexemes, should live for the entire duration of the program.
+    /// Locations only keep their source and offsets into it, though, so a driver which wants the memory back can free tokens and source text as soon as sema has interned
+    /// the tree's strings (see `ly_sema_intern_strings`, `ly_syntax_tree_release_strings` and `ch_source_release`) and still report diagnostics in it;
+    /// printing one reloads the text with `ch_source_reload`.
     const char* lexeme_begin;
     /// @brief The length of this token's text, its "lexeme".
     /// @details Hypothetically, this length *could* be specified as an int64_t, but we may already see issues with tooling if a single token is 2GB long.
@@ -44,21 +95,179 @@ typedef struct ly_token {
     struct ly_token* leading_trivia;
     struct ly_token* trailing_trivia;
 
+    /// @brief Set for integer literals whose value does not fit in `integer_value`, in which case it is stored in `wide_integer_value` instead.
+    bool is_wide_integer;
+
+    /// @brief The length in bytes of `string_value`, after escape sequences have been processed.
+    int64 string_length;
+
     union {
+        /// @brief The contents of a string literal, with escape sequences processed.
+        /// @details This is not NUL-terminated; use `string_length`.
+        /// Literals without escape sequences, the common case, point directly into the source text between the quotes.
+        /// Literals with escape sequences are decoded into storage allocated with the token allocator.
         const char* string_value;
         int64 integer_value;
+        /// @brief The value of an integer literal too large for an `int64`, allocated with the token allocator.
+        /// @details Values are limited to `CH_WIDE_INT_WORDS` words (256 bits), the widest integer type Laye supports.
+        ch_wide_int* wide_integer_value;
     };
 } ly_token;
 
+/// @brief Pull-based lexer state, defined along with the rest of the lexer API below.
+typedef struct ly_lexer ly_lexer;
+
+/// @brief Describes the kind of a Laye syntax node.
+/// @details See `syntax.inc` for how each kind uses the fields of its node.
 typedef enum ly_syntax_kind {
-    LY_SN_NONE = 0,
+#define LY_SYNTAX(Name) LY_SN_##Name,
+#include <laye/syntax.inc>
+    LY_SN_COUNT,
 } ly_syntax_kind;
 
-typedef struct ly_syntax {
-    /// @brief The distinct kind of this syntax node.
-    ly_syntax_kind kind;
-    ch_location location;
-} ly_syntax;
+/// @brief Returns the name of the enum constant associated with this Laye syntax kind.
+CHOIR_API const char* ly_syntax_kind_name_get(ly_syntax_kind kind);
+
+/// @brief Identifies a node within its syntax tree; 0 is the absent node.
+typedef uint32 ly_syntax_id;
+
+typedef enum ly_syntax_flag {
+    LY_SF_NONE = 0,
+    LY_SF_EXPORT = 1 << 0,
+    LY_SF_FOREIGN = 1 << 1,
+    LY_SF_INLINE = 1 << 2,
+    LY_SF_DISCARDABLE = 1 << 3,
+    LY_SF_STRICT = 1 << 4,
+    LY_SF_MUT = 1 << 5,
+} ly_syntax_flag;
+
+/// @brief A single node in a Laye syntax tree.
+/// @details Nodes are deliberately small and hold no pointers, so a whole tree is a few contiguous arrays which are cheap to build, walk and throw away.
+/// Children are referred to by id, either directly in `lhs` and `rhs` or through the tree's extra data, as described for each kind in `syntax.inc`.
+typedef struct ly_syntax_node {
+    /// @brief The distinct kind of this syntax node, a `ly_syntax_kind`.
+    uint8 kind;
+    /// @brief Any `ly_syntax_flag`s which apply to this node.
+    uint8 flags;
+    /// @brief The operator or keyword this node was built from, a `ly_token_kind`, for kinds which need one.
+    uint16 token_kind;
+    /// @brief The span of source text this node covers.
+    uint32 offset;
+    uint32 length;
+    uint32 lhs;
+    uint32 rhs;
+} ly_syntax_node;
+
+/// @brief A view of text referred to by a syntax tree, such as an identifier or a string literal's value.
+/// @details Not NUL-terminated.
+typedef struct ly_syntax_string {
+    const char* text;
+    int64 length;
+} ly_syntax_string;
+
+/// @brief A view of a list of node ids stored in a syntax tree's extra data.
+typedef struct ly_syntax_list {
+    const ly_syntax_id* items;
+    int64 count;
+} ly_syntax_list;
+
+typedef struct ly_syntax_nodes {
+    ch_allocator allocator;
+    ly_syntax_node* items;
+    int64 count, capacity;
+} ly_syntax_nodes;
+
+typedef struct ly_syntax_extra {
+    ch_allocator allocator;
+    uint32* items;
+    int64 count, capacity;
+} ly_syntax_extra;
+
+typedef struct ly_syntax_strings {
+    ch_allocator allocator;
+    ly_syntax_string* items;
+    int64 count, capacity;
+} ly_syntax_strings;
+
+/// @brief The syntax of a single Laye source file.
+/// @details The tree does not own its source text or any string storage; strings are views into the source or into the token allocator that lexed it.
+typedef struct ly_syntax_tree {
+    ch_source* source;
+    ly_syntax_nodes nodes;
+    ly_syntax_extra extra;
+    ly_syntax_strings strings;
+    /// @brief The MODULE_UNIT node, once the tree has been parsed.
+    ly_syntax_id root;
+    /// @brief The source text which the tree's string views point into, so they can be moved along when the text is edited.
+    const char* text;
+    /// @brief How many nodes were left unreachable by declarations `ly_reparse` replaced.
+    int64 dead_node_count;
+    /// @brief Set for trees loaded with `ly_syntax_cache_read`, whose nodes and extra data are a read-only file mapping.
+    /// @details Such trees can be walked like any other, but nothing can be added to them.
+    bool is_mapped;
+} ly_syntax_tree;
+
+/// @brief Prepares an empty syntax tree for the given source, reserving id 0 for the absent node and string 0 for the empty string.
+CHOIR_API void ly_syntax_tree_init(ly_syntax_tree* tree, ch_allocator allocator, ch_source* source);
+CHOIR_API void ly_syntax_tree_deinit(ly_syntax_tree* tree);
+/// @brief Drops the tree's string table before the source text or tokens its views point into are freed.
+/// @details Nodes and locations are kept. Semantic analysis interns every string before anything else (see `ly_sema_intern_strings`),
+/// so nothing needs the table after that; reading a string afterwards asserts rather than reading freed memory.
+CHOIR_API void ly_syntax_tree_release_strings(ly_syntax_tree* tree);
+
+/// @brief Appends a node to the tree and returns its id.
+CHOIR_API ly_syntax_id ly_syntax_add(ly_syntax_tree* tree, ly_syntax_node node);
+/// @brief Appends words to the extra data and returns the index of the first.
+CHOIR_API uint32 ly_syntax_add_extra(ly_syntax_tree* tree, const uint32* words, int64 count);
+/// @brief Appends a list of node ids to the extra data and returns its index, suitable for `ly_syntax_list_get`.
+CHOIR_API uint32 ly_syntax_add_list(ly_syntax_tree* tree, const ly_syntax_id* ids, int64 count);
+/// @brief Appends a string to the string table and returns its index. The text is not copied.
+CHOIR_API uint32 ly_syntax_add_string(ly_syntax_tree* tree, const char* text, int64 length);
+
+/// @brief Returns the node with the given id. The pointer is invalidated by adding nodes.
+CHOIR_API ly_syntax_node* ly_syntax_get(ly_syntax_tree* tree, ly_syntax_id id);
+CHOIR_API ly_syntax_list ly_syntax_list_get(ly_syntax_tree* tree, uint32 list_index);
+CHOIR_API ly_syntax_string ly_syntax_string_get(ly_syntax_tree* tree, uint32 string_index);
+CHOIR_API ch_location ly_syntax_location(ly_syntax_tree* tree, ly_syntax_id id);
+
+/// @brief Writes the ids of the direct children of a node, in source order, to `children` and returns how many there are.
+/// @details At most `capacity` ids are written, but the full count is always returned so the caller can retry with more room.
+/// Absent optional children are skipped.
+CHOIR_API int64 ly_syntax_children(ly_syntax_tree* tree, ly_syntax_id id, ly_syntax_id* children, int64 capacity);
+
+/// @brief Parses the tokens read from a streaming lexer into an initialized, empty syntax tree and returns its MODULE_UNIT node.
+/// @details The lexer must read the tree's source and not have been read from yet. Tokens are pulled from it as the parser goes,
+/// so no more than the lexer's lookahead is ever held in memory, and the lexer's diagnostics are reported along with the parser's.
+/// Expressions are parsed with an operator precedence (Pratt) loop over `ly_token_kind_binding_powers` which keeps its pending operators on an explicit stack, so long operator chains do not grow the C stack.
+/// Only bracketed nesting recurses, and it is limited to `LY_PARSE_MAX_DEPTH` levels.
+/// Strings in the tree refer to the source text and to the token allocator, so both must outlive the tree.
+CHOIR_API ly_syntax_id ly_parse(ch_context* context, ly_syntax_tree* tree, ly_lexer* lexer);
+
+/// @brief Updates a tree previously produced by `ly_parse` to reflect an edit of its source text.
+/// @details `tokens` must already describe the edited text, as returned by `ly_relex`, while the tree still describes the text as it was before the edit.
+/// When the edit falls strictly inside one top level declaration, only that declaration is parsed again.
+/// Its new nodes are appended to the tree and take its place in the root's list, and every node and string view after the edit is shifted to match the new text, so node ids outside the declaration stay valid.
+/// Any other edit, one close enough to the declaration's start that the previous declaration may have looked at it, or one which changes where the declaration ends, reparses the whole file, as does letting replaced declarations pile up.
+/// Returns the root, which is also left in `tree->root`.
+CHOIR_API ly_syntax_id ly_reparse(ch_context* context, ly_syntax_tree* tree, ly_token* tokens, ch_source_edit edit);
+
+/// @brief How deeply brackets, blocks and nested statements may be nested before the parser gives up on them.
+#define LY_PARSE_MAX_DEPTH 256
+
+/// @brief Bumped whenever the layout of syntax trees or of syntax cache files changes, or the parser builds a different tree for the same text, so stale cache files are never read.
+#define LY_SYNTAX_CACHE_VERSION 2
+
+/// @brief Computes the key a source's syntax tree is cached under, from the source text and the version of the compiler caching it.
+/// @details Any change to the text, or a different compiler, gives a different key, so a cache file can be reused without checking the source again.
+CHOIR_API uint64 ly_syntax_cache_key(ch_source* source, const char* compiler_version);
+/// @brief Writes a parsed tree to `path` in the flat form `ly_syntax_cache_read` maps back in, returning false if the file cannot be written.
+/// @details The file is written to a temporary path first and then moved into place, so a reader never sees it half written.
+CHOIR_API bool ly_syntax_cache_write(ly_syntax_tree* tree, uint64 key, const char* path);
+/// @brief Loads the tree cached at `path` for `source`, which must have the text it was cached for, into an uninitialized tree.
+/// @details Returns false, leaving the tree uninitialized, if there is no usable cache file: it is missing, truncated, from another cache version, or for another key.
+/// The nodes and extra data are used directly from `mapping`, so loading costs one mapping plus a pass over the string table.
+/// String views refer to the source text and to the mapping, so both must outlive the tree; the mapping is released with `ch_file_unmap`.
+CHOIR_API bool ly_syntax_cache_read(ly_syntax_tree* tree, ch_allocator allocator, ch_source* source, uint64 key, const char* path, ch_mapped_file* mapping);
 
 typedef struct ly_ast_header {
     int dummy;
@@ -68,16 +277,758 @@ typedef struct ly_ast {
     int dummy;
 } ly_ast;
 
+typedef struct ly_syntax_trees {
+    ch_allocator allocator;
+    ly_syntax_tree** items;
+    int64 count, capacity;
+} ly_syntax_trees;
+
 typedef struct ly_module {
     ch_sources sources;
+    /// @brief The syntax tree of each of the module's files, in the order the files were given.
+    /// @details Trees are built independently, each by a single thread into memory owned by its file, and are only read once they have been added here.
+    ly_syntax_trees trees;
 } ly_module;
 
+/// @brief Identifies a declaration known to semantic analysis; 0 is no declaration.
+typedef uint32 ly_decl_id;
+
+/// @brief How many declarations of one name a scope stores inline before moving them out to its overflow storage.
+/// @details Names almost always have a single declaration, and overload sets are rarely larger than this.
+#define LY_SCOPE_INLINE_DECLS 3
+
+/// @brief The declarations of one name within one scope.
+typedef struct ly_scope_entry {
+    /// @brief The declared name, or 0 if the entry is empty; declared names are never empty.
+    ch_atom name;
+    uint16 count;
+    /// @brief Set while every declaration of the name can be overloaded, which only functions can.
+    bool is_overload_set;
+    union {
+        ly_decl_id decls[LY_SCOPE_INLINE_DECLS];
+        /// @brief Where the declarations are in the scope's overflow storage, once there are more than fit inline.
+        struct {
+            uint32 index;
+            uint32 capacity;
+        } overflow;
+    };
+} ly_scope_entry;
+
+typedef struct ly_scope_overflow {
+    ch_allocator allocator;
+    ly_decl_id* items;
+    int64 count, capacity;
+} ly_scope_overflow;
+
+/// @brief A lexical scope, chained to the scope it is nested in.
+/// @details Entries form a flat open-addressing table keyed by name atom, kept at most half full, so a lookup is a multiply and usually a single probe.
+typedef struct ly_scope {
+    struct ly_scope* parent;
+    ch_allocator allocator;
+    ly_scope_entry* entries;
+    /// @brief Zero until the first declaration is added, then always a power of two.
+    int64 capacity;
+    int64 count;
+    ly_scope_overflow overflow;
+} ly_scope;
+
+/// @brief A view of declarations stored in a scope; it is invalidated by adding to that scope.
+typedef struct ly_decl_view {
+    const ly_decl_id* items;
+    int64 count;
+} ly_decl_view;
+
+typedef struct ly_scope_lookup {
+    /// @brief The nearest scope declaring the name, or NULL if no scope does.
+    ly_scope* scope;
+    ly_decl_view decls;
+    bool is_overload_set;
+} ly_scope_lookup;
+
+/// @brief Prepares an empty scope; nothing is allocated until a declaration is added.
+CHOIR_API void ly_scope_init(ly_scope* scope, ch_allocator allocator, ly_scope* parent);
+CHOIR_API void ly_scope_deinit(ly_scope* scope);
+/// @brief Removes every declaration from the scope, keeping its storage for reuse.
+CHOIR_API void ly_scope_clear(ly_scope* scope);
+/// @brief Declares `decl` under `name`, returning false if it conflicts with an earlier declaration of that name.
+/// @details Overloadable declarations are added to the name's overload set when every earlier declaration is overloadable as well.
+/// Any other redeclaration replaces the earlier declarations, so analysis can go on after the conflict is reported.
+/// Adding a declaration which is already in the set does nothing.
+CHOIR_API bool ly_scope_add(ly_scope* scope, ch_atom name, ly_decl_id decl, bool is_overloadable);
+/// @brief Returns the declarations of `name` in this scope alone, without looking at the scopes it is nested in.
+CHOIR_API ly_decl_view ly_scope_lookup_local(ly_scope* scope, ch_atom name);
+/// @brief Finds the nearest scope, starting with `scope` itself, which declares `name`.
+/// @details Nothing is allocated: the declarations are a view into the scope they were found in.
+/// An overload set can continue in enclosing scopes, which a caller collecting every candidate visits by looking up the name again from `result.scope->parent`.
+CHOIR_API ly_scope_lookup ly_scope_lookup_name(ly_scope* scope, ch_atom name);
+
+typedef enum ly_type_kind {
+    LY_TY_INVALID,
+
+    // Simple types have no operands, and each is stored once when the store is created with an id equal to its kind.
+    // Poison is equal to itself like any other type, so checks which must never accept it have to test for it first.
+    LY_TY_POISON,
+    LY_TY_TYPEINFO,
+    LY_TY_NIL,
+    LY_TY_VOID,
+    LY_TY_NORETURN,
+    LY_TY_BOOL,
+    LY_TY_INT,
+    LY_TY_UINT,
+    LY_TY_FFI_BOOL,
+    LY_TY_FFI_CHAR,
+    LY_TY_FFI_SCHAR,
+    LY_TY_FFI_UCHAR,
+    LY_TY_FFI_SHORT,
+    LY_TY_FFI_USHORT,
+    LY_TY_FFI_INT,
+    LY_TY_FFI_UINT,
+    LY_TY_FFI_LONG,
+    LY_TY_FFI_ULONG,
+    LY_TY_FFI_LONGLONG,
+    LY_TY_FFI_ULONGLONG,
+    LY_TY_FFI_FLOAT,
+    LY_TY_FFI_DOUBLE,
+    LY_TY_FFI_LONGDOUBLE,
+    LY_TY_LITERAL_BOOL,
+    LY_TY_LITERAL_INTEGER,
+    LY_TY_LITERAL_FLOAT,
+    LY_TY_LITERAL_STRING,
+
+    // Sized types, whose operand is their bit width.
+    LY_TY_BOOL_SIZED,
+    LY_TY_INT_SIZED,
+    LY_TY_UINT_SIZED,
+    LY_TY_FLOAT_SIZED,
+
+    // Containers of a single element type.
+    LY_TY_POINTER,
+    LY_TY_BUFFER,
+    LY_TY_NILABLE,
+    LY_TY_SLICE,
+    LY_TY_RANGE,
+    LY_TY_ARRAY,
+
+    LY_TY_ERROR_PAIR,
+    LY_TY_FUNCTION,
+
+    // Nominal types, which are equal only to themselves; their operand is the declaration introducing them.
+    LY_TY_STRUCT,
+    LY_TY_ENUM,
+    LY_TY_TEMPLATE_PARAMETER,
+
+    LY_TY_COUNT,
+} ly_type_kind;
+
+#define LY_TY_LAST_SIMPLE LY_TY_LITERAL_STRING
+
+/// @brief Identifies a canonical type in a type store; 0 is no type.
+/// @details Types are hash-consed, so two types are structurally equal exactly when their ids are equal.
+typedef uint32 ly_type_id;
+
+typedef enum ly_type_qualifier {
+    LY_TQ_NONE = 0,
+    LY_TQ_MUTABLE = 1 << 0,
+} ly_type_qualifier;
+
+#define LY_TYPE_QUALIFIER_BITS 2
+
+/// @brief A type id together with its qualifiers, which are stored in the low bits.
+/// @details Equality with identical qualifiers is a compare of the whole value, and equality of the types alone a compare of `ly_qual_type_id` of each.
+typedef uint32 ly_qual_type;
+
+#define ly_qual_type_make(Type, Qualifiers) (cast(ly_qual_type)((Type) << LY_TYPE_QUALIFIER_BITS) | cast(ly_qual_type)(Qualifiers))
+#define ly_qual_type_id(QualType)           (cast(ly_type_id)((QualType) >> LY_TYPE_QUALIFIER_BITS))
+#define ly_qual_type_qualifiers(QualType)   (cast(ly_type_qualifier)((QualType) & ((1u << LY_TYPE_QUALIFIER_BITS) - 1)))
+
+typedef enum ly_calling_convention {
+    LY_CC_LAYE,
+    LY_CC_CDECL,
+    LY_CC_STDCALL,
+    LY_CC_FASTCALL,
+} ly_calling_convention;
+
+typedef enum ly_varargs_kind {
+    LY_VARARGS_NONE,
+    LY_VARARGS_C,
+    LY_VARARGS_LAYE,
+} ly_varargs_kind;
+
+typedef enum ly_type_flag {
+    LY_TF_NONE = 0,
+    /// @brief A buffer type with a terminator value, stored in its extra words.
+    LY_TF_TERMINATED = 1 << 0,
+    /// @brief A function type whose result may be discarded.
+    LY_TF_DISCARDABLE = 1 << 1,
+} ly_type_flag;
+
+typedef enum ly_param_flag {
+    LY_PF_NONE = 0,
+    LY_PF_REF = 1 << 0,
+} ly_param_flag;
+
+/// @brief A canonical type, stored flat the way syntax nodes are.
+typedef struct ly_type {
+    uint8 kind;
+    /// @brief For functions, their calling convention.
+    uint8 calling_convention;
+    /// @brief For functions, their varargs kind.
+    uint8 varargs_kind;
+    uint8 flags;
+    /// @brief The element type of a container, the result type of an error pair, or the return type of a function.
+    ly_qual_type element;
+    /// @brief The bit width of a sized type, the error type of an error pair, the declaration of a nominal type,
+    /// the number of parameters of a function or the number of dimensions of an array.
+    uint32 operand;
+    /// @brief The index of the type's first extra word: an array's lengths, a function's parameters, or a buffer's terminator.
+    /// @details Lengths and terminators take two words each, low word first; each parameter takes two words, its type and its `ly_param_flag`s.
+    uint32 extra;
+} ly_type;
+
+/// @brief Owns every canonical type of a compilation, each stored exactly once.
+/// @details Types are interned through an open-addressing table of type ids keyed by a hash of their kind, operands and extra words,
+/// so building a type which already exists costs one hash and usually one comparison, and comparing two types never walks either of them.
+/// A store may be shared between threads: building types takes the store's lock, while types and their extra words are kept in stable arrays
+/// so reading them never does.
+typedef struct ly_type_store {
+    ch_allocator allocator;
+    ch_mutex mutex;
+    /// @brief Every `ly_type`, indexed by id.
+    ch_stable_array types;
+    /// @brief The extra words of every type, each type's words being contiguous.
+    ch_stable_array extra;
+    /// @brief The table of type ids, 0 marking an empty slot; kept at most half full and only used with the lock held.
+    ly_type_id* slots;
+    /// @brief Always a power of two.
+    int64 slot_count;
+} ly_type_store;
+
+/// @brief A function type's parameter, as passed to `ly_type_function` and returned by `ly_type_function_param`.
+typedef struct ly_type_param {
+    ly_qual_type type;
+    ly_param_flag flags;
+} ly_type_param;
+
+/// @brief Prepares a store holding only the simple types.
+CHOIR_API void ly_type_store_init(ly_type_store* store, ch_allocator allocator);
+CHOIR_API void ly_type_store_deinit(ly_type_store* store);
+CHOIR_API const ly_type* ly_type_get(ly_type_store* store, ly_type_id id);
+
+/// @brief Returns the id of a simple type, which is its kind.
+CHOIR_API ly_type_id ly_type_simple(ly_type_kind kind);
+CHOIR_API ly_type_id ly_type_sized(ly_type_store* store, ly_type_kind kind, uint32 bit_width);
+/// @brief Returns a container type of a single element: a pointer, buffer, nilable, slice or range.
+CHOIR_API ly_type_id ly_type_container(ly_type_store* store, ly_type_kind kind, ly_qual_type element);
+CHOIR_API ly_type_id ly_type_buffer_terminated(ly_type_store* store, ly_qual_type element, uint64 terminator);
+CHOIR_API ly_type_id ly_type_array(ly_type_store* store, ly_qual_type element, const uint64* lengths, int64 dimension_count);
+CHOIR_API ly_type_id ly_type_error_pair(ly_type_store* store, ly_qual_type result, ly_qual_type error);
+CHOIR_API ly_type_id ly_type_function(ly_type_store* store, ly_qual_type return_type, const ly_type_param* params, int64 param_count, ly_calling_convention calling_convention, ly_varargs_kind varargs_kind, ly_type_flag flags);
+/// @brief Returns the type a struct, enum or template parameter declaration introduces.
+CHOIR_API ly_type_id ly_type_nominal(ly_type_store* store, ly_type_kind kind, ly_decl_id decl);
+
+CHOIR_API uint64 ly_type_array_length(ly_type_store* store, ly_type_id array, int64 dimension);
+CHOIR_API uint64 ly_type_buffer_terminator(ly_type_store* store, ly_type_id buffer);
+CHOIR_API ly_type_param ly_type_function_param(ly_type_store* store, ly_type_id function, int64 index);
+
+/// @brief One instantiation of a template: the template declaration, the canonical ids of its arguments, and the declaration instantiated for them.
+typedef struct ly_template_instance {
+    ly_decl_id template_decl;
+    ly_decl_id instance;
+    /// @brief Where the argument types are in the cache's argument words.
+    uint32 args;
+    uint32 arg_count;
+} ly_template_instance;
+
+typedef struct ly_template_instances {
+    ch_allocator allocator;
+    ly_template_instance* items;
+    int64 count, capacity;
+} ly_template_instances;
+
+typedef struct ly_template_args {
+    ch_allocator allocator;
+    ly_type_id* items;
+    int64 count, capacity;
+} ly_template_args;
+
+/// @brief Every template instantiation of a module, so each distinct set of arguments to a template is only instantiated once.
+/// @details Arguments are canonical type ids, so `foo<int>` written anywhere in the module finds the same instantiation.
+/// Instances are found through an open-addressing table of instance indices keyed by a hash of the template and its arguments.
+/// An instance is recorded before it is complete, so that a template which refers to itself finds the instance being made, and is
+/// only visible to other threads once it is published. Finding, adding and publishing instances may be done from any thread; each takes the cache's lock.
+typedef struct ly_template_cache {
+    ch_allocator allocator;
+    ch_mutex mutex;
+    ly_template_instances instances;
+    ly_template_args args;
+    /// @brief How many of `instances`, from the first, are published.
+    int64 published_count;
+    /// @brief One more than the index of an instance, or 0 marking an empty slot; kept at most half full.
+    uint32* slots;
+    /// @brief Always a power of two.
+    int64 slot_count;
+} ly_template_cache;
+
+CHOIR_API void ly_template_cache_init(ly_template_cache* cache, ch_allocator allocator);
+CHOIR_API void ly_template_cache_deinit(ly_template_cache* cache);
+/// @brief Returns the instantiation of `template_decl` for these arguments, or 0 if it has not been instantiated for them yet.
+/// @details Instances added since the last `ly_template_cache_publish` are only found with `include_unpublished`, which only the thread adding them may pass.
+CHOIR_API ly_decl_id ly_template_cache_find(ly_template_cache* cache, ly_decl_id template_decl, const ly_type_id* args, int64 arg_count, bool include_unpublished);
+/// @brief Records the instantiation of `template_decl` for these arguments, which must not have been recorded yet.
+CHOIR_API void ly_template_cache_add(ly_template_cache* cache, ly_decl_id template_decl, const ly_type_id* args, int64 arg_count, ly_decl_id instance);
+/// @brief Makes every instance added so far visible to `ly_template_cache_find`.
+CHOIR_API void ly_template_cache_publish(ly_template_cache* cache);
+
+typedef enum ly_constant_kind {
+    LY_CK_INVALID,
+    LY_CK_BOOL,
+    LY_CK_INTEGER,
+    LY_CK_RANGE,
+} ly_constant_kind;
+
+/// @brief A constant integer, kept as a native 64-bit value for as long as it fits.
+/// @details Only a value outside the signed 64-bit range is promoted to a 256-bit two's complement `ch_wide_int`, and results which fit
+/// again are demoted, so the common case never touches the wide arithmetic. Neither form allocates.
+typedef struct ly_constant_integer {
+    bool is_wide;
+    int64 value;
+    ch_wide_int wide;
+} ly_constant_integer;
+
+/// @brief The value of a constant expression.
+typedef struct ly_constant {
+    uint8 kind;
+    bool bool_value;
+    /// @brief The value of an integer, or the beginning of a range.
+    ly_constant_integer integer;
+    /// @brief The exclusive end of a range.
+    ly_constant_integer range_end;
+} ly_constant;
+
+/// @brief Answers a query expression such as `sizeof(T)` for the constant evaluator, returning false, having reported why, if it has no constant value.
+typedef bool (*ly_constant_query_fn)(void* userdata, ly_syntax_id query, ly_constant* out_constant);
+
+/// @brief Evaluates a constant expression, returning false if it is not one.
+/// @details Every problem is reported, whether the expression is not constant or its arithmetic overflows 256 bits or divides by zero.
+/// Queries are passed to `query`, which knows about types and layouts; without one, a query is not constant.
+/// `allocator` is only used if the expression is nested more deeply than a small fixed stack allows.
+CHOIR_API bool ly_constant_evaluate(ch_context* context, ch_allocator allocator, ly_syntax_tree* tree, ly_syntax_id id, ly_constant_query_fn query, void* userdata, ly_constant* out_constant);
+/// @brief Returns true, storing the value in `out_value`, if the integer is not negative and fits in 64 bits.
+CHOIR_API bool ly_constant_integer_to_uint64(ly_constant_integer integer, uint64* out_value);
+
+/// @brief How an argument converts to its parameter's type, from best to worst.
+typedef enum ly_conversion {
+    LY_CONV_EXACT,
+    /// @brief An untyped literal taking on the parameter's type.
+    LY_CONV_LITERAL,
+    /// @brief Between two integer types, or two float types.
+    LY_CONV_NUMERIC,
+    /// @brief Any other conversion, including from an argument whose type is not known yet; whether it is allowed is left to type checking.
+    LY_CONV_OTHER,
+    /// @brief An argument passed through C varargs.
+    LY_CONV_VARARGS,
+} ly_conversion;
+
+/// @brief The function an overload set resolved to for one tuple of argument types.
+typedef struct ly_overload_resolution {
+    /// @brief The first declaration of the overload set, which identifies it.
+    ly_decl_id overload_set;
+    ly_decl_id chosen;
+    /// @brief Where the argument types are in the cache's words, followed by the `ly_conversion` of each argument.
+    uint32 args;
+    uint32 arg_count;
+} ly_overload_resolution;
+
+typedef struct ly_overload_resolutions {
+    ch_allocator allocator;
+    ly_overload_resolution* items;
+    int64 count, capacity;
+} ly_overload_resolutions;
+
+typedef struct ly_overload_words {
+    ch_allocator allocator;
+    uint32* items;
+    int64 count, capacity;
+} ly_overload_words;
+
+/// @brief Remembers which overload every call resolved to, keyed by the overload set and the canonical types of its arguments.
+/// @details Calls to the same set with the same argument types, such as every `printf` with a format string and an int, resolve
+/// the same way, so only the first has its candidates ranked and the rest find the chosen function and its conversions here.
+/// Finding and adding resolutions may be done from any thread; both take the cache's lock.
+typedef struct ly_overload_cache {
+    ch_allocator allocator;
+    ch_mutex mutex;
+    ly_overload_resolutions resolutions;
+    ly_overload_words words;
+    /// @brief One more than the index of a resolution, or 0 marking an empty slot; kept at most half full.
+    uint32* slots;
+    /// @brief Always a power of two.
+    int64 slot_count;
+} ly_overload_cache;
+
+CHOIR_API void ly_overload_cache_init(ly_overload_cache* cache, ch_allocator allocator);
+CHOIR_API void ly_overload_cache_deinit(ly_overload_cache* cache);
+/// @brief Returns the function an overload set resolved to for these argument types, copying the conversion of each argument
+/// to `out_conversions`, or returns 0 if it has not been resolved for them yet.
+CHOIR_API ly_decl_id ly_overload_cache_find(ly_overload_cache* cache, ly_decl_id overload_set, const ly_type_id* arg_types, int64 arg_count, ly_conversion* out_conversions);
+/// @brief Records the function an overload set resolved to for these argument types. A resolution recorded first by another thread is kept.
+CHOIR_API void ly_overload_cache_add(ly_overload_cache* cache, ly_decl_id overload_set, const ly_type_id* arg_types, int64 arg_count, ly_decl_id chosen, const ly_conversion* conversions);
+
+typedef enum ly_layout_state {
+    /// @brief The layout is being computed; reaching it again in this state means the struct contains itself.
+    LY_LS_COMPUTING,
+    LY_LS_COMPUTED,
+    /// @brief The struct has no layout because one of its fields has none, which has already been reported.
+    LY_LS_INVALID,
+} ly_layout_state;
+
+/// @brief Where one field is placed, in bytes from the start of its struct.
+typedef struct ly_field_layout {
+    ch_atom name;
+    ly_qual_type type;
+    ch_size offset;
+} ly_field_layout;
+
+/// @brief The size, alignment and field offsets of one struct type.
+/// @details The struct's own fields come first, in declaration order, followed by the fields of each of its variants, depth first.
+/// A variant's fields start where its parent's end, so every variant overlaps the others, and the struct is as large as its largest variant.
+typedef struct ly_struct_layout {
+    ly_type_id type;
+    uint8 state;
+    ch_layout layout;
+    ly_field_layout* fields;
+    int64 field_count;
+} ly_struct_layout;
+
+/// @brief The layout of every struct in a module, each computed once for the cache's target, the first time anything needs it.
+/// @details Layouts are found through an open-addressing table of layout indices keyed by struct type, and are kept in a stable array so a
+/// layout, once found, can be read without the lock. Finding and adding layouts takes the cache's lock, but computing one does not:
+/// a struct is only ever reachable from another thread once its layout has been computed.
+typedef struct ly_layout_cache {
+    ch_allocator allocator;
+    ch_mutex mutex;
+    const ch_target* target;
+    /// @brief Every `ly_struct_layout`.
+    ch_stable_array layouts;
+    /// @brief One more than the index of a layout, or 0 marking an empty slot; kept at most half full.
+    uint32* slots;
+    /// @brief Always a power of two.
+    int64 slot_count;
+} ly_layout_cache;
+
+CHOIR_API void ly_layout_cache_init(ly_layout_cache* cache, ch_allocator allocator, const ch_target* target);
+CHOIR_API void ly_layout_cache_deinit(ly_layout_cache* cache);
+/// @brief Returns the layout recorded for a struct type, or NULL if its computation has not started.
+CHOIR_API ly_struct_layout* ly_layout_cache_find(ly_layout_cache* cache, ly_type_id struct_type);
+/// @brief Records that the layout of a struct type is being computed, returning the entry its computation fills in.
+CHOIR_API ly_struct_layout* ly_layout_cache_add(ly_layout_cache* cache, ly_type_id struct_type);
+
+/// @brief Bumped whenever the layout of module files changes, so stale files are never read.
+#define LY_MODULE_FILE_VERSION 2
+
+/// @brief An entry of a module file's symbol index, naming the declaration with the same index in the file.
+/// @details Entries are sorted by hash and then by name, so the declarations of one name are contiguous and found with a binary search.
+typedef struct ly_module_symbol {
+    uint64 hash;
+    /// @brief Where the name is in the file's string bytes.
+    uint32 name;
+    uint32 name_length;
+} ly_module_symbol;
+
+/// @brief A declaration as stored in a module file.
+/// @details Types are indices into the file's own type table, qualified the way `ly_qual_type` is, with 0 as no type.
+typedef struct ly_module_decl {
+    uint8 kind;
+    uint8 reserved[3];
+    uint32 name;
+    uint32 name_length;
+    ly_qual_type type;
+    /// @brief For a struct, where its fields are in the file's field table, in the order of its layout.
+    uint32 fields;
+    uint32 field_count;
+    /// @brief For a struct, its layout on the target the module was compiled for.
+    ch_layout layout;
+} ly_module_decl;
+
+/// @brief An instantiation of an exported template as stored in a module file, so a dependent module uses it rather than instantiating the template again.
+/// @details Instances are keyed by the template's exported name, never by a declaration id, and are sorted by hash and then by name the way
+/// symbols are, so the instances of one template are contiguous and found with a binary search.
+typedef struct ly_module_instance {
+    /// @brief The name of the template, as its symbol has it.
+    ly_module_symbol template_name;
+    /// @brief Where the argument types are in the file's extra words.
+    uint32 args;
+    uint32 arg_count;
+    /// @brief The declaration the template was instantiated to, which is not exported under a symbol of its own.
+    uint32 decl;
+    uint32 reserved;
+} ly_module_instance;
+
+/// @brief A struct field as stored in a module file.
+typedef struct ly_module_field {
+    uint32 name;
+    uint32 name_length;
+    ly_qual_type type;
+    uint32 reserved;
+    ch_size offset;
+} ly_module_field;
+
+/// @brief A module file mapped for lazy loading.
+/// @details A module file holds the exported declarations of one compiled module, and is laid out so an importer never decodes it whole.
+/// The file is mapped rather than read, and every array in it is aligned for use in place, so opening one only checks its header and
+/// copies nothing: the symbol index, names, declarations, fields, types and template instances are all views into the mapping, paged in as lookups touch them.
+/// A type is stored as a `ly_type` whose element, error and parameter types are file type indices and whose nominal operand is a file
+/// declaration index. Records are checked as they are returned, so a damaged file fails a lookup rather than producing nonsense.
+/// Nothing in the file is written once it is open, so it may be read from any thread.
+typedef struct ly_module_file {
+    ch_mapped_file mapping;
+    /// @brief The name the module was compiled as, and the name of the target it was compiled for.
+    const char* name;
+    int64 name_length;
+    const char* target;
+    int64 target_length;
+    const ly_module_symbol* symbols;
+    int64 symbol_count;
+    const char* strings;
+    int64 string_size;
+    const ly_module_decl* decls;
+    int64 decl_count;
+    const ly_module_field* fields;
+    int64 field_count;
+    const ly_type* types;
+    int64 type_count;
+    const ly_module_instance* instances;
+    int64 instance_count;
+    const uint32* extra;
+    int64 extra_count;
+} ly_module_file;
+
+/// @brief Maps a module file, returning false if there is no usable file: it is missing, truncated or from another module file version.
+CHOIR_API bool ly_module_file_open(ly_module_file* file, const char* path);
+CHOIR_API void ly_module_file_close(ly_module_file* file);
+/// @brief Returns how many declarations the module exports under `name`, storing the index of the first in `out_first`.
+CHOIR_API int64 ly_module_file_find(ly_module_file* file, const char* name, int64 length, uint32* out_first);
+/// @brief Returns a declaration record, or NULL if there is no such record or it is damaged. Records point into the mapping.
+CHOIR_API const ly_module_decl* ly_module_file_decl(ly_module_file* file, uint32 index);
+CHOIR_API const ly_module_field* ly_module_file_field(ly_module_file* file, uint32 index);
+CHOIR_API const ly_type* ly_module_file_type(ly_module_file* file, uint32 index);
+/// @brief Returns how many instantiations of the template exported under `name` the module made, storing the index of the first in `out_first`.
+CHOIR_API int64 ly_module_file_find_instances(ly_module_file* file, const char* name, int64 length, uint32* out_first);
+/// @brief Returns an instance record, or NULL if there is no such record or it is damaged, including when one of its argument types is.
+CHOIR_API const ly_module_instance* ly_module_file_instance(ly_module_file* file, uint32 index);
+/// @brief Returns `count` of the file's extra words starting at `index`, or NULL if the file does not have them.
+CHOIR_API const uint32* ly_module_file_extra(ly_module_file* file, uint32 index, int64 count);
+
+typedef enum ly_decl_kind {
+    LY_DK_INVALID,
+    LY_DK_IMPORT,
+    LY_DK_BINDING,
+    LY_DK_FUNCTION,
+    LY_DK_PARAM,
+    LY_DK_STRUCT,
+    LY_DK_ENUM,
+    LY_DK_ALIAS,
+    LY_DK_TEMPLATE,
+    /// @brief A template's parameter, whose type is the parameter itself within the template and the argument it was given within an instance.
+    LY_DK_TEMPLATE_PARAM,
+} ly_decl_kind;
+
+/// @brief How far a declaration's type has been resolved.
+typedef enum ly_decl_state {
+    LY_DS_UNRESOLVED,
+    /// @brief Resolution has started but not finished; finding a declaration in this state again means it depends on itself.
+    LY_DS_RESOLVING,
+    LY_DS_RESOLVED,
+} ly_decl_state;
+
+/// @brief A declaration known to semantic analysis, referring back to the syntax which declared it.
+/// @details Declarations are resolved on demand: the first time something needs a declaration's type it is resolved and the result kept,
+/// so a declaration nothing uses costs no more than adding its name to a scope.
+typedef struct ly_decl {
+    uint8 kind;
+    uint8 state;
+    /// @brief `ly_decl_flag` bits.
+    uint8 flags;
+    ch_atom name;
+    /// @brief The index of the declaring syntax tree in its module, or `LY_DECL_IMPORTED` with the index of the import it was decoded from.
+    uint32 tree;
+    /// @brief The declaring syntax node, or for an imported declaration its index in the module file.
+    ly_syntax_id syntax;
+    /// @brief The type of a binding or parameter, the type of a function, the type a struct or enum introduces, or the type an alias names.
+    /// @details 0 while unknown, such as for a binding whose type is inferred from its initializer.
+    /// A template has the type of the declaration it is a pattern for, in terms of its parameters, or the poison type if that is invalid.
+    ly_qual_type type;
+} ly_decl;
+
+#define LY_DECL_IMPORTED (1u << 31)
+
+typedef enum ly_decl_flag {
+    LY_DF_NONE = 0,
+    /// @brief An instance whose arguments refer to the parameters of another template, made while resolving that template's pattern.
+    /// @details A dependent struct has no layout and a dependent instance is never written to a module file.
+    LY_DF_DEPENDENT = 1 << 0,
+} ly_decl_flag;
+
+typedef struct ly_decl_ids {
+    ch_allocator allocator;
+    ly_decl_id* items;
+    int64 count, capacity;
+} ly_decl_ids;
+
+/// @brief A module file imported by the module being analysed, and which of its records have been decoded.
+typedef struct ly_sema_import {
+    ly_module_file* file;
+    /// @brief Set once an import declaration names the module; its declarations are not visible until then.
+    bool is_imported;
+    /// @brief The declaration each of the file's declarations decoded to, or 0 until something looks it up.
+    /// @details Both tables are NULL until the first lookup which finds something in the module.
+    ly_decl_id* decls;
+    /// @brief The type each of the file's types decoded to, or 0 until a decoded declaration uses it.
+    ly_type_id* types;
+} ly_sema_import;
+
+typedef struct ly_sema_imports {
+    ch_allocator allocator;
+    ly_sema_import* items;
+    int64 count, capacity;
+} ly_sema_imports;
+
+/// @brief A function whose body is analysed, and the scope its body is in: the scope of a template's parameters, or NULL for the module scope.
+typedef struct ly_sema_function {
+    ly_decl_id decl;
+    ly_scope* scope;
+} ly_sema_function;
+
+typedef struct ly_sema_functions {
+    ch_allocator allocator;
+    ly_sema_function* items;
+    int64 count, capacity;
+} ly_sema_functions;
+
+/// @brief The state of semantic analysis of one module.
+/// @details Analysis runs in two phases. Declarations and their signatures are analysed on one thread, after which everything they
+/// introduced is only read. Function bodies are then analysed in parallel, one job per body, each reporting its diagnostics to a context
+/// of its own which is merged into the module's context in declaration order, so the output does not depend on scheduling.
+/// Declarations and types created while bodies are analysed go into stores which are safe to share between jobs.
+typedef struct ly_sema {
+    ch_context* context;
+    ly_module* module;
+    ch_allocator allocator;
+
+    /// @brief Every name in the module, interned before any body is analysed so that the table is only read while jobs run.
+    ch_atom_table atoms;
+    /// @brief For each syntax tree of the module, the atom of each of its strings, by string index.
+    ch_atom** tree_atoms;
+
+    ly_type_store types;
+    ly_overload_cache overloads;
+    ly_layout_cache layouts;
+    /// @brief Every instantiation of the module's own templates; instances of imported ones are found in their module files.
+    /// @details Instances are made when something first names them, which may be from a body job; `instantiate_mutex` is held from the
+    /// outermost instantiation until its instances, and any they instantiated in turn, are complete and published.
+    ly_template_cache templates;
+    ch_mutex instantiate_mutex;
+
+    /// @brief Every `ly_decl`, indexed by id; id 0 is the absent declaration. Appending takes `decls_mutex`, reading never does.
+    ch_stable_array decls;
+    ch_mutex decls_mutex;
+
+    /// @brief The top level declarations of every file in the module.
+    ly_scope module_scope;
+    /// @brief The same declarations in declaration order, which is the order a module file exports them in.
+    ly_decl_ids module_decls;
+    /// @brief Every function with a body, in declaration order, including the pattern of each function template.
+    /// @details A template's body is analysed once, in terms of its parameters, rather than once for each instance.
+    ly_sema_functions functions;
+
+    /// @brief Module files which imports are resolved against. A name not declared in the module is looked up in each imported one,
+    /// and only the declarations of that name are decoded, the first time they are needed. Decoding takes `imports_mutex`.
+    ly_sema_imports imports;
+    ch_mutex imports_mutex;
+    /// @brief What is decoded from module files which is not kept in a store: each import's decoded ids, and scratch for decoding.
+    /// Only used with `imports_mutex` held.
+    ch_arena imports_arena;
+    /// @brief The scope imported declarations are reported as found in; it never declares anything itself.
+    ly_scope import_scope;
+} ly_sema;
+
+CHOIR_API void ly_sema_init(ly_sema* sema, ch_context* context, ly_module* module, ch_allocator allocator);
+CHOIR_API void ly_sema_deinit(ly_sema* sema);
+/// @brief Interns every string of the module's syntax trees, which `ly_sema_analyse` otherwise does first thing.
+/// @details Past this, analysis only reads the trees' nodes, so a driver can release their strings, the tokens and the source text
+/// (see `ly_syntax_tree_release_strings` and `ch_source_release`) before the rest of the analysis runs rather than after it.
+CHOIR_API void ly_sema_intern_strings(ly_sema* sema);
+/// @brief Analyses the module, running the function body phase on `pool`. Problems are reported to the sema's context.
+CHOIR_API void ly_sema_analyse(ly_sema* sema, ch_thread_pool* pool);
+/// @brief Adds a declaration, returning its id. May be called from any thread.
+CHOIR_API ly_decl_id ly_sema_decl_add(ly_sema* sema, ly_decl decl);
+CHOIR_API ly_decl* ly_sema_decl_get(ly_sema* sema, ly_decl_id id);
+/// @brief Returns true, storing the type's size and alignment on the sema's target in `out_layout`, if the type has a layout.
+/// @details Poison, literal and template parameter types have none, and neither does a struct whose layout could not be computed or
+/// which is made of a template's parameters.
+/// Every struct's layout is computed while the module is analysed, so this only reads the layout cache once analysis is done.
+CHOIR_API bool ly_sema_type_layout(ly_sema* sema, ly_type_id type, ch_layout* out_layout);
+/// @brief Returns the layout of a struct type, or NULL if it could not be computed.
+CHOIR_API const ly_struct_layout* ly_sema_struct_layout(ly_sema* sema, ly_type_id struct_type);
+/// @brief Makes a module file available to the module's imports. The file must stay open until the sema is deinitialized.
+CHOIR_API void ly_sema_add_import(ly_sema* sema, ly_module_file* file);
+
+/// @brief Writes the top level declarations of an analysed module to a module file named `name`, returning false if it cannot be written.
+/// @details Types the declarations use are written with them, along with any declaration those types name, such as an imported struct,
+/// so the file is complete without the modules it imported. Every instance of an exported template the module made is written too, so that
+/// importers use those instead of instantiating the template themselves. The file is written to a temporary path first and then moved into place.
+CHOIR_API bool ly_module_file_write(ly_sema* sema, const char* name, const char* path);
+
 typedef enum ly_lex_flag {
     LY_LEX_NONE = 0,
     LY_LEX_PRESERVE_TRIVIA = 1 << 0,
 } ly_lex_flag;
 
+/// @brief The number of tokens a streaming lexer can hold for lookahead.
+/// @details Must be a power of two, since it is used to mask indices into the lookahead ring buffer.
+/// It also bounds how far the parser can look to tell template arguments from a comparison, so nested argument lists need more than a handful of tokens.
+#define LY_LEXER_LOOKAHEAD 16
+
+/// @brief Pull-based lexer state for reading Laye tokens on demand.
+/// @details Tokens are read lazily into a fixed ring buffer, so a consumer which only needs a bounded amount of lookahead never holds more than `LY_LEXER_LOOKAHEAD` tokens in memory at once.
+/// The token allocator is only used for trivia when `LY_LEX_PRESERVE_TRIVIA` is requested; otherwise the streaming lexer does not allocate at all.
+typedef struct ly_lexer {
+    ch_context* context;
+    ch_source* source;
+    ch_allocator token_allocator;
+    ly_lex_flag flags;
+
+    /// @brief The offset in the source text of the next character to be lexed.
+    int64 position;
+
+    /// @brief Tokens which have been lexed but not yet consumed, oldest first starting at `lookahead_start`.
+    ly_token lookahead[LY_LEXER_LOOKAHEAD];
+    int64 lookahead_start;
+    int64 lookahead_count;
+} ly_lexer;
+
+/// @brief Prepares a streaming lexer to read tokens from the given source.
+/// @details No tokens are read until one is requested with `ly_lexer_peek` or `ly_lexer_next`.
+CHOIR_API void ly_lexer_init(ly_lexer* lexer, ch_context* context, ch_source* source, ch_allocator token_allocator, ly_lex_flag flags);
+/// @brief Returns the token `ahead` tokens past the next one, lexing more of the source as needed.
+/// @details `ahead` must be less than `LY_LEXER_LOOKAHEAD`.
+/// The returned pointer refers to lexer storage and is only valid until the next call to `ly_lexer_next`.
+/// Peeking past the end of the source always yields the EOF token.
+CHOIR_API ly_token* ly_lexer_peek(ly_lexer* lexer, int64 ahead);
+/// @brief Consumes and returns the next token from the source.
+/// @details Once the end of the source has been reached, every subsequent call returns another EOF token.
+CHOIR_API ly_token ly_lexer_next(ly_lexer* lexer);
+
+/// @brief Lexes an entire source text, returning its tokens as a list allocated with the token allocator.
+/// @details The list always ends with an EOF token.
 CHOIR_API ly_token* ly_lex(ch_context* context, ch_source* source, ch_allocator token_allocator, ly_lex_flag flags);
+/// @brief Updates a token list previously produced by `ly_lex` to reflect an edit of its source text.
+/// @details `source` must already contain the edited text (see `ch_source_apply_edit`), while `tokens` still describe the text as it was before the edit.
+/// Lexing restarts from the last token known to be unaffected by the edit and stops as soon as the new tokens line up with the old ones again, at which point the remainder of the old list is reused with its locations shifted.
+/// Every reused token is rebased onto the new source text, so the previous text is no longer referenced once this returns.
+/// Tokens which were replaced are not freed, since the token allocator is typically an arena.
+/// `flags` must match the flags the list was originally lexed with.
+CHOIR_API ly_token* ly_relex(ch_context* context, ch_source* source, ly_token* tokens, ch_source_edit edit, ch_allocator token_allocator, ly_lex_flag flags);
 
 #if defined(__cplusplus)
 }
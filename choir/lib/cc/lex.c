@@ -1 +1,481 @@
 #include <cc/cc.h>
+#include <string.h>
+
+struct lexer {
+    ch_context* context;
+    ch_source* source;
+    ch_allocator token_allocator;
+
+    bool preserve_trivia : 1;
+
+    int64 position;
+};
+
+static cc_token* cc_read_token(struct lexer* l);
+
+CHOIR_API cc_token* cc_lex(ch_context* context, ch_source* source, ch_allocator token_allocator, cc_lex_flag flags) {
+    struct lexer lexer = {
+        .context = context,
+        .source = source,
+        .token_allocator = token_allocator,
+    };
+
+    lexer.preserve_trivia = 0 != (flags & CC_LEX_PRESERVE_TRIVIA);
+    discard ch_source_validate_utf8(context, source);
+
+    cc_token* result = NULL;
+    cc_token* previous = NULL;
+
+    while (true) {
+        cc_token* token = cc_read_token(&lexer);
+        if (result == NULL) {
+            result = token;
+        } else {
+            assert(previous != NULL && "where is previous");
+            previous->next = token;
+        }
+
+        previous = token;
+        if (token->kind == CC_TK_EOF) {
+            break;
+        }
+    }
+
+    assert(result != NULL && "did not read any tokens; at least EOF should have been read.");
+    assert(lexer.position >= lexer.source->length && "did not consume enough characters from the source text.");
+
+    return result;
+}
+
+static char lexer_peek(struct lexer* l, int64 ahead) {
+    assert(l != NULL && "where is the lexer?");
+    assert(l->source != NULL && "where is the source?");
+    assert(ahead >= 0 && "cannot peek backwards");
+
+    int64 position = l->position + ahead;
+    if (position >= l->source->length) {
+        return 0;
+    }
+
+    return l->source->text[position];
+}
+
+static char lexer_current(struct lexer* l) {
+    return lexer_peek(l, 0);
+}
+
+static void lexer_advance(struct lexer* l) {
+    if (l->position >= l->source->length) return;
+    l->position++;
+}
+
+static bool lexer_try_advance(struct lexer* l, char c) {
+    if (lexer_current(l) != c || l->position >= l->source->length) return false;
+    lexer_advance(l);
+    return true;
+}
+
+enum {
+    CC_CHAR_IDENTIFIER_START = 1 << 0,
+    CC_CHAR_IDENTIFIER_CONTINUE = 1 << 1,
+    CC_CHAR_DIGIT = 1 << 2,
+};
+
+// classifies ASCII bytes in a single load; bytes 0x80 and above are left unclassified and go through the Unicode tables.
+static const uint8 cc_char_classes[256] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 0x00
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 0x10
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 0x20
+    6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 0, 0, 0, 0, 0, 0, // 0x30 '0'-'9'
+    0, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, // 0x40 'A'-'O'
+    3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 0, 0, 0, 0, 3, // 0x50 'P'-'Z', '_'
+    0, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, // 0x60 'a'-'o'
+    3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 0, 0, 0, 0, 0, // 0x70 'p'-'z'
+};
+
+static bool cc_is_digit(char c) {
+    return 0 != (cc_char_classes[cast(uint8) c] & CC_CHAR_DIGIT);
+}
+
+static bool cc_is_identifier_start(char c) {
+    return 0 != (cc_char_classes[cast(uint8) c] & CC_CHAR_IDENTIFIER_START);
+}
+
+static bool cc_is_identifier_char(char c) {
+    return 0 != (cc_char_classes[cast(uint8) c] & CC_CHAR_IDENTIFIER_CONTINUE);
+}
+
+// returns the byte length of the Unicode identifier character at the current position, or 0 if there isn't one.
+static int cc_unicode_identifier_char_length(struct lexer* l, bool is_start) {
+    uint32 code_point = 0;
+    int count = ch_utf8_decode(l->source->text + l->position, l->source->length - l->position, &code_point);
+    if (count == 0) return 0;
+
+    bool is_identifier_char = is_start ? ch_unicode_is_xid_start(code_point) : ch_unicode_is_xid_continue(code_point);
+    return is_identifier_char ? count : 0;
+}
+
+static bool cc_try_read_trivium(struct lexer* l, cc_token** out_trivia, bool* consumed_tailing_terminal) {
+    cc_token* trivia = NULL;
+
+    int64 start_position = l->position;
+    cc_token_kind kind = CC_TK_EOF;
+    char c = lexer_current(l);
+
+    switch (c) {
+        default: break;
+        case ' ':
+        case '\t':
+        case '\r':
+        case '\v':
+        case '\f': {
+            lexer_advance(l);
+            while ((c = lexer_current(l)), (c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f')) {
+                lexer_advance(l);
+            }
+
+            kind = CC_TK_WHITE_SPACE;
+        } break;
+
+        case '\\': {
+            // line splices are only meaningful to the preprocessor's notion of lines, so treat them as white space.
+            int64 ahead = 1;
+            if (lexer_peek(l, ahead) == '\r') ahead++;
+            if (lexer_peek(l, ahead) != '\n') break;
+
+            l->position += ahead + 1;
+            kind = CC_TK_WHITE_SPACE;
+        } break;
+
+        case '\n': {
+            lexer_advance(l);
+            kind = CC_TK_NEW_LINE;
+            *consumed_tailing_terminal = true;
+        } break;
+
+        case '/': {
+            if (lexer_peek(l, 1) == '/') {
+                while (l->position < l->source->length && lexer_current(l) != '\n') {
+                    lexer_advance(l);
+                }
+
+                kind = CC_TK_COMMENT_LINE;
+            } else if (lexer_peek(l, 1) == '*') {
+                lexer_advance(l);
+                lexer_advance(l);
+
+                while (l->position < l->source->length && !(lexer_current(l) == '*' && lexer_peek(l, 1) == '/')) {
+                    lexer_advance(l);
+                }
+
+                if (l->position >= l->source->length) {
+                    ch_diag(l->context, CH_DIAG_ERROR, (ch_location){l->source, start_position, 2}, "unterminated /* comment");
+                } else {
+                    lexer_advance(l);
+                    lexer_advance(l);
+                }
+
+                kind = CC_TK_COMMENT_DELIMITED;
+            }
+        } break;
+    }
+
+    if (kind != CC_TK_EOF && l->preserve_trivia) {
+        trivia = ch_alloc(l->token_allocator, sizeof *trivia);
+        memset(trivia, 0, sizeof *trivia);
+        trivia->kind = kind;
+    }
+
+    *out_trivia = trivia;
+    if (trivia != NULL) {
+        trivia->lexeme_begin = l->source->text + start_position;
+        trivia->lexeme_length = l->position - start_position;
+
+        trivia->location.source = l->source;
+        trivia->location.offset = start_position;
+        trivia->location.length = l->position - start_position;
+    }
+
+    return l->position > start_position;
+}
+
+static void cc_read_trivia(struct lexer* l, cc_token** trivia, bool is_trailing) {
+    cc_token* current_trivia = NULL;
+    cc_token* previous_trivia = NULL;
+
+    bool consumed_tailing_terminal = false;
+    while (cc_try_read_trivium(l, &current_trivia, &consumed_tailing_terminal)) {
+        if (l->preserve_trivia) {
+            if (*trivia == NULL) {
+                *trivia = current_trivia;
+            } else {
+                previous_trivia->next = current_trivia;
+            }
+
+            previous_trivia = current_trivia;
+        }
+
+        if (is_trailing && consumed_tailing_terminal) {
+            break;
+        }
+    }
+}
+
+static void cc_read_identifier(struct lexer* l, cc_token* token) {
+    int64 start_position = l->position;
+    token->kind = CC_TK_IDENT;
+
+    while (true) {
+        while (cc_is_identifier_char(lexer_current(l))) {
+            lexer_advance(l);
+        }
+
+        if (cast(uint8) lexer_current(l) < 0x80) break;
+
+        int count = cc_unicode_identifier_char_length(l, l->position == start_position);
+        if (count == 0) break;
+        l->position += count;
+    }
+
+    assert(l->position > start_position && "the lexer was instructed to read a C identifier, but the current character cannot start an identifier");
+}
+
+// reads a preprocessing number, which is deliberately more permissive than any actual numeric literal.
+static void cc_read_pp_number(struct lexer* l, cc_token* token) {
+    token->kind = CC_TK_CPP_NUMBER;
+
+    if (lexer_current(l) == '.') lexer_advance(l);
+    assert(cc_is_digit(lexer_current(l)) && "the lexer was instructed to read a C preprocessing number, but the current character cannot start one");
+
+    while (true) {
+        char c = lexer_current(l);
+        if ((c == 'e' || c == 'E' || c == 'p' || c == 'P') && (lexer_peek(l, 1) == '+' || lexer_peek(l, 1) == '-')) {
+            lexer_advance(l);
+            lexer_advance(l);
+        } else if (c == '\'' && cc_is_identifier_char(lexer_peek(l, 1))) {
+            lexer_advance(l);
+            lexer_advance(l);
+        } else if (cc_is_identifier_char(c) || c == '.') {
+            lexer_advance(l);
+        } else {
+            break;
+        }
+    }
+}
+
+static void cc_read_quoted(struct lexer* l, cc_token* token, char delimiter) {
+    int64 start_position = l->position;
+    token->kind = delimiter == '"' ? CC_TK_LITERAL_STRING : CC_TK_LITERAL_CHAR;
+
+    while (l->position < l->source->length && lexer_current(l) != delimiter) {
+        lexer_advance(l);
+    }
+
+    assert(lexer_current(l) == delimiter && "the lexer was instructed to read a quoted C literal, but could not find its opening delimiter");
+    lexer_advance(l);
+
+    char c;
+    while ((c = lexer_current(l)), c != delimiter && c != '\n' && l->position < l->source->length) {
+        if (c == '\\' && lexer_peek(l, 1) != 0) {
+            lexer_advance(l);
+        }
+
+        lexer_advance(l);
+    }
+
+    if (lexer_try_advance(l, delimiter)) {
+        return;
+    }
+
+    const char* what = delimiter == '"' ? "string" : "character";
+    ch_diag(l->context, CH_DIAG_ERROR, (ch_location){l->source, start_position, 1}, "missing terminating %c character in %s literal", delimiter, what);
+}
+
+static bool cc_is_quote_prefix(struct lexer* l, int64 length) {
+    char quote = lexer_peek(l, length);
+    if (quote != '"' && quote != '\'') return false;
+
+    const char* text = l->source->text + l->position;
+    switch (length) {
+        default: return false;
+        case 1: return text[0] == 'L' || text[0] == 'u' || text[0] == 'U';
+        case 2: return text[0] == 'u' && text[1] == '8';
+    }
+}
+
+static cc_token* cc_read_token(struct lexer* l) {
+    cc_token* token = ch_alloc(l->token_allocator, sizeof *token);
+    memset(token, 0, sizeof *token);
+    cc_read_trivia(l, &token->leading_trivia, false);
+
+    int64 start_position = l->position;
+    char c = lexer_current(l);
+
+    switch (c) {
+        default: {
+            if (cc_is_identifier_start(c) || (cast(uint8) c >= 0x80 && cc_unicode_identifier_char_length(l, true) > 0)) {
+                int64 length = 0;
+                while (length < 2 && cc_is_identifier_char(lexer_peek(l, length))) length++;
+                if (cc_is_quote_prefix(l, length) || cc_is_quote_prefix(l, 1)) {
+                    cc_read_quoted(l, token, lexer_peek(l, cc_is_quote_prefix(l, 1) ? 1 : 2));
+                } else {
+                    cc_read_identifier(l, token);
+                }
+
+                break;
+            }
+
+            token->kind = CC_TK_INVALID;
+            uint32 code_point = 0;
+            int count = ch_utf8_decode(l->source->text + l->position, l->source->length - l->position, &code_point);
+            l->position += count == 0 ? 1 : count;
+            ch_diag(l->context, CH_DIAG_ERROR, (ch_location){l->source, start_position, l->position - start_position}, "invalid character '%.*s' in C source", cast(int)(l->position - start_position), l->source->text + start_position);
+        } break;
+
+        case 0: {
+            if (l->position < l->source->length) {
+                lexer_advance(l);
+                token->kind = CC_TK_INVALID;
+                ch_diag(l->context, CH_DIAG_ERROR, (ch_location){l->source, start_position, 1}, "invalid NUL character in C source");
+                break;
+            }
+
+            token->kind = CC_TK_EOF;
+        } break;
+
+        case '0': case '1': case '2': case '3': case '4':
+        case '5': case '6': case '7': case '8': case '9': {
+            cc_read_pp_number(l, token);
+        } break;
+
+        case '"':
+        case '\'': {
+            cc_read_quoted(l, token, c);
+        } break;
+
+        case '(': lexer_advance(l); token->kind = CC_TK_OPEN_PAREN; break;
+        case ')': lexer_advance(l); token->kind = CC_TK_CLOSE_PAREN; break;
+        case '[': lexer_advance(l); token->kind = CC_TK_OPEN_BRACKET; break;
+        case ']': lexer_advance(l); token->kind = CC_TK_CLOSE_BRACKET; break;
+        case '{': lexer_advance(l); token->kind = CC_TK_OPEN_BRACE; break;
+        case '}': lexer_advance(l); token->kind = CC_TK_CLOSE_BRACE; break;
+        case ';': lexer_advance(l); token->kind = CC_TK_SEMICOLON; break;
+        case ',': lexer_advance(l); token->kind = CC_TK_COMMA; break;
+        case '?': lexer_advance(l); token->kind = CC_TK_QUESTION; break;
+        case ':': lexer_advance(l); token->kind = CC_TK_COLON; break;
+
+        case '.': {
+            if (cc_is_digit(lexer_peek(l, 1))) {
+                cc_read_pp_number(l, token);
+            } else if (lexer_peek(l, 1) == '.' && lexer_peek(l, 2) == '.') {
+                l->position += 3;
+                token->kind = CC_TK_DOT_DOT_DOT;
+            } else {
+                lexer_advance(l);
+                token->kind = CC_TK_DOT;
+            }
+        } break;
+
+        case '+': {
+            lexer_advance(l);
+            token->kind = lexer_try_advance(l, '+')   ? CC_TK_PLUS_PLUS
+                        : lexer_try_advance(l, '=') ? CC_TK_PLUS_EQUAL
+                                                    : CC_TK_PLUS;
+        } break;
+
+        case '-': {
+            lexer_advance(l);
+            token->kind = lexer_try_advance(l, '-')   ? CC_TK_MINUS_MINUS
+                        : lexer_try_advance(l, '=') ? CC_TK_MINUS_EQUAL
+                        : lexer_try_advance(l, '>') ? CC_TK_MINUS_GREATER
+                                                    : CC_TK_MINUS;
+        } break;
+
+        case '*': {
+            lexer_advance(l);
+            token->kind = lexer_try_advance(l, '=') ? CC_TK_STAR_EQUAL : CC_TK_STAR;
+        } break;
+
+        case '/': {
+            lexer_advance(l);
+            token->kind = lexer_try_advance(l, '=') ? CC_TK_SLASH_EQUAL : CC_TK_SLASH;
+        } break;
+
+        case '%': {
+            lexer_advance(l);
+            token->kind = lexer_try_advance(l, '=') ? CC_TK_PERCENT_EQUAL : CC_TK_PERCENT;
+        } break;
+
+        case '&': {
+            lexer_advance(l);
+            token->kind = lexer_try_advance(l, '&')   ? CC_TK_AMPERSAND_AMPERSAND
+                        : lexer_try_advance(l, '=') ? CC_TK_AMPERSAND_EQUAL
+                                                    : CC_TK_AMPERSAND;
+        } break;
+
+        case '|': {
+            lexer_advance(l);
+            token->kind = lexer_try_advance(l, '|')   ? CC_TK_PIPE_PIPE
+                        : lexer_try_advance(l, '=') ? CC_TK_PIPE_EQUAL
+                                                    : CC_TK_PIPE;
+        } break;
+
+        case '^': {
+            lexer_advance(l);
+            token->kind = lexer_try_advance(l, '=') ? CC_TK_CARET_EQUAL : CC_TK_CARET;
+        } break;
+
+        case '~': {
+            lexer_advance(l);
+            token->kind = lexer_try_advance(l, '=') ? CC_TK_TILDE_EQUAL : CC_TK_TILDE;
+        } break;
+
+        case '=': {
+            lexer_advance(l);
+            token->kind = lexer_try_advance(l, '=') ? CC_TK_EQUAL_EQUAL : CC_TK_EQUAL;
+        } break;
+
+        case '!': {
+            lexer_advance(l);
+            token->kind = lexer_try_advance(l, '=') ? CC_TK_BANG_EQUAL : CC_TK_BANG;
+        } break;
+
+        case '<': {
+            lexer_advance(l);
+            if (lexer_try_advance(l, '<')) {
+                token->kind = lexer_try_advance(l, '=') ? CC_TK_LESS_LESS_EQUAL : CC_TK_LESS_LESS;
+            } else {
+                token->kind = lexer_try_advance(l, '=') ? CC_TK_LESS_EQUAL : CC_TK_LESS;
+            }
+        } break;
+
+        case '>': {
+            lexer_advance(l);
+            if (lexer_try_advance(l, '>')) {
+                token->kind = lexer_try_advance(l, '=') ? CC_TK_GREATER_GREATER_EQUAL : CC_TK_GREATER_GREATER;
+            } else {
+                token->kind = lexer_try_advance(l, '=') ? CC_TK_GREATER_EQUAL : CC_TK_GREATER;
+            }
+        } break;
+
+        case '#': {
+            lexer_advance(l);
+            token->kind = lexer_try_advance(l, '#') ? CC_TK_HASH_HASH : CC_TK_HASH;
+        } break;
+    }
+
+    assert((l->position > start_position || token->kind == CC_TK_EOF) && "token read did not consume any characters");
+
+    token->lexeme_begin = l->source->text + start_position;
+    token->lexeme_length = l->position - start_position;
+
+    token->location.source = l->source;
+    token->location.offset = start_position;
+    token->location.length = l->position - start_position;
+
+    if (token->kind != CC_TK_EOF) {
+        cc_read_trivia(l, &token->trailing_trivia, true);
+    }
+
+    return token;
+}
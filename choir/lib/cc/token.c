@@ -1 +1,6 @@
 #include <cc/cc.h>
+
+const uint16 cc_token_kind_classes[CC_TK_COUNT] = {
+#define CC_TOKEN(Name, Classes) [CC_TK_##Name] = (Classes),
+#include <cc/tokens.inc>
+};
@@ -1,4 +1,7 @@
 #include <choir/choir.h>
+#include <string.h>
+
+#define CH_ARENA_ALIGN 16
 
 CHOIR_API void ch_arena_init(ch_arena* arena, ch_allocator allocator, int64 block_size) {
     arena->allocator = allocator;
@@ -6,34 +9,112 @@ CHOIR_API void ch_arena_init(ch_arena* arena, ch_allocator allocator, int64 bloc
     arena->blocks = (ch_arena_blocks){
         .allocator = allocator,
     };
+    arena->last_allocation = NULL;
+}
+
+static int64 ch_arena_align(int64 size) {
+    // keep every allocation aligned for any type, just like malloc.
+    return (size + CH_ARENA_ALIGN - 1) & ~cast(int64)(CH_ARENA_ALIGN - 1);
+}
+
+static bool ch_arena_block_is_oversized(ch_arena* arena, ch_arena_block* block) {
+    return block->size != arena->block_size;
+}
+
+// Allocations too large for a block get one of their own, placed before the newest block so that block keeps being filled.
+static void* ch_arena_alloc_oversized(ch_arena* arena, int64 size) {
+    ch_arena_block block = {
+        .memory = ch_alloc(arena->allocator, size),
+        .size = size,
+        .consumed = size,
+    };
+    da_push(&arena->blocks, block);
+
+    int64 count = arena->blocks.count;
+    if (count >= 2) {
+        ch_arena_block newest = arena->blocks.items[count - 2];
+        arena->blocks.items[count - 2] = arena->blocks.items[count - 1];
+        arena->blocks.items[count - 1] = newest;
+    }
+
+    return block.memory;
 }
 
 CHOIR_API void* ch_arena_alloc(ch_arena* arena, int64 size) {
-    assert(size <= arena->block_size && "can't allocate something that big in this arena dummy");
+    size = ch_arena_align(size);
 
+    if (size > arena->block_size) {
+        return ch_arena_alloc_oversized(arena, size);
+    }
+
+    // only the newest block is considered; scanning every block made each allocation O(blocks), which adds up to quadratic time across a large token stream.
     ch_arena_block* alloc_block = NULL;
-    for (int64 i = 0; i < arena->blocks.count && alloc_block == NULL; i++) {
-        if (arena->block_size - arena->blocks.items[i].consumed <= size) {
-            alloc_block = &arena->blocks.items[i];
+    if (arena->blocks.count > 0) {
+        ch_arena_block* last_block = &arena->blocks.items[arena->blocks.count - 1];
+        if (!ch_arena_block_is_oversized(arena, last_block) && last_block->size - last_block->consumed >= size) {
+            alloc_block = last_block;
         }
     }
-    
+
     if (alloc_block == NULL) {
         ch_arena_block block = {
             .memory = ch_alloc(arena->allocator, arena->block_size),
+            .size = arena->block_size,
         };
         da_push(&arena->blocks, block);
         alloc_block = &arena->blocks.items[arena->blocks.count - 1];
     }
 
     assert(alloc_block != NULL && "where did it go");
-    
+
     void* memory = (cast(char*) alloc_block->memory) + alloc_block->consumed;
     alloc_block->consumed += size;
 
+    arena->last_allocation = memory;
     return memory;
 }
 
+CHOIR_API void* ch_arena_realloc(ch_arena* arena, void* memory, int64 size) {
+    if (memory == NULL) {
+        return ch_arena_alloc(arena, size);
+    }
+
+    size = ch_arena_align(size);
+
+    // reallocation is rare enough, a few times per growable array, that searching for the owning block is fine.
+    ch_arena_block* block = NULL;
+    for (int64 i = arena->blocks.count - 1; i >= 0; i--) {
+        ch_arena_block* candidate = &arena->blocks.items[i];
+        char* begin = candidate->memory;
+        if (cast(char*) memory >= begin && cast(char*) memory < begin + candidate->size) {
+            block = candidate;
+            break;
+        }
+    }
+
+    assert(block != NULL && "this memory was not allocated from this arena");
+
+    // an allocation with a block of its own can be handed straight to the backing allocator.
+    if (ch_arena_block_is_oversized(arena, block) && memory == block->memory && size > arena->block_size) {
+        block->memory = ch_realloc(arena->allocator, block->memory, size);
+        block->size = size;
+        block->consumed = size;
+        return block->memory;
+    }
+
+    int64 offset = cast(char*) memory - cast(char*) block->memory;
+    if (memory == arena->last_allocation && block == &arena->blocks.items[arena->blocks.count - 1] && offset + size <= block->size) {
+        block->consumed = offset + size;
+        return memory;
+    }
+
+    // the old size is not known, but the allocation cannot extend past what its block has handed out so far, so copying up to there is enough.
+    int64 available = block->consumed - offset;
+    void* new_memory = ch_arena_alloc(arena, size);
+    memcpy(new_memory, memory, cast(usize)(size < available ? size : available));
+    return new_memory;
+}
+
 CHOIR_API void ch_arena_deinit(ch_arena* arena) {
     ch_allocator allocator = arena->allocator;
 
@@ -42,6 +123,7 @@ CHOIR_API void ch_arena_deinit(ch_arena* arena) {
     }
 
     da_free(&arena->blocks);
+    arena->last_allocation = NULL;
 }
 
 static void* ch_arena_allocator_alloc(void* self, int64 size);
@@ -68,7 +150,7 @@ static void* ch_arena_allocator_alloc(void* self, int64 size) {
 
 static void* ch_arena_allocator_realloc(void* self, void* memory, int64 size) {
     ch_arena* arena = self;
-    assert(false && "cannot realloc with an arena (yet?)");
+    return ch_arena_realloc(arena, memory, size);
 }
 
 static void ch_arena_allocator_dealloc(void* self, void* memory) {
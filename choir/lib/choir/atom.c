@@ -0,0 +1,119 @@
+#include <choir/choir.h>
+#include <string.h>
+
+#define CH_ATOM_TEXT_BLOCK_SIZE (64 * 1024)
+#define CH_ATOM_INITIAL_SLOT_COUNT 256
+
+CHOIR_API void ch_atom_table_init(ch_atom_table* table, ch_allocator allocator) {
+    *table = (ch_atom_table){
+        .allocator = allocator,
+        .atoms = {.allocator = allocator},
+        .slot_count = CH_ATOM_INITIAL_SLOT_COUNT,
+    };
+
+    ch_arena_init(&table->text_arena, allocator, CH_ATOM_TEXT_BLOCK_SIZE);
+
+    table->slots = ch_alloc(allocator, table->slot_count * cast(int64) sizeof *table->slots);
+    memset(table->slots, 0, cast(usize) table->slot_count * sizeof *table->slots);
+
+    ch_atom_info empty = {.text = "", .hash = ch_hash("", 0, 0)};
+    da_push(&table->atoms, empty);
+}
+
+CHOIR_API void ch_atom_table_deinit(ch_atom_table* table) {
+    ch_dealloc(table->allocator, table->slots);
+    da_free(&table->atoms);
+    ch_arena_deinit(&table->text_arena);
+    *table = (ch_atom_table){0};
+}
+
+// Returns the slot holding `text`, or the empty slot it would be inserted into.
+static ch_atom_slot* ch_atom_probe(ch_atom_table* table, const char* text, int64 length, uint64 hash) {
+    int64 mask = table->slot_count - 1;
+    for (int64 index = cast(int64)(hash & cast(uint64) mask);; index = (index + 1) & mask) {
+        ch_atom_slot* slot = &table->slots[index];
+        if (slot->atom == 0) {
+            return slot;
+        }
+
+        if (slot->hash != cast(uint32) hash) continue;
+
+        ch_atom_info* info = &table->atoms.items[slot->atom];
+        if (info->length == length && 0 == memcmp(info->text, text, cast(usize) length)) {
+            return slot;
+        }
+    }
+}
+
+static void ch_atom_table_grow(ch_atom_table* table) {
+    ch_atom_slot* old_slots = table->slots;
+    int64 old_slot_count = table->slot_count;
+
+    table->slot_count *= 2;
+    table->slots = ch_alloc(table->allocator, table->slot_count * cast(int64) sizeof *table->slots);
+    memset(table->slots, 0, cast(usize) table->slot_count * sizeof *table->slots);
+
+    // every interned text is distinct, so re-inserting only needs to find an empty slot.
+    int64 mask = table->slot_count - 1;
+    for (int64 i = 0; i < old_slot_count; i++) {
+        ch_atom_slot slot = old_slots[i];
+        if (slot.atom == 0) continue;
+
+        uint64 hash = table->atoms.items[slot.atom].hash;
+        int64 index = cast(int64)(hash & cast(uint64) mask);
+        while (table->slots[index].atom != 0) {
+            index = (index + 1) & mask;
+        }
+
+        table->slots[index] = slot;
+    }
+
+    ch_dealloc(table->allocator, old_slots);
+}
+
+CHOIR_API ch_atom ch_atom_intern(ch_atom_table* table, const char* text, int64 length) {
+    assert(length >= 0 && "invalid text to intern");
+    if (length == 0) return 0;
+
+    uint64 hash = ch_hash(text, length, 0);
+    ch_atom_slot* slot = ch_atom_probe(table, text, length, hash);
+    if (slot->atom != 0) {
+        return slot->atom;
+    }
+
+    assert(table->atoms.count < UINT32_MAX && "too many atoms");
+
+    char* copy = ch_arena_alloc(&table->text_arena, length + 1);
+    memcpy(copy, text, cast(usize) length);
+    copy[length] = '\0';
+
+    ch_atom atom = cast(ch_atom) table->atoms.count;
+    ch_atom_info info = {copy, length, hash};
+    da_push(&table->atoms, info);
+
+    *slot = (ch_atom_slot){cast(uint32) hash, atom};
+
+    // the empty string never occupies a slot, so one fewer slot is used than there are atoms.
+    if ((table->atoms.count - 1) * 2 > table->slot_count) {
+        ch_atom_table_grow(table);
+    }
+
+    return atom;
+}
+
+CHOIR_API bool ch_atom_find(ch_atom_table* table, const char* text, int64 length, ch_atom* out_atom) {
+    assert(length >= 0 && "invalid text to find");
+    if (length == 0) {
+        *out_atom = 0;
+        return true;
+    }
+
+    ch_atom_slot* slot = ch_atom_probe(table, text, length, ch_hash(text, length, 0));
+    *out_atom = slot->atom;
+    return slot->atom != 0;
+}
+
+CHOIR_API ch_atom_info ch_atom_get(ch_atom_table* table, ch_atom atom) {
+    assert(atom < table->atoms.count && "invalid atom");
+    return table->atoms.items[atom];
+}
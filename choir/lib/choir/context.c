@@ -4,6 +4,7 @@
 CHOIR_API void ch_context_init(ch_context* context, ch_allocator allocator) {
     memset(context, 0, sizeof *context);
     context->allocator = allocator;
+    context->target = ch_target_host();
     context->string_store.allocator = allocator;
     context->queued_diagnostics.allocator = allocator;
 }
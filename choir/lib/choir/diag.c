@@ -4,6 +4,41 @@
 #include <stdio.h>
 #include <string.h>
 
+typedef struct ch_diag_sources {
+    ch_allocator allocator;
+    ch_source** items;
+    int64 count, capacity;
+} ch_diag_sources;
+
+// Prints the line a location starts on, and underlines the location within it.
+static void ch_diag_print_excerpt(ch_location location) {
+    ch_source* source = location.source;
+    if (location.offset < 0 || location.offset > source->length) return;
+
+    const char* text = source->text;
+    int64 line_begin = location.offset;
+    while (line_begin > 0 && text[line_begin - 1] != '\n') line_begin--;
+
+    int64 line_end = location.offset;
+    while (line_end < source->length && text[line_end] != '\n' && text[line_end] != '\r') line_end++;
+
+    fprintf(stderr, "  %.*s\n  ", cast(int)(line_end - line_begin), text + line_begin);
+
+    // one mark per code point, keeping tabs so the marks line up however wide the terminal shows them.
+    int64 location_end = location.offset + (location.length > 0 ? location.length : 1);
+    for (int64 i = line_begin; i < line_end && i < location_end; i++) {
+        if ((cast(uint8) text[i] & 0xC0) == 0x80) continue;
+        if (i < location.offset) {
+            fputc(text[i] == '\t' ? '\t' : ' ', stderr);
+        } else {
+            fputc(i == location.offset ? '^' : '~', stderr);
+        }
+    }
+
+    if (location.offset == line_end) fputc('^', stderr);
+    fputc('\n', stderr);
+}
+
 CHOIR_API void ch_diag_flush(ch_context* context) {
     if (context->has_issued_diagnostics) {
         fprintf(stderr, "\n");
@@ -11,6 +46,9 @@ CHOIR_API void ch_diag_flush(ch_context* context) {
 
     context->has_issued_diagnostics = true;
 
+    // text released after it was parsed is read back to show a late diagnostic in context, and released again once they are all printed.
+    ch_diag_sources reloaded = {.allocator = context->allocator};
+
     // TODO(local): lots of diagnostic formatting to be done soon.
     for (int64 i = 0; i < context->queued_diagnostics.count; i++) {
         ch_diagnostic diag = context->queued_diagnostics.items[i];
@@ -27,8 +65,26 @@ CHOIR_API void ch_diag_flush(ch_context* context) {
         }
 
         fprintf(stderr, "%s\n", diag.message);
+
+        // notes mostly point at something an earlier diagnostic already showed, so only the rest get an excerpt.
+        ch_source* source = diag.location.source;
+        if (source == NULL || diag.kind == CH_DIAG_NOTE) continue;
+
+        if (source->text == NULL) {
+            if (!ch_source_reload(source, context->allocator)) continue;
+            da_push(&reloaded, source);
+        }
+
+        ch_diag_print_excerpt(diag.location);
+    }
+
+    for (int64 i = 0; i < reloaded.count; i++) {
+        char* text = cast(char*) reloaded.items[i]->text;
+        ch_source_release(reloaded.items[i]);
+        ch_dealloc(context->allocator, text);
     }
 
+    da_free(&reloaded);
     context->queued_diagnostics.count = 0;
 }
 
@@ -42,8 +98,25 @@ static ch_string format_diag_message(ch_context* context, ch_diagnostic_kind kin
     return result;
 }
 
+CHOIR_API void ch_diag_merge(ch_context* context, ch_context* from) {
+    assert(context->allocator.userdata == from->allocator.userdata && "cannot merge diagnostics from a context with a different allocator");
+
+    if (from->queued_diagnostics.count == 0) return;
+
+    da_push_many(&context->queued_diagnostics, from->queued_diagnostics.items, from->queued_diagnostics.count);
+    from->queued_diagnostics.count = 0;
+}
+
+CHOIR_API void ch_diag_discard(ch_context* context) {
+    for (int64 i = 0; i < context->queued_diagnostics.count; i++) {
+        ch_dealloc(context->allocator, cast(void*) context->queued_diagnostics.items[i].message);
+    }
+
+    context->queued_diagnostics.count = 0;
+}
+
 CHOIR_API void ch_diag(ch_context* context, ch_diagnostic_kind kind, ch_location location, const char* format, ...) {
-    if (kind != CH_DIAG_NOTE) {
+    if (kind != CH_DIAG_NOTE && !context->defer_diagnostics) {
         ch_diag_flush(context);
     }
 
@@ -0,0 +1,91 @@
+#include <choir/choir.h>
+
+#if defined(_WIN32)
+#    define WIN32_LEAN_AND_MEAN
+#    include <windows.h>
+#else
+#    include <fcntl.h>
+#    include <sys/mman.h>
+#    include <sys/stat.h>
+#    include <unistd.h>
+#endif
+
+CHOIR_API bool ch_file_map(ch_mapped_file* file, const char* path) {
+    *file = (ch_mapped_file){0};
+
+#if defined(_WIN32)
+    HANDLE handle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (handle == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    LARGE_INTEGER size = {0};
+    if (!GetFileSizeEx(handle, &size)) {
+        CloseHandle(handle);
+        return false;
+    }
+
+    // empty files cannot be mapped, but there is nothing to map either.
+    if (size.QuadPart == 0) {
+        CloseHandle(handle);
+        return true;
+    }
+
+    HANDLE mapping = CreateFileMappingA(handle, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(handle);
+    if (mapping == NULL) {
+        return false;
+    }
+
+    // the view keeps the mapping alive on its own.
+    void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    if (data == NULL) {
+        return false;
+    }
+
+    file->data = data;
+    file->size = cast(int64) size.QuadPart;
+    return true;
+#else
+    int descriptor = open(path, O_RDONLY);
+    if (descriptor < 0) {
+        return false;
+    }
+
+    struct stat status = {0};
+    if (0 != fstat(descriptor, &status) || !S_ISREG(status.st_mode)) {
+        close(descriptor);
+        return false;
+    }
+
+    // empty files cannot be mapped, but there is nothing to map either.
+    if (status.st_size == 0) {
+        close(descriptor);
+        return true;
+    }
+
+    // the mapping keeps the file alive on its own.
+    void* data = mmap(NULL, cast(usize) status.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+    close(descriptor);
+    if (data == MAP_FAILED) {
+        return false;
+    }
+
+    file->data = data;
+    file->size = cast(int64) status.st_size;
+    return true;
+#endif
+}
+
+CHOIR_API void ch_file_unmap(ch_mapped_file* file) {
+    if (file->data != NULL) {
+#if defined(_WIN32)
+        UnmapViewOfFile(file->data);
+#else
+        munmap(cast(void*) file->data, cast(usize) file->size);
+#endif
+    }
+
+    *file = (ch_mapped_file){0};
+}
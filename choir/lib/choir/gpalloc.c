@@ -16,6 +16,8 @@ struct allocs {
     ch_allocator allocator;
     void** items;
     int64 count, capacity;
+    // guards the list of allocations, so one allocator can be shared by jobs on a thread pool.
+    mtx_t mutex;
 };
 
 CHOIR_API ch_allocator ch_general_purpose_allocator(void) {
@@ -31,6 +33,9 @@ CHOIR_API ch_allocator ch_general_purpose_allocator(void) {
         }
     };
 
+    int mtx_result = mtx_init(&allocs->mutex, mtx_plain);
+    assert(mtx_result == thrd_success && "failed to create the allocator mutex");
+
     return (ch_allocator){
         .vtable = {
             .alloc = ch_gpa_alloc,
@@ -60,7 +65,11 @@ static void ch_libc_deinit(void* self) {
 static void* ch_gpa_alloc(void* selfv, int64 size) {
     struct allocs* allocs = selfv;
     void* memory = malloc(cast(size_t) size);
+
+    mtx_lock(&allocs->mutex);
     da_push(allocs, memory);
+    mtx_unlock(&allocs->mutex);
+
     return memory;
 }
 
@@ -68,6 +77,7 @@ static void* ch_gpa_realloc(void* selfv, void* memory, int64 size) {
     if (memory == NULL) return ch_gpa_alloc(selfv, size);
 
     struct allocs* allocs = selfv;
+    mtx_lock(&allocs->mutex);
 
     int64 memory_index;
     for (memory_index = 0; memory_index < allocs->count; memory_index++) {
@@ -80,6 +90,8 @@ static void* ch_gpa_realloc(void* selfv, void* memory, int64 size) {
 
     void* new_memory = realloc(memory, cast(size_t) size);
     allocs->items[memory_index] = new_memory;
+
+    mtx_unlock(&allocs->mutex);
     return new_memory;
 }
 
@@ -87,6 +99,7 @@ static void ch_gpa_dealloc(void* selfv, void* memory) {
     if (memory == NULL) return;
 
     struct allocs* allocs = selfv;
+    mtx_lock(&allocs->mutex);
 
     int64 memory_index;
     for (memory_index = 0; memory_index < allocs->count; memory_index++) {
@@ -101,6 +114,8 @@ static void ch_gpa_dealloc(void* selfv, void* memory) {
 
     allocs->items[memory_index] = allocs->items[allocs->count - 1];
     allocs->count--;
+
+    mtx_unlock(&allocs->mutex);
 }
 
 static void ch_gpa_deinit(void* selfv) {
@@ -111,5 +126,6 @@ static void ch_gpa_deinit(void* selfv) {
     }
 
     da_free(allocs);
+    mtx_destroy(&allocs->mutex);
     free(allocs);
 }
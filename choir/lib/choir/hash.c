@@ -0,0 +1,98 @@
+#include <choir/choir.h>
+#include <string.h>
+
+// This is the XXH64 algorithm: it reads 32 bytes per step into four independent lanes, so it runs at memory speed on large inputs,
+// and finishes with a full avalanche so that every input bit affects every output bit.
+
+#define CH_HASH_PRIME1 0x9E3779B185EBCA87ull
+#define CH_HASH_PRIME2 0xC2B2AE3D27D4EB4Full
+#define CH_HASH_PRIME3 0x165667B19E3779F9ull
+#define CH_HASH_PRIME4 0x85EBCA77C2B2AE63ull
+#define CH_HASH_PRIME5 0x27D4EB2F165667C5ull
+
+static uint64 ch_hash_rotl(uint64 value, int bits) {
+    return (value << bits) | (value >> (64 - bits));
+}
+
+static uint64 ch_hash_read64(const uint8* bytes) {
+    uint64 value;
+    memcpy(&value, bytes, sizeof value);
+    return value;
+}
+
+static uint32 ch_hash_read32(const uint8* bytes) {
+    uint32 value;
+    memcpy(&value, bytes, sizeof value);
+    return value;
+}
+
+static uint64 ch_hash_round(uint64 accumulator, uint64 input) {
+    accumulator += input * CH_HASH_PRIME2;
+    accumulator = ch_hash_rotl(accumulator, 31);
+    return accumulator * CH_HASH_PRIME1;
+}
+
+static uint64 ch_hash_merge_round(uint64 accumulator, uint64 lane) {
+    accumulator ^= ch_hash_round(0, lane);
+    return accumulator * CH_HASH_PRIME1 + CH_HASH_PRIME4;
+}
+
+CHOIR_API uint64 ch_hash(const void* data, int64 length, uint64 seed) {
+    assert(length >= 0 && (length == 0 || data != NULL) && "invalid data to hash");
+
+    const uint8* bytes = data;
+    const uint8* end = bytes + length;
+    uint64 hash;
+
+    if (length >= 32) {
+        uint64 lanes[4] = {
+            seed + CH_HASH_PRIME1 + CH_HASH_PRIME2,
+            seed + CH_HASH_PRIME2,
+            seed,
+            seed - CH_HASH_PRIME1,
+        };
+
+        const uint8* last_stripe = end - 32;
+        do {
+            lanes[0] = ch_hash_round(lanes[0], ch_hash_read64(bytes + 0));
+            lanes[1] = ch_hash_round(lanes[1], ch_hash_read64(bytes + 8));
+            lanes[2] = ch_hash_round(lanes[2], ch_hash_read64(bytes + 16));
+            lanes[3] = ch_hash_round(lanes[3], ch_hash_read64(bytes + 24));
+            bytes += 32;
+        } while (bytes <= last_stripe);
+
+        hash = ch_hash_rotl(lanes[0], 1) + ch_hash_rotl(lanes[1], 7) + ch_hash_rotl(lanes[2], 12) + ch_hash_rotl(lanes[3], 18);
+        for (int i = 0; i < 4; i++) {
+            hash = ch_hash_merge_round(hash, lanes[i]);
+        }
+    } else {
+        hash = seed + CH_HASH_PRIME5;
+    }
+
+    hash += cast(uint64) length;
+
+    while (end - bytes >= 8) {
+        hash ^= ch_hash_round(0, ch_hash_read64(bytes));
+        hash = ch_hash_rotl(hash, 27) * CH_HASH_PRIME1 + CH_HASH_PRIME4;
+        bytes += 8;
+    }
+
+    if (end - bytes >= 4) {
+        hash ^= cast(uint64) ch_hash_read32(bytes) * CH_HASH_PRIME1;
+        hash = ch_hash_rotl(hash, 23) * CH_HASH_PRIME2 + CH_HASH_PRIME3;
+        bytes += 4;
+    }
+
+    while (bytes < end) {
+        hash ^= *bytes * CH_HASH_PRIME5;
+        hash = ch_hash_rotl(hash, 11) * CH_HASH_PRIME1;
+        bytes++;
+    }
+
+    hash ^= hash >> 33;
+    hash *= CH_HASH_PRIME2;
+    hash ^= hash >> 29;
+    hash *= CH_HASH_PRIME3;
+    hash ^= hash >> 32;
+    return hash;
+}
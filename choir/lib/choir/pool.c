@@ -0,0 +1,201 @@
+#include <choir/choir.h>
+#include <threads.h>
+
+#if defined(_WIN32)
+#    define WIN32_LEAN_AND_MEAN
+#    include <windows.h>
+#else
+#    include <unistd.h>
+#endif
+
+struct ch_thread_pool_state {
+    mtx_t mutex;
+    cnd_t work_ready;
+    cnd_t work_done;
+
+    thrd_t* threads;
+    int64 worker_count;
+
+    // everything below is guarded by the mutex.
+    ch_job_fn job;
+    void* userdata;
+    int64 job_count;
+    int64 next_job;
+    int64 unfinished_job_count;
+
+    // bumped for every call to run, so workers can tell new work from a spurious wake up.
+    uint64 generation;
+    bool is_shutting_down;
+};
+
+CHOIR_API int64 ch_processor_count(void) {
+#if defined(_WIN32)
+    SYSTEM_INFO system_info = {0};
+    GetSystemInfo(&system_info);
+    return system_info.dwNumberOfProcessors > 0 ? cast(int64) system_info.dwNumberOfProcessors : 1;
+#else
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? cast(int64) count : 1;
+#endif
+}
+
+// Runs jobs until there are none left to start. The mutex must be held, and is held again on return.
+static void ch_thread_pool_work(struct ch_thread_pool_state* state) {
+    while (state->next_job < state->job_count) {
+        int64 index = state->next_job++;
+        ch_job_fn job = state->job;
+        void* userdata = state->userdata;
+
+        mtx_unlock(&state->mutex);
+        job(userdata, index);
+        mtx_lock(&state->mutex);
+
+        state->unfinished_job_count--;
+        if (state->unfinished_job_count == 0) {
+            cnd_broadcast(&state->work_done);
+        }
+    }
+}
+
+static int ch_thread_pool_worker(void* userdata) {
+    struct ch_thread_pool_state* state = userdata;
+    uint64 seen_generation = 0;
+
+    mtx_lock(&state->mutex);
+    while (true) {
+        while (state->generation == seen_generation && !state->is_shutting_down) {
+            cnd_wait(&state->work_ready, &state->mutex);
+        }
+
+        if (state->is_shutting_down) {
+            break;
+        }
+
+        seen_generation = state->generation;
+        ch_thread_pool_work(state);
+    }
+
+    mtx_unlock(&state->mutex);
+    return 0;
+}
+
+CHOIR_API void ch_thread_pool_init(ch_thread_pool* pool, ch_allocator allocator, int64 thread_count) {
+    assert(thread_count > 0 && "a thread pool needs at least the calling thread");
+
+    *pool = (ch_thread_pool){
+        .allocator = allocator,
+        .thread_count = thread_count,
+    };
+
+    struct ch_thread_pool_state* state = ch_alloc(allocator, sizeof *state);
+    *state = (struct ch_thread_pool_state){0};
+    pool->state = state;
+
+    bool initialized = mtx_init(&state->mutex, mtx_plain) == thrd_success;
+    initialized &= cnd_init(&state->work_ready) == thrd_success;
+    initialized &= cnd_init(&state->work_done) == thrd_success;
+    assert(initialized && "failed to create the thread pool synchronization primitives");
+
+    if (thread_count == 1) {
+        return;
+    }
+
+    state->threads = ch_alloc(allocator, (thread_count - 1) * cast(int64) sizeof *state->threads);
+    for (int64 i = 0; i < thread_count - 1; i++) {
+        if (thrd_success != thrd_create(&state->threads[i], ch_thread_pool_worker, state)) {
+            // running with fewer workers is slower, but not wrong.
+            break;
+        }
+
+        state->worker_count++;
+    }
+}
+
+CHOIR_API void ch_thread_pool_run(ch_thread_pool* pool, int64 job_count, ch_job_fn job, void* userdata) {
+    struct ch_thread_pool_state* state = pool->state;
+    assert(state != NULL && "the thread pool was not initialized");
+
+    if (job_count <= 0) {
+        return;
+    }
+
+    if (state->worker_count == 0 || job_count == 1) {
+        for (int64 i = 0; i < job_count; i++) {
+            job(userdata, i);
+        }
+
+        return;
+    }
+
+    mtx_lock(&state->mutex);
+    assert(state->unfinished_job_count == 0 && "ch_thread_pool_run cannot be called from one of its own jobs");
+
+    state->job = job;
+    state->userdata = userdata;
+    state->job_count = job_count;
+    state->next_job = 0;
+    state->unfinished_job_count = job_count;
+    state->generation++;
+    cnd_broadcast(&state->work_ready);
+
+    ch_thread_pool_work(state);
+    while (state->unfinished_job_count > 0) {
+        cnd_wait(&state->work_done, &state->mutex);
+    }
+
+    state->job = NULL;
+    state->userdata = NULL;
+    mtx_unlock(&state->mutex);
+}
+
+CHOIR_API void ch_thread_pool_deinit(ch_thread_pool* pool) {
+    struct ch_thread_pool_state* state = pool->state;
+    if (state == NULL) return;
+
+    mtx_lock(&state->mutex);
+    state->is_shutting_down = true;
+    cnd_broadcast(&state->work_ready);
+    mtx_unlock(&state->mutex);
+
+    for (int64 i = 0; i < state->worker_count; i++) {
+        thrd_join(state->threads[i], NULL);
+    }
+
+    cnd_destroy(&state->work_done);
+    cnd_destroy(&state->work_ready);
+    mtx_destroy(&state->mutex);
+
+    ch_dealloc(pool->allocator, state->threads);
+    ch_dealloc(pool->allocator, state);
+    *pool = (ch_thread_pool){0};
+}
+
+struct ch_mutex_state {
+    mtx_t mutex;
+};
+
+CHOIR_API void ch_mutex_init(ch_mutex* mutex, ch_allocator allocator) {
+    *mutex = (ch_mutex){
+        .allocator = allocator,
+        .state = ch_alloc(allocator, sizeof(struct ch_mutex_state)),
+    };
+
+    bool initialized = mtx_init(&mutex->state->mutex, mtx_plain) == thrd_success;
+    assert(initialized && "failed to create a mutex");
+}
+
+CHOIR_API void ch_mutex_deinit(ch_mutex* mutex) {
+    if (mutex->state == NULL) return;
+
+    mtx_destroy(&mutex->state->mutex);
+    ch_dealloc(mutex->allocator, mutex->state);
+    *mutex = (ch_mutex){0};
+}
+
+CHOIR_API void ch_mutex_lock(ch_mutex* mutex) {
+    mtx_lock(&mutex->state->mutex);
+}
+
+CHOIR_API void ch_mutex_unlock(ch_mutex* mutex) {
+    mtx_unlock(&mutex->state->mutex);
+}
@@ -0,0 +1,109 @@
+#include <choir/choir.h>
+#include <string.h>
+
+// Returns where an offset into the text before an edit ends up after it; offsets within the removed text move to the end of the inserted text.
+static int64 ch_source_edit_shift(ch_source_edit edit, int64 offset) {
+    if (offset <= edit.offset) return offset;
+    if (offset >= edit.offset + edit.removed_length) return offset - edit.removed_length + edit.inserted_length;
+    return edit.offset + edit.inserted_length;
+}
+
+CHOIR_API void ch_source_apply_edit(ch_source* source, ch_source_edit edit, ch_allocator allocator) {
+    assert(source != NULL && "where is the source?");
+    assert(edit.offset >= 0 && edit.removed_length >= 0 && edit.inserted_length >= 0 && "invalid source edit");
+    assert(edit.offset + edit.removed_length <= source->length && "source edit extends past the end of the source text");
+    assert((edit.inserted_length == 0 || edit.inserted_text != NULL) && "source edit inserts text but provides none");
+
+    int64 tail_offset = edit.offset + edit.removed_length;
+    int64 tail_length = source->length - tail_offset;
+    int64 new_length = edit.offset + edit.inserted_length + tail_length;
+
+    char* text = ch_alloc(allocator, new_length + 1);
+    memcpy(text, source->text, cast(size_t) edit.offset);
+    if (edit.inserted_length > 0) {
+        memcpy(text + edit.offset, edit.inserted_text, cast(size_t) edit.inserted_length);
+    }
+    memcpy(text + edit.offset + edit.inserted_length, source->text + tail_offset, cast(size_t) tail_length);
+    text[new_length] = 0;
+
+    if (source->is_utf8_validated) {
+        int64 begin = edit.offset;
+        int64 end = edit.offset + edit.inserted_length;
+
+        // bytes checked before the edit which it shifted or replaced are still to be checked, wherever they are now.
+        if (source->unvalidated_begin < source->unvalidated_end) {
+            int64 old_begin = ch_source_edit_shift(edit, source->unvalidated_begin);
+            int64 old_end = ch_source_edit_shift(edit, source->unvalidated_end);
+            begin = begin < old_begin ? begin : old_begin;
+            end = end > old_end ? end : old_end;
+        }
+
+        // widen to whole code points: the one the edit starts inside of, and any continuation bytes it left dangling after it.
+        if (begin > 0) {
+            begin--;
+            for (int i = 0; i < 3 && begin > 0 && (cast(uint8) text[begin] & 0xC0) == 0x80; i++) begin--;
+        }
+
+        for (int i = 0; i < 3 && end < new_length && (cast(uint8) text[end] & 0xC0) == 0x80; i++) end++;
+
+        source->unvalidated_begin = begin;
+        source->unvalidated_end = end;
+    }
+
+    source->text = text;
+    source->length = new_length;
+}
+
+CHOIR_API bool ch_source_validate_utf8(ch_context* context, ch_source* source) {
+    assert(source != NULL && "where is the source?");
+
+    int64 begin = 0;
+    int64 end = source->length;
+    if (source->is_utf8_validated) {
+        begin = source->unvalidated_begin;
+        end = source->unvalidated_end;
+        if (begin >= end) return true;
+    }
+
+    source->is_utf8_validated = true;
+    source->unvalidated_begin = 0;
+    source->unvalidated_end = 0;
+
+    int64 valid_length = ch_utf8_validate(source->text + begin, end - begin);
+    if (valid_length == end - begin) return true;
+
+    ch_diag(context, CH_DIAG_ERROR, (ch_location){source, begin + valid_length, 1}, "invalid UTF-8 in source text");
+    return false;
+}
+
+CHOIR_API void ch_source_release(ch_source* source) {
+    assert(source != NULL && "where is the source?");
+    assert(source->text != NULL && "the source text was already released");
+
+    source->released_hash = ch_hash(source->text, source->length, 0);
+    source->text = NULL;
+}
+
+CHOIR_API bool ch_source_reload(ch_source* source, ch_allocator allocator) {
+    assert(source != NULL && "where is the source?");
+    assert(source->text == NULL && "only released source text can be reloaded");
+
+    ch_mapped_file mapping;
+    if (!ch_file_map(&mapping, source->name)) {
+        return false;
+    }
+
+    bool result = true;
+    if (mapping.size != source->length || ch_hash(mapping.data, mapping.size, 0) != source->released_hash) {
+        return_defer(false);
+    }
+
+    char* text = ch_alloc(allocator, source->length + 1);
+    if (source->length != 0) memcpy(text, mapping.data, cast(usize) source->length);
+    text[source->length] = 0;
+    source->text = text;
+
+defer:
+    ch_file_unmap(&mapping);
+    return result;
+}
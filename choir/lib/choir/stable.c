@@ -0,0 +1,57 @@
+#include <choir/choir.h>
+#include <string.h>
+
+CHOIR_API void ch_stable_array_init(ch_stable_array* array, ch_allocator allocator, int64 item_size, int chunk_shift, int64 max_chunk_count) {
+    assert(item_size > 0 && chunk_shift >= 0 && chunk_shift < 32 && max_chunk_count > 0 && "invalid stable array shape");
+
+    *array = (ch_stable_array){
+        .allocator = allocator,
+        .item_size = item_size,
+        .chunk_shift = chunk_shift,
+        .max_chunk_count = max_chunk_count,
+        .chunks = ch_alloc(allocator, max_chunk_count * cast(int64) sizeof(void*)),
+    };
+
+    memset(array->chunks, 0, cast(usize) max_chunk_count * sizeof(void*));
+}
+
+CHOIR_API void ch_stable_array_deinit(ch_stable_array* array) {
+    if (array->chunks != NULL) {
+        for (int64 i = 0; i < array->max_chunk_count && array->chunks[i] != NULL; i++) {
+            ch_dealloc(array->allocator, array->chunks[i]);
+        }
+    }
+
+    ch_dealloc(array->allocator, array->chunks);
+    *array = (ch_stable_array){0};
+}
+
+CHOIR_API int64 ch_stable_array_push(ch_stable_array* array, const void* items, int64 count) {
+    int64 chunk_size = cast(int64) 1 << array->chunk_shift;
+    assert(count >= 0 && count <= chunk_size && "too many items to push at once to a stable array");
+
+    int64 index = array->count;
+    int64 used_in_chunk = index & (chunk_size - 1);
+    if (used_in_chunk != 0 && used_in_chunk + count > chunk_size) {
+        index += chunk_size - used_in_chunk;
+    }
+
+    if (count != 0) {
+        // the items fit in one chunk, so this is the only one which may need allocating.
+        int64 chunk = index >> array->chunk_shift;
+        assert(chunk < array->max_chunk_count && "stable array is full");
+        if (array->chunks[chunk] == NULL) {
+            array->chunks[chunk] = ch_alloc(array->allocator, chunk_size * array->item_size);
+        }
+
+        void* destination = ch_stable_array_get(array, index);
+        if (items != NULL) {
+            memcpy(destination, items, cast(usize)(count * array->item_size));
+        } else {
+            memset(destination, 0, cast(usize)(count * array->item_size));
+        }
+    }
+
+    array->count = index + count;
+    return index;
+}
@@ -0,0 +1,47 @@
+#include <choir/choir.h>
+#include <string.h>
+
+static const ch_target ch_targets[] = {
+#define CH_TARGET(Name, IsCharSigned) {.name = Name, .is_char_signed = IsCharSigned, .layouts = {
+#define CH_TARGET_TYPE(Type, Size, Align) [CH_TT_##Type] = {Size, Align},
+#define CH_TARGET_END }},
+#include <choir/targets.inc>
+};
+
+#define CH_TARGET_COUNT (cast(int64)(sizeof ch_targets / sizeof ch_targets[0]))
+
+#if defined(__x86_64__) || defined(_M_X64)
+#    if defined(_WIN32)
+#        define CH_HOST_TARGET "x86_64-windows"
+#    else
+#        define CH_HOST_TARGET "x86_64-linux"
+#    endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#    if defined(__APPLE__)
+#        define CH_HOST_TARGET "aarch64-darwin"
+#    else
+#        define CH_HOST_TARGET "aarch64-linux"
+#    endif
+#endif
+
+CHOIR_API const ch_target* ch_target_find(const char* name) {
+    for (int64 i = 0; i < CH_TARGET_COUNT; i++) {
+        if (0 == strcmp(ch_targets[i].name, name)) {
+            for (int64 j = 0; j < CH_TT_COUNT; j++) {
+                assert(ch_targets[i].layouts[j].align > 0 && "every target must describe every type in targets.inc");
+            }
+
+            return &ch_targets[i];
+        }
+    }
+
+    return NULL;
+}
+
+CHOIR_API const ch_target* ch_target_host(void) {
+#if defined(CH_HOST_TARGET)
+    return ch_target_find(CH_HOST_TARGET);
+#else
+    return &ch_targets[0];
+#endif
+}
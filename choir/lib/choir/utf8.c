@@ -0,0 +1,110 @@
+#include <choir/choir.h>
+#include <string.h>
+
+#if defined(CHOIR_USE_SSE2)
+#    include <emmintrin.h>
+#endif
+
+CHOIR_API int ch_utf8_encode(uint32 code_point, char* buffer) {
+    if (code_point < 0x80) {
+        buffer[0] = cast(char) code_point;
+        return 1;
+    }
+
+    if (code_point < 0x800) {
+        buffer[0] = cast(char)(0xC0 | (code_point >> 6));
+        buffer[1] = cast(char)(0x80 | (code_point & 0x3F));
+        return 2;
+    }
+
+    if (code_point < 0x10000) {
+        buffer[0] = cast(char)(0xE0 | (code_point >> 12));
+        buffer[1] = cast(char)(0x80 | ((code_point >> 6) & 0x3F));
+        buffer[2] = cast(char)(0x80 | (code_point & 0x3F));
+        return 3;
+    }
+
+    assert(code_point <= 0x10FFFF && "code point is out of the Unicode range");
+    buffer[0] = cast(char)(0xF0 | (code_point >> 18));
+    buffer[1] = cast(char)(0x80 | ((code_point >> 12) & 0x3F));
+    buffer[2] = cast(char)(0x80 | ((code_point >> 6) & 0x3F));
+    buffer[3] = cast(char)(0x80 | (code_point & 0x3F));
+    return 4;
+}
+
+CHOIR_API int ch_utf8_decode(const char* text, int64 length, uint32* out_code_point) {
+    if (length <= 0) return 0;
+
+    const uint8* bytes = cast(const uint8*) text;
+    uint8 lead = bytes[0];
+    if (lead < 0x80) {
+        *out_code_point = lead;
+        return 1;
+    }
+
+    int count;
+    uint32 code_point;
+    uint32 minimum;
+    if ((lead & 0xE0) == 0xC0) {
+        count = 2, code_point = lead & 0x1F, minimum = 0x80;
+    } else if ((lead & 0xF0) == 0xE0) {
+        count = 3, code_point = lead & 0x0F, minimum = 0x800;
+    } else if ((lead & 0xF8) == 0xF0) {
+        count = 4, code_point = lead & 0x07, minimum = 0x10000;
+    } else {
+        return 0;
+    }
+
+    if (length < count) return 0;
+    for (int i = 1; i < count; i++) {
+        if ((bytes[i] & 0xC0) != 0x80) return 0;
+        code_point = (code_point << 6) | (bytes[i] & 0x3F);
+    }
+
+    // reject overlong encodings, surrogates and anything past the end of Unicode.
+    if (code_point < minimum || code_point > 0x10FFFF || (code_point >= 0xD800 && code_point <= 0xDFFF)) {
+        return 0;
+    }
+
+    *out_code_point = code_point;
+    return count;
+}
+
+// returns the number of leading bytes which are ASCII, checking as many bytes at once as the target allows.
+static int64 ch_ascii_prefix_length(const uint8* bytes, int64 length) {
+    int64 i = 0;
+
+#if defined(CHOIR_USE_SSE2)
+    for (; i + 16 <= length; i += 16) {
+        __m128i chunk = _mm_loadu_si128(cast(const __m128i*)(bytes + i));
+        if (_mm_movemask_epi8(chunk) != 0) break;
+    }
+#endif
+
+    for (; i + 8 <= length; i += 8) {
+        uint64 chunk;
+        memcpy(&chunk, bytes + i, sizeof chunk);
+        if ((chunk & 0x8080808080808080) != 0) break;
+    }
+
+    while (i < length && bytes[i] < 0x80) i++;
+    return i;
+}
+
+CHOIR_API int64 ch_utf8_validate(const char* text, int64 length) {
+    const uint8* bytes = cast(const uint8*) text;
+
+    // source code is overwhelmingly ASCII, so skip over it in bulk and only decode the rare multibyte sequences.
+    int64 position = 0;
+    while (position < length) {
+        position += ch_ascii_prefix_length(bytes + position, length - position);
+        while (position < length && bytes[position] >= 0x80) {
+            uint32 code_point;
+            int count = ch_utf8_decode(text + position, length - position, &code_point);
+            if (count == 0) return position;
+            position += count;
+        }
+    }
+
+    return position;
+}
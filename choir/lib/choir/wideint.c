@@ -0,0 +1,241 @@
+#include <choir/choir.h>
+
+CHOIR_API ch_wide_int ch_wide_int_from_uint64(uint64 value) {
+    ch_wide_int result = {0};
+    result.words[0] = value;
+    return result;
+}
+
+CHOIR_API bool ch_wide_int_mul_add(ch_wide_int* value, uint32 multiplier, uint32 addend) {
+    assert(value != NULL && "where is the value?");
+
+    // multiply in 32-bit halves so every partial product fits in 64 bits without compiler-specific 128-bit types.
+    uint64 carry = addend;
+    for (int64 i = 0; i < CH_WIDE_INT_WORDS; i++) {
+        uint64 word = value->words[i];
+        uint64 low = (word & 0xFFFFFFFF) * multiplier + (carry & 0xFFFFFFFF);
+        uint64 high = (word >> 32) * multiplier + (low >> 32) + (carry >> 32);
+        value->words[i] = (high << 32) | (low & 0xFFFFFFFF);
+        carry = high >> 32;
+    }
+
+    return carry == 0;
+}
+
+CHOIR_API ch_wide_int ch_wide_int_from_int64(int64 value) {
+    ch_wide_int result;
+    for (int64 i = 0; i < CH_WIDE_INT_WORDS; i++) {
+        result.words[i] = value < 0 ? UINT64_MAX : 0;
+    }
+
+    result.words[0] = cast(uint64) value;
+    return result;
+}
+
+CHOIR_API bool ch_wide_int_is_negative(ch_wide_int value) {
+    return (value.words[CH_WIDE_INT_WORDS - 1] >> 63) != 0;
+}
+
+CHOIR_API bool ch_wide_int_to_int64(ch_wide_int value, int64* out_value) {
+    // it fits if every word above the first is just the sign of the first extended.
+    uint64 extension = (value.words[0] >> 63) != 0 ? UINT64_MAX : 0;
+    for (int64 i = 1; i < CH_WIDE_INT_WORDS; i++) {
+        if (value.words[i] != extension) return false;
+    }
+
+    *out_value = cast(int64) value.words[0];
+    return true;
+}
+
+CHOIR_API int ch_wide_int_compare(ch_wide_int lhs, ch_wide_int rhs) {
+    bool lhs_negative = ch_wide_int_is_negative(lhs);
+    if (lhs_negative != ch_wide_int_is_negative(rhs)) {
+        return lhs_negative ? -1 : 1;
+    }
+
+    // with equal signs, two's complement values order the same as their bits do.
+    for (int64 i = CH_WIDE_INT_WORDS - 1; i >= 0; i--) {
+        if (lhs.words[i] != rhs.words[i]) {
+            return lhs.words[i] < rhs.words[i] ? -1 : 1;
+        }
+    }
+
+    return 0;
+}
+
+static ch_wide_int ch_wide_int_add_bits(ch_wide_int lhs, ch_wide_int rhs, uint64 carry) {
+    ch_wide_int result;
+    for (int64 i = 0; i < CH_WIDE_INT_WORDS; i++) {
+        uint64 sum = lhs.words[i] + rhs.words[i];
+        uint64 sum_carry = sum < lhs.words[i];
+        result.words[i] = sum + carry;
+        carry = sum_carry | (result.words[i] < sum);
+    }
+
+    return result;
+}
+
+CHOIR_API bool ch_wide_int_add(ch_wide_int lhs, ch_wide_int rhs, ch_wide_int* out_result) {
+    *out_result = ch_wide_int_add_bits(lhs, rhs, 0);
+    // overflow is only possible when the operands share a sign, and shows as a result with the other sign.
+    bool lhs_negative = ch_wide_int_is_negative(lhs);
+    return lhs_negative != ch_wide_int_is_negative(rhs) || lhs_negative == ch_wide_int_is_negative(*out_result);
+}
+
+CHOIR_API bool ch_wide_int_sub(ch_wide_int lhs, ch_wide_int rhs, ch_wide_int* out_result) {
+    *out_result = ch_wide_int_add_bits(lhs, ch_wide_int_not(rhs), 1);
+    bool lhs_negative = ch_wide_int_is_negative(lhs);
+    return lhs_negative == ch_wide_int_is_negative(rhs) || lhs_negative == ch_wide_int_is_negative(*out_result);
+}
+
+CHOIR_API bool ch_wide_int_negate(ch_wide_int value, ch_wide_int* out_result) {
+    return ch_wide_int_sub((ch_wide_int){0}, value, out_result);
+}
+
+// Computes the magnitude of a value, which for the most negative value is its own bits read as unsigned.
+static ch_wide_int ch_wide_int_magnitude(ch_wide_int value) {
+    if (!ch_wide_int_is_negative(value)) return value;
+    return ch_wide_int_add_bits(ch_wide_int_not(value), (ch_wide_int){0}, 1);
+}
+
+CHOIR_API bool ch_wide_int_mul(ch_wide_int lhs, ch_wide_int rhs, ch_wide_int* out_result) {
+    ch_wide_int a = ch_wide_int_magnitude(lhs);
+    ch_wide_int b = ch_wide_int_magnitude(rhs);
+
+    // schoolbook multiplication of the magnitudes in 32-bit digits, keeping the full product to see whether it fits.
+    uint32 a_digits[2 * CH_WIDE_INT_WORDS], b_digits[2 * CH_WIDE_INT_WORDS], product[4 * CH_WIDE_INT_WORDS] = {0};
+    for (int64 i = 0; i < CH_WIDE_INT_WORDS; i++) {
+        a_digits[2 * i + 0] = cast(uint32) a.words[i];
+        a_digits[2 * i + 1] = cast(uint32)(a.words[i] >> 32);
+        b_digits[2 * i + 0] = cast(uint32) b.words[i];
+        b_digits[2 * i + 1] = cast(uint32)(b.words[i] >> 32);
+    }
+
+    for (int64 i = 0; i < 2 * CH_WIDE_INT_WORDS; i++) {
+        uint64 carry = 0;
+        for (int64 j = 0; j < 2 * CH_WIDE_INT_WORDS; j++) {
+            uint64 t = cast(uint64) a_digits[i] * b_digits[j] + product[i + j] + carry;
+            product[i + j] = cast(uint32) t;
+            carry = t >> 32;
+        }
+
+        product[i + 2 * CH_WIDE_INT_WORDS] = cast(uint32) carry;
+    }
+
+    for (int64 i = 2 * CH_WIDE_INT_WORDS; i < 4 * CH_WIDE_INT_WORDS; i++) {
+        if (product[i] != 0) return false;
+    }
+
+    ch_wide_int magnitude;
+    for (int64 i = 0; i < CH_WIDE_INT_WORDS; i++) {
+        magnitude.words[i] = cast(uint64) product[2 * i] | (cast(uint64) product[2 * i + 1] << 32);
+    }
+
+    bool is_negative = ch_wide_int_is_negative(lhs) != ch_wide_int_is_negative(rhs);
+    if (!is_negative) {
+        *out_result = magnitude;
+        return !ch_wide_int_is_negative(magnitude);
+    }
+
+    // the most negative value has a magnitude with only the sign bit set, which negates to itself.
+    *out_result = ch_wide_int_add_bits(ch_wide_int_not(magnitude), (ch_wide_int){0}, 1);
+    return !ch_wide_int_is_negative(magnitude) || ch_wide_int_compare(*out_result, magnitude) == 0;
+}
+
+CHOIR_API bool ch_wide_int_div_rem(ch_wide_int lhs, ch_wide_int rhs, ch_wide_int* out_quotient, ch_wide_int* out_remainder) {
+    assert(ch_wide_int_compare(rhs, (ch_wide_int){0}) != 0 && "division by zero");
+
+    ch_wide_int a = ch_wide_int_magnitude(lhs);
+    ch_wide_int b = ch_wide_int_magnitude(rhs);
+
+    // restoring division, one bit at a time; constants are rarely wide, so this does not need to be fast.
+    ch_wide_int quotient = {0}, remainder = {0};
+    for (int64 bit = CH_WIDE_INT_WORDS * 64 - 1; bit >= 0; bit--) {
+        for (int64 i = CH_WIDE_INT_WORDS - 1; i > 0; i--) {
+            remainder.words[i] = (remainder.words[i] << 1) | (remainder.words[i - 1] >> 63);
+        }
+
+        remainder.words[0] = (remainder.words[0] << 1) | ((a.words[bit / 64] >> (bit % 64)) & 1);
+
+        // compare as unsigned, since the magnitude of the most negative value has the sign bit set.
+        int order = 0;
+        for (int64 i = CH_WIDE_INT_WORDS - 1; i >= 0 && order == 0; i--) {
+            if (remainder.words[i] != b.words[i]) order = remainder.words[i] < b.words[i] ? -1 : 1;
+        }
+
+        if (order >= 0) {
+            remainder = ch_wide_int_add_bits(remainder, ch_wide_int_not(b), 1);
+            quotient.words[bit / 64] |= cast(uint64) 1 << (bit % 64);
+        }
+    }
+
+    bool quotient_fits = true;
+    if (ch_wide_int_is_negative(lhs) != ch_wide_int_is_negative(rhs)) {
+        quotient = ch_wide_int_add_bits(ch_wide_int_not(quotient), (ch_wide_int){0}, 1);
+    } else {
+        // only the most negative value divided by -1 has a quotient too large to represent.
+        quotient_fits = !ch_wide_int_is_negative(quotient);
+    }
+
+    if (ch_wide_int_is_negative(lhs)) {
+        remainder = ch_wide_int_add_bits(ch_wide_int_not(remainder), (ch_wide_int){0}, 1);
+    }
+
+    *out_quotient = quotient;
+    *out_remainder = remainder;
+    return quotient_fits;
+}
+
+CHOIR_API bool ch_wide_int_shl(ch_wide_int value, int64 count, ch_wide_int* out_result) {
+    assert(count >= 0 && count < CH_WIDE_INT_WORDS * 64 && "shift count out of range");
+
+    ch_wide_int result = {0};
+    int64 word_shift = count / 64, bit_shift = count % 64;
+    for (int64 i = CH_WIDE_INT_WORDS - 1; i >= word_shift; i--) {
+        uint64 word = value.words[i - word_shift] << bit_shift;
+        if (bit_shift != 0 && i - word_shift > 0) {
+            word |= value.words[i - word_shift - 1] >> (64 - bit_shift);
+        }
+
+        result.words[i] = word;
+    }
+
+    *out_result = result;
+    // nothing was lost if shifting back recovers the value.
+    return ch_wide_int_compare(ch_wide_int_shr(result, count), value) == 0;
+}
+
+CHOIR_API ch_wide_int ch_wide_int_shr(ch_wide_int value, int64 count) {
+    assert(count >= 0 && count < CH_WIDE_INT_WORDS * 64 && "shift count out of range");
+
+    uint64 fill = ch_wide_int_is_negative(value) ? UINT64_MAX : 0;
+    ch_wide_int result;
+    int64 word_shift = count / 64, bit_shift = count % 64;
+    for (int64 i = 0; i < CH_WIDE_INT_WORDS; i++) {
+        uint64 low = i + word_shift < CH_WIDE_INT_WORDS ? value.words[i + word_shift] : fill;
+        uint64 high = i + word_shift + 1 < CH_WIDE_INT_WORDS ? value.words[i + word_shift + 1] : fill;
+        result.words[i] = bit_shift == 0 ? low : (low >> bit_shift) | (high << (64 - bit_shift));
+    }
+
+    return result;
+}
+
+CHOIR_API ch_wide_int ch_wide_int_and(ch_wide_int lhs, ch_wide_int rhs) {
+    for (int64 i = 0; i < CH_WIDE_INT_WORDS; i++) lhs.words[i] &= rhs.words[i];
+    return lhs;
+}
+
+CHOIR_API ch_wide_int ch_wide_int_or(ch_wide_int lhs, ch_wide_int rhs) {
+    for (int64 i = 0; i < CH_WIDE_INT_WORDS; i++) lhs.words[i] |= rhs.words[i];
+    return lhs;
+}
+
+CHOIR_API ch_wide_int ch_wide_int_xor(ch_wide_int lhs, ch_wide_int rhs) {
+    for (int64 i = 0; i < CH_WIDE_INT_WORDS; i++) lhs.words[i] ^= rhs.words[i];
+    return lhs;
+}
+
+CHOIR_API ch_wide_int ch_wide_int_not(ch_wide_int value) {
+    for (int64 i = 0; i < CH_WIDE_INT_WORDS; i++) value.words[i] = ~value.words[i];
+    return value;
+}
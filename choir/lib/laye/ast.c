@@ -1 +1,260 @@
 #include <laye/laye.h>
+#include <string.h>
+
+static_assert(LY_SN_COUNT <= 256, "syntax kinds must fit in a ly_syntax_node's kind field");
+static_assert(LY_TK_COUNT <= 65536, "token kinds must fit in a ly_syntax_node's token_kind field");
+static_assert(sizeof(ly_syntax_node) == 20, "syntax nodes should stay small; think twice before growing them");
+
+CHOIR_API const char* ly_syntax_kind_name_get(ly_syntax_kind kind) {
+    switch (kind) {
+        default: return "[unknown Laye syntax kind]";
+        // clang-format off
+#define LY_SYNTAX(Name) case LY_SN_##Name: return #Name;
+#include <laye/syntax.inc>
+        // clang-format on
+    }
+}
+
+CHOIR_API void ly_syntax_tree_init(ly_syntax_tree* tree, ch_allocator allocator, ch_source* source) {
+    *tree = (ly_syntax_tree){
+        .source = source,
+        .nodes.allocator = allocator,
+        .extra.allocator = allocator,
+        .strings.allocator = allocator,
+    };
+
+    ly_syntax_node none = {0};
+    da_push(&tree->nodes, none);
+
+    ly_syntax_string empty = {"", 0};
+    da_push(&tree->strings, empty);
+}
+
+CHOIR_API void ly_syntax_tree_deinit(ly_syntax_tree* tree) {
+    // a mapped tree's nodes and extra data belong to the mapping; only its string table was allocated.
+    if (!tree->is_mapped) {
+        da_free(&tree->nodes);
+        da_free(&tree->extra);
+    }
+
+    da_free(&tree->strings);
+    *tree = (ly_syntax_tree){0};
+}
+
+CHOIR_API void ly_syntax_tree_release_strings(ly_syntax_tree* tree) {
+    da_free(&tree->strings);
+    tree->strings = (ly_syntax_strings){.allocator = tree->strings.allocator};
+    tree->text = NULL;
+}
+
+CHOIR_API ly_syntax_id ly_syntax_add(ly_syntax_tree* tree, ly_syntax_node node) {
+    assert(tree->nodes.count > 0 && "the syntax tree was not initialized");
+    assert(!tree->is_mapped && "cannot add to a syntax tree loaded from the syntax cache");
+    assert(tree->nodes.count < UINT32_MAX && "too many syntax nodes for 32-bit ids");
+
+    ly_syntax_id id = cast(ly_syntax_id) tree->nodes.count;
+    da_push(&tree->nodes, node);
+    return id;
+}
+
+CHOIR_API uint32 ly_syntax_add_extra(ly_syntax_tree* tree, const uint32* words, int64 count) {
+    assert(!tree->is_mapped && "cannot add to a syntax tree loaded from the syntax cache");
+    assert(tree->extra.count + count < UINT32_MAX && "too much syntax extra data for 32-bit indices");
+
+    uint32 index = cast(uint32) tree->extra.count;
+    if (count > 0) {
+        da_push_many(&tree->extra, words, count);
+    }
+
+    return index;
+}
+
+CHOIR_API uint32 ly_syntax_add_list(ly_syntax_tree* tree, const ly_syntax_id* ids, int64 count) {
+    assert(count >= 0 && count < UINT32_MAX && "invalid syntax list length");
+
+    uint32 count_word = cast(uint32) count;
+    uint32 index = ly_syntax_add_extra(tree, &count_word, 1);
+    discard ly_syntax_add_extra(tree, ids, count);
+    return index;
+}
+
+CHOIR_API uint32 ly_syntax_add_string(ly_syntax_tree* tree, const char* text, int64 length) {
+    assert(!tree->is_mapped && "cannot add to a syntax tree loaded from the syntax cache");
+    assert(tree->strings.count < UINT32_MAX && "too many syntax strings for 32-bit indices");
+
+    uint32 index = cast(uint32) tree->strings.count;
+    ly_syntax_string string = {text, length};
+    da_push(&tree->strings, string);
+    return index;
+}
+
+CHOIR_API ly_syntax_node* ly_syntax_get(ly_syntax_tree* tree, ly_syntax_id id) {
+    assert(id < tree->nodes.count && "syntax node id out of range");
+    return &tree->nodes.items[id];
+}
+
+CHOIR_API ly_syntax_list ly_syntax_list_get(ly_syntax_tree* tree, uint32 list_index) {
+    assert(list_index < tree->extra.count && "syntax list index out of range");
+
+    int64 count = tree->extra.items[list_index];
+    assert(list_index + 1 + count <= tree->extra.count && "syntax list extends past the extra data");
+
+    return (ly_syntax_list){
+        .items = tree->extra.items + list_index + 1,
+        .count = count,
+    };
+}
+
+CHOIR_API ly_syntax_string ly_syntax_string_get(ly_syntax_tree* tree, uint32 string_index) {
+    assert(tree->strings.items != NULL && "the tree's strings were released");
+    assert(string_index < tree->strings.count && "syntax string index out of range");
+    return tree->strings.items[string_index];
+}
+
+CHOIR_API ch_location ly_syntax_location(ly_syntax_tree* tree, ly_syntax_id id) {
+    ly_syntax_node* node = ly_syntax_get(tree, id);
+    return (ch_location){
+        .source = tree->source,
+        .offset = node->offset,
+        .length = node->length,
+    };
+}
+
+struct children {
+    ly_syntax_id* items;
+    int64 count, capacity;
+};
+
+static void children_add(struct children* children, ly_syntax_id id) {
+    if (id == 0) return;
+    if (children->count < children->capacity) {
+        children->items[children->count] = id;
+    }
+
+    children->count++;
+}
+
+static void children_add_list(struct children* children, ly_syntax_tree* tree, uint32 list_index) {
+    ly_syntax_list list = ly_syntax_list_get(tree, list_index);
+    for (int64 i = 0; i < list.count; i++) {
+        children_add(children, list.items[i]);
+    }
+}
+
+CHOIR_API int64 ly_syntax_children(ly_syntax_tree* tree, ly_syntax_id id, ly_syntax_id* items, int64 capacity) {
+    struct children children = {items, 0, capacity};
+    ly_syntax_node node = *ly_syntax_get(tree, id);
+    const uint32* extra = tree->extra.items;
+
+    switch (cast(ly_syntax_kind) node.kind) {
+        default: {
+            assert(false && "unhandled syntax kind in ly_syntax_children");
+        } break;
+
+        case LY_SN_NONE:
+        case LY_SN_INVALID:
+        case LY_SN_DECL_IMPORT:
+        case LY_SN_DECL_TEMPLATE_PARAM:
+        case LY_SN_STMT_BREAK:
+        case LY_SN_STMT_CONTINUE:
+        case LY_SN_STMT_GOTO:
+        case LY_SN_STMT_LABEL:
+        case LY_SN_STMT_UNREACHABLE:
+        case LY_SN_STMT_XYZZY:
+        case LY_SN_EXPR_NAMEREF:
+        case LY_SN_EXPR_LITERAL_INTEGER:
+        case LY_SN_EXPR_LITERAL_WIDE_INTEGER:
+        case LY_SN_EXPR_LITERAL_STRING:
+        case LY_SN_EXPR_LITERAL_RUNE:
+        case LY_SN_EXPR_LITERAL_BOOL:
+        case LY_SN_EXPR_LITERAL_NIL:
+        case LY_SN_TYPE_BUILTIN: break;
+
+        case LY_SN_MODULE_UNIT:
+        case LY_SN_STMT_COMPOUND: {
+            children_add_list(&children, tree, node.lhs);
+        } break;
+
+        case LY_SN_DECL_BINDING: {
+            children_add(&children, node.lhs);
+            children_add(&children, extra[node.rhs + 1]);
+        } break;
+
+        case LY_SN_DECL_FUNCTION: {
+            children_add(&children, extra[node.lhs + 0]);
+            children_add_list(&children, tree, extra[node.lhs + 2]);
+            children_add(&children, extra[node.lhs + 3]);
+        } break;
+
+        case LY_SN_DECL_PARAM:
+        case LY_SN_DECL_FIELD:
+        case LY_SN_STMT_EXPR:
+        case LY_SN_STMT_RETURN:
+        case LY_SN_STMT_YIELD:
+        case LY_SN_STMT_DEFER:
+        case LY_SN_STMT_DISCARD:
+        case LY_SN_STMT_DELETE:
+        case LY_SN_STMT_ASSERT:
+        case LY_SN_EXPR_GROUPED:
+        case LY_SN_EXPR_UNARY_PREFIX:
+        case LY_SN_EXPR_UNARY_POSTFIX:
+        case LY_SN_EXPR_FIELD:
+        case LY_SN_EXPR_QUERY:
+        case LY_SN_TYPE_POINTER:
+        case LY_SN_TYPE_BUFFER:
+        case LY_SN_TYPE_SLICE:
+        case LY_SN_TYPE_NILABLE:
+        case LY_SN_TYPE_RANGE:
+        case LY_SN_TYPE_MUT: {
+            children_add(&children, node.lhs);
+        } break;
+
+        case LY_SN_DECL_STRUCT:
+        case LY_SN_DECL_ENUM: {
+            children_add_list(&children, tree, node.rhs);
+        } break;
+
+        case LY_SN_DECL_ENUM_VARIANT:
+        case LY_SN_DECL_ALIAS: {
+            children_add(&children, node.rhs);
+        } break;
+
+        case LY_SN_STMT_ASSIGN:
+        case LY_SN_STMT_DO:
+        case LY_SN_EXPR_BINARY:
+        case LY_SN_EXPR_CAST: {
+            children_add(&children, node.lhs);
+            children_add(&children, node.rhs);
+        } break;
+
+        case LY_SN_STMT_IF:
+        case LY_SN_STMT_WHILE: {
+            children_add(&children, node.lhs);
+            children_add(&children, extra[node.rhs + 0]);
+            children_add(&children, extra[node.rhs + 1]);
+        } break;
+
+        case LY_SN_STMT_FOR: {
+            children_add(&children, extra[node.lhs + 0]);
+            children_add(&children, extra[node.lhs + 1]);
+            children_add(&children, extra[node.lhs + 2]);
+            children_add(&children, node.rhs);
+        } break;
+
+        case LY_SN_DECL_TEMPLATE: {
+            children_add_list(&children, tree, node.lhs);
+            children_add(&children, node.rhs);
+        } break;
+
+        case LY_SN_EXPR_CALL:
+        case LY_SN_EXPR_INDEX:
+        case LY_SN_EXPR_CONSTRUCTOR:
+        case LY_SN_EXPR_TEMPLATE:
+        case LY_SN_TYPE_ARRAY: {
+            children_add(&children, node.lhs);
+            children_add_list(&children, tree, node.rhs);
+        } break;
+    }
+
+    return children.count;
+}
@@ -0,0 +1,225 @@
+#include <laye/laye.h>
+#include <stdio.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#    define WIN32_LEAN_AND_MEAN
+#    include <windows.h>
+#endif
+
+// A cache file is the header followed by the tree's arrays, each stored exactly as it is in memory so the nodes and extra data can be used straight from a mapping:
+//
+//   header | nodes | extra data | strings | string bytes
+//
+// Strings can not be stored as pointers, so each one records where its text is instead: in the source text, as most identifiers are,
+// or in the string bytes at the end of the file, for text the lexer decoded such as string literals with escape sequences.
+
+#define LY_SYNTAX_CACHE_MAGIC "LYSYNTAX"
+#define LY_SYNTAX_CACHE_BYTE_ORDER 0x01020304u
+
+typedef struct ly_syntax_cache_header {
+    char magic[8];
+    uint32 version;
+    // catches files written on a machine with a different byte order.
+    uint32 byte_order;
+    uint64 key;
+    uint64 source_length;
+    uint32 root;
+    uint32 node_size;
+    uint32 node_count;
+    uint32 extra_count;
+    uint32 string_count;
+    uint32 reserved;
+    uint64 string_bytes_size;
+} ly_syntax_cache_header;
+
+typedef struct ly_syntax_cache_string {
+    uint32 is_in_string_bytes;
+    uint32 offset;
+    uint32 length;
+} ly_syntax_cache_string;
+
+static_assert(sizeof(ly_syntax_cache_header) == 64, "the syntax cache header should not have any padding");
+static_assert(sizeof(ly_syntax_cache_string) == 12, "syntax cache strings should not have any padding");
+
+CHOIR_API uint64 ly_syntax_cache_key(ch_source* source, const char* compiler_version) {
+    uint64 seed = ch_hash(compiler_version, cast(int64) strlen(compiler_version), LY_SYNTAX_CACHE_VERSION);
+    return ch_hash(source->text, source->length, seed);
+}
+
+static bool ly_syntax_cache_is_in_source(ly_syntax_tree* tree, ly_syntax_string string) {
+    uintptr_t text = cast(uintptr_t) string.text;
+    uintptr_t source_text = cast(uintptr_t) tree->source->text;
+    return text >= source_text && text + cast(uintptr_t) string.length <= source_text + cast(uintptr_t) tree->source->length;
+}
+
+static bool ly_syntax_cache_replace_file(const char* from, const char* to) {
+#if defined(_WIN32)
+    return MoveFileExA(from, to, MOVEFILE_REPLACE_EXISTING);
+#else
+    return 0 == rename(from, to);
+#endif
+}
+
+CHOIR_API bool ly_syntax_cache_write(ly_syntax_tree* tree, uint64 key, const char* path) {
+    assert(tree->root != 0 && "only parsed syntax trees can be cached");
+    assert(tree->source->length < UINT32_MAX && "syntax tree offsets are 32-bit");
+
+    bool result = true;
+    ch_allocator allocator = tree->strings.allocator;
+
+    int64 string_count = tree->strings.count;
+    ly_syntax_cache_string* strings = ch_alloc(allocator, string_count * cast(int64) sizeof *strings);
+
+    uint64 string_bytes_size = 0;
+    for (int64 i = 0; i < string_count; i++) {
+        ly_syntax_string string = tree->strings.items[i];
+        if (string.length == 0) {
+            strings[i] = (ly_syntax_cache_string){0};
+        } else if (ly_syntax_cache_is_in_source(tree, string)) {
+            strings[i] = (ly_syntax_cache_string){
+                .offset = cast(uint32)(string.text - tree->source->text),
+                .length = cast(uint32) string.length,
+            };
+        } else {
+            strings[i] = (ly_syntax_cache_string){
+                .is_in_string_bytes = 1,
+                .offset = cast(uint32) string_bytes_size,
+                .length = cast(uint32) string.length,
+            };
+
+            string_bytes_size += cast(uint64) string.length;
+        }
+    }
+
+    ly_syntax_cache_header header = {
+        .version = LY_SYNTAX_CACHE_VERSION,
+        .byte_order = LY_SYNTAX_CACHE_BYTE_ORDER,
+        .key = key,
+        .source_length = cast(uint64) tree->source->length,
+        .root = tree->root,
+        .node_size = sizeof(ly_syntax_node),
+        .node_count = cast(uint32) tree->nodes.count,
+        .extra_count = cast(uint32) tree->extra.count,
+        .string_count = cast(uint32) string_count,
+        .string_bytes_size = string_bytes_size,
+    };
+
+    memcpy(header.magic, LY_SYNTAX_CACHE_MAGIC, sizeof header.magic);
+
+    int64 path_length = cast(int64) strlen(path);
+    char* temporary_path = ch_alloc(allocator, path_length + 5);
+    memcpy(temporary_path, path, cast(usize) path_length);
+    memcpy(temporary_path + path_length, ".tmp", 5);
+
+    FILE* stream = fopen(temporary_path, "wb");
+    if (stream == NULL) {
+        return_defer(false);
+    }
+
+    bool written = 1 == fwrite(&header, sizeof header, 1, stream);
+    written = written && cast(usize) tree->nodes.count == fwrite(tree->nodes.items, sizeof(ly_syntax_node), cast(usize) tree->nodes.count, stream);
+    written = written && cast(usize) tree->extra.count == fwrite(tree->extra.items, sizeof(uint32), cast(usize) tree->extra.count, stream);
+    written = written && cast(usize) string_count == fwrite(strings, sizeof *strings, cast(usize) string_count, stream);
+
+    for (int64 i = 0; written && i < string_count; i++) {
+        if (!strings[i].is_in_string_bytes) continue;
+        ly_syntax_string string = tree->strings.items[i];
+        written = cast(usize) string.length == fwrite(string.text, 1, cast(usize) string.length, stream);
+    }
+
+    written = (0 == fclose(stream)) && written;
+    if (!written || !ly_syntax_cache_replace_file(temporary_path, path)) {
+        discard remove(temporary_path);
+        return_defer(false);
+    }
+
+defer:
+    ch_dealloc(allocator, temporary_path);
+    ch_dealloc(allocator, strings);
+    return result;
+}
+
+CHOIR_API bool ly_syntax_cache_read(ly_syntax_tree* tree, ch_allocator allocator, ch_source* source, uint64 key, const char* path, ch_mapped_file* mapping) {
+    if (!ch_file_map(mapping, path)) {
+        return false;
+    }
+
+    bool result = true;
+    ly_syntax_strings strings = {.allocator = allocator};
+
+    if (mapping->size < cast(int64) sizeof(ly_syntax_cache_header)) {
+        return_defer(false);
+    }
+
+    const char* data = mapping->data;
+    ly_syntax_cache_header header;
+    memcpy(&header, data, sizeof header);
+
+    bool is_compatible = 0 == memcmp(header.magic, LY_SYNTAX_CACHE_MAGIC, sizeof header.magic) &&
+                         header.version == LY_SYNTAX_CACHE_VERSION &&
+                         header.byte_order == LY_SYNTAX_CACHE_BYTE_ORDER &&
+                         header.node_size == sizeof(ly_syntax_node);
+
+    if (!is_compatible || header.key != key || header.source_length != cast(uint64) source->length) {
+        return_defer(false);
+    }
+
+    // node 0 and string 0 always exist, for the absent node and the empty string.
+    if (header.node_count == 0 || header.string_count == 0 || header.root == 0 || header.root >= header.node_count) {
+        return_defer(false);
+    }
+
+    int64 nodes_offset = sizeof header;
+    int64 extra_offset = nodes_offset + cast(int64) header.node_count * cast(int64) sizeof(ly_syntax_node);
+    int64 strings_offset = extra_offset + cast(int64) header.extra_count * cast(int64) sizeof(uint32);
+    int64 string_bytes_offset = strings_offset + cast(int64) header.string_count * cast(int64) sizeof(ly_syntax_cache_string);
+    if (mapping->size != string_bytes_offset + cast(int64) header.string_bytes_size) {
+        return_defer(false);
+    }
+
+    const char* string_bytes = data + string_bytes_offset;
+    strings.items = ch_alloc(allocator, cast(int64) header.string_count * cast(int64) sizeof *strings.items);
+    strings.count = strings.capacity = header.string_count;
+
+    for (int64 i = 0; i < strings.count; i++) {
+        ly_syntax_cache_string string;
+        memcpy(&string, data + strings_offset + i * cast(int64) sizeof string, sizeof string);
+
+        uint64 end = cast(uint64) string.offset + string.length;
+        if (string.is_in_string_bytes ? end > header.string_bytes_size : end > cast(uint64) source->length) {
+            return_defer(false);
+        }
+
+        const char* text = string.is_in_string_bytes ? string_bytes : source->text;
+        strings.items[i] = (ly_syntax_string){text + string.offset, string.length};
+    }
+
+    *tree = (ly_syntax_tree){
+        .source = source,
+        .nodes = {
+            .allocator = allocator,
+            .items = cast(ly_syntax_node*)(data + nodes_offset),
+            .count = header.node_count,
+            .capacity = header.node_count,
+        },
+        .extra = {
+            .allocator = allocator,
+            .items = cast(uint32*)(data + extra_offset),
+            .count = header.extra_count,
+            .capacity = header.extra_count,
+        },
+        .strings = strings,
+        .root = header.root,
+        .text = source->text,
+        .is_mapped = true,
+    };
+
+defer:
+    if (!result) {
+        da_free(&strings);
+        ch_file_unmap(mapping);
+    }
+
+    return result;
+}
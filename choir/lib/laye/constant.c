@@ -0,0 +1,493 @@
+#include <laye/laye.h>
+#include <string.h>
+
+// Expressions are evaluated with explicit stacks rather than recursion, so a long chain of operators cannot overflow the C stack.
+// Both stacks start out in these fixed buffers, which any reasonable constant fits in without allocating.
+#define LY_CONSTANT_INLINE_WORK_COUNT 64
+#define LY_CONSTANT_INLINE_VALUE_COUNT 16
+
+typedef enum constant_status {
+    CONSTANT_OK,
+    CONSTANT_OVERFLOW,
+    CONSTANT_DIVISION_BY_ZERO,
+    CONSTANT_SHIFT_OUT_OF_RANGE,
+} constant_status;
+
+static ly_constant_integer constant_integer_small(int64 value) {
+    return (ly_constant_integer){.value = value};
+}
+
+// Demotes a wide value back to 64 bits if it fits, so later arithmetic takes the fast path again.
+static ly_constant_integer constant_integer_from_wide(ch_wide_int wide) {
+    int64 value;
+    if (ch_wide_int_to_int64(wide, &value)) {
+        return constant_integer_small(value);
+    }
+
+    return (ly_constant_integer){.is_wide = true, .wide = wide};
+}
+
+static ch_wide_int constant_integer_to_wide(ly_constant_integer integer) {
+    return integer.is_wide ? integer.wide : ch_wide_int_from_int64(integer.value);
+}
+
+CHOIR_API bool ly_constant_integer_to_uint64(ly_constant_integer integer, uint64* out_value) {
+    if (!integer.is_wide) {
+        if (integer.value < 0) return false;
+        *out_value = cast(uint64) integer.value;
+        return true;
+    }
+
+    for (int64 i = 1; i < CH_WIDE_INT_WORDS; i++) {
+        if (integer.wide.words[i] != 0) return false;
+    }
+
+    *out_value = integer.wide.words[0];
+    return true;
+}
+
+// The 64-bit operations report overflow instead of wrapping, so the caller can redo the operation with wide integers.
+
+static bool constant_add_small(int64 lhs, int64 rhs, int64* out_result) {
+    if ((rhs > 0 && lhs > INT64_MAX - rhs) || (rhs < 0 && lhs < INT64_MIN - rhs)) return false;
+    *out_result = lhs + rhs;
+    return true;
+}
+
+static bool constant_sub_small(int64 lhs, int64 rhs, int64* out_result) {
+    if ((rhs < 0 && lhs > INT64_MAX + rhs) || (rhs > 0 && lhs < INT64_MIN + rhs)) return false;
+    *out_result = lhs - rhs;
+    return true;
+}
+
+static bool constant_mul_small(int64 lhs, int64 rhs, int64* out_result) {
+    if (lhs == 0 || rhs == 0) {
+        *out_result = 0;
+        return true;
+    }
+
+    if ((lhs == -1 && rhs == INT64_MIN) || (rhs == -1 && lhs == INT64_MIN)) return false;
+
+    // multiplying as unsigned wraps instead of overflowing, and dividing back finds out whether it did.
+    int64 result = cast(int64)(cast(uint64) lhs * cast(uint64) rhs);
+    if (result / rhs != lhs) return false;
+
+    *out_result = result;
+    return true;
+}
+
+static constant_status constant_shift_count(ly_constant_integer count, int64* out_count) {
+    if (count.is_wide || count.value < 0 || count.value >= CH_WIDE_INT_WORDS * 64) {
+        return CONSTANT_SHIFT_OUT_OF_RANGE;
+    }
+
+    *out_count = count.value;
+    return CONSTANT_OK;
+}
+
+static constant_status constant_integer_binary(ly_token_kind op, ly_constant_integer lhs, ly_constant_integer rhs, ly_constant_integer* out_result) {
+    switch (op) {
+        default: assert(false && "not an integer operator"); return CONSTANT_OK;
+
+        case LY_TK_PLUS:
+        case LY_TK_MINUS:
+        case LY_TK_STAR: {
+            int64 small;
+            if (!lhs.is_wide && !rhs.is_wide) {
+                bool fits = op == LY_TK_PLUS  ? constant_add_small(lhs.value, rhs.value, &small)
+                          : op == LY_TK_MINUS ? constant_sub_small(lhs.value, rhs.value, &small)
+                                              : constant_mul_small(lhs.value, rhs.value, &small);
+                if (fits) {
+                    *out_result = constant_integer_small(small);
+                    return CONSTANT_OK;
+                }
+            }
+
+            ch_wide_int a = constant_integer_to_wide(lhs), b = constant_integer_to_wide(rhs), result;
+            bool fits = op == LY_TK_PLUS  ? ch_wide_int_add(a, b, &result)
+                      : op == LY_TK_MINUS ? ch_wide_int_sub(a, b, &result)
+                                          : ch_wide_int_mul(a, b, &result);
+            if (!fits) return CONSTANT_OVERFLOW;
+
+            *out_result = constant_integer_from_wide(result);
+            return CONSTANT_OK;
+        }
+
+        case LY_TK_SLASH:
+        case LY_TK_PERCENT: {
+            if (!rhs.is_wide && rhs.value == 0) return CONSTANT_DIVISION_BY_ZERO;
+
+            if (!lhs.is_wide && !rhs.is_wide && !(lhs.value == INT64_MIN && rhs.value == -1)) {
+                *out_result = constant_integer_small(op == LY_TK_SLASH ? lhs.value / rhs.value : lhs.value % rhs.value);
+                return CONSTANT_OK;
+            }
+
+            ch_wide_int quotient, remainder;
+            bool fits = ch_wide_int_div_rem(constant_integer_to_wide(lhs), constant_integer_to_wide(rhs), &quotient, &remainder);
+            if (op == LY_TK_SLASH && !fits) return CONSTANT_OVERFLOW;
+
+            *out_result = constant_integer_from_wide(op == LY_TK_SLASH ? quotient : remainder);
+            return CONSTANT_OK;
+        }
+
+        case LY_TK_AMPERSAND:
+        case LY_TK_PIPE:
+        case LY_TK_TILDE: {
+            if (!lhs.is_wide && !rhs.is_wide) {
+                int64 result = op == LY_TK_AMPERSAND ? (lhs.value & rhs.value)
+                             : op == LY_TK_PIPE      ? (lhs.value | rhs.value)
+                                                     : (lhs.value ^ rhs.value);
+                *out_result = constant_integer_small(result);
+                return CONSTANT_OK;
+            }
+
+            ch_wide_int a = constant_integer_to_wide(lhs), b = constant_integer_to_wide(rhs);
+            ch_wide_int result = op == LY_TK_AMPERSAND ? ch_wide_int_and(a, b)
+                               : op == LY_TK_PIPE      ? ch_wide_int_or(a, b)
+                                                       : ch_wide_int_xor(a, b);
+            *out_result = constant_integer_from_wide(result);
+            return CONSTANT_OK;
+        }
+
+        case LY_TK_LESS_LESS: {
+            int64 count;
+            if (constant_shift_count(rhs, &count) != CONSTANT_OK) return CONSTANT_SHIFT_OUT_OF_RANGE;
+
+            if (!lhs.is_wide && count < 63) {
+                int64 result = cast(int64)(cast(uint64) lhs.value << count);
+                if ((result >> count) == lhs.value) {
+                    *out_result = constant_integer_small(result);
+                    return CONSTANT_OK;
+                }
+            }
+
+            ch_wide_int result;
+            if (!ch_wide_int_shl(constant_integer_to_wide(lhs), count, &result)) return CONSTANT_OVERFLOW;
+
+            *out_result = constant_integer_from_wide(result);
+            return CONSTANT_OK;
+        }
+
+        case LY_TK_GREATER_GREATER: {
+            int64 count;
+            if (constant_shift_count(rhs, &count) != CONSTANT_OK) return CONSTANT_SHIFT_OUT_OF_RANGE;
+
+            if (!lhs.is_wide) {
+                *out_result = constant_integer_small(count < 64 ? lhs.value >> count : (lhs.value < 0 ? -1 : 0));
+                return CONSTANT_OK;
+            }
+
+            *out_result = constant_integer_from_wide(ch_wide_int_shr(lhs.wide, count));
+            return CONSTANT_OK;
+        }
+    }
+}
+
+static int constant_integer_compare(ly_constant_integer lhs, ly_constant_integer rhs) {
+    if (!lhs.is_wide && !rhs.is_wide) {
+        return lhs.value < rhs.value ? -1 : lhs.value > rhs.value ? 1 : 0;
+    }
+
+    return ch_wide_int_compare(constant_integer_to_wide(lhs), constant_integer_to_wide(rhs));
+}
+
+static bool constant_is_integer_operator(ly_token_kind op) {
+    switch (op) {
+        default: return false;
+        case LY_TK_PLUS:
+        case LY_TK_MINUS:
+        case LY_TK_STAR:
+        case LY_TK_SLASH:
+        case LY_TK_PERCENT:
+        case LY_TK_AMPERSAND:
+        case LY_TK_PIPE:
+        case LY_TK_TILDE:
+        case LY_TK_LESS_LESS:
+        case LY_TK_GREATER_GREATER: return true;
+    }
+}
+
+static bool constant_is_comparison(ly_token_kind op) {
+    switch (op) {
+        default: return false;
+        case LY_TK_EQUAL_EQUAL:
+        case LY_TK_BANG_EQUAL:
+        case LY_TK_LESS:
+        case LY_TK_LESS_EQUAL:
+        case LY_TK_GREATER:
+        case LY_TK_GREATER_EQUAL: return true;
+    }
+}
+
+typedef struct constant_work {
+    ly_syntax_id id;
+    // false to evaluate the node's operands, true to combine their values once they have been evaluated.
+    bool is_apply;
+} constant_work;
+
+typedef struct constant_evaluator {
+    ch_context* context;
+    ch_allocator allocator;
+    ly_syntax_tree* tree;
+    ly_constant_query_fn query;
+    void* userdata;
+
+    constant_work* work;
+    int64 work_count, work_capacity;
+    ly_constant* values;
+    int64 value_count, value_capacity;
+
+    constant_work inline_work[LY_CONSTANT_INLINE_WORK_COUNT];
+    ly_constant inline_values[LY_CONSTANT_INLINE_VALUE_COUNT];
+} constant_evaluator;
+
+// Grows one of the evaluator's stacks, moving it off of its fixed buffer the first time.
+static void* constant_stack_grow(constant_evaluator* e, void* items, int64 count, int64* capacity, int64 item_size, void* inline_items) {
+    int64 new_capacity = *capacity * 2;
+    void* new_items = ch_alloc(e->allocator, new_capacity * item_size);
+    memcpy(new_items, items, cast(usize)(count * item_size));
+
+    if (items != inline_items) {
+        ch_dealloc(e->allocator, items);
+    }
+
+    *capacity = new_capacity;
+    return new_items;
+}
+
+static void constant_push_work(constant_evaluator* e, ly_syntax_id id, bool is_apply) {
+    if (e->work_count == e->work_capacity) {
+        e->work = constant_stack_grow(e, e->work, e->work_count, &e->work_capacity, sizeof *e->work, e->inline_work);
+    }
+
+    e->work[e->work_count++] = (constant_work){id, is_apply};
+}
+
+static void constant_push_value(constant_evaluator* e, ly_constant value) {
+    if (e->value_count == e->value_capacity) {
+        e->values = constant_stack_grow(e, e->values, e->value_count, &e->value_capacity, sizeof *e->values, e->inline_values);
+    }
+
+    e->values[e->value_count++] = value;
+}
+
+static ly_constant constant_pop_value(constant_evaluator* e) {
+    assert(e->value_count > 0 && "constant evaluation popped more values than it pushed");
+    return e->values[--e->value_count];
+}
+
+static bool constant_error(constant_evaluator* e, ly_syntax_id id, const char* message) {
+    ch_diag(e->context, CH_DIAG_ERROR, ly_syntax_location(e->tree, id), "%s", message);
+    return false;
+}
+
+static bool constant_status_check(constant_evaluator* e, ly_syntax_id id, constant_status status) {
+    switch (status) {
+        case CONSTANT_OK: return true;
+        case CONSTANT_OVERFLOW: {
+            ch_diag(e->context, CH_DIAG_ERROR, ly_syntax_location(e->tree, id), "constant expression overflows %d bits", CH_WIDE_INT_WORDS * 64);
+            return false;
+        }
+
+        case CONSTANT_DIVISION_BY_ZERO: return constant_error(e, id, "division by zero in a constant expression");
+        case CONSTANT_SHIFT_OUT_OF_RANGE: return constant_error(e, id, "shift count is out of range in a constant expression");
+    }
+
+    return false;
+}
+
+// Starts evaluating a node: leaves push their value, operators push themselves to be applied after their operands.
+static bool constant_visit(constant_evaluator* e, ly_syntax_id id) {
+    ly_syntax_node node = *ly_syntax_get(e->tree, id);
+
+    switch (cast(ly_syntax_kind) node.kind) {
+        default: return constant_error(e, id, "expression is not constant");
+
+        case LY_SN_EXPR_LITERAL_INTEGER: {
+            // the lexer only stores values which fit in a signed 64-bit integer this way.
+            uint64 value = cast(uint64) node.lhs | (cast(uint64) node.rhs << 32);
+            constant_push_value(e, (ly_constant){.kind = LY_CK_INTEGER, .integer = constant_integer_small(cast(int64) value)});
+        } break;
+
+        case LY_SN_EXPR_LITERAL_WIDE_INTEGER: {
+            ch_wide_int wide;
+            for (int64 i = 0; i < CH_WIDE_INT_WORDS; i++) {
+                wide.words[i] = cast(uint64) e->tree->extra.items[node.lhs + 2 * i] | (cast(uint64) e->tree->extra.items[node.lhs + 2 * i + 1] << 32);
+            }
+
+            // literals are unsigned, so one using the top bit is too large for a signed constant.
+            if (ch_wide_int_is_negative(wide)) {
+                return constant_status_check(e, id, CONSTANT_OVERFLOW);
+            }
+
+            constant_push_value(e, (ly_constant){.kind = LY_CK_INTEGER, .integer = constant_integer_from_wide(wide)});
+        } break;
+
+        case LY_SN_EXPR_LITERAL_BOOL: {
+            constant_push_value(e, (ly_constant){.kind = LY_CK_BOOL, .bool_value = node.lhs != 0});
+        } break;
+
+        case LY_SN_EXPR_GROUPED: {
+            constant_push_work(e, node.lhs, false);
+        } break;
+
+        case LY_SN_EXPR_QUERY: {
+            if (e->query == NULL) {
+                return constant_error(e, id, "expression is not constant");
+            }
+
+            ly_constant value;
+            if (!e->query(e->userdata, id, &value)) {
+                return false;
+            }
+
+            constant_push_value(e, value);
+        } break;
+
+        case LY_SN_EXPR_UNARY_PREFIX: {
+            if (node.token_kind != LY_TK_MINUS && node.token_kind != LY_TK_PLUS && node.token_kind != LY_TK_TILDE && node.token_kind != LY_TK_NOT) {
+                return constant_error(e, id, "expression is not constant");
+            }
+
+            constant_push_work(e, id, true);
+            constant_push_work(e, node.lhs, false);
+        } break;
+
+        case LY_SN_EXPR_BINARY: {
+            if (node.rhs == 0) {
+                return constant_error(e, id, "expression is not constant");
+            }
+
+            // pushed in reverse, so the left operand is evaluated first.
+            constant_push_work(e, id, true);
+            constant_push_work(e, node.rhs, false);
+            constant_push_work(e, node.lhs, false);
+        } break;
+    }
+
+    return true;
+}
+
+static bool constant_apply_unary(constant_evaluator* e, ly_syntax_id id, ly_token_kind op) {
+    ly_constant operand = constant_pop_value(e);
+
+    if (op == LY_TK_NOT) {
+        if (operand.kind != LY_CK_BOOL) return constant_error(e, id, "the operand of 'not' must be a bool");
+        constant_push_value(e, (ly_constant){.kind = LY_CK_BOOL, .bool_value = !operand.bool_value});
+        return true;
+    }
+
+    if (operand.kind != LY_CK_INTEGER) {
+        return constant_error(e, id, "the operand of this operator must be an integer");
+    }
+
+    ly_constant_integer result = operand.integer;
+    if (op == LY_TK_MINUS) {
+        if (!constant_status_check(e, id, constant_integer_binary(LY_TK_MINUS, constant_integer_small(0), operand.integer, &result))) {
+            return false;
+        }
+    } else if (op == LY_TK_TILDE) {
+        result = operand.integer.is_wide ? constant_integer_from_wide(ch_wide_int_not(operand.integer.wide)) : constant_integer_small(~operand.integer.value);
+    }
+
+    constant_push_value(e, (ly_constant){.kind = LY_CK_INTEGER, .integer = result});
+    return true;
+}
+
+static bool constant_apply_binary(constant_evaluator* e, ly_syntax_id id, ly_token_kind op) {
+    ly_constant rhs = constant_pop_value(e);
+    ly_constant lhs = constant_pop_value(e);
+
+    if (op == LY_TK_AND || op == LY_TK_OR || op == LY_TK_XOR) {
+        if (lhs.kind != LY_CK_BOOL || rhs.kind != LY_CK_BOOL) return constant_error(e, id, "the operands of this operator must be bools");
+
+        bool value = op == LY_TK_AND ? (lhs.bool_value && rhs.bool_value)
+                   : op == LY_TK_OR  ? (lhs.bool_value || rhs.bool_value)
+                                     : (lhs.bool_value != rhs.bool_value);
+        constant_push_value(e, (ly_constant){.kind = LY_CK_BOOL, .bool_value = value});
+        return true;
+    }
+
+    if ((op == LY_TK_EQUAL_EQUAL || op == LY_TK_BANG_EQUAL) && lhs.kind == LY_CK_BOOL && rhs.kind == LY_CK_BOOL) {
+        bool value = (lhs.bool_value == rhs.bool_value) == (op == LY_TK_EQUAL_EQUAL);
+        constant_push_value(e, (ly_constant){.kind = LY_CK_BOOL, .bool_value = value});
+        return true;
+    }
+
+    if (lhs.kind != LY_CK_INTEGER || rhs.kind != LY_CK_INTEGER) {
+        return constant_error(e, id, "the operands of this operator must be integers");
+    }
+
+    if (constant_is_comparison(op)) {
+        int order = constant_integer_compare(lhs.integer, rhs.integer);
+        bool value = op == LY_TK_EQUAL_EQUAL ? order == 0
+                   : op == LY_TK_BANG_EQUAL  ? order != 0
+                   : op == LY_TK_LESS        ? order < 0
+                   : op == LY_TK_LESS_EQUAL  ? order <= 0
+                   : op == LY_TK_GREATER     ? order > 0
+                                             : order >= 0;
+        constant_push_value(e, (ly_constant){.kind = LY_CK_BOOL, .bool_value = value});
+        return true;
+    }
+
+    if (op == LY_TK_DOT_DOT || op == LY_TK_DOT_DOT_EQUAL) {
+        ly_constant range = {.kind = LY_CK_RANGE, .integer = lhs.integer, .range_end = rhs.integer};
+        if (op == LY_TK_DOT_DOT_EQUAL && !constant_status_check(e, id, constant_integer_binary(LY_TK_PLUS, rhs.integer, constant_integer_small(1), &range.range_end))) {
+            return false;
+        }
+
+        constant_push_value(e, range);
+        return true;
+    }
+
+    if (!constant_is_integer_operator(op)) {
+        return constant_error(e, id, "expression is not constant");
+    }
+
+    ly_constant result = {.kind = LY_CK_INTEGER};
+    if (!constant_status_check(e, id, constant_integer_binary(op, lhs.integer, rhs.integer, &result.integer))) {
+        return false;
+    }
+
+    constant_push_value(e, result);
+    return true;
+}
+
+CHOIR_API bool ly_constant_evaluate(ch_context* context, ch_allocator allocator, ly_syntax_tree* tree, ly_syntax_id id, ly_constant_query_fn query, void* userdata, ly_constant* out_constant) {
+    constant_evaluator e = {
+        .context = context,
+        .allocator = allocator,
+        .tree = tree,
+        .query = query,
+        .userdata = userdata,
+        .work_capacity = LY_CONSTANT_INLINE_WORK_COUNT,
+        .value_capacity = LY_CONSTANT_INLINE_VALUE_COUNT,
+    };
+
+    e.work = e.inline_work;
+    e.values = e.inline_values;
+
+    bool result = true;
+
+    constant_push_work(&e, id, false);
+    while (e.work_count > 0) {
+        constant_work work = e.work[--e.work_count];
+        if (!work.is_apply) {
+            if (!constant_visit(&e, work.id)) return_defer(false);
+            continue;
+        }
+
+        ly_syntax_node* node = ly_syntax_get(tree, work.id);
+        bool applied = node->kind == LY_SN_EXPR_UNARY_PREFIX ? constant_apply_unary(&e, work.id, node->token_kind)
+                                                             : constant_apply_binary(&e, work.id, node->token_kind);
+        if (!applied) return_defer(false);
+    }
+
+    assert(e.value_count == 1 && "constant evaluation should leave exactly one value");
+    *out_constant = e.values[0];
+
+defer:
+    if (e.work != e.inline_work) ch_dealloc(allocator, e.work);
+    if (e.values != e.inline_values) ch_dealloc(allocator, e.values);
+    return result;
+}
@@ -0,0 +1,95 @@
+#include <laye/laye.h>
+#include <string.h>
+
+#define LY_LAYOUT_CACHE_INITIAL_SLOT_COUNT 64
+
+// 1024 layouts per chunk, and up to 16M of them.
+#define LY_LAYOUT_CACHE_CHUNK_SHIFT 10
+#define LY_LAYOUT_CACHE_MAX_CHUNK_COUNT (1 << 14)
+
+CHOIR_API void ly_layout_cache_init(ly_layout_cache* cache, ch_allocator allocator, const ch_target* target) {
+    *cache = (ly_layout_cache){
+        .allocator = allocator,
+        .target = target,
+        .slot_count = LY_LAYOUT_CACHE_INITIAL_SLOT_COUNT,
+    };
+
+    ch_mutex_init(&cache->mutex, allocator);
+    ch_stable_array_init(&cache->layouts, allocator, sizeof(ly_struct_layout), LY_LAYOUT_CACHE_CHUNK_SHIFT, LY_LAYOUT_CACHE_MAX_CHUNK_COUNT);
+    cache->slots = ch_alloc(allocator, cache->slot_count * cast(int64) sizeof *cache->slots);
+    memset(cache->slots, 0, cast(usize) cache->slot_count * sizeof *cache->slots);
+}
+
+CHOIR_API void ly_layout_cache_deinit(ly_layout_cache* cache) {
+    for (int64 i = 0; i < cache->layouts.count; i++) {
+        ly_struct_layout* layout = ch_stable_array_get(&cache->layouts, i);
+        ch_dealloc(cache->allocator, layout->fields);
+    }
+
+    ch_dealloc(cache->allocator, cache->slots);
+    ch_stable_array_deinit(&cache->layouts);
+    ch_mutex_deinit(&cache->mutex);
+    *cache = (ly_layout_cache){0};
+}
+
+// Returns the slot holding the layout of a struct type, or the empty slot it would be stored in.
+static uint32* ly_layout_cache_probe(ly_layout_cache* cache, ly_type_id struct_type) {
+    int64 mask = cache->slot_count - 1;
+    uint64 hash = ch_hash(&struct_type, sizeof struct_type, 0);
+    for (int64 index = cast(int64)(hash & cast(uint64) mask);; index = (index + 1) & mask) {
+        uint32* slot = &cache->slots[index];
+        if (*slot == 0) {
+            return slot;
+        }
+
+        ly_struct_layout* layout = ch_stable_array_get(&cache->layouts, *slot - 1);
+        if (layout->type == struct_type) {
+            return slot;
+        }
+    }
+}
+
+static void ly_layout_cache_grow(ly_layout_cache* cache) {
+    ch_dealloc(cache->allocator, cache->slots);
+
+    cache->slot_count *= 2;
+    cache->slots = ch_alloc(cache->allocator, cache->slot_count * cast(int64) sizeof *cache->slots);
+    memset(cache->slots, 0, cast(usize) cache->slot_count * sizeof *cache->slots);
+
+    for (int64 i = 0; i < cache->layouts.count; i++) {
+        ly_struct_layout* layout = ch_stable_array_get(&cache->layouts, i);
+        *ly_layout_cache_probe(cache, layout->type) = cast(uint32)(i + 1);
+    }
+}
+
+CHOIR_API ly_struct_layout* ly_layout_cache_find(ly_layout_cache* cache, ly_type_id struct_type) {
+    ch_mutex_lock(&cache->mutex);
+    uint32 slot = *ly_layout_cache_probe(cache, struct_type);
+    ly_struct_layout* layout = slot == 0 ? NULL : ch_stable_array_get(&cache->layouts, slot - 1);
+    ch_mutex_unlock(&cache->mutex);
+
+    return layout;
+}
+
+CHOIR_API ly_struct_layout* ly_layout_cache_add(ly_layout_cache* cache, ly_type_id struct_type) {
+    assert(struct_type != 0 && "layouts are only recorded for struct types");
+
+    ch_mutex_lock(&cache->mutex);
+    assert(cache->layouts.count < UINT32_MAX && "too many struct layouts");
+
+    uint32* slot = ly_layout_cache_probe(cache, struct_type);
+    assert(*slot == 0 && "a struct's layout is only computed once");
+
+    ly_struct_layout entry = {.type = struct_type, .state = LY_LS_COMPUTING};
+    int64 index = ch_stable_array_push(&cache->layouts, &entry, 1);
+    *slot = cast(uint32)(index + 1);
+
+    if (cache->layouts.count * 2 > cache->slot_count) {
+        ly_layout_cache_grow(cache);
+    }
+
+    ly_struct_layout* layout = ch_stable_array_get(&cache->layouts, index);
+    ch_mutex_unlock(&cache->mutex);
+
+    return layout;
+}
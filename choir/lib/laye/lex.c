@@ -1,32 +1,76 @@
 #include <laye/laye.h>
 #include <string.h>
+#include <threads.h>
 
-struct lexer {
-    ch_context* context;
-    ch_source* source;
-    ch_allocator token_allocator;
-    
-    bool preserve_trivia : 1;
+static_assert((LY_LEXER_LOOKAHEAD & (LY_LEXER_LOOKAHEAD - 1)) == 0, "LY_LEXER_LOOKAHEAD must be a power of two");
 
-    int64 position;
-};
+static void ly_read_token(ly_lexer* l, ly_token* token);
 
-static ly_token* ly_read_token(struct lexer* l);
+static once_flag ly_keyword_table_once;
+static void ly_keyword_table_init(void);
 
-CHOIR_API ly_token* ly_lex(ch_context* context, ch_source* source, ch_allocator token_allocator, ly_lex_flag flags) {
-    struct lexer lexer = {
-        .context = context,
-        .source = source,
-        .token_allocator = token_allocator,
-    };
+CHOIR_API void ly_lexer_init(ly_lexer* lexer, ch_context* context, ch_source* source, ch_allocator token_allocator, ly_lex_flag flags) {
+    assert(lexer != NULL && "where is the lexer?");
+    assert(source != NULL && "where is the source?");
+
+    memset(lexer, 0, sizeof *lexer);
+    lexer->context = context;
+    lexer->source = source;
+    lexer->token_allocator = token_allocator;
+    lexer->flags = flags;
+
+    call_once(&ly_keyword_table_once, ly_keyword_table_init);
+    discard ch_source_validate_utf8(context, source);
+}
+
+CHOIR_API ly_token* ly_lexer_peek(ly_lexer* lexer, int64 ahead) {
+    assert(lexer != NULL && "where is the lexer?");
+    assert(ahead >= 0 && ahead < LY_LEXER_LOOKAHEAD && "cannot peek that far ahead");
+
+    while (lexer->lookahead_count <= ahead) {
+        int64 index = (lexer->lookahead_start + lexer->lookahead_count) & (LY_LEXER_LOOKAHEAD - 1);
+        ly_token* token = &lexer->lookahead[index];
+
+        // once EOF has been buffered there's nothing left to read, so keep handing out copies of it.
+        if (lexer->lookahead_count > 0) {
+            ly_token* last = &lexer->lookahead[(index - 1) & (LY_LEXER_LOOKAHEAD - 1)];
+            if (last->kind == LY_TK_EOF) {
+                *token = *last;
+                lexer->lookahead_count++;
+                continue;
+            }
+        }
 
-    lexer.preserve_trivia = 0 != (flags & LY_LEX_PRESERVE_TRIVIA);
+        ly_read_token(lexer, token);
+        lexer->lookahead_count++;
+    }
+
+    return &lexer->lookahead[(lexer->lookahead_start + ahead) & (LY_LEXER_LOOKAHEAD - 1)];
+}
+
+CHOIR_API ly_token ly_lexer_next(ly_lexer* lexer) {
+    ly_token token = *ly_lexer_peek(lexer, 0);
+    if (token.kind == LY_TK_EOF && lexer->lookahead_count == 1) {
+        // leave EOF in the buffer so the lexer never has to re-read past the end of the source.
+        return token;
+    }
+
+    lexer->lookahead_start = (lexer->lookahead_start + 1) & (LY_LEXER_LOOKAHEAD - 1);
+    lexer->lookahead_count--;
+    return token;
+}
+
+CHOIR_API ly_token* ly_lex(ch_context* context, ch_source* source, ch_allocator token_allocator, ly_lex_flag flags) {
+    ly_lexer lexer = {0};
+    ly_lexer_init(&lexer, context, source, token_allocator, flags);
 
     ly_token* result = NULL;
     ly_token* previous = NULL;
 
     while (true) {
-        ly_token* token = ly_read_token(&lexer);
+        ly_token* token = ch_alloc(token_allocator, sizeof *token);
+        *token = ly_lexer_next(&lexer);
+
         if (result == NULL) {
             result = token;
         } else {
@@ -46,7 +90,115 @@ CHOIR_API ly_token* ly_lex(ch_context* context, ch_source* source, ch_allocator
     return result;
 }
 
-static char lexer_peek(struct lexer* l, int64 ahead) {
+static void ly_token_rebase(ly_token* token, ch_source* source, int64 delta) {
+    // identifiers and escape-free string literals are views into the source text, so they have to move along with their lexeme.
+    bool has_string_value = token->kind == LY_TK_LITERAL_STRING || (token->kind == LY_TK_IDENTIFIER && token->string_value != NULL);
+    int64 string_view_offset = -1;
+    if (has_string_value) {
+        uintptr_t string_address = cast(uintptr_t) token->string_value;
+        uintptr_t lexeme_address = cast(uintptr_t) token->lexeme_begin;
+        if (string_address >= lexeme_address && string_address < lexeme_address + cast(uintptr_t) token->lexeme_length) {
+            string_view_offset = cast(int64)(string_address - lexeme_address);
+        }
+    }
+
+    token->location.source = source;
+    token->location.offset += delta;
+    token->lexeme_begin = source->text + token->location.offset;
+
+    if (string_view_offset >= 0) {
+        token->string_value = token->lexeme_begin + string_view_offset;
+    }
+}
+
+static void ly_trivia_rebase(ly_token* trivia, ch_source* source, int64 delta) {
+    for (; trivia != NULL; trivia = trivia->next) {
+        ly_token_rebase(trivia, source, delta);
+    }
+}
+
+CHOIR_API ly_token* ly_relex(ch_context* context, ch_source* source, ly_token* tokens, ch_source_edit edit, ch_allocator token_allocator, ly_lex_flag flags) {
+    assert(tokens != NULL && "relexing requires the previous tokens; at least EOF should be present.");
+
+    int64 delta = edit.inserted_length - edit.removed_length;
+    int64 removed_end = edit.offset + edit.removed_length;
+
+    // the restart token is the last one which ends before the edit.
+    // it is re-lexed along with everything after it, since its trailing trivia and lookahead may reach into the edit.
+    // everything before it is kept as is.
+    ly_token* restart = NULL;
+    ly_token* restart_previous = NULL;
+    for (ly_token* token = tokens; token->kind != LY_TK_EOF; token = token->next) {
+        if (token->location.offset + token->location.length >= edit.offset) {
+            break;
+        }
+
+        restart_previous = restart;
+        restart = token;
+    }
+
+    ly_token* result = tokens;
+    for (ly_token* token = tokens; token != restart; token = token->next) {
+        ly_token_rebase(token, source, 0);
+        ly_trivia_rebase(token->leading_trivia, source, 0);
+        ly_trivia_rebase(token->trailing_trivia, source, 0);
+    }
+
+    ly_lexer lexer = {0};
+    ly_lexer_init(&lexer, context, source, token_allocator, flags);
+
+    ly_token* previous = restart_previous;
+    ly_token* old = tokens;
+    if (restart != NULL) {
+        lexer.position = restart->location.offset;
+        old = restart;
+    }
+
+    while (true) {
+        ly_token* token = ch_alloc(token_allocator, sizeof *token);
+        *token = ly_lexer_next(&lexer);
+
+        if (previous == NULL) {
+            result = token;
+        } else {
+            previous->next = token;
+        }
+
+        if (restart != NULL && previous == restart_previous) {
+            // lexing began at the restart token's lexeme, so its leading trivia was skipped; it cannot have changed.
+            token->leading_trivia = restart->leading_trivia;
+            ly_trivia_rebase(token->leading_trivia, source, 0);
+        }
+
+        previous = token;
+
+        // find the first old token which, once shifted, does not start before the new token.
+        while (old != NULL && (old->location.offset < removed_end || old->location.offset + delta < token->location.offset)) {
+            old = old->next;
+        }
+
+        // the lexer carries no state between tokens, so once a token starts where an old token past the edit
+        // started and matches it, every following token is guaranteed to lex identically as well.
+        if (old != NULL && old->location.offset + delta == token->location.offset && old->kind == token->kind && old->location.length == token->location.length) {
+            token->next = old->next;
+            for (ly_token* reused = old->next; reused != NULL; reused = reused->next) {
+                ly_token_rebase(reused, source, delta);
+                ly_trivia_rebase(reused->leading_trivia, source, delta);
+                ly_trivia_rebase(reused->trailing_trivia, source, delta);
+            }
+
+            break;
+        }
+
+        if (token->kind == LY_TK_EOF) {
+            break;
+        }
+    }
+
+    return result;
+}
+
+static char lexer_peek(ly_lexer* l, int64 ahead) {
     assert(l != NULL && "where is the lexer?");
     assert(l->source != NULL && "where is the source?");
     assert(ahead >= 0 && "cannot peek backwards");
@@ -59,36 +211,96 @@ static char lexer_peek(struct lexer* l, int64 ahead) {
     return l->source->text[position];
 }
 
-static char lexer_current(struct lexer* l) {
+static char lexer_current(ly_lexer* l) {
     return lexer_peek(l, 0);
 }
 
-static void lexer_advance(struct lexer* l) {
+static void lexer_advance(ly_lexer* l) {
     if (l->position >= l->source->length) return;
     l->position++;
 }
 
-static bool ly_try_read_trivium(struct lexer* l, ly_token** out_trivia, bool* consumed_tailing_terminal) {
+static bool lexer_try_advance(ly_lexer* l, char c) {
+    if (lexer_current(l) != c || l->position >= l->source->length) return false;
+    lexer_advance(l);
+    return true;
+}
+
+static bool ly_try_read_trivium(ly_lexer* l, ly_token** out_trivia, bool* consumed_tailing_terminal) {
     ly_token* trivia = NULL;
 
     int64 start_position = l->position;
+    ly_token_kind kind = LY_TK_EOF;
     char c = lexer_current(l);
 
     switch (c) {
         default: break;
         case ' ':
-        case '\t': {
+        case '\t':
+        case '\r':
+        case '\v':
+        case '\f': {
             lexer_advance(l);
-            while ((c = lexer_current(l)), (c == ' ' || c == '\t')) {
+            while ((c = lexer_current(l)), (c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f')) {
                 lexer_advance(l);
             }
 
-            if (l->preserve_trivia) {
-                trivia = ch_alloc(l->token_allocator, sizeof *trivia);
-                memset(trivia, 0, sizeof *trivia);
-                trivia->kind = LY_TK_WHITE_SPACE;
+            kind = LY_TK_WHITE_SPACE;
+        } break;
+
+        case '\n': {
+            lexer_advance(l);
+            kind = LY_TK_NEW_LINE;
+            *consumed_tailing_terminal = true;
+        } break;
+
+        case '#': {
+            while (l->position < l->source->length && lexer_current(l) != '\n') {
+                lexer_advance(l);
             }
+
+            kind = LY_TK_COMMENT_LINE;
         } break;
+
+        case '/': {
+            if (lexer_peek(l, 1) == '/') {
+                while (l->position < l->source->length && lexer_current(l) != '\n') {
+                    lexer_advance(l);
+                }
+
+                kind = LY_TK_COMMENT_LINE;
+            } else if (lexer_peek(l, 1) == '*') {
+                lexer_advance(l);
+                lexer_advance(l);
+
+                int nesting = 1;
+                while (l->position < l->source->length && nesting > 0) {
+                    if (lexer_current(l) == '/' && lexer_peek(l, 1) == '*') {
+                        lexer_advance(l);
+                        lexer_advance(l);
+                        nesting++;
+                    } else if (lexer_current(l) == '*' && lexer_peek(l, 1) == '/') {
+                        lexer_advance(l);
+                        lexer_advance(l);
+                        nesting--;
+                    } else {
+                        lexer_advance(l);
+                    }
+                }
+
+                if (nesting > 0) {
+                    ch_diag(l->context, CH_DIAG_ERROR, (ch_location){l->source, start_position, 2}, "comment unclosed at end of file");
+                }
+
+                kind = LY_TK_COMMENT_DELIMITED;
+            }
+        } break;
+    }
+
+    if (kind != LY_TK_EOF && 0 != (l->flags & LY_LEX_PRESERVE_TRIVIA)) {
+        trivia = ch_alloc(l->token_allocator, sizeof *trivia);
+        memset(trivia, 0, sizeof *trivia);
+        trivia->kind = kind;
     }
 
     *out_trivia = trivia;
@@ -104,13 +316,13 @@ static bool ly_try_read_trivium(struct lexer* l, ly_token** out_trivia, bool* co
     return l->position > start_position;
 }
 
-static void ly_read_trivia(struct lexer* l, ly_token** trivia, bool is_trailing) {
+static void ly_read_trivia(ly_lexer* l, ly_token** trivia, bool is_trailing) {
     ly_token* current_trivia = NULL;
     ly_token* previous_trivia = NULL;
 
     bool consumed_tailing_terminal = false;
     while (ly_try_read_trivium(l, &current_trivia, &consumed_tailing_terminal)) {
-        if (l->preserve_trivia) {
+        if (0 != (l->flags & LY_LEX_PRESERVE_TRIVIA)) {
             if (*trivia == NULL) {
                 *trivia = current_trivia;
             } else {
@@ -126,8 +338,549 @@ static void ly_read_trivia(struct lexer* l, ly_token** trivia, bool is_trailing)
     }
 }
 
-static ly_token* ly_read_token(struct lexer* l) {
-    ly_token* token = ch_alloc(l->token_allocator, sizeof *token);
+enum {
+    LY_CHAR_IDENTIFIER_START = 1 << 0,
+    LY_CHAR_IDENTIFIER_CONTINUE = 1 << 1,
+    LY_CHAR_DIGIT = 1 << 2,
+};
+
+// classifies ASCII bytes in a single load; bytes 0x80 and above are left unclassified and go through the Unicode tables.
+static const uint8 ly_char_classes[256] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 0x00
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 0x10
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 0x20
+    6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 0, 0, 0, 0, 0, 0, // 0x30 '0'-'9'
+    0, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, // 0x40 'A'-'O'
+    3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 0, 0, 0, 0, 3, // 0x50 'P'-'Z', '_'
+    0, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, // 0x60 'a'-'o'
+    3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 0, 0, 0, 0, 0, // 0x70 'p'-'z'
+};
+
+static bool ly_is_digit(char c) {
+    return 0 != (ly_char_classes[cast(uint8) c] & LY_CHAR_DIGIT);
+}
+
+static bool ly_is_ascii_letter(char c) {
+    return c != '_' && 0 != (ly_char_classes[cast(uint8) c] & LY_CHAR_IDENTIFIER_START);
+}
+
+static bool ly_is_identifier_char(char c) {
+    return 0 != (ly_char_classes[cast(uint8) c] & LY_CHAR_IDENTIFIER_CONTINUE);
+}
+
+static int ly_digit_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'z') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'Z') return c - 'A' + 10;
+    return 36;
+}
+
+// returns the byte length of the Unicode identifier character at the current position, or 0 if there isn't one.
+static int ly_unicode_identifier_char_length(ly_lexer* l, bool is_start) {
+    uint32 code_point = 0;
+    int count = ch_utf8_decode(l->source->text + l->position, l->source->length - l->position, &code_point);
+    if (count == 0) return 0;
+
+    bool is_identifier_char = is_start ? ch_unicode_is_xid_start(code_point) : ch_unicode_is_xid_continue(code_point);
+    return is_identifier_char ? count : 0;
+}
+
+typedef struct ly_keyword {
+    const char* text;
+    int64 length;
+    ly_token_kind kind;
+} ly_keyword;
+
+static const ly_keyword ly_keywords[] = {
+#define LY_TOKEN_KW(Name, Text, Classes) {Text, sizeof(Text) - 1, LY_TK_##Name},
+#include <laye/tokens.inc>
+};
+
+static const ly_keyword ly_sized_keywords[] = {
+#define LY_TOKEN_KW_SIZED(Name, Text, Classes) {Text, sizeof(Text) - 1, LY_TK_##Name},
+#include <laye/tokens.inc>
+};
+
+#define LY_KEYWORD_TABLE_SIZE 512
+static_assert(LY_KEYWORD_TABLE_SIZE >= 2 * (sizeof ly_keywords / sizeof ly_keywords[0]), "the keyword table should stay at most half full");
+
+static int16 ly_keyword_table[LY_KEYWORD_TABLE_SIZE];
+static once_flag ly_keyword_table_once = ONCE_FLAG_INIT;
+
+static uint32 ly_keyword_hash(const char* text, int64 length) {
+    uint32 hash = 2166136261u;
+    for (int64 i = 0; i < length; i++) {
+        hash = (hash ^ cast(uint8) text[i]) * 16777619u;
+    }
+
+    return hash;
+}
+
+static void ly_keyword_table_init(void) {
+    for (int64 i = 0; i < LY_KEYWORD_TABLE_SIZE; i++) {
+        ly_keyword_table[i] = -1;
+    }
+
+    for (int64 i = 0; i < cast(int64)(sizeof ly_keywords / sizeof ly_keywords[0]); i++) {
+        uint32 slot = ly_keyword_hash(ly_keywords[i].text, ly_keywords[i].length) & (LY_KEYWORD_TABLE_SIZE - 1);
+        while (ly_keyword_table[slot] != -1) {
+            slot = (slot + 1) & (LY_KEYWORD_TABLE_SIZE - 1);
+        }
+
+        ly_keyword_table[slot] = cast(int16) i;
+    }
+}
+
+static ly_token_kind ly_keyword_kind(const char* text, int64 length) {
+    uint32 slot = ly_keyword_hash(text, length) & (LY_KEYWORD_TABLE_SIZE - 1);
+    while (ly_keyword_table[slot] != -1) {
+        const ly_keyword* keyword = &ly_keywords[ly_keyword_table[slot]];
+        if (keyword->length == length && 0 == memcmp(keyword->text, text, cast(size_t) length)) {
+            return keyword->kind;
+        }
+
+        slot = (slot + 1) & (LY_KEYWORD_TABLE_SIZE - 1);
+    }
+
+    return LY_TK_IDENTIFIER;
+}
+
+static void ly_classify_sized_keyword(ly_lexer* l, ly_token* token, const char* text, int64 length) {
+    for (int64 i = 0; i < cast(int64)(sizeof ly_sized_keywords / sizeof ly_sized_keywords[0]); i++) {
+        const ly_keyword* keyword = &ly_sized_keywords[i];
+        if (length <= keyword->length || 0 != memcmp(keyword->text, text, cast(size_t) keyword->length)) {
+            continue;
+        }
+
+        int64 bit_width = 0;
+        int64 digit_count = length - keyword->length;
+        for (int64 j = keyword->length; j < length; j++) {
+            if (!ly_is_digit(text[j])) return;
+            if (bit_width < 65536) bit_width = bit_width * 10 + (text[j] - '0');
+        }
+
+        if (keyword->kind == LY_TK_FLOAT_SIZED) {
+            // only the floating point formats which actually exist get a keyword.
+            if (bit_width != 16 && bit_width != 32 && bit_width != 64 && bit_width != 80 && bit_width != 128) return;
+        } else if (digit_count > 5 || bit_width < 1 || bit_width >= 65536) {
+            ch_diag(l->context, CH_DIAG_ERROR, token->location, "sized primitive bit width must be in the range [1, 65536)");
+        }
+
+        token->kind = keyword->kind;
+        token->string_length = 0;
+        token->integer_value = bit_width;
+        return;
+    }
+}
+
+static void ly_read_identifier(ly_lexer* l, ly_token* token) {
+    int64 start_position = l->position;
+    token->kind = LY_TK_IDENTIFIER;
+
+    while (true) {
+        while (ly_is_identifier_char(lexer_current(l))) {
+            lexer_advance(l);
+        }
+
+        if (cast(uint8) lexer_current(l) < 0x80) break;
+
+        int count = ly_unicode_identifier_char_length(l, l->position == start_position);
+        if (count == 0) break;
+        l->position += count;
+    }
+
+    assert(l->position > start_position && "the lexer was instructed to read a Laye identifier, but the current character cannot start an identifier");
+
+    const char* text = l->source->text + start_position;
+    int64 length = l->position - start_position;
+
+    token->string_value = text;
+    token->string_length = length;
+}
+
+static void ly_read_identifier_or_keyword(ly_lexer* l, ly_token* token) {
+    int64 start_position = l->position;
+    ly_read_identifier(l, token);
+
+    const char* text = l->source->text + start_position;
+    int64 length = l->position - start_position;
+
+    token->location = (ch_location){l->source, start_position, length};
+    token->kind = ly_keyword_kind(text, length);
+    if (token->kind != LY_TK_IDENTIFIER) {
+        token->string_value = NULL;
+        token->string_length = 0;
+        return;
+    }
+
+    ly_classify_sized_keyword(l, token, text, length);
+}
+
+#if defined(CHOIR_LITTLE_ENDIAN)
+static uint64 ly_load8(const char* text) {
+    uint64 chunk;
+    memcpy(&chunk, text, sizeof chunk);
+    return chunk;
+}
+
+static bool ly_chunk_has_separator(uint64 chunk) {
+    uint64 v = chunk ^ 0x5F5F5F5F5F5F5F5F;
+    return 0 != ((v - 0x0101010101010101) & ~v & 0x8080808080808080);
+}
+
+// decodes 8 decimal digits, the first digit in the lowest byte, into their value.
+static uint64 ly_swar_decimal8(uint64 chunk) {
+    chunk -= 0x3030303030303030;
+    chunk = (chunk * 10) + (chunk >> 8);
+    chunk = (((chunk & 0x000000FF000000FF) * (100 + (1000000ULL << 32))) + (((chunk >> 16) & 0x000000FF000000FF) * (1 + (10000ULL << 32)))) >> 32;
+    return chunk;
+}
+
+static uint64 ly_swar_hex8(uint64 chunk) {
+    // '0'-'9' keep their low nibble, 'a'-'f' and 'A'-'F' have bit 6 set and a low nibble of 1-6.
+    uint64 v = (chunk & 0x0F0F0F0F0F0F0F0F) + ((chunk >> 6) & 0x0101010101010101) * 9;
+    v = ((v << 4) | (v >> 8)) & 0x00FF00FF00FF00FF;
+    v = ((v << 8) | (v >> 16)) & 0x0000FFFF0000FFFF;
+    v = ((v << 16) | (v >> 32)) & 0x00000000FFFFFFFF;
+    return v;
+}
+
+static uint64 ly_swar_binary8(uint64 chunk) {
+    return ((chunk - 0x3030303030303030) * 0x8040201008040201) >> 56;
+}
+#endif // CHOIR_LITTLE_ENDIAN
+
+// decodes digits, already validated for the radix and possibly containing '_' separators, into a 64-bit value.
+// returns false if the value does not fit in an int64.
+static bool ly_decode_integer_fast(const char* digits, int64 length, int radix, uint64* out_value) {
+    uint64 value = 0;
+    int64 i = 0;
+
+#if defined(CHOIR_LITTLE_ENDIAN)
+    // chunks of eight digits are converted at once; their multiplier is the radix raised to the eighth power.
+    uint64 chunk_scale = 0;
+    uint64 (*decode_chunk)(uint64) = NULL;
+    switch (radix) {
+        default: break;
+        case 2: chunk_scale = 1ULL << 8; decode_chunk = ly_swar_binary8; break;
+        case 10: chunk_scale = 100000000; decode_chunk = ly_swar_decimal8; break;
+        case 16: chunk_scale = 1ULL << 32; decode_chunk = ly_swar_hex8; break;
+    }
+
+    if (decode_chunk != NULL) {
+        while (i + 8 <= length) {
+            uint64 chunk = ly_load8(digits + i);
+            if (ly_chunk_has_separator(chunk)) {
+                // step over the separated digits one at a time, then try for whole chunks again.
+                int64 chunk_end = i + 8;
+                for (; i < chunk_end; i++) {
+                    if (digits[i] == '_') continue;
+                    uint64 digit = cast(uint64) ly_digit_value(digits[i]);
+                    if (value > (INT64_MAX - digit) / cast(uint64) radix) return false;
+                    value = value * cast(uint64) radix + digit;
+                }
+
+                continue;
+            }
+
+            uint64 chunk_value = decode_chunk(chunk);
+            if (value > (INT64_MAX - chunk_value) / chunk_scale) return false;
+            value = value * chunk_scale + chunk_value;
+            i += 8;
+        }
+    }
+#endif // CHOIR_LITTLE_ENDIAN
+
+    for (; i < length; i++) {
+        if (digits[i] == '_') continue;
+        uint64 digit = cast(uint64) ly_digit_value(digits[i]);
+        if (value > (INT64_MAX - digit) / cast(uint64) radix) return false;
+        value = value * cast(uint64) radix + digit;
+    }
+
+    *out_value = value;
+    return true;
+}
+
+static void ly_decode_integer(ly_lexer* l, ly_token* token, int64 digits_offset, int64 digits_length, int radix) {
+    const char* digits = l->source->text + digits_offset;
+
+    uint64 value = 0;
+    if (ly_decode_integer_fast(digits, digits_length, radix, &value)) {
+        token->integer_value = cast(int64) value;
+        return;
+    }
+
+    ch_wide_int wide_value = {0};
+    for (int64 i = 0; i < digits_length; i++) {
+        if (digits[i] == '_') continue;
+        if (!ch_wide_int_mul_add(&wide_value, cast(uint32) radix, cast(uint32) ly_digit_value(digits[i]))) {
+            ch_diag(l->context, CH_DIAG_ERROR, (ch_location){l->source, digits_offset, digits_length}, "integer literal is too large; Laye integers are at most %d bits", CH_WIDE_INT_WORDS * 64);
+            return;
+        }
+    }
+
+    token->is_wide_integer = true;
+    token->wide_integer_value = ch_alloc(l->token_allocator, sizeof *token->wide_integer_value);
+    *token->wide_integer_value = wide_value;
+}
+
+static void ly_read_number(ly_lexer* l, ly_token* token) {
+    assert(ly_is_digit(lexer_current(l)) && "the lexer was instructed to read a Laye number, but the current character cannot start a number");
+
+    int64 start_position = l->position;
+
+    // scan ahead to find out what kind of literal this is, if it's a number at all.
+    int64 ahead = 0;
+    while (true) {
+        char c = lexer_peek(l, ahead);
+        if (ly_is_digit(c)) {
+            ahead++;
+        } else if (c == '_') {
+            int64 underscores = 0;
+            while (lexer_peek(l, ahead + underscores) == '_') underscores++;
+            if (!ly_is_digit(lexer_peek(l, ahead + underscores))) break;
+            ahead += underscores;
+        } else {
+            break;
+        }
+    }
+
+    char next = lexer_peek(l, ahead);
+    if (ly_is_ascii_letter(next) || next == '_') {
+        ly_read_identifier(l, token);
+        return;
+    }
+
+    if (next == '.' && ly_is_digit(lexer_peek(l, ahead + 1))) {
+        l->position += ahead + 1;
+        while (ly_is_identifier_char(lexer_current(l))) lexer_advance(l);
+        token->kind = LY_TK_LITERAL_FLOAT;
+        ch_diag(l->context, CH_DIAG_ERROR, (ch_location){l->source, start_position, l->position - start_position}, "float literals are not supported yet");
+        return;
+    }
+
+    token->kind = LY_TK_LITERAL_INTEGER;
+    if (next != '#') {
+        l->position += ahead;
+        ly_decode_integer(l, token, start_position, ahead, 10);
+        return;
+    }
+
+    int radix = 0;
+    if (ahead == 1) {
+        radix = ly_digit_value(lexer_current(l));
+    } else if (ahead == 2) {
+        radix = 10 * ly_digit_value(lexer_current(l)) + ly_digit_value(lexer_peek(l, 1));
+    }
+
+    if (radix < 2 || radix > 36) {
+        ch_diag(l->context, CH_DIAG_ERROR, (ch_location){l->source, start_position, ahead}, "integer base must be in the range [2, 36]");
+        radix = 36;
+    }
+
+    l->position += ahead + 1;
+    int64 digits_position = l->position;
+    bool has_invalid_digit = false;
+    while (ly_is_identifier_char(lexer_current(l))) {
+        char c = lexer_current(l);
+        if (c != '_' && ly_digit_value(c) >= radix && !has_invalid_digit) {
+            ch_diag(l->context, CH_DIAG_ERROR, (ch_location){l->source, l->position, 1}, "invalid digit '%c' in base %d integer literal", c, radix);
+            has_invalid_digit = true;
+        }
+
+        lexer_advance(l);
+    }
+
+    int64 digits_length = l->position - digits_position;
+    if (digits_length == 0) {
+        ch_diag(l->context, CH_DIAG_ERROR, (ch_location){l->source, start_position, l->position - start_position}, "expected digits after the integer base");
+    } else if (l->source->text[l->position - 1] == '_') {
+        ch_diag(l->context, CH_DIAG_ERROR, (ch_location){l->source, l->position - 1, 1}, "integer literal cannot end with an '_' separator");
+    } else if (!has_invalid_digit) {
+        ly_decode_integer(l, token, digits_position, digits_length, radix);
+    }
+}
+
+static bool ly_is_hex_digits(ly_lexer* l, int64 ahead, int count) {
+    for (int i = 0; i < count; i++) {
+        if (ly_digit_value(lexer_peek(l, ahead + i)) >= 16) return false;
+    }
+
+    return true;
+}
+
+static uint32 ly_hex_digits_value(ly_lexer* l, int count) {
+    uint32 value = 0;
+    for (int i = 0; i < count; i++) {
+        value = (value << 4) | cast(uint32) ly_digit_value(lexer_current(l));
+        lexer_advance(l);
+    }
+
+    return value;
+}
+
+// reads the escape sequence at the current position and returns the value it represents.
+// `\x` escapes denote a single byte rather than a code point, which is reported through `is_byte`.
+static uint32 ly_read_escape_sequence(ly_lexer* l, bool* is_byte) {
+    assert(lexer_current(l) == '\\' && "the lexer was instructed to read an escape sequence, but the current character was not the escape start character '\\'");
+
+    int64 start_position = l->position;
+    lexer_advance(l);
+
+    *is_byte = false;
+    char c = lexer_current(l);
+    switch (c) {
+        case 'a': lexer_advance(l); return '\a';
+        case 'b': lexer_advance(l); return '\b';
+        case 'f': lexer_advance(l); return '\f';
+        case 'n': lexer_advance(l); return '\n';
+        case 'r': lexer_advance(l); return '\r';
+        case 't': lexer_advance(l); return '\t';
+        case 'v': lexer_advance(l); return '\v';
+        case '\\': lexer_advance(l); return '\\';
+        case '\'': lexer_advance(l); return '\'';
+        case '"': lexer_advance(l); return '"';
+
+        case 'x': {
+            if (!ly_is_hex_digits(l, 1, 2)) break;
+            lexer_advance(l);
+            *is_byte = true;
+            return ly_hex_digits_value(l, 2);
+        }
+
+        case 'u':
+        case 'U': {
+            int count = c == 'u' ? 4 : 8;
+            if (!ly_is_hex_digits(l, 1, count)) break;
+            lexer_advance(l);
+            uint32 code_point = ly_hex_digits_value(l, count);
+            if (code_point > 0x10FFFF || (code_point >= 0xD800 && code_point <= 0xDFFF)) {
+                ch_diag(l->context, CH_DIAG_ERROR, (ch_location){l->source, start_position, l->position - start_position}, "escape sequence is not a valid Unicode code point");
+                return 0xFFFD;
+            }
+
+            return code_point;
+        }
+
+        default: break;
+    }
+
+    ch_diag(l->context, CH_DIAG_ERROR, (ch_location){l->source, start_position, 2}, "unrecognized escape sequence");
+    if (c == '\n' || l->position >= l->source->length) return '\\';
+
+    lexer_advance(l);
+    return cast(uint8) c;
+}
+
+static void ly_read_string(ly_lexer* l, ly_token* token) {
+    assert(lexer_current(l) == '"' && "the lexer was instructed to read a Laye string literal, but the current character is not the string start character '\"'");
+
+    int64 start_position = l->position;
+    token->kind = LY_TK_LITERAL_STRING;
+    lexer_advance(l);
+
+    int64 contents_position = l->position;
+    const char* text = l->source->text;
+
+    // escape sequences never encode to more bytes than they are spelled with, so the text up to the first escape
+    // is kept as a view into the source and everything after it can be decoded straight into one allocation.
+    char c;
+    while ((c = lexer_current(l)), c != '"' && c != '\\' && c != '\n' && l->position < l->source->length) {
+        lexer_advance(l);
+    }
+
+    if (c != '\\') {
+        token->string_value = text + contents_position;
+        token->string_length = l->position - contents_position;
+    } else {
+        int64 escape_position = l->position;
+        int64 length = escape_position - contents_position;
+
+        // the decoded text can be no longer than the rest of the line, so find that without decoding anything yet.
+        int64 line_end = escape_position;
+        while (line_end < l->source->length && text[line_end] != '\n') line_end++;
+
+        char* buffer = ch_alloc(l->token_allocator, line_end - contents_position + 1);
+        memcpy(buffer, text + contents_position, cast(size_t) length);
+
+        while ((c = lexer_current(l)), c != '"' && c != '\n' && l->position < l->source->length) {
+            if (c != '\\') {
+                buffer[length++] = c;
+                lexer_advance(l);
+                continue;
+            }
+
+            bool is_byte = false;
+            uint32 value = ly_read_escape_sequence(l, &is_byte);
+            if (is_byte) {
+                buffer[length++] = cast(char) value;
+            } else {
+                length += ch_utf8_encode(value, buffer + length);
+            }
+        }
+
+        buffer[length] = 0;
+        token->string_value = buffer;
+        token->string_length = length;
+    }
+
+    if (lexer_current(l) == '"') {
+        lexer_advance(l);
+    } else if (l->position >= l->source->length) {
+        ch_diag(l->context, CH_DIAG_ERROR, (ch_location){l->source, start_position, 1}, "end of file reached in string literal");
+    } else {
+        ch_diag(l->context, CH_DIAG_ERROR, (ch_location){l->source, start_position, 1}, "newline in string literal");
+    }
+}
+
+static void ly_read_rune(ly_lexer* l, ly_token* token) {
+    assert(lexer_current(l) == '\'' && "the lexer was instructed to read a Laye rune literal, but the current character is not the rune start character '\\''");
+
+    int64 start_position = l->position;
+    token->kind = LY_TK_LITERAL_RUNE;
+    lexer_advance(l);
+
+    char c = lexer_current(l);
+    if (c == '\\') {
+        bool is_byte = false;
+        token->integer_value = ly_read_escape_sequence(l, &is_byte);
+    } else if (c == '\'' || c == '\n' || l->position >= l->source->length) {
+        ch_diag(l->context, CH_DIAG_ERROR, (ch_location){l->source, start_position, 1}, "empty rune literal");
+    } else {
+        uint32 code_point = 0xFFFD;
+        int count = ch_utf8_decode(l->source->text + l->position, l->source->length - l->position, &code_point);
+        if (count == 0) {
+            ch_diag(l->context, CH_DIAG_ERROR, (ch_location){l->source, l->position, 1}, "invalid UTF-8 in rune literal");
+            count = 1;
+        }
+
+        token->integer_value = code_point;
+        l->position += count;
+    }
+
+    if (lexer_current(l) == '\'') {
+        lexer_advance(l);
+        return;
+    }
+
+    if (l->position >= l->source->length) {
+        ch_diag(l->context, CH_DIAG_ERROR, (ch_location){l->source, start_position, 1}, "end of file reached in rune literal");
+        return;
+    }
+
+    while (l->position < l->source->length && lexer_current(l) != '\n' && lexer_current(l) != '\'') {
+        lexer_advance(l);
+    }
+
+    if (lexer_current(l) == '\'') {
+        lexer_advance(l);
+    }
+
+    ch_diag(l->context, CH_DIAG_ERROR, (ch_location){l->source, start_position, l->position - start_position}, "too many characters in rune literal");
+}
+
+static void ly_read_token(ly_lexer* l, ly_token* token) {
     memset(token, 0, sizeof *token);
     ly_read_trivia(l, &token->leading_trivia, false);
 
@@ -136,31 +889,170 @@ static ly_token* ly_read_token(struct lexer* l) {
 
     switch (c) {
         default: {
-            assert(false && "unhandled character in Laye source");
-        }
+            if (cast(uint8) c >= 0x80 && ly_unicode_identifier_char_length(l, true) > 0) {
+                ly_read_identifier_or_keyword(l, token);
+                break;
+            }
+
+            token->kind = LY_TK_INVALID;
+            uint32 code_point = 0;
+            int count = ch_utf8_decode(l->source->text + l->position, l->source->length - l->position, &code_point);
+            l->position += count == 0 ? 1 : count;
+            ch_diag(l->context, CH_DIAG_ERROR, (ch_location){l->source, start_position, l->position - start_position}, "invalid character '%.*s' in Laye source", cast(int)(l->position - start_position), l->source->text + start_position);
+        } break;
 
         case 0: {
+            if (l->position < l->source->length) {
+                lexer_advance(l);
+                token->kind = LY_TK_INVALID;
+                ch_diag(l->context, CH_DIAG_ERROR, (ch_location){l->source, start_position, 1}, "invalid NUL character in Laye source");
+                break;
+            }
+
             token->kind = LY_TK_EOF;
         } break;
 
-        case '+': {
+        case '0': case '1': case '2': case '3': case '4':
+        case '5': case '6': case '7': case '8': case '9': {
+            ly_read_number(l, token);
+        } break;
+
+        case '_':
+        case 'a': case 'b': case 'c': case 'd': case 'e': case 'f': case 'g': case 'h': case 'i':
+        case 'j': case 'k': case 'l': case 'm': case 'n': case 'o': case 'p': case 'q': case 'r':
+        case 's': case 't': case 'u': case 'v': case 'w': case 'x': case 'y': case 'z':
+        case 'A': case 'B': case 'C': case 'D': case 'E': case 'F': case 'G': case 'H': case 'I':
+        case 'J': case 'K': case 'L': case 'M': case 'N': case 'O': case 'P': case 'Q': case 'R':
+        case 'S': case 'T': case 'U': case 'V': case 'W': case 'X': case 'Y': case 'Z': {
+            ly_read_identifier_or_keyword(l, token);
+        } break;
+
+        case '@': {
             lexer_advance(l);
-            token->kind = LY_TK_PLUS;
+            if (lexer_current(l) == '"') {
+                ly_read_string(l, token);
+                token->kind = LY_TK_IDENTIFIER;
+            } else if (ly_is_identifier_char(lexer_current(l)) || (cast(uint8) lexer_current(l) >= 0x80 && ly_unicode_identifier_char_length(l, true) > 0)) {
+                // '@' lets keywords be used as plain identifiers, so don't look this one up.
+                ly_read_identifier(l, token);
+            } else {
+                token->kind = LY_TK_INVALID;
+                ch_diag(l->context, CH_DIAG_ERROR, (ch_location){l->source, start_position, 1}, "expected an identifier or string after '@'");
+            }
         } break;
 
-        case '-': {
+        case '"': {
+            ly_read_string(l, token);
+        } break;
+
+        case '\'': {
+            ly_read_rune(l, token);
+        } break;
+
+        case '(': lexer_advance(l); token->kind = LY_TK_OPEN_PAREN; break;
+        case ')': lexer_advance(l); token->kind = LY_TK_CLOSE_PAREN; break;
+        case '[': lexer_advance(l); token->kind = LY_TK_OPEN_SQUARE; break;
+        case ']': lexer_advance(l); token->kind = LY_TK_CLOSE_SQUARE; break;
+        case '{': lexer_advance(l); token->kind = LY_TK_OPEN_CURLY; break;
+        case '}': lexer_advance(l); token->kind = LY_TK_CLOSE_CURLY; break;
+        case ';': lexer_advance(l); token->kind = LY_TK_SEMI_COLON; break;
+        case ',': lexer_advance(l); token->kind = LY_TK_COMMA; break;
+
+        case '.': {
+            lexer_advance(l);
+            token->kind = lexer_try_advance(l, '.')
+                            ? (lexer_try_advance(l, '=') ? LY_TK_DOT_DOT_EQUAL : LY_TK_DOT_DOT)
+                            : LY_TK_DOT;
+        } break;
+
+        case '~': {
             lexer_advance(l);
-            token->kind = LY_TK_MINUS;
+            token->kind = lexer_try_advance(l, '=') ? LY_TK_TILDE_EQUAL : LY_TK_TILDE;
+        } break;
+
+        case '!': {
+            lexer_advance(l);
+            token->kind = lexer_try_advance(l, '=') ? LY_TK_BANG_EQUAL : LY_TK_BANG;
+        } break;
+
+        case '%': {
+            lexer_advance(l);
+            token->kind = lexer_try_advance(l, '=') ? LY_TK_PERCENT_EQUAL : LY_TK_PERCENT;
+        } break;
+
+        case '&': {
+            lexer_advance(l);
+            token->kind = lexer_try_advance(l, '=') ? LY_TK_AMPERSAND_EQUAL : LY_TK_AMPERSAND;
         } break;
 
         case '*': {
             lexer_advance(l);
-            token->kind = LY_TK_STAR;
+            token->kind = lexer_try_advance(l, '=') ? LY_TK_STAR_EQUAL : LY_TK_STAR;
+        } break;
+
+        case '-': {
+            lexer_advance(l);
+            token->kind = lexer_try_advance(l, '=')   ? LY_TK_MINUS_EQUAL
+                        : lexer_try_advance(l, '-') ? LY_TK_MINUS_MINUS
+                                                    : LY_TK_MINUS;
+        } break;
+
+        case '=': {
+            lexer_advance(l);
+            token->kind = lexer_try_advance(l, '=')   ? LY_TK_EQUAL_EQUAL
+                        : lexer_try_advance(l, '>') ? LY_TK_EQUAL_GREATER
+                                                    : LY_TK_EQUAL;
+        } break;
+
+        case '+': {
+            lexer_advance(l);
+            token->kind = lexer_try_advance(l, '=')   ? LY_TK_PLUS_EQUAL
+                        : lexer_try_advance(l, '+') ? LY_TK_PLUS_PLUS
+                                                    : LY_TK_PLUS;
+        } break;
+
+        case '|': {
+            lexer_advance(l);
+            token->kind = lexer_try_advance(l, '=') ? LY_TK_PIPE_EQUAL : LY_TK_PIPE;
+        } break;
+
+        case ':': {
+            lexer_advance(l);
+            token->kind = lexer_try_advance(l, ':') ? LY_TK_COLON_COLON : LY_TK_COLON;
+        } break;
+
+        case '<': {
+            lexer_advance(l);
+            if (lexer_try_advance(l, '<')) {
+                token->kind = lexer_try_advance(l, '=') ? LY_TK_LESS_LESS_EQUAL : LY_TK_LESS_LESS;
+            } else if (lexer_try_advance(l, '=')) {
+                token->kind = lexer_try_advance(l, '>') ? LY_TK_LESS_EQUAL_GREATER : LY_TK_LESS_EQUAL;
+            } else {
+                token->kind = LY_TK_LESS;
+            }
+        } break;
+
+        case '>': {
+            lexer_advance(l);
+            if (lexer_try_advance(l, '>')) {
+                token->kind = lexer_try_advance(l, '=') ? LY_TK_GREATER_GREATER_EQUAL : LY_TK_GREATER_GREATER;
+            } else {
+                token->kind = lexer_try_advance(l, '=') ? LY_TK_GREATER_EQUAL : LY_TK_GREATER;
+            }
         } break;
 
         case '/': {
             lexer_advance(l);
-            token->kind = LY_TK_SLASH;
+            token->kind = lexer_try_advance(l, '=') ? LY_TK_SLASH_EQUAL : LY_TK_SLASH;
+        } break;
+
+        case '?': {
+            lexer_advance(l);
+            if (lexer_try_advance(l, '?')) {
+                token->kind = lexer_try_advance(l, '=') ? LY_TK_QUESTION_QUESTION_EQUAL : LY_TK_QUESTION_QUESTION;
+            } else {
+                token->kind = LY_TK_QUESTION;
+            }
         } break;
     }
 
@@ -176,6 +1068,4 @@ static ly_token* ly_read_token(struct lexer* l) {
     if (token->kind != LY_TK_EOF) {
         ly_read_trivia(l, &token->trailing_trivia, true);
     }
-
-    return token;
 }
@@ -0,0 +1,660 @@
+#include <laye/laye.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#    define WIN32_LEAN_AND_MEAN
+#    include <windows.h>
+#endif
+
+// A module file is the header followed by arrays of fixed size records, each starting on an 8 byte boundary:
+//
+//   header | symbols | string bytes | declarations | fields | types | template instances | extra words
+//
+// Symbol i names declaration i, so the exported declarations come first, in symbol order, followed by any declaration which is not
+// exported but is named by an exported type or is a template instance. Type 0 is a placeholder, so a file type index of 0 means no type
+// the way it does in memory. An instance's argument types are file type indices in the extra words.
+
+#define LY_MODULE_FILE_MAGIC "LYMODULE"
+#define LY_MODULE_FILE_BYTE_ORDER 0x01020304u
+
+typedef struct ly_module_file_header {
+    char magic[8];
+    uint32 version;
+    // catches files written on a machine with a different byte order.
+    uint32 byte_order;
+    uint32 name;
+    uint32 name_length;
+    uint32 target;
+    uint32 target_length;
+    uint32 symbol_count;
+    uint32 decl_count;
+    uint32 field_count;
+    uint32 type_count;
+    uint32 extra_count;
+    uint32 string_size;
+    uint32 instance_count;
+    uint32 reserved;
+} ly_module_file_header;
+
+static_assert(sizeof(ly_module_file_header) == 64, "the module file header should not have any padding");
+static_assert(sizeof(ly_module_symbol) == 16, "module symbols should not have any padding");
+static_assert(sizeof(ly_module_decl) == 40, "module declarations should not have any padding");
+static_assert(sizeof(ly_module_field) == 24, "module fields should not have any padding");
+static_assert(sizeof(ly_module_instance) == 32, "module template instances should not have any padding");
+static_assert(sizeof(ly_type) == 16, "types are stored in module files as they are in memory");
+
+// ======================================================================
+// Writing
+// ======================================================================
+
+typedef struct ly_module_chars {
+    ch_allocator allocator;
+    char* items;
+    int64 count, capacity;
+} ly_module_chars;
+
+typedef struct ly_module_symbols {
+    ch_allocator allocator;
+    ly_module_symbol* items;
+    int64 count, capacity;
+} ly_module_symbols;
+
+typedef struct ly_module_decls {
+    ch_allocator allocator;
+    ly_module_decl* items;
+    int64 count, capacity;
+} ly_module_decls;
+
+typedef struct ly_module_fields {
+    ch_allocator allocator;
+    ly_module_field* items;
+    int64 count, capacity;
+} ly_module_fields;
+
+typedef struct ly_module_types {
+    ch_allocator allocator;
+    ly_type* items;
+    int64 count, capacity;
+} ly_module_types;
+
+typedef struct ly_module_words {
+    ch_allocator allocator;
+    uint32* items;
+    int64 count, capacity;
+} ly_module_words;
+
+typedef struct ly_module_instances {
+    ch_allocator allocator;
+    ly_module_instance* items;
+    int64 count, capacity;
+} ly_module_instances;
+
+typedef struct ly_module_writer {
+    ly_sema* sema;
+    ly_module_chars strings;
+    ly_module_symbols symbols;
+    ly_module_decls decls;
+    ly_module_fields fields;
+    ly_module_types types;
+    ly_module_instances instances;
+    ly_module_words extra;
+    // one more than the file index each of the sema's declarations was written to, or 0 if it has not been.
+    uint32* decl_indices;
+    // the file index each of the sema's types was written to, or 0 if it has not been.
+    uint32* type_indices;
+} ly_module_writer;
+
+// An exported declaration, as it is sorted into symbol order.
+typedef struct ly_module_export {
+    uint64 hash;
+    const char* text;
+    int64 length;
+    int64 order;
+    ly_decl_id decl;
+} ly_module_export;
+
+static int ly_module_export_compare(const void* lhs, const void* rhs) {
+    const ly_module_export* a = lhs;
+    const ly_module_export* b = rhs;
+    if (a->hash != b->hash) return a->hash < b->hash ? -1 : 1;
+    if (a->length != b->length) return a->length < b->length ? -1 : 1;
+
+    int order = memcmp(a->text, b->text, cast(usize) a->length);
+    if (order != 0) return order;
+    return a->order < b->order ? -1 : a->order > b->order;
+}
+
+// Template instances are sorted the way symbols are, and then in the order they were made.
+static int ly_module_instance_compare(const void* lhs, const void* rhs) {
+    const ly_module_instance* a = lhs;
+    const ly_module_instance* b = rhs;
+    if (a->template_name.hash != b->template_name.hash) return a->template_name.hash < b->template_name.hash ? -1 : 1;
+    // every instance of one template shares the string its name was written to.
+    if (a->template_name.name != b->template_name.name) return a->template_name.name < b->template_name.name ? -1 : 1;
+    return a->reserved < b->reserved ? -1 : a->reserved > b->reserved;
+}
+
+static uint32 ly_module_writer_string(ly_module_writer* w, const char* text, int64 length) {
+    assert(w->strings.count + length <= UINT32_MAX && "too many module strings");
+
+    uint32 offset = cast(uint32) w->strings.count;
+    if (length != 0) {
+        da_push_many(&w->strings, text, length);
+    }
+
+    return offset;
+}
+
+static uint32 ly_module_writer_decl(ly_module_writer* w, ly_decl_id decl_id);
+
+static uint32 ly_module_writer_type(ly_module_writer* w, ly_type_id id);
+
+static ly_qual_type ly_module_writer_qual_type(ly_module_writer* w, ly_qual_type type) {
+    if (type == 0) return 0;
+    return ly_qual_type_make(ly_module_writer_type(w, ly_qual_type_id(type)), ly_qual_type_qualifiers(type));
+}
+
+// Writes a type, and everything it refers to, the first time it is needed, returning its file index.
+static uint32 ly_module_writer_type(ly_module_writer* w, ly_type_id id) {
+    if (id == 0) return 0;
+    if (w->type_indices[id] != 0) return w->type_indices[id];
+
+    ly_type_store* store = &w->sema->types;
+    ly_type type = *ly_type_get(store, id);
+    ly_type record = type;
+    record.extra = 0;
+
+    int64 extra_count = 0;
+    switch (cast(ly_type_kind) type.kind) {
+        default: break;
+
+        case LY_TY_POINTER:
+        case LY_TY_BUFFER:
+        case LY_TY_NILABLE:
+        case LY_TY_SLICE:
+        case LY_TY_RANGE: {
+            record.element = ly_module_writer_qual_type(w, type.element);
+            if (type.flags & LY_TF_TERMINATED) extra_count = 2;
+        } break;
+
+        case LY_TY_ARRAY: {
+            record.element = ly_module_writer_qual_type(w, type.element);
+            extra_count = 2 * cast(int64) type.operand;
+        } break;
+
+        case LY_TY_ERROR_PAIR: {
+            record.element = ly_module_writer_qual_type(w, type.element);
+            record.operand = ly_module_writer_qual_type(w, type.operand);
+        } break;
+
+        case LY_TY_FUNCTION: {
+            record.element = ly_module_writer_qual_type(w, type.element);
+            extra_count = 2 * cast(int64) type.operand;
+        } break;
+
+        case LY_TY_STRUCT:
+        case LY_TY_ENUM: {
+            record.operand = ly_module_writer_decl(w, type.operand);
+        } break;
+
+        // a template parameter only means something inside its template, which is never exported.
+        case LY_TY_TEMPLATE_PARAMETER: {
+            record = (ly_type){.kind = LY_TY_POISON};
+        } break;
+    }
+
+    if (extra_count != 0) {
+        // parameter types are written before any of the words, since writing them can push words of their own.
+        uint32* words = ch_alloc(w->sema->allocator, extra_count * cast(int64) sizeof *words);
+        for (int64 i = 0; i < extra_count; i++) {
+            words[i] = *cast(uint32*) ch_stable_array_get(&store->extra, type.extra + i);
+            // a function's words alternate between a parameter's type and its flags.
+            if (type.kind == LY_TY_FUNCTION && i % 2 == 0) {
+                words[i] = ly_module_writer_qual_type(w, words[i]);
+            }
+        }
+
+        assert(w->extra.count + extra_count <= UINT32_MAX && "too many module extra words");
+        record.extra = cast(uint32) w->extra.count;
+        da_push_many(&w->extra, words, extra_count);
+        ch_dealloc(w->sema->allocator, words);
+    }
+
+    assert(w->types.count < UINT32_MAX && "too many module types");
+    uint32 index = cast(uint32) w->types.count;
+    da_push(&w->types, record);
+    w->type_indices[id] = index;
+    return index;
+}
+
+// Fills in the record of a declaration whose index has been assigned, writing its struct fields along with it.
+static void ly_module_writer_fill_decl(ly_module_writer* w, ly_decl_id decl_id, uint32 index) {
+    ly_decl* decl = ly_sema_decl_get(w->sema, decl_id);
+    ch_atom_info name = ch_atom_get(&w->sema->atoms, decl->name);
+
+    ly_module_decl record = {
+        .kind = decl->kind,
+        .name = ly_module_writer_string(w, name.text, name.length),
+        .name_length = cast(uint32) name.length,
+    };
+
+    if (decl->kind == LY_DK_STRUCT) {
+        const ly_struct_layout* layout = ly_layout_cache_find(&w->sema->layouts, ly_qual_type_id(decl->type));
+        if (layout != NULL && layout->state == LY_LS_COMPUTED) {
+            record.layout = layout->layout;
+            record.fields = cast(uint32) w->fields.count;
+            record.field_count = cast(uint32) layout->field_count;
+
+            // the struct's fields are reserved first so that they stay contiguous while their types write other structs' fields.
+            for (int64 i = 0; i < layout->field_count; i++) {
+                da_push(&w->fields, (ly_module_field){0});
+            }
+
+            for (int64 i = 0; i < layout->field_count; i++) {
+                ly_field_layout field = layout->fields[i];
+                ch_atom_info field_name = ch_atom_get(&w->sema->atoms, field.name);
+                ly_module_field field_record = {
+                    .name = ly_module_writer_string(w, field_name.text, field_name.length),
+                    .name_length = cast(uint32) field_name.length,
+                    .type = ly_module_writer_qual_type(w, field.type),
+                    .offset = field.offset,
+                };
+
+                w->fields.items[record.fields + i] = field_record;
+            }
+        }
+    }
+
+    // a template's type is in terms of its parameters, which mean nothing to an importer; it only uses the template's instances.
+    if (decl->kind != LY_DK_TEMPLATE) {
+        record.type = ly_module_writer_qual_type(w, decl->type);
+    }
+
+    w->decls.items[index] = record;
+}
+
+// Returns the file index of a declaration, writing it first if nothing has named it yet.
+static uint32 ly_module_writer_decl(ly_module_writer* w, ly_decl_id decl_id) {
+    if (w->decl_indices[decl_id] != 0) return w->decl_indices[decl_id] - 1;
+
+    assert(w->decls.count < UINT32_MAX && "too many module declarations");
+    uint32 index = cast(uint32) w->decls.count;
+    da_push(&w->decls, (ly_module_decl){0});
+    w->decl_indices[decl_id] = index + 1;
+
+    ly_module_writer_fill_decl(w, decl_id, index);
+    return index;
+}
+
+static bool ly_module_file_replace_file(const char* from, const char* to) {
+#if defined(_WIN32)
+    return MoveFileExA(from, to, MOVEFILE_REPLACE_EXISTING);
+#else
+    return 0 == rename(from, to);
+#endif
+}
+
+// An empty array has no storage to write from, which fwrite does not accept.
+static bool ly_module_file_write_array(FILE* stream, const void* items, usize size, int64 count) {
+    return count == 0 || cast(usize) count == fwrite(items, size, cast(usize) count, stream);
+}
+
+CHOIR_API bool ly_module_file_write(ly_sema* sema, const char* name, const char* path) {
+    bool result = true;
+    ch_allocator allocator = sema->allocator;
+
+    ly_module_writer w = {
+        .sema = sema,
+        .strings.allocator = allocator,
+        .symbols.allocator = allocator,
+        .decls.allocator = allocator,
+        .fields.allocator = allocator,
+        .types.allocator = allocator,
+        .instances.allocator = allocator,
+        .extra.allocator = allocator,
+    };
+
+    int64 decl_count = sema->decls.count;
+    int64 type_count = sema->types.types.count;
+    w.decl_indices = ch_alloc(allocator, decl_count * cast(int64) sizeof *w.decl_indices);
+    w.type_indices = ch_alloc(allocator, type_count * cast(int64) sizeof *w.type_indices);
+    memset(w.decl_indices, 0, cast(usize) decl_count * sizeof *w.decl_indices);
+    memset(w.type_indices, 0, cast(usize) type_count * sizeof *w.type_indices);
+
+    ly_module_export* exports = ch_alloc(allocator, (sema->module_decls.count + 1) * cast(int64) sizeof *exports);
+    int64 export_count = 0;
+    for (int64 i = 0; i < sema->module_decls.count; i++) {
+        ly_decl* decl = ly_sema_decl_get(sema, sema->module_decls.items[i]);
+        if (decl->kind == LY_DK_IMPORT) continue;
+
+        ch_atom_info decl_name = ch_atom_get(&sema->atoms, decl->name);
+        exports[export_count++] = (ly_module_export){
+            .hash = ch_hash(decl_name.text, decl_name.length, 0),
+            .text = decl_name.text,
+            .length = decl_name.length,
+            .order = i,
+            .decl = sema->module_decls.items[i],
+        };
+    }
+
+    if (export_count != 0) {
+        qsort(exports, cast(usize) export_count, sizeof *exports, ly_module_export_compare);
+    }
+
+    uint32 name_offset = ly_module_writer_string(&w, name, cast(int64) strlen(name));
+    const char* target = sema->context->target->name;
+    uint32 target_offset = ly_module_writer_string(&w, target, cast(int64) strlen(target));
+
+    da_push(&w.types, (ly_type){0});
+
+    // exported declarations take the first indices, in symbol order, before any of them writes what it refers to.
+    for (int64 i = 0; i < export_count; i++) {
+        da_push(&w.decls, (ly_module_decl){0});
+        w.decl_indices[exports[i].decl] = cast(uint32)(i + 1);
+    }
+
+    for (int64 i = 0; i < export_count; i++) {
+        ly_module_writer_fill_decl(&w, exports[i].decl, cast(uint32) i);
+
+        ly_module_symbol symbol = {
+            .hash = exports[i].hash,
+            .name = w.decls.items[i].name,
+            .name_length = w.decls.items[i].name_length,
+        };
+
+        da_push(&w.symbols, symbol);
+    }
+
+    // instances of exported templates, keyed by the template's name. Those of imported templates are in the modules which export them,
+    // and dependent ones only exist inside a template's pattern.
+    ly_template_cache* templates = &sema->templates;
+    for (int64 i = 0; i < templates->published_count; i++) {
+        ly_template_instance instance = templates->instances.items[i];
+        ly_decl* template_decl = ly_sema_decl_get(sema, instance.template_decl);
+        if ((template_decl->tree & LY_DECL_IMPORTED) || (ly_sema_decl_get(sema, instance.instance)->flags & LY_DF_DEPENDENT)) continue;
+
+        uint32 template_index = ly_module_writer_decl(&w, instance.template_decl);
+        ly_module_decl* template_record = &w.decls.items[template_index];
+        ly_module_instance record = {
+            .template_name = {
+                .hash = ch_hash(w.strings.items + template_record->name, template_record->name_length, 0),
+                .name = template_record->name,
+                .name_length = template_record->name_length,
+            },
+            .arg_count = instance.arg_count,
+            .decl = ly_module_writer_decl(&w, instance.instance),
+            // the order it was made in, only kept while sorting.
+            .reserved = cast(uint32) w.instances.count,
+        };
+
+        // argument types are written before any of the words, since writing them can push words of their own.
+        uint32* args = ch_alloc(allocator, instance.arg_count * cast(int64) sizeof *args);
+        for (int64 j = 0; j < instance.arg_count; j++) {
+            args[j] = ly_module_writer_type(&w, templates->args.items[instance.args + j]);
+        }
+
+        assert(w.extra.count + instance.arg_count <= UINT32_MAX && "too many module extra words");
+        record.args = cast(uint32) w.extra.count;
+        if (instance.arg_count != 0) {
+            da_push_many(&w.extra, args, instance.arg_count);
+        }
+
+        ch_dealloc(allocator, args);
+        da_push(&w.instances, record);
+    }
+
+    if (w.instances.count != 0) {
+        qsort(w.instances.items, cast(usize) w.instances.count, sizeof *w.instances.items, ly_module_instance_compare);
+        for (int64 i = 0; i < w.instances.count; i++) {
+            w.instances.items[i].reserved = 0;
+        }
+    }
+
+    while (w.strings.count % 8 != 0) {
+        da_push(&w.strings, '\0');
+    }
+
+    assert(w.strings.count <= UINT32_MAX && "too many module strings");
+    ly_module_file_header header = {
+        .version = LY_MODULE_FILE_VERSION,
+        .byte_order = LY_MODULE_FILE_BYTE_ORDER,
+        .name = name_offset,
+        .name_length = cast(uint32) strlen(name),
+        .target = target_offset,
+        .target_length = cast(uint32) strlen(target),
+        .symbol_count = cast(uint32) w.symbols.count,
+        .decl_count = cast(uint32) w.decls.count,
+        .field_count = cast(uint32) w.fields.count,
+        .type_count = cast(uint32) w.types.count,
+        .extra_count = cast(uint32) w.extra.count,
+        .string_size = cast(uint32) w.strings.count,
+        .instance_count = cast(uint32) w.instances.count,
+    };
+
+    memcpy(header.magic, LY_MODULE_FILE_MAGIC, sizeof header.magic);
+
+    int64 path_length = cast(int64) strlen(path);
+    char* temporary_path = ch_alloc(allocator, path_length + 5);
+    memcpy(temporary_path, path, cast(usize) path_length);
+    memcpy(temporary_path + path_length, ".tmp", 5);
+
+    FILE* stream = fopen(temporary_path, "wb");
+    if (stream == NULL) {
+        return_defer(false);
+    }
+
+    bool written = ly_module_file_write_array(stream, &header, sizeof header, 1);
+    written = written && ly_module_file_write_array(stream, w.symbols.items, sizeof(ly_module_symbol), w.symbols.count);
+    written = written && ly_module_file_write_array(stream, w.strings.items, 1, w.strings.count);
+    written = written && ly_module_file_write_array(stream, w.decls.items, sizeof(ly_module_decl), w.decls.count);
+    written = written && ly_module_file_write_array(stream, w.fields.items, sizeof(ly_module_field), w.fields.count);
+    written = written && ly_module_file_write_array(stream, w.types.items, sizeof(ly_type), w.types.count);
+    written = written && ly_module_file_write_array(stream, w.instances.items, sizeof(ly_module_instance), w.instances.count);
+    written = written && ly_module_file_write_array(stream, w.extra.items, sizeof(uint32), w.extra.count);
+
+    written = (0 == fclose(stream)) && written;
+    if (!written || !ly_module_file_replace_file(temporary_path, path)) {
+        discard remove(temporary_path);
+        return_defer(false);
+    }
+
+defer:
+    ch_dealloc(allocator, temporary_path);
+    ch_dealloc(allocator, exports);
+    ch_dealloc(allocator, w.type_indices);
+    ch_dealloc(allocator, w.decl_indices);
+    da_free(&w.extra);
+    da_free(&w.instances);
+    da_free(&w.types);
+    da_free(&w.fields);
+    da_free(&w.decls);
+    da_free(&w.symbols);
+    da_free(&w.strings);
+    return result;
+}
+
+// ======================================================================
+// Reading
+// ======================================================================
+
+static bool ly_module_file_has_string(ly_module_file* file, uint32 name, uint32 length) {
+    return cast(int64) name + cast(int64) length <= file->string_size;
+}
+
+static bool ly_module_file_has_type(ly_module_file* file, ly_qual_type type) {
+    return cast(int64) ly_qual_type_id(type) < file->type_count;
+}
+
+CHOIR_API bool ly_module_file_open(ly_module_file* file, const char* path) {
+    *file = (ly_module_file){0};
+    if (!ch_file_map(&file->mapping, path)) {
+        return false;
+    }
+
+    bool result = true;
+
+    if (file->mapping.size < cast(int64) sizeof(ly_module_file_header)) {
+        return_defer(false);
+    }
+
+    const char* data = file->mapping.data;
+    ly_module_file_header header;
+    memcpy(&header, data, sizeof header);
+
+    bool is_compatible = 0 == memcmp(header.magic, LY_MODULE_FILE_MAGIC, sizeof header.magic) &&
+                         header.version == LY_MODULE_FILE_VERSION &&
+                         header.byte_order == LY_MODULE_FILE_BYTE_ORDER;
+
+    if (!is_compatible || header.symbol_count > header.decl_count || header.type_count == 0 || header.string_size % 8 != 0) {
+        return_defer(false);
+    }
+
+    int64 symbols_offset = sizeof header;
+    int64 strings_offset = symbols_offset + cast(int64) header.symbol_count * cast(int64) sizeof(ly_module_symbol);
+    int64 decls_offset = strings_offset + cast(int64) header.string_size;
+    int64 fields_offset = decls_offset + cast(int64) header.decl_count * cast(int64) sizeof(ly_module_decl);
+    int64 types_offset = fields_offset + cast(int64) header.field_count * cast(int64) sizeof(ly_module_field);
+    int64 instances_offset = types_offset + cast(int64) header.type_count * cast(int64) sizeof(ly_type);
+    int64 extra_offset = instances_offset + cast(int64) header.instance_count * cast(int64) sizeof(ly_module_instance);
+    if (file->mapping.size != extra_offset + cast(int64) header.extra_count * cast(int64) sizeof(uint32)) {
+        return_defer(false);
+    }
+
+    // the mapping is page aligned and every array starts on an 8 byte boundary, so each can be used in place.
+    file->symbols = cast(const ly_module_symbol*)(data + symbols_offset);
+    file->symbol_count = header.symbol_count;
+    file->strings = data + strings_offset;
+    file->string_size = header.string_size;
+    file->decls = cast(const ly_module_decl*)(data + decls_offset);
+    file->decl_count = header.decl_count;
+    file->fields = cast(const ly_module_field*)(data + fields_offset);
+    file->field_count = header.field_count;
+    file->types = cast(const ly_type*)(data + types_offset);
+    file->type_count = header.type_count;
+    file->instances = cast(const ly_module_instance*)(data + instances_offset);
+    file->instance_count = header.instance_count;
+    file->extra = cast(const uint32*)(data + extra_offset);
+    file->extra_count = header.extra_count;
+
+    if (!ly_module_file_has_string(file, header.name, header.name_length) || !ly_module_file_has_string(file, header.target, header.target_length)) {
+        return_defer(false);
+    }
+
+    file->name = file->strings + header.name;
+    file->name_length = header.name_length;
+    file->target = file->strings + header.target;
+    file->target_length = header.target_length;
+
+defer:
+    if (!result) {
+        ly_module_file_close(file);
+    }
+
+    return result;
+}
+
+CHOIR_API void ly_module_file_close(ly_module_file* file) {
+    ch_file_unmap(&file->mapping);
+    *file = (ly_module_file){0};
+}
+
+// Symbols and template instances both start with a symbol and are sorted by it, so both are searched the same way, `stride` bytes apart.
+static const ly_module_symbol* ly_module_file_symbol_at(const void* records, int64 stride, int64 index) {
+    return cast(const ly_module_symbol*)(cast(const char*) records + index * stride);
+}
+
+static int64 ly_module_file_find_sorted(ly_module_file* file, const void* records, int64 stride, int64 record_count, const char* name, int64 length, uint32* out_first) {
+    uint64 hash = ch_hash(name, length, 0);
+
+    // find the first symbol with this hash, then the names sharing it, which are sorted together.
+    int64 low = 0, high = record_count;
+    while (low < high) {
+        int64 middle = low + (high - low) / 2;
+        if (ly_module_file_symbol_at(records, stride, middle)->hash < hash) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+
+    int64 first = -1, count = 0;
+    for (int64 i = low; i < record_count && ly_module_file_symbol_at(records, stride, i)->hash == hash; i++) {
+        const ly_module_symbol* symbol = ly_module_file_symbol_at(records, stride, i);
+        bool is_match = symbol->name_length == length && ly_module_file_has_string(file, symbol->name, symbol->name_length) &&
+                        0 == memcmp(file->strings + symbol->name, name, cast(usize) length);
+        if (is_match) {
+            if (first < 0) first = i;
+            count++;
+        } else if (first >= 0) {
+            break;
+        }
+    }
+
+    *out_first = first < 0 ? 0 : cast(uint32) first;
+    return count;
+}
+
+CHOIR_API int64 ly_module_file_find(ly_module_file* file, const char* name, int64 length, uint32* out_first) {
+    return ly_module_file_find_sorted(file, file->symbols, sizeof *file->symbols, file->symbol_count, name, length, out_first);
+}
+
+CHOIR_API int64 ly_module_file_find_instances(ly_module_file* file, const char* name, int64 length, uint32* out_first) {
+    return ly_module_file_find_sorted(file, file->instances, sizeof *file->instances, file->instance_count, name, length, out_first);
+}
+
+CHOIR_API const ly_module_decl* ly_module_file_decl(ly_module_file* file, uint32 index) {
+    if (index >= file->decl_count) return NULL;
+
+    const ly_module_decl* decl = &file->decls[index];
+    bool is_valid = decl->kind != LY_DK_INVALID && decl->kind <= LY_DK_TEMPLATE &&
+                    ly_module_file_has_string(file, decl->name, decl->name_length) &&
+                    ly_module_file_has_type(file, decl->type) &&
+                    cast(int64) decl->fields + cast(int64) decl->field_count <= file->field_count;
+
+    return is_valid ? decl : NULL;
+}
+
+CHOIR_API const ly_module_field* ly_module_file_field(ly_module_file* file, uint32 index) {
+    if (index >= file->field_count) return NULL;
+
+    const ly_module_field* field = &file->fields[index];
+    bool is_valid = ly_module_file_has_string(file, field->name, field->name_length) && ly_module_file_has_type(file, field->type);
+    return is_valid ? field : NULL;
+}
+
+CHOIR_API const ly_type* ly_module_file_type(ly_module_file* file, uint32 index) {
+    if (index >= file->type_count) return NULL;
+
+    const ly_type* type = &file->types[index];
+    if (type->kind == LY_TY_INVALID || type->kind >= LY_TY_COUNT || !ly_module_file_has_type(file, type->element)) {
+        return NULL;
+    }
+
+    switch (cast(ly_type_kind) type->kind) {
+        default: return type;
+        case LY_TY_ERROR_PAIR: return ly_module_file_has_type(file, type->operand) ? type : NULL;
+        case LY_TY_STRUCT:
+        case LY_TY_ENUM: return type->operand < file->decl_count ? type : NULL;
+    }
+}
+
+CHOIR_API const uint32* ly_module_file_extra(ly_module_file* file, uint32 index, int64 count) {
+    if (cast(int64) index + count > file->extra_count) return NULL;
+    return file->extra + index;
+}
+
+CHOIR_API const ly_module_instance* ly_module_file_instance(ly_module_file* file, uint32 index) {
+    if (index >= file->instance_count) return NULL;
+
+    const ly_module_instance* instance = &file->instances[index];
+    bool is_valid = ly_module_file_has_string(file, instance->template_name.name, instance->template_name.name_length) &&
+                    instance->decl < file->decl_count && cast(int64) instance->args + cast(int64) instance->arg_count <= file->extra_count;
+
+    for (int64 i = 0; i < instance->arg_count && is_valid; i++) {
+        is_valid = file->extra[instance->args + i] < file->type_count;
+    }
+
+    return is_valid ? instance : NULL;
+}
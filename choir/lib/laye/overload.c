@@ -0,0 +1,128 @@
+#include <laye/laye.h>
+#include <string.h>
+
+#define LY_OVERLOAD_CACHE_INITIAL_SLOT_COUNT 64
+
+static_assert(sizeof(ly_type_id) == sizeof(uint32), "argument types are stored as cache words");
+
+CHOIR_API void ly_overload_cache_init(ly_overload_cache* cache, ch_allocator allocator) {
+    *cache = (ly_overload_cache){
+        .allocator = allocator,
+        .resolutions.allocator = allocator,
+        .words.allocator = allocator,
+        .slot_count = LY_OVERLOAD_CACHE_INITIAL_SLOT_COUNT,
+    };
+
+    ch_mutex_init(&cache->mutex, allocator);
+    cache->slots = ch_alloc(allocator, cache->slot_count * cast(int64) sizeof *cache->slots);
+    memset(cache->slots, 0, cast(usize) cache->slot_count * sizeof *cache->slots);
+}
+
+CHOIR_API void ly_overload_cache_deinit(ly_overload_cache* cache) {
+    ch_dealloc(cache->allocator, cache->slots);
+    da_free(&cache->resolutions);
+    da_free(&cache->words);
+    ch_mutex_deinit(&cache->mutex);
+    *cache = (ly_overload_cache){0};
+}
+
+static uint64 ly_overload_cache_hash(ly_decl_id overload_set, const ly_type_id* arg_types, int64 arg_count) {
+    uint64 hash = ch_hash(&overload_set, sizeof overload_set, 0);
+    if (arg_count != 0) {
+        hash = ch_hash(arg_types, arg_count * cast(int64) sizeof *arg_types, hash);
+    }
+
+    return hash;
+}
+
+// Returns the slot holding the resolution for these argument types, or the empty slot it would be stored in.
+static uint32* ly_overload_cache_probe(ly_overload_cache* cache, ly_decl_id overload_set, const ly_type_id* arg_types, int64 arg_count, uint64 hash) {
+    int64 mask = cache->slot_count - 1;
+    for (int64 index = cast(int64)(hash & cast(uint64) mask);; index = (index + 1) & mask) {
+        uint32* slot = &cache->slots[index];
+        if (*slot == 0) {
+            return slot;
+        }
+
+        ly_overload_resolution* resolution = &cache->resolutions.items[*slot - 1];
+        if (resolution->overload_set == overload_set && resolution->arg_count == arg_count &&
+            (arg_count == 0 || 0 == memcmp(cache->words.items + resolution->args, arg_types, cast(usize) arg_count * sizeof *arg_types))) {
+            return slot;
+        }
+    }
+}
+
+static void ly_overload_cache_grow(ly_overload_cache* cache) {
+    ch_dealloc(cache->allocator, cache->slots);
+
+    cache->slot_count *= 2;
+    cache->slots = ch_alloc(cache->allocator, cache->slot_count * cast(int64) sizeof *cache->slots);
+    memset(cache->slots, 0, cast(usize) cache->slot_count * sizeof *cache->slots);
+
+    for (int64 i = 0; i < cache->resolutions.count; i++) {
+        ly_overload_resolution* resolution = &cache->resolutions.items[i];
+        const ly_type_id* arg_types = cache->words.items + resolution->args;
+        uint64 hash = ly_overload_cache_hash(resolution->overload_set, arg_types, resolution->arg_count);
+        *ly_overload_cache_probe(cache, resolution->overload_set, arg_types, resolution->arg_count, hash) = cast(uint32)(i + 1);
+    }
+}
+
+CHOIR_API ly_decl_id ly_overload_cache_find(ly_overload_cache* cache, ly_decl_id overload_set, const ly_type_id* arg_types, int64 arg_count, ly_conversion* out_conversions) {
+    uint64 hash = ly_overload_cache_hash(overload_set, arg_types, arg_count);
+
+    ch_mutex_lock(&cache->mutex);
+
+    ly_decl_id chosen = 0;
+    uint32 slot = *ly_overload_cache_probe(cache, overload_set, arg_types, arg_count, hash);
+    if (slot != 0) {
+        ly_overload_resolution* resolution = &cache->resolutions.items[slot - 1];
+        const uint32* conversions = cache->words.items + resolution->args + resolution->arg_count;
+        for (int64 i = 0; i < arg_count; i++) {
+            out_conversions[i] = cast(ly_conversion) conversions[i];
+        }
+
+        chosen = resolution->chosen;
+    }
+
+    ch_mutex_unlock(&cache->mutex);
+    return chosen;
+}
+
+CHOIR_API void ly_overload_cache_add(ly_overload_cache* cache, ly_decl_id overload_set, const ly_type_id* arg_types, int64 arg_count, ly_decl_id chosen, const ly_conversion* conversions) {
+    assert(overload_set != 0 && chosen != 0 && "overload resolutions need both a set and the function chosen from it");
+
+    uint64 hash = ly_overload_cache_hash(overload_set, arg_types, arg_count);
+
+    ch_mutex_lock(&cache->mutex);
+    assert(arg_count >= 0 && cache->words.count + 2 * arg_count <= UINT32_MAX && "too many overload resolutions");
+
+    uint32* slot = ly_overload_cache_probe(cache, overload_set, arg_types, arg_count, hash);
+    if (*slot != 0) {
+        goto unlock;
+    }
+
+    ly_overload_resolution resolution = {
+        .overload_set = overload_set,
+        .chosen = chosen,
+        .args = cast(uint32) cache->words.count,
+        .arg_count = cast(uint32) arg_count,
+    };
+
+    if (arg_count != 0) {
+        da_push_many(&cache->words, arg_types, arg_count);
+        for (int64 i = 0; i < arg_count; i++) {
+            uint32 conversion = cast(uint32) conversions[i];
+            da_push(&cache->words, conversion);
+        }
+    }
+
+    da_push(&cache->resolutions, resolution);
+    *slot = cast(uint32) cache->resolutions.count;
+
+    if (cache->resolutions.count * 2 > cache->slot_count) {
+        ly_overload_cache_grow(cache);
+    }
+
+unlock:
+    ch_mutex_unlock(&cache->mutex);
+}
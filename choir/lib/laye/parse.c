@@ -1 +1,1738 @@
 #include <laye/laye.h>
+#include <string.h>
+
+typedef struct parser_ids {
+    ch_allocator allocator;
+    ly_syntax_id* items;
+    int64 count, capacity;
+} parser_ids;
+
+// A binary or prefix operator which is waiting for its operands to be parsed.
+typedef struct parser_operator {
+    ly_token_kind kind;
+    // for binary operators, how strongly this operator holds on to the operand which follows it.
+    uint8 right_binding_power;
+    uint32 offset;
+    uint32 end;
+    // the target type of a `cast(T)`, otherwise 0.
+    ly_syntax_id type;
+} parser_operator;
+
+typedef struct parser_operators {
+    ch_allocator allocator;
+    parser_operator* items;
+    int64 count, capacity;
+} parser_operators;
+
+typedef struct parser {
+    ch_context* context;
+    ly_syntax_tree* tree;
+
+    // tokens are pulled from the streaming lexer, or, when `ly_reparse` parses part of an existing token list, from that list.
+    ly_lexer* lexer;
+    // the current token. one from the lexer is only valid until the parser advances past it.
+    ly_token* token;
+    // how many tokens have been consumed so far, which tells `parser_recover` whether a construct made any progress.
+    int64 consumed;
+    // the end offset of the most recently consumed token, which is where the node being built ends.
+    uint32 previous_end;
+    int64 depth;
+    bool reported_depth;
+    // set once a syntax error is reported, until `parser_recover` reaches a synchronization point.
+    // errors in between are almost always fallout from the first one, so they are not reported.
+    bool recovering;
+    // how many template argument lists are open. the `>>` closing two of them is consumed by the inner one, which leaves
+    // `pending_greater` set for the outer one to close on without consuming anything.
+    int64 template_depth;
+    bool pending_greater;
+
+    // expression operands and operators still waiting to be combined, shared by every nested expression.
+    // each expression only ever looks at the part of these stacks it pushed itself.
+    parser_ids operands;
+    parser_operators operators;
+    // node ids of lists which are still being parsed, shared the same way.
+    parser_ids scratch;
+} parser;
+
+static ly_syntax_id parse_top_level(parser* p);
+static ly_syntax_id parse_statement(parser* p);
+static ly_syntax_id parse_compound(parser* p);
+static ly_syntax_id parse_type(parser* p);
+static ly_syntax_id parse_template_arguments(parser* p, uint32 offset, ly_syntax_id nameref);
+static ly_syntax_id parse_expression(parser* p);
+static ly_syntax_id parse_binary(parser* p, ly_syntax_id lhs);
+static ly_syntax_id parse_unary(parser* p);
+
+static ly_token_kind parser_kind(parser* p) {
+    return p->token->kind;
+}
+
+static bool parser_at(parser* p, ly_token_kind kind) {
+    return p->token->kind == kind;
+}
+
+static ly_token_kind parser_peek(parser* p, int64 ahead) {
+    if (p->lexer != NULL) {
+        return ly_lexer_peek(p->lexer, ahead)->kind;
+    }
+
+    ly_token* token = p->token;
+    for (int64 i = 0; i < ahead && token->next != NULL; i++) {
+        token = token->next;
+    }
+
+    return token->kind;
+}
+
+static uint32 parser_offset(parser* p) {
+    return cast(uint32) p->token->location.offset;
+}
+
+static void parser_advance(parser* p) {
+    p->previous_end = cast(uint32)(p->token->location.offset + p->token->location.length);
+    if (p->token->kind == LY_TK_EOF) return;
+
+    if (p->lexer != NULL) {
+        discard ly_lexer_next(p->lexer);
+        p->token = ly_lexer_peek(p->lexer, 0);
+    } else if (p->token->next != NULL) {
+        p->token = p->token->next;
+    } else {
+        return;
+    }
+
+    p->consumed++;
+}
+
+static bool parser_consume(parser* p, ly_token_kind kind) {
+    if (!parser_at(p, kind)) return false;
+    parser_advance(p);
+    return true;
+}
+
+// Reports a syntax error at the current token, unless the parser is still recovering from an earlier one.
+static void parser_error(parser* p, const char* message) {
+    if (p->recovering) return;
+    ch_diag(p->context, CH_DIAG_ERROR, p->token->location, "%s", message);
+    p->recovering = true;
+}
+
+static bool parser_expect(parser* p, ly_token_kind kind, const char* what) {
+    if (parser_consume(p, kind)) {
+        // finding an expected `;` or brace means the parser is back in step with the source.
+        if (kind == LY_TK_SEMI_COLON || kind == LY_TK_OPEN_CURLY || kind == LY_TK_CLOSE_CURLY) {
+            p->recovering = false;
+        }
+
+        return true;
+    }
+
+    if (p->recovering) return false;
+    ch_diag(p->context, CH_DIAG_ERROR, p->token->location, "expected %s", what);
+    p->recovering = true;
+    return false;
+}
+
+static ly_syntax_id parser_node(parser* p, ly_syntax_kind kind, ly_token_kind token_kind, uint32 offset, uint32 lhs, uint32 rhs) {
+    uint32 end = p->previous_end > offset ? p->previous_end : offset;
+    return ly_syntax_add(p->tree, (ly_syntax_node){
+        .kind = cast(uint8) kind,
+        .token_kind = cast(uint16) token_kind,
+        .offset = offset,
+        .length = end - offset,
+        .lhs = lhs,
+        .rhs = rhs,
+    });
+}
+
+static uint32 parser_node_end(parser* p, ly_syntax_id id) {
+    ly_syntax_node* node = ly_syntax_get(p->tree, id);
+    return node->offset + node->length;
+}
+
+static ly_syntax_kind parser_node_kind(parser* p, ly_syntax_id id) {
+    return cast(ly_syntax_kind) ly_syntax_get(p->tree, id)->kind;
+}
+
+static uint32 parser_token_string(parser* p, ly_token* token) {
+    if (token->kind == LY_TK_LITERAL_STRING) {
+        return ly_syntax_add_string(p->tree, token->string_value, token->string_length);
+    }
+
+    return ly_syntax_add_string(p->tree, token->lexeme_begin, token->lexeme_length);
+}
+
+// Consumes an identifier and returns its string, or reports an error and returns 0.
+static uint32 parser_expect_identifier(parser* p) {
+    if (!parser_at(p, LY_TK_IDENTIFIER)) {
+        parser_error(p, "expected an identifier");
+        return 0;
+    }
+
+    uint32 name = parser_token_string(p, p->token);
+    parser_advance(p);
+    return name;
+}
+
+static uint32 parser_expect_string(parser* p) {
+    if (!parser_at(p, LY_TK_LITERAL_STRING)) {
+        parser_error(p, "expected a string literal");
+        return 0;
+    }
+
+    uint32 string = parser_token_string(p, p->token);
+    parser_advance(p);
+    return string;
+}
+
+// Moves the ids pushed to the scratch stack since `base` into the tree as a list.
+static uint32 parser_finish_list(parser* p, int64 base) {
+    uint32 list = ly_syntax_add_list(p->tree, p->scratch.items + base, p->scratch.count - base);
+    p->scratch.count = base;
+    return list;
+}
+
+// Skips a construct this parser does not understand, up to and including its terminating `;` or balanced `}`.
+static void parser_skip_construct(parser* p) {
+    int64 nesting = 0;
+    while (!parser_at(p, LY_TK_EOF)) {
+        ly_token_kind kind = parser_kind(p);
+        parser_advance(p);
+
+        if (kind == LY_TK_OPEN_CURLY) {
+            nesting++;
+        } else if (kind == LY_TK_CLOSE_CURLY) {
+            // `static if` and friends may continue with an `else` block.
+            if (--nesting <= 0 && !parser_at(p, LY_TK_ELSE)) return;
+        } else if (kind == LY_TK_SEMI_COLON && nesting == 0) {
+            return;
+        }
+    }
+}
+
+// Skips an over-nested region up to, but not including, the token which closes the bracket it is in.
+static void parser_skip_nested(parser* p) {
+    int64 nesting = 0;
+    while (!parser_at(p, LY_TK_EOF)) {
+        ly_token_kind kind = parser_kind(p);
+        if (kind == LY_TK_OPEN_PAREN || kind == LY_TK_OPEN_SQUARE || kind == LY_TK_OPEN_CURLY) {
+            nesting++;
+        } else if (kind == LY_TK_CLOSE_PAREN || kind == LY_TK_CLOSE_SQUARE || kind == LY_TK_CLOSE_CURLY) {
+            if (nesting == 0) return;
+            nesting--;
+        } else if (kind == LY_TK_SEMI_COLON && nesting == 0) {
+            return;
+        }
+
+        parser_advance(p);
+    }
+}
+
+// Called after each statement, member or top level declaration, with the `consumed` count it started at.
+// When that construct failed to parse, tokens are skipped up to the next synchronization point: past a `;` or a balanced `{}` block,
+// or up to the `}` closing the enclosing block or a token which starts a statement or declaration.
+// At least one token is consumed if the construct consumed none, so every step moves forward and garbage costs time linear in its length.
+static void parser_recover(parser* p, int64 start) {
+    bool moved = p->consumed != start;
+    if (moved && !p->recovering) return;
+
+    // inside a block, statements are synchronization points too; at the top level only declarations are.
+    ly_token_class resume = p->depth > 0 ? LY_TKC_STATEMENT_START | LY_TKC_DECLARATION_START : LY_TKC_DECLARATION_START;
+
+    int64 nesting = 0;
+    while (!parser_at(p, LY_TK_EOF)) {
+        ly_token_kind kind = parser_kind(p);
+        if (moved && nesting == 0) {
+            if (kind == LY_TK_SEMI_COLON) {
+                parser_advance(p);
+                break;
+            }
+
+            // the enclosing block's `}` is left for the block to consume.
+            if (kind == LY_TK_CLOSE_CURLY && p->depth > 0) break;
+            if (kind != LY_TK_CLOSE_CURLY && ly_token_kind_has_class(kind, resume)) break;
+        }
+
+        parser_advance(p);
+        moved = true;
+
+        if (kind == LY_TK_OPEN_CURLY) {
+            nesting++;
+        } else if (kind == LY_TK_CLOSE_CURLY && --nesting <= 0) {
+            break;
+        }
+    }
+
+    p->recovering = false;
+}
+
+// Enters a level of bracketed nesting. When the limit is reached the nested region is skipped instead, and false returned.
+static bool parser_enter(parser* p) {
+    if (p->depth >= LY_PARSE_MAX_DEPTH) {
+        if (!p->reported_depth) {
+            ch_diag(p->context, CH_DIAG_ERROR, p->token->location, "too deeply nested; the parser stops at %d levels", LY_PARSE_MAX_DEPTH);
+            p->reported_depth = true;
+        }
+
+        parser_skip_nested(p);
+        return false;
+    }
+
+    p->depth++;
+    return true;
+}
+
+static void parser_leave(parser* p) {
+    assert(p->depth > 0 && "unbalanced parser nesting");
+    p->depth--;
+}
+
+static bool can_start_type(ly_token_kind kind) {
+    return kind == LY_TK_IDENTIFIER || kind == LY_TK_MUT || ly_token_kind_is_type_keyword(kind);
+}
+
+static bool can_start_expression(ly_token_kind kind) {
+    switch (kind) {
+        default: return ly_token_kind_has_class(kind, LY_TKC_LITERAL | LY_TKC_PREFIX_OPERATOR | LY_TKC_TYPE_KEYWORD);
+
+        case LY_TK_IDENTIFIER:
+        case LY_TK_MUT:
+        case LY_TK_OPEN_PAREN:
+        case LY_TK_SIZEOF:
+        case LY_TK_ALIGNOF:
+        case LY_TK_OFFSETOF:
+        case LY_TK_COUNTOF:
+        case LY_TK_RANKOF:
+        case LY_TK_TYPEOF: return true;
+    }
+}
+
+static parser parser_create(ch_context* context, ly_syntax_tree* tree, ly_lexer* lexer, ly_token* token) {
+    ch_allocator allocator = tree->nodes.allocator;
+    return (parser){
+        .context = context,
+        .tree = tree,
+        .lexer = lexer,
+        .token = lexer != NULL ? ly_lexer_peek(lexer, 0) : token,
+        .operands.allocator = allocator,
+        .operators.allocator = allocator,
+        .scratch.allocator = allocator,
+    };
+}
+
+static void parser_destroy(parser* p) {
+    da_free(&p->operands);
+    da_free(&p->operators);
+    da_free(&p->scratch);
+}
+
+static ly_syntax_id parse_module_unit(parser* p) {
+    ly_syntax_tree* tree = p->tree;
+    assert(tree->nodes.count == 1 && "ly_parse expects an initialized, empty syntax tree");
+
+    tree->text = tree->source->text;
+
+    uint32 offset = parser_offset(p);
+    uint32 module_name = 0;
+    if (parser_consume(p, LY_TK_MODULE)) {
+        module_name = parser_expect_identifier(p);
+        parser_expect(p, LY_TK_SEMI_COLON, "';'");
+    }
+
+    int64 base = p->scratch.count;
+    while (!parser_at(p, LY_TK_EOF)) {
+        int64 start = p->consumed;
+        ly_syntax_id decl = parse_top_level(p);
+        if (decl != 0) {
+            da_push(&p->scratch, decl);
+        }
+
+        parser_recover(p, start);
+    }
+
+    uint32 decls = parser_finish_list(p, base);
+    tree->root = parser_node(p, LY_SN_MODULE_UNIT, LY_TK_MODULE, offset, decls, module_name);
+    return tree->root;
+}
+
+CHOIR_API ly_syntax_id ly_parse(ch_context* context, ly_syntax_tree* tree, ly_lexer* lexer) {
+    assert(lexer != NULL && "where is the lexer?");
+    assert(lexer->source == tree->source && "ly_parse expects the lexer to read the tree's source");
+
+    parser p = parser_create(context, tree, lexer, NULL);
+    ly_syntax_id root = parse_module_unit(&p);
+    parser_destroy(&p);
+    return root;
+}
+
+typedef struct reparse_stack {
+    ch_allocator allocator;
+    ly_syntax_id* items;
+    int64 count, capacity;
+} reparse_stack;
+
+// Counts the nodes of a subtree, walking it with an explicit stack since expression chains make for deep trees.
+static int64 reparse_count_nodes(ly_syntax_tree* tree, ly_syntax_id root) {
+    reparse_stack stack = {.allocator = tree->nodes.allocator};
+    ly_syntax_id children[16];
+    int64 count = 0;
+
+    da_push(&stack, root);
+    while (stack.count > 0) {
+        ly_syntax_id id = stack.items[--stack.count];
+        count++;
+
+        int64 child_count = ly_syntax_children(tree, id, children, 16);
+        if (child_count > 16) {
+            // the extra data is stable while nothing is being added, so wide nodes can push their list directly.
+            int64 base = stack.count;
+            for (int64 i = 0; i < child_count; i++) {
+                da_push(&stack, 0);
+            }
+
+            discard ly_syntax_children(tree, id, stack.items + base, child_count);
+            continue;
+        }
+
+        for (int64 i = 0; i < child_count; i++) {
+            da_push(&stack, children[i]);
+        }
+    }
+
+    da_free(&stack);
+    return count;
+}
+
+// the farthest `parser_peek` ever looks past the end of a declaration; looking for template arguments goes further, but never past a `;` or brace.
+#define REPARSE_LOOKAHEAD 2
+
+static ly_syntax_id reparse_everything(ch_context* context, ly_syntax_tree* tree, ly_token* tokens) {
+    ch_allocator allocator = tree->nodes.allocator;
+    ch_source* source = tree->source;
+
+    ly_syntax_tree_deinit(tree);
+    ly_syntax_tree_init(tree, allocator, source);
+
+    parser p = parser_create(context, tree, NULL, tokens);
+    ly_syntax_id root = parse_module_unit(&p);
+    parser_destroy(&p);
+    return root;
+}
+
+CHOIR_API ly_syntax_id ly_reparse(ch_context* context, ly_syntax_tree* tree, ly_token* tokens, ch_source_edit edit) {
+    assert(tree->root != 0 && "ly_reparse expects a tree which has already been parsed");
+    assert(!tree->is_mapped && "ly_reparse cannot update a tree loaded from the syntax cache");
+    assert(tokens != NULL && "ly_reparse expects at least the EOF token");
+
+    int64 delta = edit.inserted_length - edit.removed_length;
+    int64 removed_end = edit.offset + edit.removed_length;
+
+    // only an edit strictly inside a single top level declaration can be handled locally.
+    // an edit touching a declaration's boundary could just as well join it to its neighbor or split it in two.
+    ly_syntax_node root = *ly_syntax_get(tree, tree->root);
+    ly_syntax_list decls = ly_syntax_list_get(tree, root.lhs);
+
+    int64 decl_index = -1;
+    for (int64 i = 0; i < decls.count; i++) {
+        ly_syntax_node* decl = ly_syntax_get(tree, decls.items[i]);
+        if (decl->offset < edit.offset && removed_end < decl->offset + decl->length) {
+            decl_index = i;
+            break;
+        }
+
+        if (decl->offset >= edit.offset) break;
+    }
+
+    if (decl_index < 0) {
+        return reparse_everything(context, tree, tokens);
+    }
+
+    ly_syntax_id old_decl = decls.items[decl_index];
+    uint32 decl_offset = ly_syntax_get(tree, old_decl)->offset;
+
+    ly_token* start = tokens;
+    while (start->kind != LY_TK_EOF && start->location.offset < decl_offset) {
+        start = start->next;
+    }
+
+    if (start->location.offset != decl_offset) {
+        return reparse_everything(context, tree, tokens);
+    }
+
+    // the previous declaration may have stopped because of what it saw in this one's leading tokens, up to the parser's lookahead.
+    // those have to be untouched by the edit for the previous declaration to still end where it did.
+    ly_token* lookahead = start;
+    for (int64 i = 0; i < REPARSE_LOOKAHEAD && lookahead->kind != LY_TK_EOF; i++) {
+        lookahead = lookahead->next;
+    }
+
+    if (lookahead->location.offset + lookahead->location.length >= edit.offset) {
+        return reparse_everything(context, tree, tokens);
+    }
+
+    int64 expected_next_offset = tree->source->length;
+    if (decl_index + 1 < decls.count) {
+        expected_next_offset = ly_syntax_get(tree, decls.items[decl_index + 1])->offset + delta;
+    }
+
+    int64 first_new_node = tree->nodes.count;
+    int64 first_new_string = tree->strings.count;
+
+    // diagnostics are held back until the new declaration is known to fit where the old one was.
+    ch_context declaration_context = {0};
+    ch_context_init(&declaration_context, context->allocator);
+    declaration_context.defer_diagnostics = true;
+
+    parser p = parser_create(&declaration_context, tree, NULL, start);
+    ly_syntax_id new_decl = parse_top_level(&p);
+    // skipping past whatever follows a broken declaration is part of parsing it, just as in `ly_parse`.
+    parser_recover(&p, 0);
+    bool fits = new_decl != 0 && p.token->location.offset == expected_next_offset;
+    uint32 new_decl_end = p.previous_end;
+    parser_destroy(&p);
+
+    if (!fits) {
+        ch_diag_discard(&declaration_context);
+        ch_context_deinit(&declaration_context);
+        return reparse_everything(context, tree, tokens);
+    }
+
+    ch_diag_merge(context, &declaration_context);
+    ch_context_deinit(&declaration_context);
+
+    tree->dead_node_count += reparse_count_nodes(tree, old_decl);
+    tree->extra.items[root.lhs + 1 + decl_index] = new_decl;
+
+    // everything which was kept moves with the text after the edit, and whatever spans the edit, the root, grows or shrinks with it.
+    for (int64 i = 1; i < first_new_node; i++) {
+        ly_syntax_node* node = &tree->nodes.items[i];
+        if (node->offset >= removed_end) {
+            node->offset = cast(uint32)(node->offset + delta);
+        } else if (node->offset + node->length >= removed_end) {
+            node->length = cast(uint32)(node->length + delta);
+        }
+    }
+
+    // the root ends with the last token the parser consumed. when that belongs to the new declaration it need not have moved by the
+    // edit's size; an edit opening a comment, for one, swallows the rest of the file.
+    if (decl_index == decls.count - 1) {
+        ly_syntax_node* root_node = ly_syntax_get(tree, tree->root);
+        root_node->length = new_decl_end > root_node->offset ? new_decl_end - root_node->offset : 0;
+    }
+
+    // string views into the old text are moved to the same text in the new one.
+    int64 old_length = tree->source->length - delta;
+    for (int64 i = 1; i < first_new_string; i++) {
+        ly_syntax_string* string = &tree->strings.items[i];
+        uintptr_t string_address = cast(uintptr_t) string->text;
+        uintptr_t text_address = cast(uintptr_t) tree->text;
+        if (string_address < text_address || string_address > text_address + cast(uintptr_t) old_length) continue;
+
+        int64 offset = cast(int64)(string_address - text_address);
+        if (offset >= removed_end) {
+            offset += delta;
+        } else if (offset >= edit.offset) {
+            // only the replaced declaration referred to the edited text, and nothing reaches it anymore.
+            string->text = "";
+            string->length = 0;
+            continue;
+        }
+
+        string->text = tree->source->text + offset;
+    }
+
+    tree->text = tree->source->text;
+
+    // replaced declarations are never reused, so once they outnumber the live ones the tree is rebuilt to get the memory back.
+    if (tree->dead_node_count > tree->nodes.count - tree->dead_node_count) {
+        return reparse_everything(context, tree, tokens);
+    }
+
+    return tree->root;
+}
+
+// ======================================================================
+// Declarations
+// ======================================================================
+
+typedef struct parser_attributes {
+    uint8 flags;
+    uint32 foreign_name;
+    uint32 calling_convention;
+} parser_attributes;
+
+static parser_attributes parse_attributes(parser* p) {
+    parser_attributes attributes = {0};
+    while (true) {
+        switch (parser_kind(p)) {
+            default: return attributes;
+
+            case LY_TK_EXPORT: {
+                parser_advance(p);
+                attributes.flags |= LY_SF_EXPORT;
+            } break;
+
+            case LY_TK_FOREIGN: {
+                parser_advance(p);
+                attributes.flags |= LY_SF_FOREIGN;
+                if (parser_at(p, LY_TK_LITERAL_STRING)) {
+                    attributes.foreign_name = parser_expect_string(p);
+                }
+            } break;
+
+            case LY_TK_INLINE: {
+                parser_advance(p);
+                attributes.flags |= LY_SF_INLINE;
+            } break;
+
+            case LY_TK_DISCARDABLE: {
+                parser_advance(p);
+                attributes.flags |= LY_SF_DISCARDABLE;
+            } break;
+
+            case LY_TK_CALLCONV: {
+                parser_advance(p);
+                if (parser_consume(p, LY_TK_OPEN_PAREN)) {
+                    attributes.calling_convention = parser_expect_identifier(p);
+                    parser_expect(p, LY_TK_CLOSE_PAREN, "')'");
+                } else {
+                    attributes.calling_convention = parser_expect_string(p);
+                }
+            } break;
+        }
+    }
+}
+
+static ly_syntax_id parse_import(parser* p, uint32 offset, parser_attributes attributes) {
+    assert(parser_at(p, LY_TK_IMPORT));
+    parser_advance(p);
+
+    uint32 name = 0;
+    if (parser_at(p, LY_TK_LITERAL_STRING)) {
+        name = parser_expect_string(p);
+    } else {
+        name = parser_expect_identifier(p);
+    }
+
+    uint32 alias = 0;
+    if (parser_consume(p, LY_TK_AS)) {
+        alias = parser_expect_identifier(p);
+    }
+
+    parser_expect(p, LY_TK_SEMI_COLON, "';'");
+
+    ly_syntax_id import = parser_node(p, LY_SN_DECL_IMPORT, LY_TK_IMPORT, offset, name, alias);
+    ly_syntax_get(p->tree, import)->flags = attributes.flags;
+    return import;
+}
+
+static ly_syntax_id parse_struct(parser* p, uint32 offset, parser_attributes attributes) {
+    ly_token_kind kind = parser_kind(p);
+    assert(kind == LY_TK_STRUCT || kind == LY_TK_VARIANT);
+    parser_advance(p);
+
+    uint32 name = parser_expect_identifier(p);
+    int64 base = p->scratch.count;
+
+    if (parser_expect(p, LY_TK_OPEN_CURLY, "'{'") && parser_enter(p)) {
+        while (!parser_at(p, LY_TK_CLOSE_CURLY) && !parser_at(p, LY_TK_EOF)) {
+            int64 start = p->consumed;
+            uint32 member_offset = parser_offset(p);
+
+            ly_syntax_id member = 0;
+            if (parser_at(p, LY_TK_VARIANT)) {
+                member = parse_struct(p, member_offset, (parser_attributes){0});
+            } else {
+                ly_syntax_id type = parse_type(p);
+                uint32 field_name = parser_expect_identifier(p);
+                parser_expect(p, LY_TK_SEMI_COLON, "';'");
+                member = parser_node(p, LY_SN_DECL_FIELD, LY_TK_MISSING, member_offset, type, field_name);
+            }
+
+            da_push(&p->scratch, member);
+            parser_recover(p, start);
+        }
+
+        parser_leave(p);
+    }
+
+    parser_expect(p, LY_TK_CLOSE_CURLY, "'}'");
+
+    uint32 members = parser_finish_list(p, base);
+    ly_syntax_id decl = parser_node(p, LY_SN_DECL_STRUCT, kind, offset, name, members);
+    ly_syntax_get(p->tree, decl)->flags = attributes.flags;
+    return decl;
+}
+
+static ly_syntax_id parse_enum(parser* p, uint32 offset, parser_attributes attributes) {
+    assert(parser_at(p, LY_TK_ENUM));
+    parser_advance(p);
+
+    uint32 name = parser_expect_identifier(p);
+    int64 base = p->scratch.count;
+
+    if (parser_expect(p, LY_TK_OPEN_CURLY, "'{'")) {
+        while (!parser_at(p, LY_TK_CLOSE_CURLY) && !parser_at(p, LY_TK_EOF)) {
+            uint32 variant_offset = parser_offset(p);
+            uint32 variant_name = parser_expect_identifier(p);
+
+            ly_syntax_id value = 0;
+            if (parser_consume(p, LY_TK_EQUAL)) {
+                value = parse_expression(p);
+            }
+
+            da_push(&p->scratch, parser_node(p, LY_SN_DECL_ENUM_VARIANT, LY_TK_MISSING, variant_offset, variant_name, value));
+            if (!parser_consume(p, LY_TK_COMMA)) break;
+        }
+    }
+
+    parser_expect(p, LY_TK_CLOSE_CURLY, "'}'");
+
+    uint32 variants = parser_finish_list(p, base);
+    ly_syntax_id decl = parser_node(p, LY_SN_DECL_ENUM, LY_TK_ENUM, offset, name, variants);
+    ly_syntax_get(p->tree, decl)->flags = attributes.flags;
+    return decl;
+}
+
+static ly_syntax_id parse_alias(parser* p, uint32 offset, parser_attributes attributes) {
+    if (parser_consume(p, LY_TK_STRICT)) {
+        attributes.flags |= LY_SF_STRICT;
+    }
+
+    parser_expect(p, LY_TK_ALIAS, "'alias'");
+    uint32 name = parser_expect_identifier(p);
+    parser_expect(p, LY_TK_EQUAL, "'='");
+    ly_syntax_id type = parse_type(p);
+    parser_expect(p, LY_TK_SEMI_COLON, "';'");
+
+    ly_syntax_id decl = parser_node(p, LY_SN_DECL_ALIAS, LY_TK_ALIAS, offset, name, type);
+    ly_syntax_get(p->tree, decl)->flags = attributes.flags;
+    return decl;
+}
+
+static ly_syntax_id parse_parameter(parser* p) {
+    uint32 offset = parser_offset(p);
+    if (parser_consume(p, LY_TK_VARARGS)) {
+        return parser_node(p, LY_SN_DECL_PARAM, LY_TK_VARARGS, offset, 0, 0);
+    }
+
+    // a `ref` parameter is marked by its token kind, the same way `varargs` is.
+    ly_token_kind kind = parser_consume(p, LY_TK_REF) ? LY_TK_REF : LY_TK_MISSING;
+    ly_syntax_id type = parse_type(p);
+    uint32 name = parser_expect_identifier(p);
+    return parser_node(p, LY_SN_DECL_PARAM, kind, offset, type, name);
+}
+
+// Parses the rest of a binding or function declaration once its type has been parsed; the current token should be its name.
+static ly_syntax_id parse_declaration_at_name(parser* p, uint32 offset, parser_attributes attributes, ly_syntax_id type) {
+    uint32 name = parser_expect_identifier(p);
+
+    if (!parser_consume(p, LY_TK_OPEN_PAREN)) {
+        ly_syntax_id initializer = 0;
+        if (parser_consume(p, LY_TK_EQUAL)) {
+            initializer = parse_expression(p);
+        }
+
+        parser_expect(p, LY_TK_SEMI_COLON, "';'");
+
+        uint32 words[2] = {name, initializer};
+        uint32 extra = ly_syntax_add_extra(p->tree, words, 2);
+        ly_syntax_id decl = parser_node(p, LY_SN_DECL_BINDING, LY_TK_MISSING, offset, type, extra);
+        ly_syntax_get(p->tree, decl)->flags = attributes.flags;
+        return decl;
+    }
+
+    int64 base = p->scratch.count;
+    if (!parser_at(p, LY_TK_CLOSE_PAREN)) {
+        do {
+            da_push(&p->scratch, parse_parameter(p));
+        } while (parser_consume(p, LY_TK_COMMA));
+    }
+
+    parser_expect(p, LY_TK_CLOSE_PAREN, "')'");
+    uint32 params = parser_finish_list(p, base);
+
+    ly_syntax_id body = 0;
+    if (parser_at(p, LY_TK_OPEN_CURLY)) {
+        body = parse_compound(p);
+    } else {
+        parser_expect(p, LY_TK_SEMI_COLON, "'{' or ';'");
+    }
+
+    uint32 words[6] = {type, name, params, body, attributes.foreign_name, attributes.calling_convention};
+    uint32 extra = ly_syntax_add_extra(p->tree, words, 6);
+    ly_syntax_id decl = parser_node(p, LY_SN_DECL_FUNCTION, LY_TK_MISSING, offset, extra, 0);
+    ly_syntax_get(p->tree, decl)->flags = attributes.flags;
+    return decl;
+}
+
+// Parses `template<T, ...>` and the struct or function declaration it is a pattern for, which is given the template's attributes.
+static ly_syntax_id parse_template(parser* p, uint32 offset, parser_attributes attributes) {
+    assert(parser_at(p, LY_TK_TEMPLATE));
+    parser_advance(p);
+    parser_expect(p, LY_TK_LESS, "'<'");
+
+    int64 base = p->scratch.count;
+    while (!parser_at(p, LY_TK_GREATER) && !parser_at(p, LY_TK_EOF)) {
+        uint32 param_offset = parser_offset(p);
+        if (parser_at(p, LY_TK_IDENTIFIER) && (parser_peek(p, 1) == LY_TK_COMMA || parser_peek(p, 1) == LY_TK_GREATER)) {
+            uint32 name = parser_expect_identifier(p);
+            da_push(&p->scratch, parser_node(p, LY_SN_DECL_TEMPLATE_PARAM, LY_TK_MISSING, param_offset, name, 0));
+        } else {
+            ch_diag(p->context, CH_DIAG_ERROR, p->token->location, "value template parameters are not supported yet");
+            discard parse_type(p);
+            discard parser_expect_identifier(p);
+        }
+
+        if (!parser_consume(p, LY_TK_COMMA)) break;
+    }
+
+    parser_expect(p, LY_TK_GREATER, "'>'");
+    uint32 params = parser_finish_list(p, base);
+
+    ch_location pattern_location = p->token->location;
+    uint32 pattern_offset = parser_offset(p);
+
+    ly_syntax_id pattern = 0;
+    if (parser_at(p, LY_TK_STRUCT)) {
+        pattern = parse_struct(p, pattern_offset, attributes);
+    } else if (can_start_type(parser_kind(p))) {
+        ly_syntax_id type = parse_type(p);
+        pattern = parse_declaration_at_name(p, pattern_offset, attributes, type);
+    } else if (!ly_token_kind_is_declaration_start(parser_kind(p))) {
+        parser_error(p, "expected a struct or function declaration");
+        return parser_node(p, LY_SN_INVALID, LY_TK_MISSING, offset, 0, 0);
+    } else {
+        parser_skip_construct(p);
+    }
+
+    if (pattern == 0 || parser_node_kind(p, pattern) == LY_SN_DECL_BINDING) {
+        ch_diag(p->context, CH_DIAG_ERROR, pattern_location, "only structs and functions can be templates");
+        return parser_node(p, LY_SN_INVALID, LY_TK_MISSING, offset, 0, 0);
+    }
+
+    ly_syntax_id decl = parser_node(p, LY_SN_DECL_TEMPLATE, LY_TK_TEMPLATE, offset, params, pattern);
+    ly_syntax_get(p->tree, decl)->flags = attributes.flags;
+    return decl;
+}
+
+// Parses the declarations which begin with a keyword or attribute, returning 0 without consuming anything if the current token does not start one.
+static ly_syntax_id parse_keyword_declaration(parser* p) {
+    uint32 offset = parser_offset(p);
+
+    switch (parser_kind(p)) {
+        default: break;
+
+        case LY_TK_STATIC:
+        case LY_TK_REGISTER:
+        case LY_TK_TEST:
+        case LY_TK_DELEGATE: {
+            ch_diag(p->context, CH_DIAG_ERROR, p->token->location, "'%.*s' declarations are not supported yet", p->token->lexeme_length, p->token->lexeme_begin);
+            parser_skip_construct(p);
+            return parser_node(p, LY_SN_INVALID, LY_TK_MISSING, offset, 0, 0);
+        }
+
+        case LY_TK_FOREIGN: {
+            if (parser_peek(p, 1) != LY_TK_IMPORT) break;
+            ch_diag(p->context, CH_DIAG_ERROR, p->token->location, "foreign imports are not supported yet");
+            parser_skip_construct(p);
+            return parser_node(p, LY_SN_INVALID, LY_TK_MISSING, offset, 0, 0);
+        }
+    }
+
+    if (!ly_token_kind_is_declaration_start(parser_kind(p))) {
+        return 0;
+    }
+
+    parser_attributes attributes = parse_attributes(p);
+    switch (parser_kind(p)) {
+        default: {
+            ly_syntax_id type = parse_type(p);
+            return parse_declaration_at_name(p, offset, attributes, type);
+        }
+
+        case LY_TK_IMPORT: {
+            if (p->depth > 0) {
+                ch_diag(p->context, CH_DIAG_ERROR, p->token->location, "imports must be declared at the top level of a file");
+            }
+
+            return parse_import(p, offset, attributes);
+        }
+
+        case LY_TK_TEMPLATE: {
+            if (p->depth > 0) {
+                ch_diag(p->context, CH_DIAG_ERROR, p->token->location, "templates must be declared at the top level of a file");
+            }
+
+            return parse_template(p, offset, attributes);
+        }
+
+        case LY_TK_STRUCT:
+        case LY_TK_VARIANT: return parse_struct(p, offset, attributes);
+        case LY_TK_ENUM: return parse_enum(p, offset, attributes);
+        case LY_TK_STRICT:
+        case LY_TK_ALIAS: return parse_alias(p, offset, attributes);
+    }
+}
+
+static ly_syntax_id parse_top_level(parser* p) {
+    ly_syntax_id decl = parse_keyword_declaration(p);
+    if (decl != 0) return decl;
+
+    if (!can_start_type(parser_kind(p))) {
+        parser_error(p, "expected a declaration");
+        return 0;
+    }
+
+    uint32 offset = parser_offset(p);
+    ly_syntax_id type = parse_type(p);
+    return parse_declaration_at_name(p, offset, (parser_attributes){0}, type);
+}
+
+// ======================================================================
+// Statements
+// ======================================================================
+
+static ly_syntax_id parse_compound(parser* p) {
+    uint32 offset = parser_offset(p);
+    parser_expect(p, LY_TK_OPEN_CURLY, "'{'");
+
+    int64 base = p->scratch.count;
+    if (parser_enter(p)) {
+        while (!parser_at(p, LY_TK_CLOSE_CURLY) && !parser_at(p, LY_TK_EOF)) {
+            int64 start = p->consumed;
+            ly_syntax_id statement = parse_statement(p);
+            if (statement != 0) {
+                da_push(&p->scratch, statement);
+            }
+
+            parser_recover(p, start);
+        }
+
+        parser_leave(p);
+    }
+
+    parser_expect(p, LY_TK_CLOSE_CURLY, "'}'");
+
+    uint32 statements = parser_finish_list(p, base);
+    return parser_node(p, LY_SN_STMT_COMPOUND, LY_TK_OPEN_CURLY, offset, statements, 0);
+}
+
+// Statements nested directly in other statements, like the body of an `if`, are bracketed nesting too.
+static ly_syntax_id parse_nested_statement(parser* p) {
+    if (!parser_enter(p)) {
+        return parser_node(p, LY_SN_INVALID, LY_TK_MISSING, parser_offset(p), 0, 0);
+    }
+
+    ly_syntax_id statement = parse_statement(p);
+    parser_leave(p);
+    return statement;
+}
+
+static ly_syntax_id parse_condition(parser* p) {
+    parser_expect(p, LY_TK_OPEN_PAREN, "'('");
+    ly_syntax_id condition = parse_expression(p);
+    parser_expect(p, LY_TK_CLOSE_PAREN, "')'");
+    return condition;
+}
+
+// `else if` chains are parsed in a loop, linking each `if` into the else slot of the one before it, so long chains do not recurse.
+static ly_syntax_id parse_if(parser* p) {
+    ly_syntax_id first = 0;
+    uint32 previous_extra = 0;
+
+    while (true) {
+        uint32 offset = parser_offset(p);
+        parser_expect(p, LY_TK_IF, "'if'");
+
+        ly_syntax_id condition = parse_condition(p);
+        ly_syntax_id then = parse_nested_statement(p);
+
+        uint32 words[2] = {then, 0};
+        uint32 extra = ly_syntax_add_extra(p->tree, words, 2);
+        ly_syntax_id statement = parser_node(p, LY_SN_STMT_IF, LY_TK_IF, offset, condition, extra);
+
+        if (first == 0) {
+            first = statement;
+        } else {
+            p->tree->extra.items[previous_extra + 1] = statement;
+        }
+
+        previous_extra = extra;
+        if (!parser_consume(p, LY_TK_ELSE)) break;
+
+        if (!parser_at(p, LY_TK_IF)) {
+            // parsing may grow the extra data, so the slot is only looked up afterwards.
+            ly_syntax_id otherwise = parse_nested_statement(p);
+            p->tree->extra.items[extra + 1] = otherwise;
+            break;
+        }
+    }
+
+    // every `if` in the chain ends where the last one does.
+    uint32 end = p->previous_end;
+    for (ly_syntax_id id = first; id != 0;) {
+        ly_syntax_node* node = ly_syntax_get(p->tree, id);
+        node->length = end - node->offset;
+
+        ly_syntax_id next = p->tree->extra.items[node->rhs + 1];
+        id = (next != 0 && parser_node_kind(p, next) == LY_SN_STMT_IF && next > id) ? next : 0;
+    }
+
+    return first;
+}
+
+// Whether the `(` `ahead` tokens from here opens a function's parameters rather than a call's arguments, going by what is just inside it.
+static bool parser_at_parameter_list(parser* p, int64 ahead) {
+    ly_token_kind first = parser_peek(p, ahead + 1);
+    if (first == LY_TK_CLOSE_PAREN) {
+        ly_token_kind after = parser_peek(p, ahead + 2);
+        return after == LY_TK_OPEN_CURLY || after == LY_TK_SEMI_COLON;
+    }
+
+    if (first == LY_TK_REF || first == LY_TK_MUT || ly_token_kind_is_type_keyword(first)) {
+        return true;
+    }
+
+    // `(T name` or `(T* name`, since an argument could not be followed by a name.
+    ly_token_kind second = parser_peek(p, ahead + 2);
+    return first == LY_TK_IDENTIFIER && (second == LY_TK_IDENTIFIER || (second == LY_TK_STAR && parser_peek(p, ahead + 3) == LY_TK_IDENTIFIER));
+}
+
+// Parses the rest of an expression or assignment statement whose leading operand has already been parsed.
+static ly_syntax_id parse_expression_statement_at_operand(parser* p, uint32 offset, ly_syntax_id operand) {
+    ly_syntax_id expression = parse_binary(p, operand);
+
+    if (ly_token_kind_is_assignment(parser_kind(p))) {
+        ly_token_kind assignment = parser_kind(p);
+        parser_advance(p);
+
+        ly_syntax_id value = parse_expression(p);
+        parser_expect(p, LY_TK_SEMI_COLON, "';'");
+        return parser_node(p, LY_SN_STMT_ASSIGN, assignment, offset, expression, value);
+    }
+
+    parser_expect(p, LY_TK_SEMI_COLON, "';'");
+    return parser_node(p, LY_SN_STMT_EXPR, LY_TK_MISSING, offset, expression, 0);
+}
+
+// Parses a statement which begins with a type or an expression, deciding which it is once the leading operand has been parsed.
+static ly_syntax_id parse_declaration_or_expression_statement(parser* p) {
+    uint32 offset = parser_offset(p);
+    ly_syntax_id operand = parse_unary(p);
+
+    // only operands which can name a type are considered for declarations.
+    ly_syntax_kind kind = parser_node_kind(p, operand);
+    if (kind != LY_SN_EXPR_NAMEREF && kind != LY_SN_EXPR_INDEX && kind != LY_SN_EXPR_TEMPLATE && (kind < LY_SN_TYPE_BUILTIN || kind > LY_SN_TYPE_MUT)) {
+        return parse_expression_statement_at_operand(p, offset, operand);
+    }
+
+    // `T* name` and `T.. name` would otherwise be a multiplication and a range, so they are declarations only when the name is
+    // followed by something which could not continue an expression. `T** name` takes one more token of lookahead per `*`.
+    int64 suffix_count = 0;
+    if (parser_at(p, LY_TK_DOT_DOT)) {
+        suffix_count = 1;
+    } else {
+        while (suffix_count < LY_LEXER_LOOKAHEAD - 5 && parser_peek(p, suffix_count) == LY_TK_STAR) {
+            suffix_count++;
+        }
+    }
+
+    bool is_suffixed_declaration = false;
+    if (suffix_count > 0 && parser_peek(p, suffix_count) == LY_TK_IDENTIFIER) {
+        ly_token_kind after_name = parser_peek(p, suffix_count + 1);
+        is_suffixed_declaration = after_name == LY_TK_EQUAL || after_name == LY_TK_SEMI_COLON ||
+                                  (after_name == LY_TK_OPEN_PAREN && parser_at_parameter_list(p, suffix_count + 1));
+    }
+
+    if (!is_suffixed_declaration && !parser_at(p, LY_TK_IDENTIFIER)) {
+        return parse_expression_statement_at_operand(p, offset, operand);
+    }
+
+    if (kind == LY_SN_EXPR_INDEX) {
+        // `T[N] name`, which was parsed as an index until the name showed up.
+        ly_syntax_get(p->tree, operand)->kind = LY_SN_TYPE_ARRAY;
+    }
+
+    for (int64 i = 0; i < suffix_count && is_suffixed_declaration; i++) {
+        ly_token_kind suffix = parser_kind(p);
+        parser_advance(p);
+        operand = parser_node(p, suffix == LY_TK_STAR ? LY_SN_TYPE_POINTER : LY_SN_TYPE_RANGE, suffix, offset, operand, 0);
+    }
+
+    return parse_declaration_at_name(p, offset, (parser_attributes){0}, operand);
+}
+
+static ly_syntax_id parse_statement(parser* p) {
+    uint32 offset = parser_offset(p);
+    ly_token_kind kind = parser_kind(p);
+
+    switch (kind) {
+        default: break;
+
+        case LY_TK_SEMI_COLON: {
+            parser_advance(p);
+            return 0;
+        }
+
+        case LY_TK_OPEN_CURLY: return parse_compound(p);
+        case LY_TK_IF: return parse_if(p);
+
+        case LY_TK_WHILE: {
+            parser_advance(p);
+            ly_syntax_id condition = parse_condition(p);
+            ly_syntax_id body = parse_nested_statement(p);
+
+            ly_syntax_id otherwise = 0;
+            if (parser_consume(p, LY_TK_ELSE)) {
+                otherwise = parse_nested_statement(p);
+            }
+
+            uint32 words[2] = {body, otherwise};
+            uint32 extra = ly_syntax_add_extra(p->tree, words, 2);
+            return parser_node(p, LY_SN_STMT_WHILE, kind, offset, condition, extra);
+        }
+
+        case LY_TK_DO: {
+            parser_advance(p);
+            ly_syntax_id body = parse_nested_statement(p);
+            parser_expect(p, LY_TK_WHILE, "'while'");
+            ly_syntax_id condition = parse_condition(p);
+            parser_expect(p, LY_TK_SEMI_COLON, "';'");
+            return parser_node(p, LY_SN_STMT_DO, kind, offset, body, condition);
+        }
+
+        case LY_TK_FOR: {
+            parser_advance(p);
+            parser_expect(p, LY_TK_OPEN_PAREN, "'('");
+
+            // the initializer is a full statement, so it consumes its own `;`.
+            ly_syntax_id initializer = 0;
+            if (!parser_consume(p, LY_TK_SEMI_COLON)) {
+                initializer = parse_nested_statement(p);
+            }
+
+            ly_syntax_id condition = 0;
+            if (!parser_at(p, LY_TK_SEMI_COLON)) {
+                condition = parse_expression(p);
+            }
+
+            parser_expect(p, LY_TK_SEMI_COLON, "';'");
+
+            // the increment is a statement without its `;`, since the `)` ends it.
+            ly_syntax_id increment = 0;
+            if (!parser_at(p, LY_TK_CLOSE_PAREN)) {
+                uint32 increment_offset = parser_offset(p);
+                ly_syntax_id target = parse_expression(p);
+                if (ly_token_kind_is_assignment(parser_kind(p))) {
+                    ly_token_kind assignment = parser_kind(p);
+                    parser_advance(p);
+                    ly_syntax_id value = parse_expression(p);
+                    increment = parser_node(p, LY_SN_STMT_ASSIGN, assignment, increment_offset, target, value);
+                } else {
+                    increment = parser_node(p, LY_SN_STMT_EXPR, LY_TK_MISSING, increment_offset, target, 0);
+                }
+            }
+
+            parser_expect(p, LY_TK_CLOSE_PAREN, "')'");
+            ly_syntax_id body = parse_nested_statement(p);
+
+            uint32 words[3] = {initializer, condition, increment};
+            uint32 extra = ly_syntax_add_extra(p->tree, words, 3);
+            return parser_node(p, LY_SN_STMT_FOR, kind, offset, extra, body);
+        }
+
+        case LY_TK_RETURN:
+        case LY_TK_YIELD: {
+            parser_advance(p);
+
+            ly_syntax_id value = 0;
+            if (!parser_at(p, LY_TK_SEMI_COLON) || kind == LY_TK_YIELD) {
+                value = parse_expression(p);
+            }
+
+            parser_expect(p, LY_TK_SEMI_COLON, "';'");
+            return parser_node(p, kind == LY_TK_RETURN ? LY_SN_STMT_RETURN : LY_SN_STMT_YIELD, kind, offset, value, 0);
+        }
+
+        case LY_TK_BREAK:
+        case LY_TK_CONTINUE:
+        case LY_TK_GOTO: {
+            parser_advance(p);
+
+            uint32 label = 0;
+            if (kind == LY_TK_GOTO || parser_at(p, LY_TK_IDENTIFIER)) {
+                label = parser_expect_identifier(p);
+            }
+
+            parser_expect(p, LY_TK_SEMI_COLON, "';'");
+
+            ly_syntax_kind syntax_kind = kind == LY_TK_BREAK ? LY_SN_STMT_BREAK : kind == LY_TK_CONTINUE ? LY_SN_STMT_CONTINUE : LY_SN_STMT_GOTO;
+            return parser_node(p, syntax_kind, kind, offset, label, 0);
+        }
+
+        case LY_TK_DEFER: {
+            parser_advance(p);
+            ly_syntax_id statement = parse_nested_statement(p);
+            return parser_node(p, LY_SN_STMT_DEFER, kind, offset, statement, 0);
+        }
+
+        case LY_TK_DISCARD:
+        case LY_TK_DELETE: {
+            parser_advance(p);
+            ly_syntax_id value = parse_expression(p);
+            parser_expect(p, LY_TK_SEMI_COLON, "';'");
+            return parser_node(p, kind == LY_TK_DISCARD ? LY_SN_STMT_DISCARD : LY_SN_STMT_DELETE, kind, offset, value, 0);
+        }
+
+        case LY_TK_ASSERT: {
+            parser_advance(p);
+            ly_syntax_id condition = parse_expression(p);
+
+            uint32 message = 0;
+            if (parser_consume(p, LY_TK_COMMA)) {
+                message = parser_expect_string(p);
+            }
+
+            parser_expect(p, LY_TK_SEMI_COLON, "';'");
+            return parser_node(p, LY_SN_STMT_ASSERT, kind, offset, condition, message);
+        }
+
+        case LY_TK_UNREACHABLE:
+        case LY_TK_XYZZY: {
+            parser_advance(p);
+            parser_expect(p, LY_TK_SEMI_COLON, "';'");
+            return parser_node(p, kind == LY_TK_UNREACHABLE ? LY_SN_STMT_UNREACHABLE : LY_SN_STMT_XYZZY, kind, offset, 0, 0);
+        }
+
+        case LY_TK_IDENTIFIER: {
+            if (parser_peek(p, 1) != LY_TK_COLON) break;
+
+            uint32 label = parser_expect_identifier(p);
+            parser_advance(p);
+            return parser_node(p, LY_SN_STMT_LABEL, kind, offset, label, 0);
+        }
+    }
+
+    ly_syntax_id decl = parse_keyword_declaration(p);
+    if (decl != 0) return decl;
+
+    return parse_declaration_or_expression_statement(p);
+}
+
+// ======================================================================
+// Types
+// ======================================================================
+
+// Parses `[]`, `[*]` or `[dims]` following an element type.
+static ly_syntax_id parse_type_brackets(parser* p, uint32 offset, ly_syntax_id element) {
+    assert(parser_at(p, LY_TK_OPEN_SQUARE));
+    parser_advance(p);
+
+    if (parser_consume(p, LY_TK_CLOSE_SQUARE)) {
+        return parser_node(p, LY_SN_TYPE_SLICE, LY_TK_OPEN_SQUARE, offset, element, 0);
+    }
+
+    if (parser_at(p, LY_TK_STAR) && parser_peek(p, 1) == LY_TK_CLOSE_SQUARE) {
+        parser_advance(p);
+        parser_advance(p);
+        return parser_node(p, LY_SN_TYPE_BUFFER, LY_TK_OPEN_SQUARE, offset, element, 0);
+    }
+
+    int64 base = p->scratch.count;
+    if (parser_enter(p)) {
+        do {
+            da_push(&p->scratch, parse_expression(p));
+        } while (parser_consume(p, LY_TK_COMMA));
+
+        parser_leave(p);
+    }
+
+    parser_expect(p, LY_TK_CLOSE_SQUARE, "']'");
+
+    uint32 dimensions = parser_finish_list(p, base);
+    return parser_node(p, LY_SN_TYPE_ARRAY, LY_TK_OPEN_SQUARE, offset, element, dimensions);
+}
+
+// Type continuations are iterative, so `int********` costs one node per `*` and no stack.
+static ly_syntax_id parse_type(parser* p) {
+    uint32 offset = parser_offset(p);
+
+    int64 leading_mut_count = 0;
+    while (parser_consume(p, LY_TK_MUT)) {
+        leading_mut_count++;
+    }
+
+    ly_syntax_id type = 0;
+    ly_token token = *p->token;
+    if (ly_token_kind_is_type_keyword(token.kind)) {
+        uint32 bit_width = ly_token_kind_is_sized_keyword(token.kind) ? cast(uint32) token.integer_value : 0;
+        parser_advance(p);
+        type = parser_node(p, LY_SN_TYPE_BUILTIN, token.kind, cast(uint32) token.location.offset, bit_width, 0);
+    } else if (token.kind == LY_TK_IDENTIFIER) {
+        uint32 name = parser_token_string(p, &token);
+        parser_advance(p);
+        type = parser_node(p, LY_SN_EXPR_NAMEREF, token.kind, cast(uint32) token.location.offset, name, 0);
+        if (parser_at(p, LY_TK_LESS)) {
+            type = parse_template_arguments(p, cast(uint32) token.location.offset, type);
+        }
+    } else {
+        parser_error(p, "expected a type");
+        return parser_node(p, LY_SN_INVALID, LY_TK_MISSING, offset, 0, 0);
+    }
+
+    for (int64 i = 0; i < leading_mut_count; i++) {
+        type = parser_node(p, LY_SN_TYPE_MUT, LY_TK_MUT, offset, type, 0);
+    }
+
+    while (true) {
+        // the `>` this type is followed by was consumed as part of a `>>`, so nothing can continue it.
+        if (p->pending_greater) return type;
+
+        switch (parser_kind(p)) {
+            default: return type;
+
+            case LY_TK_STAR: {
+                parser_advance(p);
+                type = parser_node(p, LY_SN_TYPE_POINTER, LY_TK_STAR, offset, type, 0);
+            } break;
+
+            case LY_TK_QUESTION: {
+                parser_advance(p);
+                type = parser_node(p, LY_SN_TYPE_NILABLE, LY_TK_QUESTION, offset, type, 0);
+            } break;
+
+            case LY_TK_DOT_DOT: {
+                parser_advance(p);
+                type = parser_node(p, LY_SN_TYPE_RANGE, LY_TK_DOT_DOT, offset, type, 0);
+            } break;
+
+            case LY_TK_MUT: {
+                parser_advance(p);
+                type = parser_node(p, LY_SN_TYPE_MUT, LY_TK_MUT, offset, type, 0);
+            } break;
+
+            case LY_TK_OPEN_SQUARE: {
+                type = parse_type_brackets(p, offset, type);
+            } break;
+        }
+    }
+}
+
+// Consumes the `>` closing a template argument list, which may be the second half of a `>>` closing two of them.
+static void parser_expect_template_close(parser* p) {
+    if (p->pending_greater) {
+        p->pending_greater = false;
+        return;
+    }
+
+    if (p->template_depth > 1 && parser_at(p, LY_TK_GREATER_GREATER)) {
+        parser_advance(p);
+        p->pending_greater = true;
+        return;
+    }
+
+    parser_expect(p, LY_TK_GREATER, "'>'");
+}
+
+// Parses `<T, ...>` following the name of a template.
+static ly_syntax_id parse_template_arguments(parser* p, uint32 offset, ly_syntax_id nameref) {
+    assert(parser_at(p, LY_TK_LESS));
+    parser_advance(p);
+
+    int64 base = p->scratch.count;
+    if (parser_enter(p)) {
+        p->template_depth++;
+        do {
+            da_push(&p->scratch, parse_type(p));
+        } while (!p->pending_greater && parser_consume(p, LY_TK_COMMA));
+
+        parser_expect_template_close(p);
+        p->template_depth--;
+        parser_leave(p);
+    }
+
+    uint32 arguments = parser_finish_list(p, base);
+    return parser_node(p, LY_SN_EXPR_TEMPLATE, LY_TK_LESS, offset, nameref, arguments);
+}
+
+// ======================================================================
+// Expressions
+// ======================================================================
+
+static ly_syntax_id parse_expression(parser* p) {
+    return parse_binary(p, 0);
+}
+
+// Parses a comma separated list of expressions up to `close`, which is consumed.
+static uint32 parse_expression_list(parser* p, ly_token_kind close, const char* what) {
+    int64 base = p->scratch.count;
+    while (!parser_at(p, close) && !parser_at(p, LY_TK_EOF)) {
+        da_push(&p->scratch, parse_expression(p));
+        if (!parser_consume(p, LY_TK_COMMA)) break;
+    }
+
+    parser_expect(p, close, what);
+    return parser_finish_list(p, base);
+}
+
+static ly_syntax_id parse_constructor(parser* p, uint32 offset, ly_syntax_id type) {
+    assert(parser_at(p, LY_TK_OPEN_CURLY));
+    parser_advance(p);
+
+    uint32 initializers = 0;
+    if (parser_enter(p)) {
+        initializers = parse_expression_list(p, LY_TK_CLOSE_CURLY, "'}'");
+        parser_leave(p);
+    } else {
+        parser_expect(p, LY_TK_CLOSE_CURLY, "'}'");
+        initializers = parser_finish_list(p, p->scratch.count);
+    }
+
+    return parser_node(p, LY_SN_EXPR_CONSTRUCTOR, LY_TK_OPEN_CURLY, offset, type, initializers);
+}
+
+static ly_syntax_id parse_integer_literal(parser* p, ly_token* token) {
+    uint32 offset = cast(uint32) token->location.offset;
+    if (!token->is_wide_integer) {
+        uint64 value = cast(uint64) token->integer_value;
+        return parser_node(p, LY_SN_EXPR_LITERAL_INTEGER, token->kind, offset, cast(uint32) value, cast(uint32)(value >> 32));
+    }
+
+    uint32 words[2 * CH_WIDE_INT_WORDS];
+    for (int64 i = 0; i < CH_WIDE_INT_WORDS; i++) {
+        words[2 * i + 0] = cast(uint32) token->wide_integer_value->words[i];
+        words[2 * i + 1] = cast(uint32)(token->wide_integer_value->words[i] >> 32);
+    }
+
+    uint32 extra = ly_syntax_add_extra(p->tree, words, 2 * CH_WIDE_INT_WORDS);
+    return parser_node(p, LY_SN_EXPR_LITERAL_WIDE_INTEGER, token->kind, offset, extra, 0);
+}
+
+// Whether the `<` at the current token opens template arguments rather than being a comparison.
+// It does when what follows could only be a list of types, closed by a `>` which is followed by something that ends or continues a type rather than an operand.
+// Only as much as the lexer can look ahead is considered, and the scan never passes a `;` or a brace.
+static bool parser_at_template_arguments(parser* p) {
+    assert(parser_at(p, LY_TK_LESS));
+
+    int64 nesting = 1;
+    for (int64 ahead = 1; ahead + 1 < LY_LEXER_LOOKAHEAD; ahead++) {
+        ly_token_kind kind = parser_peek(p, ahead);
+        switch (kind) {
+            default: {
+                if (!ly_token_kind_is_type_keyword(kind)) return false;
+            } break;
+
+            case LY_TK_IDENTIFIER:
+            case LY_TK_LITERAL_INTEGER:
+            case LY_TK_MUT:
+            case LY_TK_COMMA:
+            case LY_TK_STAR:
+            case LY_TK_QUESTION:
+            case LY_TK_DOT_DOT:
+            case LY_TK_OPEN_SQUARE:
+            case LY_TK_CLOSE_SQUARE: break;
+
+            case LY_TK_LESS: nesting++; break;
+            case LY_TK_GREATER: nesting--; break;
+            case LY_TK_GREATER_GREATER: nesting -= 2; break;
+        }
+
+        if (nesting < 0) return false;
+        if (nesting > 0) continue;
+
+        switch (parser_peek(p, ahead + 1)) {
+            default: return false;
+
+            case LY_TK_OPEN_PAREN:
+            case LY_TK_CLOSE_PAREN:
+            case LY_TK_OPEN_CURLY:
+            case LY_TK_CLOSE_SQUARE:
+            case LY_TK_SEMI_COLON:
+            case LY_TK_COMMA:
+            case LY_TK_DOT:
+            case LY_TK_IDENTIFIER: return true;
+
+            // type suffixes, as in `list<int>* next;`. `a < b > *c` compares a bool with a dereference, which is rare enough to give up.
+            case LY_TK_STAR:
+            case LY_TK_QUESTION:
+            case LY_TK_DOT_DOT:
+            case LY_TK_OPEN_SQUARE: return true;
+        }
+    }
+
+    return false;
+}
+
+static ly_syntax_id parse_primary(parser* p) {
+    uint32 offset = parser_offset(p);
+    ly_token token = *p->token;
+
+    switch (token.kind) {
+        default: {
+            if (can_start_type(token.kind)) {
+                ly_syntax_id type = parse_type(p);
+                if (parser_at(p, LY_TK_OPEN_CURLY)) {
+                    return parse_constructor(p, offset, type);
+                }
+
+                return type;
+            }
+
+            parser_error(p, "expected an expression");
+            return parser_node(p, LY_SN_INVALID, LY_TK_MISSING, offset, 0, 0);
+        }
+
+        case LY_TK_IDENTIFIER: {
+            uint32 name = parser_token_string(p, &token);
+            parser_advance(p);
+
+            ly_syntax_id nameref = parser_node(p, LY_SN_EXPR_NAMEREF, token.kind, offset, name, 0);
+            if (parser_at(p, LY_TK_LESS) && parser_at_template_arguments(p)) {
+                nameref = parse_template_arguments(p, offset, nameref);
+            }
+
+            if (parser_at(p, LY_TK_OPEN_CURLY)) {
+                return parse_constructor(p, offset, nameref);
+            }
+
+            return nameref;
+        }
+
+        case LY_TK_LITERAL_INTEGER: {
+            parser_advance(p);
+            return parse_integer_literal(p, &token);
+        }
+
+        case LY_TK_LITERAL_FLOAT: {
+            // the lexer has already reported these as unsupported.
+            parser_advance(p);
+            return parser_node(p, LY_SN_INVALID, token.kind, offset, 0, 0);
+        }
+
+        case LY_TK_LITERAL_STRING: {
+            uint32 string = parser_token_string(p, &token);
+            parser_advance(p);
+            return parser_node(p, LY_SN_EXPR_LITERAL_STRING, token.kind, offset, string, 0);
+        }
+
+        case LY_TK_LITERAL_RUNE: {
+            parser_advance(p);
+            return parser_node(p, LY_SN_EXPR_LITERAL_RUNE, token.kind, offset, cast(uint32) token.integer_value, 0);
+        }
+
+        case LY_TK_TRUE:
+        case LY_TK_FALSE: {
+            parser_advance(p);
+            return parser_node(p, LY_SN_EXPR_LITERAL_BOOL, token.kind, offset, token.kind == LY_TK_TRUE, 0);
+        }
+
+        case LY_TK_NIL: {
+            parser_advance(p);
+            return parser_node(p, LY_SN_EXPR_LITERAL_NIL, token.kind, offset, 0, 0);
+        }
+
+        case LY_TK_OPEN_PAREN: {
+            parser_advance(p);
+
+            ly_syntax_id inner = 0;
+            if (parser_enter(p)) {
+                inner = parse_expression(p);
+                parser_leave(p);
+            }
+
+            parser_expect(p, LY_TK_CLOSE_PAREN, "')'");
+            return parser_node(p, LY_SN_EXPR_GROUPED, token.kind, offset, inner, 0);
+        }
+
+        case LY_TK_SIZEOF:
+        case LY_TK_ALIGNOF:
+        case LY_TK_OFFSETOF:
+        case LY_TK_COUNTOF:
+        case LY_TK_RANKOF:
+        case LY_TK_TYPEOF: {
+            parser_advance(p);
+            parser_expect(p, LY_TK_OPEN_PAREN, "'('");
+
+            ly_syntax_id operand = 0;
+            if (parser_enter(p)) {
+                operand = parse_expression(p);
+                parser_leave(p);
+            }
+
+            parser_expect(p, LY_TK_CLOSE_PAREN, "')'");
+            return parser_node(p, LY_SN_EXPR_QUERY, token.kind, offset, operand, 0);
+        }
+    }
+}
+
+// Applies calls, indexing, field access and postfix operators to an operand, iteratively.
+static ly_syntax_id parse_postfix(parser* p, ly_syntax_id operand) {
+    uint32 offset = ly_syntax_get(p->tree, operand)->offset;
+
+    while (true) {
+        ly_token_kind kind = parser_kind(p);
+        switch (kind) {
+            default: return operand;
+
+            case LY_TK_OPEN_PAREN:
+            case LY_TK_OPEN_SQUARE: {
+                // `name[]` and `name[*]` can only be types.
+                if (kind == LY_TK_OPEN_SQUARE && (parser_peek(p, 1) == LY_TK_CLOSE_SQUARE || (parser_peek(p, 1) == LY_TK_STAR && parser_peek(p, 2) == LY_TK_CLOSE_SQUARE))) {
+                    operand = parse_type_brackets(p, offset, operand);
+                    break;
+                }
+
+                parser_advance(p);
+
+                ly_token_kind close = kind == LY_TK_OPEN_PAREN ? LY_TK_CLOSE_PAREN : LY_TK_CLOSE_SQUARE;
+                uint32 arguments = 0;
+                if (parser_enter(p)) {
+                    arguments = parse_expression_list(p, close, close == LY_TK_CLOSE_PAREN ? "')'" : "']'");
+                    parser_leave(p);
+                } else {
+                    parser_expect(p, close, close == LY_TK_CLOSE_PAREN ? "')'" : "']'");
+                    arguments = parser_finish_list(p, p->scratch.count);
+                }
+
+                operand = parser_node(p, kind == LY_TK_OPEN_PAREN ? LY_SN_EXPR_CALL : LY_SN_EXPR_INDEX, kind, offset, operand, arguments);
+            } break;
+
+            case LY_TK_DOT: {
+                parser_advance(p);
+                uint32 name = parser_expect_identifier(p);
+                operand = parser_node(p, LY_SN_EXPR_FIELD, kind, offset, operand, name);
+            } break;
+
+            case LY_TK_PLUS_PLUS:
+            case LY_TK_MINUS_MINUS: {
+                parser_advance(p);
+                operand = parser_node(p, LY_SN_EXPR_UNARY_POSTFIX, kind, offset, operand, 0);
+            } break;
+
+            case LY_TK_QUESTION: {
+                parser_advance(p);
+                operand = parser_node(p, LY_SN_TYPE_NILABLE, kind, offset, operand, 0);
+            } break;
+
+            case LY_TK_MUT: {
+                parser_advance(p);
+                operand = parser_node(p, LY_SN_TYPE_MUT, kind, offset, operand, 0);
+            } break;
+
+            case LY_TK_STAR: {
+                // `name*` is a pointer type only when what follows could not be the right operand of a multiplication.
+                ly_token_kind next = parser_peek(p, 1);
+                if (next != LY_TK_MUT && can_start_expression(next)) {
+                    return operand;
+                }
+
+                parser_advance(p);
+                operand = parser_node(p, LY_SN_TYPE_POINTER, kind, offset, operand, 0);
+            } break;
+        }
+    }
+}
+
+// Parses prefix operators and the operand they apply to.
+// Prefix operators bind tighter than any binary operator, so they are collected on the operator stack and applied innermost first once the operand is known.
+static ly_syntax_id parse_unary(parser* p) {
+    int64 base = p->operators.count;
+
+    while (ly_token_kind_is_prefix_operator(parser_kind(p))) {
+        parser_operator prefix = {
+            .kind = parser_kind(p),
+            .offset = parser_offset(p),
+        };
+
+        parser_advance(p);
+        if (prefix.kind == LY_TK_CAST && parser_consume(p, LY_TK_OPEN_PAREN)) {
+            prefix.type = parse_type(p);
+            parser_expect(p, LY_TK_CLOSE_PAREN, "')'");
+        }
+
+        da_push(&p->operators, prefix);
+    }
+
+    ly_syntax_id operand = parse_postfix(p, parse_primary(p));
+
+    while (p->operators.count > base) {
+        parser_operator prefix = p->operators.items[--p->operators.count];
+        if (prefix.kind == LY_TK_CAST) {
+            operand = parser_node(p, LY_SN_EXPR_CAST, prefix.kind, prefix.offset, prefix.type, operand);
+        } else {
+            operand = parser_node(p, LY_SN_EXPR_UNARY_PREFIX, prefix.kind, prefix.offset, operand, 0);
+        }
+    }
+
+    return operand;
+}
+
+// Combines the two topmost operands with the topmost operator.
+static void parser_reduce_binary(parser* p) {
+    assert(p->operators.count > 0 && p->operands.count >= 2);
+
+    parser_operator operator = p->operators.items[--p->operators.count];
+    ly_syntax_id rhs = p->operands.items[--p->operands.count];
+    ly_syntax_id lhs = p->operands.items[p->operands.count - 1];
+
+    // only ranges may be missing their left operand, as in `arr[..4]`.
+    uint32 offset = lhs != 0 ? ly_syntax_get(p->tree, lhs)->offset : operator.offset;
+    uint32 end = rhs != 0 ? parser_node_end(p, rhs) : operator.end;
+
+    p->operands.items[p->operands.count - 1] = ly_syntax_add(p->tree, (ly_syntax_node){
+        .kind = LY_SN_EXPR_BINARY,
+        .token_kind = cast(uint16) operator.kind,
+        .offset = offset,
+        .length = end - offset,
+        .lhs = lhs,
+        .rhs = rhs,
+    });
+}
+
+// The binary operator loop. Pending operators wait on the operator stack until one which binds less tightly shows up, at which point they are combined with their operands.
+// `lhs`, when not 0, is a leading operand which the caller has already parsed.
+static ly_syntax_id parse_binary(parser* p, ly_syntax_id lhs) {
+    int64 operand_base = p->operands.count;
+    int64 operator_base = p->operators.count;
+
+    if (lhs == 0 && !parser_at(p, LY_TK_DOT_DOT) && !parser_at(p, LY_TK_DOT_DOT_EQUAL)) {
+        lhs = parse_unary(p);
+    }
+
+    da_push(&p->operands, lhs);
+
+    while (true) {
+        ly_token_kind kind = parser_kind(p);
+        ly_binding_power power = ly_token_kind_binding_powers[kind];
+        if (power.left == 0) break;
+
+        while (p->operators.count > operator_base && p->operators.items[p->operators.count - 1].right_binding_power > power.left) {
+            parser_reduce_binary(p);
+        }
+
+        parser_operator operator = {
+            .kind = kind,
+            .right_binding_power = power.right,
+            .offset = parser_offset(p),
+        };
+
+        parser_advance(p);
+        operator.end = p->previous_end;
+        da_push(&p->operators, operator);
+
+        ly_syntax_id rhs = 0;
+        if ((kind != LY_TK_DOT_DOT && kind != LY_TK_DOT_DOT_EQUAL) || can_start_expression(parser_kind(p))) {
+            rhs = parse_unary(p);
+        }
+
+        da_push(&p->operands, rhs);
+    }
+
+    while (p->operators.count > operator_base) {
+        parser_reduce_binary(p);
+    }
+
+    assert(p->operands.count == operand_base + 1 && "unbalanced expression operand stack");
+    return p->operands.items[--p->operands.count];
+}
@@ -0,0 +1,177 @@
+#include <laye/laye.h>
+#include <string.h>
+
+#define LY_SCOPE_INITIAL_CAPACITY 8
+#define LY_SCOPE_INITIAL_OVERFLOW_CAPACITY 8
+// 2^64 divided by the golden ratio; multiplying by it spreads consecutive atoms across the table.
+#define LY_SCOPE_HASH_MULTIPLIER 0x9E3779B97F4A7C15ull
+
+static_assert(sizeof(ly_scope_entry) == 20, "scope entries should stay small; think twice before growing them");
+
+CHOIR_API void ly_scope_init(ly_scope* scope, ch_allocator allocator, ly_scope* parent) {
+    *scope = (ly_scope){
+        .parent = parent,
+        .allocator = allocator,
+        .overflow.allocator = allocator,
+    };
+}
+
+CHOIR_API void ly_scope_deinit(ly_scope* scope) {
+    ch_dealloc(scope->allocator, scope->entries);
+    da_free(&scope->overflow);
+    *scope = (ly_scope){0};
+}
+
+CHOIR_API void ly_scope_clear(ly_scope* scope) {
+    if (scope->capacity != 0) {
+        memset(scope->entries, 0, cast(usize) scope->capacity * sizeof *scope->entries);
+    }
+
+    scope->count = 0;
+    scope->overflow.count = 0;
+}
+
+static int64 ly_scope_index(ch_atom name, int64 capacity) {
+    return cast(int64)((cast(uint64) name * LY_SCOPE_HASH_MULTIPLIER) >> 32) & (capacity - 1);
+}
+
+// Returns the entry for `name`, or the empty entry it would be stored in. The table must have been allocated.
+static ly_scope_entry* ly_scope_probe(ly_scope* scope, ch_atom name) {
+    int64 mask = scope->capacity - 1;
+    for (int64 index = ly_scope_index(name, scope->capacity);; index = (index + 1) & mask) {
+        ly_scope_entry* entry = &scope->entries[index];
+        if (entry->name == name || entry->name == 0) {
+            return entry;
+        }
+    }
+}
+
+static void ly_scope_resize(ly_scope* scope, int64 capacity) {
+    ly_scope_entry* old_entries = scope->entries;
+    int64 old_capacity = scope->capacity;
+
+    scope->entries = ch_alloc(scope->allocator, capacity * cast(int64) sizeof *scope->entries);
+    memset(scope->entries, 0, cast(usize) capacity * sizeof *scope->entries);
+    scope->capacity = capacity;
+
+    for (int64 i = 0; i < old_capacity; i++) {
+        if (old_entries[i].name == 0) continue;
+        *ly_scope_probe(scope, old_entries[i].name) = old_entries[i];
+    }
+
+    ch_dealloc(scope->allocator, old_entries);
+}
+
+static ly_decl_view ly_scope_entry_decls(ly_scope* scope, ly_scope_entry* entry) {
+    if (entry->count <= LY_SCOPE_INLINE_DECLS) {
+        return (ly_decl_view){entry->decls, entry->count};
+    }
+
+    return (ly_decl_view){scope->overflow.items + entry->overflow.index, entry->count};
+}
+
+// Makes room for one more declaration in the entry, moving its declarations to the overflow storage when they no longer fit where they are.
+// Storage a set moves out of is not reused; overload sets that large are rare enough for this not to matter.
+static ly_decl_id* ly_scope_entry_reserve(ly_scope* scope, ly_scope_entry* entry) {
+    assert(entry->count < UINT16_MAX && "too many declarations of one name");
+
+    if (entry->count < LY_SCOPE_INLINE_DECLS) {
+        return &entry->decls[entry->count];
+    }
+
+    bool is_inline = entry->count == LY_SCOPE_INLINE_DECLS;
+    if (is_inline || entry->count == entry->overflow.capacity) {
+        uint32 capacity = is_inline ? LY_SCOPE_INITIAL_OVERFLOW_CAPACITY : entry->overflow.capacity * 2;
+        uint32 index = cast(uint32) scope->overflow.count;
+        assert(scope->overflow.count + capacity <= UINT32_MAX && "too many overloaded declarations in one scope");
+
+        // overflowed declarations are found again by index, since growing the storage may move them.
+        int64 old_index = is_inline ? 0 : entry->overflow.index;
+        for (uint32 i = 0; i < capacity; i++) {
+            da_push(&scope->overflow, 0);
+        }
+
+        const ly_decl_id* decls = is_inline ? entry->decls : scope->overflow.items + old_index;
+        memmove(scope->overflow.items + index, decls, cast(usize) entry->count * sizeof(ly_decl_id));
+
+        entry->overflow.index = index;
+        entry->overflow.capacity = capacity;
+    }
+
+    return &scope->overflow.items[entry->overflow.index + entry->count];
+}
+
+CHOIR_API bool ly_scope_add(ly_scope* scope, ch_atom name, ly_decl_id decl, bool is_overloadable) {
+    assert(name != 0 && "declared names are never empty");
+    assert(decl != 0 && "cannot declare the absent declaration");
+
+    if (scope->capacity == 0) {
+        ly_scope_resize(scope, LY_SCOPE_INITIAL_CAPACITY);
+    } else if ((scope->count + 1) * 2 > scope->capacity) {
+        ly_scope_resize(scope, scope->capacity * 2);
+    }
+
+    ly_scope_entry* entry = ly_scope_probe(scope, name);
+    if (entry->name == 0) {
+        *entry = (ly_scope_entry){
+            .name = name,
+            .count = 1,
+            .is_overload_set = is_overloadable,
+            .decls = {decl},
+        };
+
+        scope->count++;
+        return true;
+    }
+
+    ly_decl_view decls = ly_scope_entry_decls(scope, entry);
+    for (int64 i = 0; i < decls.count; i++) {
+        if (decls.items[i] == decl) return true;
+    }
+
+    if (!is_overloadable || !entry->is_overload_set) {
+        // any overflow storage the entry had is abandoned along with its declarations.
+        *entry = (ly_scope_entry){
+            .name = name,
+            .count = 1,
+            .is_overload_set = is_overloadable,
+            .decls = {decl},
+        };
+
+        return false;
+    }
+
+    *ly_scope_entry_reserve(scope, entry) = decl;
+    entry->count++;
+    return true;
+}
+
+CHOIR_API ly_decl_view ly_scope_lookup_local(ly_scope* scope, ch_atom name) {
+    if (scope->capacity == 0 || name == 0) {
+        return (ly_decl_view){0};
+    }
+
+    ly_scope_entry* entry = ly_scope_probe(scope, name);
+    if (entry->name == 0) {
+        return (ly_decl_view){0};
+    }
+
+    return ly_scope_entry_decls(scope, entry);
+}
+
+CHOIR_API ly_scope_lookup ly_scope_lookup_name(ly_scope* scope, ch_atom name) {
+    for (; scope != NULL; scope = scope->parent) {
+        if (scope->capacity == 0 || name == 0) continue;
+
+        ly_scope_entry* entry = ly_scope_probe(scope, name);
+        if (entry->name == 0) continue;
+
+        return (ly_scope_lookup){
+            .scope = scope,
+            .decls = ly_scope_entry_decls(scope, entry),
+            .is_overload_set = entry->is_overload_set,
+        };
+    }
+
+    return (ly_scope_lookup){0};
+}
@@ -1 +1,2106 @@
 #include <laye/laye.h>
+#include <string.h>
+
+// 4096 declarations per chunk, and up to 64M of them.
+#define LY_SEMA_DECL_CHUNK_SHIFT 12
+#define LY_SEMA_DECL_MAX_CHUNK_COUNT (1 << 14)
+
+// The most arguments a call, or a template, can have without allocating to resolve it.
+#define SEMA_INLINE_ARG_COUNT 16
+
+static_assert(sizeof(ly_decl) == 20, "declarations should stay small; think twice before growing them");
+
+CHOIR_API void ly_sema_init(ly_sema* sema, ch_context* context, ly_module* module, ch_allocator allocator) {
+    *sema = (ly_sema){
+        .context = context,
+        .module = module,
+        .allocator = allocator,
+        .module_decls.allocator = allocator,
+        .functions.allocator = allocator,
+        .imports.allocator = allocator,
+    };
+
+    ch_atom_table_init(&sema->atoms, allocator);
+    ly_type_store_init(&sema->types, allocator);
+    ly_overload_cache_init(&sema->overloads, allocator);
+    ly_layout_cache_init(&sema->layouts, allocator, context->target);
+    ly_template_cache_init(&sema->templates, allocator);
+    ch_mutex_init(&sema->instantiate_mutex, allocator);
+    ch_mutex_init(&sema->decls_mutex, allocator);
+    ly_scope_init(&sema->module_scope, allocator, NULL);
+    ch_mutex_init(&sema->imports_mutex, allocator);
+    ch_arena_init(&sema->imports_arena, allocator, 4096 * sizeof(ly_decl_id));
+    ly_scope_init(&sema->import_scope, allocator, NULL);
+
+    ch_stable_array_init(&sema->decls, allocator, sizeof(ly_decl), LY_SEMA_DECL_CHUNK_SHIFT, LY_SEMA_DECL_MAX_CHUNK_COUNT);
+    discard ch_stable_array_push(&sema->decls, NULL, 1);
+
+    int64 tree_count = module->trees.count;
+    sema->tree_atoms = ch_alloc(allocator, tree_count * cast(int64) sizeof *sema->tree_atoms);
+    memset(sema->tree_atoms, 0, cast(usize) tree_count * sizeof *sema->tree_atoms);
+}
+
+CHOIR_API void ly_sema_deinit(ly_sema* sema) {
+    for (int64 i = 0; i < sema->module->trees.count; i++) {
+        ch_dealloc(sema->allocator, sema->tree_atoms[i]);
+    }
+
+    ch_dealloc(sema->allocator, sema->tree_atoms);
+    da_free(&sema->imports);
+    ch_arena_deinit(&sema->imports_arena);
+    ly_scope_deinit(&sema->import_scope);
+    ch_mutex_deinit(&sema->imports_mutex);
+
+    // the parameter scopes of function templates are kept for their bodies.
+    for (int64 i = 0; i < sema->functions.count; i++) {
+        ly_scope* scope = sema->functions.items[i].scope;
+        if (scope == NULL) continue;
+        ly_scope_deinit(scope);
+        ch_dealloc(sema->allocator, scope);
+    }
+
+    da_free(&sema->functions);
+    da_free(&sema->module_decls);
+    ly_scope_deinit(&sema->module_scope);
+    ch_stable_array_deinit(&sema->decls);
+    ch_mutex_deinit(&sema->decls_mutex);
+    ch_mutex_deinit(&sema->instantiate_mutex);
+    ly_template_cache_deinit(&sema->templates);
+    ly_layout_cache_deinit(&sema->layouts);
+    ly_overload_cache_deinit(&sema->overloads);
+    ly_type_store_deinit(&sema->types);
+    ch_atom_table_deinit(&sema->atoms);
+    *sema = (ly_sema){0};
+}
+
+CHOIR_API ly_decl_id ly_sema_decl_add(ly_sema* sema, ly_decl decl) {
+    ch_mutex_lock(&sema->decls_mutex);
+    assert(sema->decls.count < UINT32_MAX && "too many declarations");
+    ly_decl_id id = cast(ly_decl_id) ch_stable_array_push(&sema->decls, &decl, 1);
+    ch_mutex_unlock(&sema->decls_mutex);
+    return id;
+}
+
+CHOIR_API ly_decl* ly_sema_decl_get(ly_sema* sema, ly_decl_id id) {
+    assert(id != 0 && "invalid declaration id");
+    return ch_stable_array_get(&sema->decls, id);
+}
+
+CHOIR_API void ly_sema_add_import(ly_sema* sema, ly_module_file* file) {
+    ly_sema_import import = {.file = file};
+    da_push(&sema->imports, import);
+}
+
+// ======================================================================
+// Imports
+// ======================================================================
+
+static ly_qual_type sema_poison(void) {
+    return ly_qual_type_make(ly_type_simple(LY_TY_POISON), LY_TQ_NONE);
+}
+
+static ly_decl_id sema_import_decl(ly_sema* sema, uint32 import_index, uint32 index);
+
+// Returns the atom of a name from a module file. Names are only ever found in the atom table, never added to it, since bodies may be
+// looking names up on other threads; a name the module being analysed never mentions, such as that of a field it does not use, is empty.
+static ch_atom sema_import_atom(ly_sema* sema, ly_module_file* file, uint32 name, uint32 name_length) {
+    ch_atom atom = 0;
+    discard ch_atom_find(&sema->atoms, file->strings + name, name_length, &atom);
+    return atom;
+}
+
+// Decodes a type from a module file the first time a decoded declaration uses it. A damaged record decodes to poison.
+static ly_qual_type sema_import_type(ly_sema* sema, uint32 import_index, ly_qual_type file_type) {
+    if (file_type == 0) return 0;
+
+    ly_sema_import* import = &sema->imports.items[import_index];
+    uint32 index = ly_qual_type_id(file_type);
+    ly_type_qualifier qualifiers = ly_qual_type_qualifiers(file_type);
+    if (import->types[index] != 0) {
+        return ly_qual_type_make(import->types[index], qualifiers);
+    }
+
+    ly_type_id id = LY_TY_POISON;
+    ly_type_store* types = &sema->types;
+    ly_module_file* file = import->file;
+
+    // types are written after the types they are made of, so a record referring to a later one is damaged, and decoding always ends.
+    const ly_type* type = ly_module_file_type(file, index);
+    if (type == NULL || ly_qual_type_id(type->element) >= index) {
+        return sema_poison();
+    }
+
+    ly_type record = *type;
+
+    bool has_element = record.kind >= LY_TY_POINTER && record.kind <= LY_TY_FUNCTION;
+    ly_qual_type element = sema_import_type(sema, import_index, record.element);
+    if (has_element && element == 0) {
+        return sema_poison();
+    }
+
+    // an array's lengths and a function's parameters take two extra words each.
+    bool has_extra_words = record.kind == LY_TY_ARRAY || record.kind == LY_TY_FUNCTION;
+    if (has_extra_words && record.operand > file->extra_count / 2) {
+        return sema_poison();
+    }
+
+    switch (cast(ly_type_kind) record.kind) {
+        default: {
+            if (record.kind <= LY_TY_LAST_SIMPLE) id = ly_type_simple(record.kind);
+        } break;
+
+        case LY_TY_BOOL_SIZED:
+        case LY_TY_INT_SIZED:
+        case LY_TY_UINT_SIZED:
+        case LY_TY_FLOAT_SIZED: {
+            id = ly_type_sized(types, record.kind, record.operand);
+        } break;
+
+        case LY_TY_POINTER:
+        case LY_TY_NILABLE:
+        case LY_TY_SLICE:
+        case LY_TY_RANGE: {
+            id = ly_type_container(types, record.kind, element);
+        } break;
+
+        case LY_TY_BUFFER: {
+            const uint32* words = ly_module_file_extra(file, record.extra, 2);
+            if (!(record.flags & LY_TF_TERMINATED)) {
+                id = ly_type_container(types, record.kind, element);
+            } else if (words != NULL) {
+                id = ly_type_buffer_terminated(types, element, words[0] | cast(uint64) words[1] << 32);
+            }
+        } break;
+
+        case LY_TY_ARRAY: {
+            int64 dimension_count = record.operand;
+            const uint32* words = ly_module_file_extra(file, record.extra, 2 * dimension_count);
+            if (dimension_count == 0 || words == NULL) break;
+
+            uint64* lengths = ch_arena_alloc(&sema->imports_arena, dimension_count * cast(int64) sizeof *lengths);
+            for (int64 i = 0; i < dimension_count; i++) {
+                lengths[i] = words[2 * i] | cast(uint64) words[2 * i + 1] << 32;
+            }
+
+            id = ly_type_array(types, element, lengths, dimension_count);
+        } break;
+
+        case LY_TY_ERROR_PAIR: {
+            ly_qual_type error = ly_qual_type_id(record.operand) < index ? sema_import_type(sema, import_index, record.operand) : 0;
+            if (error != 0) id = ly_type_error_pair(types, element, error);
+        } break;
+
+        case LY_TY_FUNCTION: {
+            int64 param_count = record.operand;
+            const uint32* words = ly_module_file_extra(file, record.extra, 2 * param_count);
+            if (words == NULL) break;
+
+            bool is_valid = true;
+            ly_type_param* params = param_count == 0 ? NULL : ch_arena_alloc(&sema->imports_arena, param_count * cast(int64) sizeof *params);
+            for (int64 i = 0; i < param_count; i++) {
+                params[i] = (ly_type_param){
+                    .type = ly_qual_type_id(words[2 * i]) < index ? sema_import_type(sema, import_index, words[2 * i]) : 0,
+                    .flags = cast(ly_param_flag) words[2 * i + 1],
+                };
+
+                is_valid = is_valid && params[i].type != 0;
+            }
+
+            if (is_valid) {
+                id = ly_type_function(types, element, params, param_count, cast(ly_calling_convention) record.calling_convention,
+                                      cast(ly_varargs_kind) record.varargs_kind, cast(ly_type_flag) record.flags);
+            }
+        } break;
+
+        case LY_TY_STRUCT:
+        case LY_TY_ENUM: {
+            ly_decl_id decl = sema_import_decl(sema, import_index, record.operand);
+            if (decl != 0) id = ly_qual_type_id(ly_sema_decl_get(sema, decl)->type);
+        } break;
+    }
+
+    import->types[index] = id;
+    return ly_qual_type_make(id, qualifiers);
+}
+
+// Records the layout a module file stores for an imported struct, so it is never computed again.
+static void sema_import_layout(ly_sema* sema, uint32 import_index, const ly_module_decl* record, ly_type_id struct_type) {
+    ly_module_file* file = sema->imports.items[import_index].file;
+    ly_struct_layout* layout = ly_layout_cache_add(&sema->layouts, struct_type);
+
+    if (record->field_count != 0) {
+        layout->fields = ch_alloc(sema->allocator, record->field_count * cast(int64) sizeof *layout->fields);
+    }
+
+    for (uint32 i = 0; i < record->field_count; i++) {
+        const ly_module_field* field = ly_module_file_field(file, record->fields + i);
+        if (field == NULL) {
+            layout->state = LY_LS_INVALID;
+            return;
+        }
+
+        layout->fields[layout->field_count++] = (ly_field_layout){
+            .name = sema_import_atom(sema, file, field->name, field->name_length),
+            .type = sema_import_type(sema, import_index, field->type),
+            .offset = field->offset,
+        };
+    }
+
+    layout->layout = record->layout;
+    layout->state = LY_LS_COMPUTED;
+}
+
+// Decodes a declaration from a module file, and the types it uses, the first time a lookup needs it, returning 0 if its record is damaged.
+// Called with `imports_mutex` held.
+static ly_decl_id sema_import_decl(ly_sema* sema, uint32 import_index, uint32 index) {
+    ly_sema_import* import = &sema->imports.items[import_index];
+    if (import->decls[index] != 0) {
+        return import->decls[index];
+    }
+
+    const ly_module_decl* record = ly_module_file_decl(import->file, index);
+    if (record == NULL) {
+        return 0;
+    }
+
+    ly_decl decl = {
+        .kind = record->kind,
+        .state = LY_DS_RESOLVED,
+        .name = sema_import_atom(sema, import->file, record->name, record->name_length),
+        .tree = LY_DECL_IMPORTED | import_index,
+        .syntax = index,
+    };
+
+    // recorded before its type is decoded, since a struct's fields can refer back to it.
+    ly_decl_id decl_id = ly_sema_decl_add(sema, decl);
+    import->decls[index] = decl_id;
+
+    ly_decl* imported = ly_sema_decl_get(sema, decl_id);
+    switch (cast(ly_decl_kind) record->kind) {
+        default: {
+            imported->type = sema_import_type(sema, import_index, record->type);
+        } break;
+
+        case LY_DK_STRUCT: {
+            imported->type = ly_qual_type_make(ly_type_nominal(&sema->types, LY_TY_STRUCT, decl_id), LY_TQ_NONE);
+            sema_import_layout(sema, import_index, record, ly_qual_type_id(imported->type));
+        } break;
+
+        case LY_DK_ENUM: {
+            imported->type = ly_qual_type_make(ly_type_nominal(&sema->types, LY_TY_ENUM, decl_id), LY_TQ_NONE);
+        } break;
+    }
+
+    return decl_id;
+}
+
+// Looks a name up in the modules imported so far, the first whose file exports it, decoding its declarations if this is the first lookup.
+static ly_scope_lookup sema_lookup_import(ly_sema* sema, ch_atom name) {
+    ch_atom_info info = ch_atom_get(&sema->atoms, name);
+    for (int64 i = 0; i < sema->imports.count; i++) {
+        ly_sema_import* import = &sema->imports.items[i];
+        if (!import->is_imported) continue;
+
+        uint32 first;
+        int64 count = ly_module_file_find(import->file, info.text, info.length, &first);
+        if (count == 0) continue;
+
+        bool is_decoded = true;
+        ch_mutex_lock(&sema->imports_mutex);
+
+        // a module nothing is looked up in costs no more than its mapping, so its tables are only made on the first lookup.
+        if (import->decls == NULL) {
+            ly_module_file* file = import->file;
+            import->decls = ch_arena_alloc(&sema->imports_arena, file->decl_count * cast(int64) sizeof *import->decls);
+            import->types = ch_arena_alloc(&sema->imports_arena, file->type_count * cast(int64) sizeof *import->types);
+            memset(import->decls, 0, cast(usize) file->decl_count * sizeof *import->decls);
+            memset(import->types, 0, cast(usize) file->type_count * sizeof *import->types);
+        }
+
+        for (int64 j = 0; j < count; j++) {
+            is_decoded = sema_import_decl(sema, cast(uint32) i, first + cast(uint32) j) != 0 && is_decoded;
+        }
+        ch_mutex_unlock(&sema->imports_mutex);
+
+        if (!is_decoded) continue;
+
+        return (ly_scope_lookup){
+            .scope = &sema->import_scope,
+            .decls = {import->decls + first, count},
+            .is_overload_set = ly_sema_decl_get(sema, import->decls[first])->kind == LY_DK_FUNCTION,
+        };
+    }
+
+    return (ly_scope_lookup){0};
+}
+
+// Returns the imported module file named `name`, or NULL if none was added.
+static ly_sema_import* sema_find_import(ly_sema* sema, ly_syntax_string name) {
+    for (int64 i = 0; i < sema->imports.count; i++) {
+        ly_module_file* file = sema->imports.items[i].file;
+        if (file->name_length == name.length && 0 == memcmp(file->name, name.text, cast(usize) name.length)) {
+            return &sema->imports.items[i];
+        }
+    }
+
+    return NULL;
+}
+
+// ======================================================================
+// Names and types
+// ======================================================================
+
+// Everything needed to analyse syntax from one tree, on one thread.
+typedef struct sema_view {
+    ly_sema* sema;
+    // where diagnostics go: the module's context while declarations are analysed, or a body's own context while bodies are.
+    ch_context* context;
+    uint32 tree_index;
+    ly_syntax_tree* tree;
+    ch_atom* atoms;
+    // set while templates are being instantiated, when this thread already holds `instantiate_mutex`.
+    bool is_instantiating;
+} sema_view;
+
+static sema_view sema_view_of(ly_sema* sema, ch_context* context, uint32 tree_index) {
+    return (sema_view){
+        .sema = sema,
+        .context = context,
+        .tree_index = tree_index,
+        .tree = sema->module->trees.items[tree_index],
+        .atoms = sema->tree_atoms[tree_index],
+    };
+}
+
+// A view of the tree a declaration was written in, for resolving it on behalf of `v`.
+static sema_view sema_view_owner(sema_view* v, uint32 tree_index) {
+    sema_view owner = sema_view_of(v->sema, v->context, tree_index);
+    owner.is_instantiating = v->is_instantiating;
+    return owner;
+}
+
+static ly_syntax_node* sema_node(sema_view* v, ly_syntax_id id) {
+    return ly_syntax_get(v->tree, id);
+}
+
+static uint32 sema_extra(sema_view* v, uint32 index) {
+    return v->tree->extra.items[index];
+}
+
+static ch_location sema_location(sema_view* v, ly_syntax_id id) {
+    return ly_syntax_location(v->tree, id);
+}
+
+// Strings are read back from their atoms, since the tree's own string table may be released once they are interned.
+static ly_syntax_string sema_string(sema_view* v, uint32 string_index) {
+    ch_atom_info info = ch_atom_get(&v->sema->atoms, v->atoms[string_index]);
+    return (ly_syntax_string){info.text, info.length};
+}
+
+static bool sema_is_builtin_sized(ly_token_kind kind, ly_type_kind* out_kind) {
+    switch (kind) {
+        default: return false;
+        case LY_TK_BOOL_SIZED: *out_kind = LY_TY_BOOL_SIZED; return true;
+        case LY_TK_INT_SIZED: *out_kind = LY_TY_INT_SIZED; return true;
+        case LY_TK_UINT_SIZED: *out_kind = LY_TY_UINT_SIZED; return true;
+        case LY_TK_FLOAT_SIZED: *out_kind = LY_TY_FLOAT_SIZED; return true;
+    }
+}
+
+static ly_type_kind sema_builtin_kind(ly_token_kind kind) {
+    switch (kind) {
+        default: return LY_TY_INVALID;
+        case LY_TK_VOID: return LY_TY_VOID;
+        case LY_TK_NORETURN: return LY_TY_NORETURN;
+        case LY_TK_BOOL: return LY_TY_BOOL;
+        case LY_TK_INT: return LY_TY_INT;
+        case LY_TK_UINT: return LY_TY_UINT;
+        case LY_TK_BUILTIN_FFI_BOOL: return LY_TY_FFI_BOOL;
+        case LY_TK_BUILTIN_FFI_CHAR: return LY_TY_FFI_CHAR;
+        case LY_TK_BUILTIN_FFI_SCHAR: return LY_TY_FFI_SCHAR;
+        case LY_TK_BUILTIN_FFI_UCHAR: return LY_TY_FFI_UCHAR;
+        case LY_TK_BUILTIN_FFI_SHORT: return LY_TY_FFI_SHORT;
+        case LY_TK_BUILTIN_FFI_USHORT: return LY_TY_FFI_USHORT;
+        case LY_TK_BUILTIN_FFI_INT: return LY_TY_FFI_INT;
+        case LY_TK_BUILTIN_FFI_UINT: return LY_TY_FFI_UINT;
+        case LY_TK_BUILTIN_FFI_LONG: return LY_TY_FFI_LONG;
+        case LY_TK_BUILTIN_FFI_ULONG: return LY_TY_FFI_ULONG;
+        case LY_TK_BUILTIN_FFI_LONGLONG: return LY_TY_FFI_LONGLONG;
+        case LY_TK_BUILTIN_FFI_ULONGLONG: return LY_TY_FFI_ULONGLONG;
+        case LY_TK_BUILTIN_FFI_FLOAT: return LY_TY_FFI_FLOAT;
+        case LY_TK_BUILTIN_FFI_DOUBLE: return LY_TY_FFI_DOUBLE;
+        case LY_TK_BUILTIN_FFI_LONG_DOUBLE: return LY_TY_FFI_LONGDOUBLE;
+    }
+}
+
+// Finds the nearest declarations of a name from `scope`, falling back to the imported modules when no scope declares it.
+static ly_scope_lookup sema_find(ly_sema* sema, ly_scope* scope, ch_atom name) {
+    ly_scope_lookup result = ly_scope_lookup_name(scope, name);
+    if (result.scope == NULL && sema->imports.count != 0) {
+        result = sema_lookup_import(sema, name);
+    }
+
+    return result;
+}
+
+// Finds what a name refers to from `scope`, reporting it if nothing does.
+static ly_scope_lookup sema_lookup(sema_view* v, ly_scope* scope, ly_syntax_id nameref) {
+    ly_syntax_node* node = sema_node(v, nameref);
+    ly_scope_lookup result = sema_find(v->sema, scope, v->atoms[node->lhs]);
+    if (result.scope == NULL) {
+        ly_syntax_string name = sema_string(v, node->lhs);
+        ch_diag(v->context, CH_DIAG_ERROR, sema_location(v, nameref), "undefined name '%.*s'", cast(int) name.length, name.text);
+    }
+
+    return result;
+}
+
+static ly_qual_type sema_resolve_type(sema_view* v, ly_scope* scope, ly_syntax_id id);
+static ly_qual_type sema_require(sema_view* v, ly_decl_id decl_id);
+static bool sema_query(void* userdata, ly_syntax_id id, ly_constant* out_constant);
+static const ly_struct_layout* sema_struct_layout(sema_view* v, ly_scope* scope, ly_type_id struct_type);
+static ly_decl_id sema_resolve_template(sema_view* v, ly_scope* scope, ly_syntax_id id);
+
+static ly_qual_type sema_resolve_named_type(sema_view* v, ly_scope* scope, ly_syntax_id id) {
+    ly_scope_lookup lookup = sema_lookup(v, scope, id);
+    if (lookup.scope == NULL) {
+        return sema_poison();
+    }
+
+    ly_decl* decl = lookup.decls.count == 1 ? ly_sema_decl_get(v->sema, lookup.decls.items[0]) : NULL;
+    if (decl != NULL && decl->kind == LY_DK_TEMPLATE) {
+        ly_syntax_string name = sema_string(v, sema_node(v, id)->lhs);
+        ch_diag(v->context, CH_DIAG_ERROR, sema_location(v, id), "'%.*s' needs template arguments", cast(int) name.length, name.text);
+        return sema_poison();
+    }
+
+    bool is_type = decl != NULL && (decl->kind == LY_DK_STRUCT || decl->kind == LY_DK_ENUM || decl->kind == LY_DK_ALIAS || decl->kind == LY_DK_TEMPLATE_PARAM);
+    if (!is_type) {
+        ly_syntax_string name = sema_string(v, sema_node(v, id)->lhs);
+        ch_diag(v->context, CH_DIAG_ERROR, sema_location(v, id), "'%.*s' is not a type", cast(int) name.length, name.text);
+        return sema_poison();
+    }
+
+    ly_qual_type type = sema_require(v, lookup.decls.items[0]);
+    return type == 0 ? sema_poison() : type;
+}
+
+// What a query in a constant expression needs to resolve the types it asks about.
+typedef struct sema_constant_scope {
+    sema_view* v;
+    ly_scope* scope;
+} sema_constant_scope;
+
+static bool sema_evaluate_constant(sema_view* v, ly_scope* scope, ly_syntax_id id, ly_constant* out_constant) {
+    sema_constant_scope constant_scope = {v, scope};
+    return ly_constant_evaluate(v->context, v->sema->allocator, v->tree, id, sema_query, &constant_scope, out_constant);
+}
+
+// Evaluates a constant which must be a length, such as an array dimension.
+static bool sema_evaluate_length(sema_view* v, ly_scope* scope, ly_syntax_id id, uint64* out_length) {
+    ly_constant constant;
+    if (!sema_evaluate_constant(v, scope, id, &constant)) {
+        return false;
+    }
+
+    if (constant.kind != LY_CK_INTEGER) {
+        ch_diag(v->context, CH_DIAG_ERROR, sema_location(v, id), "expected an integer");
+        return false;
+    }
+
+    if (!ly_constant_integer_to_uint64(constant.integer, out_length)) {
+        ch_diag(v->context, CH_DIAG_ERROR, sema_location(v, id), "length must not be negative or larger than 64 bits");
+        return false;
+    }
+
+    return true;
+}
+
+static ly_qual_type sema_resolve_array_type(sema_view* v, ly_scope* scope, ly_syntax_id id) {
+    ly_syntax_node node = *sema_node(v, id);
+    ly_qual_type element = sema_resolve_type(v, scope, node.lhs);
+    ly_syntax_list dimensions = ly_syntax_list_get(v->tree, node.rhs);
+
+    uint64 length_buffer[8];
+    uint64* lengths = dimensions.count <= 8 ? length_buffer : ch_alloc(v->sema->allocator, dimensions.count * cast(int64) sizeof *lengths);
+
+    bool is_valid = ly_qual_type_id(element) != LY_TY_POISON;
+    for (int64 i = 0; i < dimensions.count; i++) {
+        is_valid &= sema_evaluate_length(v, scope, dimensions.items[i], &lengths[i]);
+    }
+
+    ly_qual_type result = sema_poison();
+    if (is_valid) {
+        result = ly_qual_type_make(ly_type_array(&v->sema->types, element, lengths, dimensions.count), LY_TQ_NONE);
+    }
+
+    if (lengths != length_buffer) ch_dealloc(v->sema->allocator, lengths);
+    return result;
+}
+
+// Resolves the type written at `id`, returning 0 for `var` and poison for anything which is not a valid type.
+static ly_qual_type sema_resolve_type(sema_view* v, ly_scope* scope, ly_syntax_id id) {
+    ly_syntax_node node = *sema_node(v, id);
+    ly_type_store* types = &v->sema->types;
+
+    switch (cast(ly_syntax_kind) node.kind) {
+        default: {
+            ch_diag(v->context, CH_DIAG_ERROR, sema_location(v, id), "expected a type");
+            return sema_poison();
+        }
+
+        case LY_SN_INVALID: return sema_poison();
+
+        case LY_SN_TYPE_BUILTIN: {
+            if (node.token_kind == LY_TK_VAR) {
+                return 0;
+            }
+
+            ly_type_kind sized_kind;
+            if (sema_is_builtin_sized(node.token_kind, &sized_kind)) {
+                return ly_qual_type_make(ly_type_sized(types, sized_kind, node.lhs), LY_TQ_NONE);
+            }
+
+            ly_type_kind kind = sema_builtin_kind(node.token_kind);
+            assert(kind != LY_TY_INVALID && "unhandled builtin type keyword");
+            return ly_qual_type_make(ly_type_simple(kind), LY_TQ_NONE);
+        }
+
+        case LY_SN_EXPR_NAMEREF: return sema_resolve_named_type(v, scope, id);
+
+        case LY_SN_EXPR_TEMPLATE: {
+            ly_decl_id instance = sema_resolve_template(v, scope, id);
+            if (instance == 0) {
+                return sema_poison();
+            }
+
+            ly_decl* decl = ly_sema_decl_get(v->sema, instance);
+            if (decl->kind != LY_DK_STRUCT) {
+                ch_atom_info name = ch_atom_get(&v->sema->atoms, decl->name);
+                ch_diag(v->context, CH_DIAG_ERROR, sema_location(v, id), "'%.*s' is not a type", cast(int) name.length, name.text);
+                return sema_poison();
+            }
+
+            return decl->type;
+        }
+
+        case LY_SN_TYPE_MUT: {
+            ly_qual_type inner = sema_resolve_type(v, scope, node.lhs);
+            if (inner == 0) return 0;
+            return inner | LY_TQ_MUTABLE;
+        }
+
+        case LY_SN_TYPE_POINTER:
+        case LY_SN_TYPE_BUFFER:
+        case LY_SN_TYPE_SLICE:
+        case LY_SN_TYPE_NILABLE:
+        case LY_SN_TYPE_RANGE: {
+            ly_qual_type element = sema_resolve_type(v, scope, node.lhs);
+            if (element == 0) {
+                ch_diag(v->context, CH_DIAG_ERROR, sema_location(v, node.lhs), "'var' cannot be used as an element type");
+                return sema_poison();
+            }
+
+            if (ly_qual_type_id(element) == LY_TY_POISON) {
+                return sema_poison();
+            }
+
+            ly_type_kind kind = node.kind == LY_SN_TYPE_POINTER ? LY_TY_POINTER
+                              : node.kind == LY_SN_TYPE_BUFFER  ? LY_TY_BUFFER
+                              : node.kind == LY_SN_TYPE_SLICE   ? LY_TY_SLICE
+                              : node.kind == LY_SN_TYPE_RANGE   ? LY_TY_RANGE
+                                                                : LY_TY_NILABLE;
+            return ly_qual_type_make(ly_type_container(types, kind, element), LY_TQ_NONE);
+        }
+
+        case LY_SN_TYPE_ARRAY: return sema_resolve_array_type(v, scope, id);
+    }
+}
+
+static ly_calling_convention sema_calling_convention(sema_view* v, ly_syntax_id function, uint32 string_index) {
+    if (string_index == 0) {
+        return LY_CC_LAYE;
+    }
+
+    // the same four as the bootstrap compiler, which the standard library spells "c" for cdecl.
+    ly_syntax_string name = sema_string(v, string_index);
+    static const struct {
+        const char* name;
+        ly_calling_convention calling_convention;
+    } calling_conventions[] = {
+        {"laye", LY_CC_LAYE},
+        {"c", LY_CC_CDECL},
+        {"cdecl", LY_CC_CDECL},
+        {"stdcall", LY_CC_STDCALL},
+        {"fastcall", LY_CC_FASTCALL},
+    };
+
+    for (usize i = 0; i < sizeof calling_conventions / sizeof calling_conventions[0]; i++) {
+        if (cast(usize) name.length == strlen(calling_conventions[i].name) && 0 == memcmp(name.text, calling_conventions[i].name, cast(usize) name.length)) {
+            return calling_conventions[i].calling_convention;
+        }
+    }
+
+    ch_diag(v->context, CH_DIAG_ERROR, sema_location(v, function), "unknown calling convention '%.*s'", cast(int) name.length, name.text);
+    return LY_CC_LAYE;
+}
+
+// Resolves the type of a function from its return type and parameters.
+static ly_qual_type sema_resolve_function_type(sema_view* v, ly_scope* scope, ly_syntax_id function) {
+    ly_syntax_node node = *sema_node(v, function);
+    ly_syntax_list params = ly_syntax_list_get(v->tree, sema_extra(v, node.lhs + 2));
+
+    ly_qual_type return_type = sema_resolve_type(v, scope, sema_extra(v, node.lhs + 0));
+    if (return_type == 0) {
+        ch_diag(v->context, CH_DIAG_ERROR, sema_location(v, sema_extra(v, node.lhs + 0)), "functions cannot infer their return type");
+        return_type = sema_poison();
+    }
+
+    ly_type_param param_buffer[16];
+    ly_type_param* param_types = params.count <= 16 ? param_buffer : ch_alloc(v->sema->allocator, params.count * cast(int64) sizeof *param_types);
+
+    int64 param_count = 0;
+    ly_varargs_kind varargs_kind = LY_VARARGS_NONE;
+    bool is_valid = ly_qual_type_id(return_type) != LY_TY_POISON;
+
+    for (int64 i = 0; i < params.count; i++) {
+        ly_syntax_node* param = sema_node(v, params.items[i]);
+        if (param->token_kind == LY_TK_VARARGS) {
+            if (i != params.count - 1) {
+                ch_diag(v->context, CH_DIAG_ERROR, sema_location(v, params.items[i]), "'varargs' must be the last parameter");
+            }
+
+            varargs_kind = LY_VARARGS_C;
+            continue;
+        }
+
+        ly_qual_type param_type = sema_resolve_type(v, scope, param->lhs);
+        if (param_type == 0) {
+            ch_diag(v->context, CH_DIAG_ERROR, sema_location(v, params.items[i]), "parameters cannot infer their type");
+            param_type = sema_poison();
+        }
+
+        is_valid &= ly_qual_type_id(param_type) != LY_TY_POISON;
+        ly_param_flag param_flags = param->token_kind == LY_TK_REF ? LY_PF_REF : LY_PF_NONE;
+        param_types[param_count++] = (ly_type_param){param_type, param_flags};
+    }
+
+    ly_qual_type result = sema_poison();
+    if (is_valid) {
+        ly_calling_convention calling_convention = sema_calling_convention(v, function, sema_extra(v, node.lhs + 5));
+        ly_type_flag flags = (node.flags & LY_SF_DISCARDABLE) ? LY_TF_DISCARDABLE : LY_TF_NONE;
+        ly_type_id type = ly_type_function(&v->sema->types, return_type, param_types, param_count, calling_convention, varargs_kind, flags);
+        result = ly_qual_type_make(type, LY_TQ_NONE);
+    }
+
+    if (param_types != param_buffer) ch_dealloc(v->sema->allocator, param_types);
+    return result;
+}
+
+// ======================================================================
+// Declarations
+// ======================================================================
+
+// Returns the string index of the name a declaration node declares, or 0 if it does not declare one.
+static uint32 sema_decl_name(sema_view* v, ly_syntax_id id, ly_decl_kind* out_kind) {
+    ly_syntax_node* node = sema_node(v, id);
+    switch (cast(ly_syntax_kind) node->kind) {
+        default: *out_kind = LY_DK_INVALID; return 0;
+        case LY_SN_DECL_IMPORT: *out_kind = LY_DK_IMPORT; return node->rhs != 0 ? node->rhs : node->lhs;
+        case LY_SN_DECL_BINDING: *out_kind = LY_DK_BINDING; return sema_extra(v, node->rhs + 0);
+        case LY_SN_DECL_FUNCTION: *out_kind = LY_DK_FUNCTION; return sema_extra(v, node->lhs + 1);
+        case LY_SN_DECL_PARAM: *out_kind = LY_DK_PARAM; return node->rhs;
+        case LY_SN_DECL_STRUCT: *out_kind = LY_DK_STRUCT; return node->lhs;
+        case LY_SN_DECL_ENUM: *out_kind = LY_DK_ENUM; return node->lhs;
+        case LY_SN_DECL_ALIAS: *out_kind = LY_DK_ALIAS; return node->lhs;
+        case LY_SN_DECL_TEMPLATE_PARAM: *out_kind = LY_DK_TEMPLATE_PARAM; return node->lhs;
+
+        // a template is named after the declaration it is a pattern for.
+        case LY_SN_DECL_TEMPLATE: {
+            uint32 name = sema_decl_name(v, node->rhs, out_kind);
+            *out_kind = LY_DK_TEMPLATE;
+            return name;
+        }
+    }
+}
+
+// Creates the declaration for a declaration node and adds it to `scope`, reporting a conflict with an earlier declaration of the same name.
+static ly_decl_id sema_declare(sema_view* v, ly_scope* scope, ly_syntax_id id) {
+    ly_decl_kind kind;
+    uint32 name = sema_decl_name(v, id, &kind);
+    if (kind == LY_DK_INVALID || name == 0) {
+        return 0;
+    }
+
+    ly_decl decl = {
+        .kind = cast(uint8) kind,
+        .name = v->atoms[name],
+        .tree = v->tree_index,
+        .syntax = id,
+    };
+
+    ly_decl_id decl_id = ly_sema_decl_add(v->sema, decl);
+    if (!ly_scope_add(scope, decl.name, decl_id, kind == LY_DK_FUNCTION)) {
+        ly_syntax_string text = sema_string(v, name);
+        ch_diag(v->context, CH_DIAG_ERROR, sema_location(v, id), "redeclaration of '%.*s'", cast(int) text.length, text.text);
+    }
+
+    return decl_id;
+}
+
+static void sema_resolve_template_decl(sema_view* v, ly_scope* scope, ly_decl_id template_id);
+
+// Resolves the type of a declaration which has been declared but not yet resolved, looking up the names it uses from `scope`.
+static void sema_resolve_decl(sema_view* v, ly_scope* scope, ly_decl_id decl_id) {
+    ly_decl* decl = ly_sema_decl_get(v->sema, decl_id);
+    ly_syntax_node node = *sema_node(v, decl->syntax);
+
+    assert(decl->state == LY_DS_UNRESOLVED && "declarations are only resolved once");
+    decl->state = LY_DS_RESOLVING;
+
+    switch (cast(ly_decl_kind) decl->kind) {
+        default: break;
+
+        case LY_DK_IMPORT: {
+            ly_syntax_string name = sema_string(v, node.lhs);
+            ly_sema_import* import = sema_find_import(v->sema, name);
+            if (import == NULL) {
+                ch_diag(v->context, CH_DIAG_ERROR, sema_location(v, decl->syntax), "module '%.*s' was not found", cast(int) name.length, name.text);
+                break;
+            }
+
+            const char* target = v->sema->context->target->name;
+            if (import->file->target_length != cast(int64) strlen(target) || 0 != memcmp(import->file->target, target, cast(usize) import->file->target_length)) {
+                ch_diag(v->context, CH_DIAG_ERROR, sema_location(v, decl->syntax), "module '%.*s' was compiled for %.*s, not %s", cast(int) name.length, name.text,
+                        cast(int) import->file->target_length, import->file->target, target);
+                break;
+            }
+
+            import->is_imported = true;
+        } break;
+
+        case LY_DK_BINDING:
+        case LY_DK_PARAM: {
+            decl->type = sema_resolve_type(v, scope, node.lhs);
+        } break;
+
+        case LY_DK_FUNCTION: {
+            decl->type = sema_resolve_function_type(v, scope, decl->syntax);
+        } break;
+
+        case LY_DK_STRUCT: {
+            decl->type = ly_qual_type_make(ly_type_nominal(&v->sema->types, LY_TY_STRUCT, decl_id), LY_TQ_NONE);
+        } break;
+
+        case LY_DK_ENUM: {
+            decl->type = ly_qual_type_make(ly_type_nominal(&v->sema->types, LY_TY_ENUM, decl_id), LY_TQ_NONE);
+
+            // there is nowhere to keep variant values yet, but an enum whose values are not constant integers is still wrong.
+            ly_syntax_list variants = ly_syntax_list_get(v->tree, node.rhs);
+            for (int64 i = 0; i < variants.count; i++) {
+                ly_syntax_id value = sema_node(v, variants.items[i])->rhs;
+                ly_constant constant;
+                if (value != 0 && sema_evaluate_constant(v, scope, value, &constant) && constant.kind != LY_CK_INTEGER) {
+                    ch_diag(v->context, CH_DIAG_ERROR, sema_location(v, value), "expected an integer");
+                }
+            }
+        } break;
+
+        case LY_DK_ALIAS: {
+            decl->type = sema_resolve_type(v, scope, node.rhs);
+            if (decl->type == 0) {
+                ch_diag(v->context, CH_DIAG_ERROR, sema_location(v, node.rhs), "'var' cannot be aliased");
+                decl->type = sema_poison();
+            }
+        } break;
+
+        case LY_DK_TEMPLATE: {
+            sema_resolve_template_decl(v, scope, decl_id);
+        } break;
+    }
+
+    decl->state = LY_DS_RESOLVED;
+}
+
+// Returns the type of a declaration, resolving it first if nothing has needed it yet.
+// Local declarations are resolved as they are declared, so only top level declarations are ever resolved here, and only while
+// declarations are analysed: by the time bodies are analysed in parallel every declaration they can see is resolved, and jobs only read them.
+static ly_qual_type sema_require(sema_view* v, ly_decl_id decl_id) {
+    ly_decl* decl = ly_sema_decl_get(v->sema, decl_id);
+    switch (cast(ly_decl_state) decl->state) {
+        case LY_DS_RESOLVED: return decl->type;
+
+        case LY_DS_RESOLVING: {
+            // only reachable through the declaration's own resolution, so it depends on itself.
+            sema_view owner = sema_view_owner(v, decl->tree);
+            ch_atom_info name = ch_atom_get(&v->sema->atoms, decl->name);
+            ch_diag(v->context, CH_DIAG_ERROR, sema_location(&owner, decl->syntax), "'%.*s' depends on itself", cast(int) name.length, name.text);
+            return sema_poison();
+        }
+
+        case LY_DS_UNRESOLVED: {
+            sema_view owner = sema_view_owner(v, decl->tree);
+            sema_resolve_decl(&owner, &v->sema->module_scope, decl_id);
+            return decl->type;
+        }
+    }
+
+    assert(false && "invalid declaration state");
+    return sema_poison();
+}
+
+static void sema_intern_tree_strings(ly_sema* sema, uint32 tree_index) {
+    ly_syntax_tree* tree = sema->module->trees.items[tree_index];
+    assert(tree->strings.items != NULL && "the tree's strings were released before they were interned");
+
+    ch_atom* atoms = ch_alloc(sema->allocator, tree->strings.count * cast(int64) sizeof *atoms);
+    for (int64 i = 0; i < tree->strings.count; i++) {
+        ly_syntax_string string = tree->strings.items[i];
+        atoms[i] = ch_atom_intern(&sema->atoms, string.text, string.length);
+    }
+
+    sema->tree_atoms[tree_index] = atoms;
+}
+
+// Declares the top level declarations of every file, then resolves them in order. A declaration which uses another resolves that one
+// first, wherever it is declared, so nothing is resolved twice and nothing depends on the order files or declarations are written in.
+// Imports are resolved before anything else, since any declaration may use a name only an imported module declares.
+static void sema_analyse_declarations(ly_sema* sema) {
+    ly_module* module = sema->module;
+    ly_decl_ids* declared = &sema->module_decls;
+
+    for (int64 i = 0; i < module->trees.count; i++) {
+        sema_view v = sema_view_of(sema, sema->context, cast(uint32) i);
+        ly_syntax_list decls = ly_syntax_list_get(v.tree, sema_node(&v, v.tree->root)->lhs);
+        for (int64 j = 0; j < decls.count; j++) {
+            ly_decl_id decl = sema_declare(&v, &sema->module_scope, decls.items[j]);
+            if (decl != 0) da_push(declared, decl);
+        }
+    }
+
+    for (int64 i = 0; i < declared->count; i++) {
+        ly_decl* decl = ly_sema_decl_get(sema, declared->items[i]);
+        if (decl->kind != LY_DK_IMPORT) continue;
+
+        sema_view v = sema_view_of(sema, sema->context, decl->tree);
+        discard sema_require(&v, declared->items[i]);
+    }
+
+    for (int64 i = 0; i < declared->count; i++) {
+        ly_decl* decl = ly_sema_decl_get(sema, declared->items[i]);
+        sema_view v = sema_view_of(sema, sema->context, decl->tree);
+        discard sema_require(&v, declared->items[i]);
+
+        ly_syntax_node* node = sema_node(&v, decl->syntax);
+        if (decl->kind == LY_DK_FUNCTION && sema_extra(&v, node->lhs + 3) != 0) {
+            ly_sema_function function = {declared->items[i], NULL};
+            da_push(&sema->functions, function);
+        }
+    }
+
+    // every struct is laid out here, on one thread, so bodies only ever read their layouts and diagnostics come out in declaration order.
+    for (int64 i = 0; i < declared->count; i++) {
+        ly_decl* decl = ly_sema_decl_get(sema, declared->items[i]);
+        if (decl->kind != LY_DK_STRUCT) continue;
+
+        sema_view v = sema_view_of(sema, sema->context, decl->tree);
+        discard sema_struct_layout(&v, &sema->module_scope, ly_qual_type_id(decl->type));
+    }
+}
+
+// ======================================================================
+// Layouts
+// ======================================================================
+
+typedef struct sema_field_layouts {
+    ch_allocator allocator;
+    ly_field_layout* items;
+    int64 count, capacity;
+} sema_field_layouts;
+
+// A struct or variant waiting to be laid out, and where its fields begin.
+typedef struct sema_variant {
+    ly_syntax_id id;
+    ch_size offset;
+} sema_variant;
+
+typedef struct sema_variants {
+    ch_allocator allocator;
+    sema_variant* items;
+    int64 count, capacity;
+} sema_variants;
+
+static ch_size sema_align_to(ch_size size, ch_align align) {
+    return (size + align - 1) / align * align;
+}
+
+static ch_layout sema_target_layout(sema_view* v, ch_target_type type) {
+    return v->sema->layouts.target->layouts[type];
+}
+
+static bool sema_too_large(sema_view* v, ly_syntax_id at) {
+    if (at != 0) ch_diag(v->context, CH_DIAG_ERROR, sema_location(v, at), "type is too large for the target");
+    return false;
+}
+
+// Stores the size and alignment of `type` in `out_layout`, laying out structs the first time they are needed.
+// Problems are reported at `at` unless it is 0; a type which is already poisoned, or a struct whose layout failed, was reported before.
+static bool sema_type_layout(sema_view* v, ly_type_id type, ly_syntax_id at, ch_layout* out_layout) {
+    const ly_type* t = ly_type_get(&v->sema->types, type);
+
+    switch (cast(ly_type_kind) t->kind) {
+        default: {
+            if (at != 0) ch_diag(v->context, CH_DIAG_ERROR, sema_location(v, at), "this type has no size");
+            return false;
+        }
+
+        case LY_TY_POISON: return false;
+
+        case LY_TY_NIL:
+        case LY_TY_VOID:
+        case LY_TY_NORETURN: *out_layout = (ch_layout){0, 1}; return true;
+
+        case LY_TY_BOOL: *out_layout = (ch_layout){1, 1}; return true;
+        case LY_TY_INT:
+        case LY_TY_UINT: *out_layout = sema_target_layout(v, CH_TT_SIZE); return true;
+
+        case LY_TY_FFI_BOOL: *out_layout = sema_target_layout(v, CH_TT_C_BOOL); return true;
+        case LY_TY_FFI_CHAR:
+        case LY_TY_FFI_SCHAR:
+        case LY_TY_FFI_UCHAR: *out_layout = sema_target_layout(v, CH_TT_C_CHAR); return true;
+        case LY_TY_FFI_SHORT:
+        case LY_TY_FFI_USHORT: *out_layout = sema_target_layout(v, CH_TT_C_SHORT); return true;
+        case LY_TY_FFI_INT:
+        case LY_TY_FFI_UINT: *out_layout = sema_target_layout(v, CH_TT_C_INT); return true;
+        case LY_TY_FFI_LONG:
+        case LY_TY_FFI_ULONG: *out_layout = sema_target_layout(v, CH_TT_C_LONG); return true;
+        case LY_TY_FFI_LONGLONG:
+        case LY_TY_FFI_ULONGLONG: *out_layout = sema_target_layout(v, CH_TT_C_LONG_LONG); return true;
+        case LY_TY_FFI_FLOAT: *out_layout = sema_target_layout(v, CH_TT_C_FLOAT); return true;
+        case LY_TY_FFI_DOUBLE: *out_layout = sema_target_layout(v, CH_TT_C_DOUBLE); return true;
+        case LY_TY_FFI_LONGDOUBLE: *out_layout = sema_target_layout(v, CH_TT_C_LONG_DOUBLE); return true;
+
+        // sized types take whole bytes, and are aligned to the next power of two of that.
+        case LY_TY_BOOL_SIZED:
+        case LY_TY_INT_SIZED:
+        case LY_TY_UINT_SIZED:
+        case LY_TY_FLOAT_SIZED: {
+            ch_size size = (cast(ch_size) t->operand + 7) / 8;
+            ch_align align = 1;
+            while (align < size) align *= 2;
+            *out_layout = (ch_layout){size, align};
+            return true;
+        }
+
+        case LY_TY_POINTER:
+        case LY_TY_BUFFER:
+        case LY_TY_FUNCTION: *out_layout = sema_target_layout(v, CH_TT_POINTER); return true;
+
+        case LY_TY_SLICE: {
+            ch_layout pointer = sema_target_layout(v, CH_TT_POINTER);
+            ch_layout length = sema_target_layout(v, CH_TT_SIZE);
+            ch_align align = pointer.align > length.align ? pointer.align : length.align;
+            *out_layout = (ch_layout){sema_align_to(sema_align_to(pointer.size, length.align) + length.size, align), align};
+            return true;
+        }
+
+        case LY_TY_ENUM: *out_layout = sema_target_layout(v, CH_TT_C_INT); return true;
+
+        case LY_TY_STRUCT: {
+            const ly_struct_layout* layout = sema_struct_layout(v, &v->sema->module_scope, type);
+            if (layout == NULL) return false;
+            *out_layout = layout->layout;
+            return true;
+        }
+
+        case LY_TY_NILABLE:
+        case LY_TY_RANGE:
+        case LY_TY_ARRAY: break;
+    }
+
+    ly_type_id element_type = ly_qual_type_id(t->element);
+    ch_layout element;
+    if (!sema_type_layout(v, element_type, at, &element)) {
+        return false;
+    }
+
+    switch (cast(ly_type_kind) t->kind) {
+        default: break;
+
+        case LY_TY_NILABLE: {
+            // nil is the null pointer when there is one, and otherwise needs a flag after the value.
+            ly_type_kind element_kind = ly_type_get(&v->sema->types, element_type)->kind;
+            if (element_kind == LY_TY_POINTER || element_kind == LY_TY_BUFFER || element_kind == LY_TY_FUNCTION) {
+                *out_layout = element;
+                return true;
+            }
+
+            if (element.size > INT64_MAX - element.align) return sema_too_large(v, at);
+            *out_layout = (ch_layout){sema_align_to(element.size + 1, element.align), element.align};
+            return true;
+        }
+
+        case LY_TY_RANGE: {
+            *out_layout = (ch_layout){2 * element.size, element.align};
+            return true;
+        }
+
+        case LY_TY_ARRAY: {
+            ch_size size = element.size;
+            for (int64 i = 0; i < t->operand; i++) {
+                uint64 length = ly_type_array_length(&v->sema->types, type, i);
+                if (length != 0 && cast(uint64) size > cast(uint64) INT64_MAX / length) return sema_too_large(v, at);
+                size *= cast(ch_size) length;
+            }
+
+            *out_layout = (ch_layout){size, element.align};
+            return true;
+        }
+    }
+
+    assert(false && "unhandled container type");
+    return false;
+}
+
+// Lays out the fields of a struct and then, depth first, those of its variants, each variant starting where its parent's fields end.
+static void sema_compute_struct_layout(sema_view* v, ly_scope* scope, ly_syntax_id id, ly_struct_layout* layout) {
+    sema_field_layouts fields = {.allocator = v->sema->allocator};
+    sema_variants variants = {.allocator = v->sema->allocator};
+
+    ch_layout result = {0, 1};
+    bool is_valid = true;
+
+    sema_variant root = {id, 0};
+    da_push(&variants, root);
+
+    while (variants.count > 0) {
+        sema_variant variant = variants.items[--variants.count];
+        ly_syntax_list members = ly_syntax_list_get(v->tree, sema_node(v, variant.id)->rhs);
+
+        ch_size offset = variant.offset;
+        for (int64 i = 0; i < members.count; i++) {
+            ly_syntax_node member = *sema_node(v, members.items[i]);
+            if (member.kind != LY_SN_DECL_FIELD) continue;
+
+            ly_qual_type type = sema_resolve_type(v, scope, member.lhs);
+            if (type == 0) {
+                ch_diag(v->context, CH_DIAG_ERROR, sema_location(v, members.items[i]), "fields cannot infer their type");
+                is_valid = false;
+                continue;
+            }
+
+            ch_layout field;
+            if (!sema_type_layout(v, ly_qual_type_id(type), members.items[i], &field)) {
+                is_valid = false;
+                continue;
+            }
+
+            offset = sema_align_to(offset, field.align);
+            if (field.size > INT64_MAX - offset - result.align) {
+                is_valid = sema_too_large(v, members.items[i]);
+                continue;
+            }
+
+            ly_field_layout field_layout = {v->atoms[member.rhs], type, offset};
+            da_push(&fields, field_layout);
+
+            offset += field.size;
+            if (field.align > result.align) result.align = field.align;
+        }
+
+        if (offset > result.size) result.size = offset;
+
+        // pushed in reverse, so the variants are laid out in the order they are written.
+        for (int64 i = members.count - 1; i >= 0; i--) {
+            if (sema_node(v, members.items[i])->kind != LY_SN_DECL_STRUCT) continue;
+            sema_variant nested = {members.items[i], offset};
+            da_push(&variants, nested);
+        }
+    }
+
+    da_free(&variants);
+
+    result.size = sema_align_to(result.size, result.align);
+    layout->layout = result;
+    layout->fields = fields.items;
+    layout->field_count = fields.count;
+
+    // finding the struct inside itself already marked it invalid.
+    if (!is_valid || layout->state == LY_LS_INVALID) {
+        layout->state = LY_LS_INVALID;
+    } else {
+        layout->state = LY_LS_COMPUTED;
+    }
+}
+
+// Returns the layout of a struct type, computing it with field types resolved from `scope` if this is the first time it is needed,
+// or NULL if it has none. Only local structs are laid out from a scope other than the module's, as they are declared.
+static const ly_struct_layout* sema_struct_layout(sema_view* v, ly_scope* scope, ly_type_id struct_type) {
+    ly_decl_id decl_id = ly_type_get(&v->sema->types, struct_type)->operand;
+    ly_decl* decl = ly_sema_decl_get(v->sema, decl_id);
+
+    // what a template's parameters stand for is not known, so neither is the size of a struct made of them.
+    if (decl->flags & LY_DF_DEPENDENT) {
+        return NULL;
+    }
+
+    // an imported struct's layout was recorded as it was decoded, so only structs of this module ever need their syntax.
+    ly_struct_layout* layout = ly_layout_cache_find(&v->sema->layouts, struct_type);
+    if (layout == NULL) {
+        sema_view owner = sema_view_owner(v, decl->tree);
+        layout = ly_layout_cache_add(&v->sema->layouts, struct_type);
+        sema_compute_struct_layout(&owner, scope, decl->syntax, layout);
+    } else if (layout->state == LY_LS_COMPUTING) {
+        sema_view owner = sema_view_owner(v, decl->tree);
+        ch_atom_info name = ch_atom_get(&v->sema->atoms, decl->name);
+        ch_diag(v->context, CH_DIAG_ERROR, sema_location(&owner, decl->syntax), "'%.*s' contains itself", cast(int) name.length, name.text);
+        layout->state = LY_LS_INVALID;
+    }
+
+    return layout->state == LY_LS_COMPUTED ? layout : NULL;
+}
+
+CHOIR_API bool ly_sema_type_layout(ly_sema* sema, ly_type_id type, ch_layout* out_layout) {
+    sema_view v = {.sema = sema, .context = sema->context};
+    return sema_type_layout(&v, type, 0, out_layout);
+}
+
+CHOIR_API const ly_struct_layout* ly_sema_struct_layout(ly_sema* sema, ly_type_id struct_type) {
+    sema_view v = {.sema = sema, .context = sema->context};
+    return sema_struct_layout(&v, &sema->module_scope, struct_type);
+}
+
+// Returns the type a query asks about: a type, or a name whose type is known.
+static ly_type_id sema_query_type(sema_view* v, ly_scope* scope, ly_syntax_id id) {
+    ly_syntax_node* node = sema_node(v, id);
+    if (node->kind == LY_SN_EXPR_NAMEREF) {
+        ly_scope_lookup lookup = sema_find(v->sema, scope, v->atoms[node->lhs]);
+        ly_decl* decl = lookup.scope != NULL && lookup.decls.count == 1 ? ly_sema_decl_get(v->sema, lookup.decls.items[0]) : NULL;
+        if (decl != NULL && (decl->kind == LY_DK_BINDING || decl->kind == LY_DK_PARAM)) {
+            ly_qual_type type = sema_require(v, lookup.decls.items[0]);
+            if (type != 0) return ly_qual_type_id(type);
+
+            ch_diag(v->context, CH_DIAG_ERROR, sema_location(v, id), "expression is not constant");
+            return LY_TY_POISON;
+        }
+    }
+
+    ly_qual_type type = sema_resolve_type(v, scope, id);
+    if (type == 0) {
+        ch_diag(v->context, CH_DIAG_ERROR, sema_location(v, id), "expected a type");
+        return LY_TY_POISON;
+    }
+
+    return ly_qual_type_id(type);
+}
+
+// Answers `sizeof`, `alignof` and `offsetof` for the constant evaluator from the target's layouts.
+static bool sema_query(void* userdata, ly_syntax_id id, ly_constant* out_constant) {
+    sema_constant_scope* constant_scope = userdata;
+    sema_view* v = constant_scope->v;
+    ly_syntax_node node = *sema_node(v, id);
+
+    switch (cast(ly_token_kind) node.token_kind) {
+        default: {
+            ch_diag(v->context, CH_DIAG_ERROR, sema_location(v, id), "expression is not constant");
+            return false;
+        }
+
+        case LY_TK_SIZEOF:
+        case LY_TK_ALIGNOF: {
+            ly_type_id type = sema_query_type(v, constant_scope->scope, node.lhs);
+            ch_layout layout;
+            if (type == LY_TY_POISON || !sema_type_layout(v, type, id, &layout)) {
+                return false;
+            }
+
+            int64 value = node.token_kind == LY_TK_SIZEOF ? layout.size : layout.align;
+            *out_constant = (ly_constant){.kind = LY_CK_INTEGER, .integer.value = value};
+            return true;
+        }
+
+        case LY_TK_OFFSETOF: {
+            ly_syntax_node field = *sema_node(v, node.lhs);
+            if (field.kind != LY_SN_EXPR_FIELD) {
+                ch_diag(v->context, CH_DIAG_ERROR, sema_location(v, node.lhs), "expected a struct field, as in 'offsetof(S.field)'");
+                return false;
+            }
+
+            ly_type_id type = sema_query_type(v, constant_scope->scope, field.lhs);
+            if (type == LY_TY_POISON) {
+                return false;
+            }
+
+            if (ly_type_get(&v->sema->types, type)->kind != LY_TY_STRUCT) {
+                ch_diag(v->context, CH_DIAG_ERROR, sema_location(v, field.lhs), "expected a struct type");
+                return false;
+            }
+
+            const ly_struct_layout* layout = sema_struct_layout(v, &v->sema->module_scope, type);
+            if (layout == NULL) {
+                return false;
+            }
+
+            for (int64 i = 0; i < layout->field_count; i++) {
+                if (layout->fields[i].name == v->atoms[field.rhs]) {
+                    *out_constant = (ly_constant){.kind = LY_CK_INTEGER, .integer.value = layout->fields[i].offset};
+                    return true;
+                }
+            }
+
+            ly_syntax_string name = sema_string(v, field.rhs);
+            ch_diag(v->context, CH_DIAG_ERROR, sema_location(v, node.lhs), "no field named '%.*s'", cast(int) name.length, name.text);
+            return false;
+        }
+    }
+}
+
+// ======================================================================
+// Templates
+// ======================================================================
+
+// Declares a template's parameters in `scope`: as the types of the given arguments in an instance, or as themselves in the template's pattern.
+static void sema_declare_template_params(sema_view* v, ly_scope* scope, ly_syntax_list params, const ly_type_id* args) {
+    for (int64 i = 0; i < params.count; i++) {
+        if (args == NULL) {
+            ly_decl_id param = sema_declare(v, scope, params.items[i]);
+            if (param == 0) continue;
+
+            ly_decl* decl = ly_sema_decl_get(v->sema, param);
+            decl->type = ly_qual_type_make(ly_type_nominal(&v->sema->types, LY_TY_TEMPLATE_PARAMETER, param), LY_TQ_NONE);
+            decl->state = LY_DS_RESOLVED;
+            continue;
+        }
+
+        // a duplicate parameter was reported with the pattern, so it is not reported again for every instance.
+        ly_decl decl = {
+            .kind = LY_DK_TEMPLATE_PARAM,
+            .state = LY_DS_RESOLVED,
+            .name = v->atoms[sema_node(v, params.items[i])->lhs],
+            .tree = v->tree_index,
+            .syntax = params.items[i],
+            .type = ly_qual_type_make(args[i], LY_TQ_NONE),
+        };
+
+        discard ly_scope_add(scope, decl.name, ly_sema_decl_add(v->sema, decl), false);
+    }
+}
+
+// Resolves the field types of a struct template's pattern, returning false if any is invalid. Only instances are laid out.
+static bool sema_resolve_pattern_fields(sema_view* v, ly_scope* scope, ly_syntax_id id) {
+    sema_variants variants = {.allocator = v->sema->allocator};
+    sema_variant root = {id, 0};
+    da_push(&variants, root);
+
+    bool is_valid = true;
+    while (variants.count > 0) {
+        sema_variant variant = variants.items[--variants.count];
+        ly_syntax_list members = ly_syntax_list_get(v->tree, sema_node(v, variant.id)->rhs);
+        for (int64 i = 0; i < members.count; i++) {
+            ly_syntax_node member = *sema_node(v, members.items[i]);
+            if (member.kind == LY_SN_DECL_STRUCT) {
+                sema_variant nested = {members.items[i], 0};
+                da_push(&variants, nested);
+                continue;
+            }
+
+            if (member.kind != LY_SN_DECL_FIELD) continue;
+
+            ly_qual_type type = sema_resolve_type(v, scope, member.lhs);
+            if (type == 0) {
+                ch_diag(v->context, CH_DIAG_ERROR, sema_location(v, members.items[i]), "fields cannot infer their type");
+            }
+
+            is_valid &= type != 0 && ly_qual_type_id(type) != LY_TY_POISON;
+        }
+    }
+
+    da_free(&variants);
+    return is_valid;
+}
+
+// Resolves a template by resolving its pattern in terms of its parameters, so that problems which do not depend on the arguments
+// are reported once rather than for every instance. A function template's body is analysed the same way, once.
+static void sema_resolve_template_decl(sema_view* v, ly_scope* scope, ly_decl_id template_id) {
+    ly_decl* decl = ly_sema_decl_get(v->sema, template_id);
+    ly_syntax_node node = *sema_node(v, decl->syntax);
+
+    ly_scope* params = ch_alloc(v->sema->allocator, sizeof *params);
+    ly_scope_init(params, v->sema->allocator, scope);
+    sema_declare_template_params(v, params, ly_syntax_list_get(v->tree, node.lhs), NULL);
+
+    ly_decl_kind kind;
+    discard sema_decl_name(v, node.rhs, &kind);
+
+    ly_decl pattern = {
+        .kind = cast(uint8) kind,
+        .flags = LY_DF_DEPENDENT,
+        .name = decl->name,
+        .tree = decl->tree,
+        .syntax = node.rhs,
+    };
+
+    ly_decl_id pattern_id = ly_sema_decl_add(v->sema, pattern);
+    sema_resolve_decl(v, params, pattern_id);
+    decl->type = ly_sema_decl_get(v->sema, pattern_id)->type;
+
+    if (kind == LY_DK_STRUCT) {
+        // the pattern's fields may instantiate the template itself, as in `template<T> struct list { list<T>* next; }`.
+        decl->state = LY_DS_RESOLVED;
+        if (!sema_resolve_pattern_fields(v, params, node.rhs)) {
+            decl->type = sema_poison();
+        }
+    }
+
+    if (kind == LY_DK_FUNCTION && sema_extra(v, sema_node(v, node.rhs)->lhs + 3) != 0) {
+        ly_sema_function function = {pattern_id, params};
+        da_push(&v->sema->functions, function);
+        return;
+    }
+
+    ly_scope_deinit(params);
+    ch_dealloc(v->sema->allocator, params);
+}
+
+// Whether a type refers to a template parameter, which it only can inside a template's pattern.
+static bool sema_type_is_dependent(ly_sema* sema, ly_type_id type) {
+    while (true) {
+        const ly_type* t = ly_type_get(&sema->types, type);
+        switch (cast(ly_type_kind) t->kind) {
+            default: return false;
+
+            case LY_TY_TEMPLATE_PARAMETER: return true;
+            case LY_TY_STRUCT: return 0 != (ly_sema_decl_get(sema, t->operand)->flags & LY_DF_DEPENDENT);
+
+            case LY_TY_POINTER:
+            case LY_TY_BUFFER:
+            case LY_TY_NILABLE:
+            case LY_TY_SLICE:
+            case LY_TY_RANGE:
+            case LY_TY_ARRAY: {
+                type = ly_qual_type_id(t->element);
+            } break;
+
+            case LY_TY_ERROR_PAIR: {
+                if (sema_type_is_dependent(sema, ly_qual_type_id(t->element))) return true;
+                type = ly_qual_type_id(t->operand);
+            } break;
+
+            case LY_TY_FUNCTION: {
+                for (int64 i = 0; i < t->operand; i++) {
+                    if (sema_type_is_dependent(sema, ly_qual_type_id(ly_type_function_param(&sema->types, type, i).type))) return true;
+                }
+
+                type = ly_qual_type_id(t->element);
+            } break;
+        }
+    }
+}
+
+// Finds the instance of an imported template for these arguments among those its module file records, since importers cannot
+// instantiate a template themselves: module files do not carry syntax.
+static ly_decl_id sema_import_instance(sema_view* v, ly_decl_id template_id, const ly_type_id* args, int64 arg_count, ly_syntax_id at) {
+    ly_sema* sema = v->sema;
+    ly_decl* decl = ly_sema_decl_get(sema, template_id);
+    uint32 import_index = decl->tree & ~LY_DECL_IMPORTED;
+    ly_module_file* file = sema->imports.items[import_index].file;
+
+    ch_atom_info name = ch_atom_get(&sema->atoms, decl->name);
+    uint32 first;
+    int64 count = ly_module_file_find_instances(file, name.text, name.length, &first);
+
+    ly_decl_id result = 0;
+    ch_mutex_lock(&sema->imports_mutex);
+
+    for (int64 i = 0; i < count && result == 0; i++) {
+        const ly_module_instance* instance = ly_module_file_instance(file, first + cast(uint32) i);
+        if (instance == NULL || instance->arg_count != arg_count) continue;
+
+        bool is_match = true;
+        for (int64 j = 0; j < arg_count && is_match; j++) {
+            ly_qual_type arg = sema_import_type(sema, import_index, ly_qual_type_make(file->extra[instance->args + j], LY_TQ_NONE));
+            is_match = ly_qual_type_id(arg) == args[j];
+        }
+
+        if (is_match) {
+            result = sema_import_decl(sema, import_index, instance->decl);
+        }
+    }
+
+    ch_mutex_unlock(&sema->imports_mutex);
+
+    if (result == 0) {
+        ch_diag(v->context, CH_DIAG_ERROR, sema_location(v, at), "module '%.*s' has no instantiation of '%.*s' for these arguments", cast(int) file->name_length, file->name,
+                cast(int) name.length, name.text);
+    }
+
+    return result;
+}
+
+// Returns the instance of a template for these arguments, instantiating it the first time they are used. Problems are reported at `at`.
+// The outermost instantiation holds `instantiate_mutex` until it and every instance it made along the way are complete, and only then
+// publishes them, so other threads find either nothing or a finished instance. An instance first made by a body reports what is wrong
+// with it along with that body.
+static ly_decl_id sema_instantiate(sema_view* v, ly_decl_id template_id, const ly_type_id* args, int64 arg_count, ly_syntax_id at) {
+    ly_sema* sema = v->sema;
+    ly_qual_type pattern_type = sema_require(v, template_id);
+
+    ly_decl* decl = ly_sema_decl_get(sema, template_id);
+    if (decl->tree & LY_DECL_IMPORTED) {
+        return sema_import_instance(v, template_id, args, arg_count, at);
+    }
+
+    if (ly_qual_type_id(pattern_type) == LY_TY_POISON) {
+        return 0;
+    }
+
+    ly_decl_id result = ly_template_cache_find(&sema->templates, template_id, args, arg_count, v->is_instantiating);
+    if (result != 0) {
+        return result;
+    }
+
+    sema_view owner = sema_view_owner(v, decl->tree);
+    ly_syntax_node node = *sema_node(&owner, decl->syntax);
+    ly_syntax_list params = ly_syntax_list_get(owner.tree, node.lhs);
+    if (params.count != arg_count) {
+        ch_atom_info name = ch_atom_get(&sema->atoms, decl->name);
+        ch_diag(v->context, CH_DIAG_ERROR, sema_location(v, at), "'%.*s' takes %lld template argument%s, but %lld were given", cast(int) name.length, name.text,
+                cast(long long) params.count, params.count == 1 ? "" : "s", cast(long long) arg_count);
+        return 0;
+    }
+
+    bool is_outermost = !v->is_instantiating;
+    if (is_outermost) {
+        ch_mutex_lock(&sema->instantiate_mutex);
+
+        // another thread may have made it while this one waited.
+        result = ly_template_cache_find(&sema->templates, template_id, args, arg_count, true);
+        if (result != 0) {
+            ch_mutex_unlock(&sema->instantiate_mutex);
+            return result;
+        }
+    }
+
+    owner.is_instantiating = true;
+
+    ly_scope* scope = ch_alloc(sema->allocator, sizeof *scope);
+    ly_scope_init(scope, sema->allocator, &sema->module_scope);
+    sema_declare_template_params(&owner, scope, params, args);
+
+    bool is_dependent = false;
+    for (int64 i = 0; i < arg_count && !is_dependent; i++) {
+        is_dependent = sema_type_is_dependent(sema, args[i]);
+    }
+
+    ly_decl_kind kind;
+    discard sema_decl_name(&owner, node.rhs, &kind);
+
+    ly_decl instance = {
+        .kind = cast(uint8) kind,
+        .flags = cast(uint8)(is_dependent ? LY_DF_DEPENDENT : LY_DF_NONE),
+        .name = decl->name,
+        .tree = decl->tree,
+        .syntax = node.rhs,
+    };
+
+    // recorded before it is resolved, so that it finds itself through its own fields.
+    result = ly_sema_decl_add(sema, instance);
+    ly_template_cache_add(&sema->templates, template_id, args, arg_count, result);
+
+    sema_resolve_decl(&owner, scope, result);
+    if (kind == LY_DK_STRUCT) {
+        discard sema_struct_layout(&owner, scope, ly_qual_type_id(ly_sema_decl_get(sema, result)->type));
+    }
+
+    ly_scope_deinit(scope);
+    ch_dealloc(sema->allocator, scope);
+
+    if (is_outermost) {
+        ly_template_cache_publish(&sema->templates);
+        ch_mutex_unlock(&sema->instantiate_mutex);
+    }
+
+    return result;
+}
+
+// Resolves `name<args>` to the instance it names. Arguments are canonical type ids, so `mut` on an argument itself is dropped.
+static ly_decl_id sema_resolve_template(sema_view* v, ly_scope* scope, ly_syntax_id id) {
+    ly_syntax_node node = *sema_node(v, id);
+    ly_scope_lookup lookup = sema_lookup(v, scope, node.lhs);
+    if (lookup.scope == NULL) {
+        return 0;
+    }
+
+    ly_decl_id template_id = lookup.decls.items[0];
+    if (lookup.decls.count != 1 || ly_sema_decl_get(v->sema, template_id)->kind != LY_DK_TEMPLATE) {
+        ly_syntax_string name = sema_string(v, sema_node(v, node.lhs)->lhs);
+        ch_diag(v->context, CH_DIAG_ERROR, sema_location(v, node.lhs), "'%.*s' is not a template", cast(int) name.length, name.text);
+        return 0;
+    }
+
+    ly_syntax_list arg_syntax = ly_syntax_list_get(v->tree, node.rhs);
+    ly_type_id arg_buffer[SEMA_INLINE_ARG_COUNT];
+    ly_type_id* args = arg_syntax.count <= SEMA_INLINE_ARG_COUNT ? arg_buffer : ch_alloc(v->sema->allocator, arg_syntax.count * cast(int64) sizeof *args);
+
+    bool is_valid = true;
+    for (int64 i = 0; i < arg_syntax.count; i++) {
+        ly_qual_type arg = sema_resolve_type(v, scope, arg_syntax.items[i]);
+        if (arg == 0) {
+            ch_diag(v->context, CH_DIAG_ERROR, sema_location(v, arg_syntax.items[i]), "'var' cannot be a template argument");
+            arg = sema_poison();
+        }
+
+        args[i] = ly_qual_type_id(arg);
+        is_valid &= args[i] != LY_TY_POISON;
+    }
+
+    ly_decl_id result = is_valid ? sema_instantiate(v, template_id, args, arg_syntax.count, id) : 0;
+
+    if (args != arg_buffer) ch_dealloc(v->sema->allocator, args);
+    return result;
+}
+
+// ======================================================================
+// Overload resolution
+// ======================================================================
+
+static bool sema_is_integer_kind(ly_type_kind kind) {
+    return kind == LY_TY_INT || kind == LY_TY_UINT || kind == LY_TY_INT_SIZED || kind == LY_TY_UINT_SIZED ||
+           (kind >= LY_TY_FFI_CHAR && kind <= LY_TY_FFI_ULONGLONG);
+}
+
+static bool sema_is_float_kind(ly_type_kind kind) {
+    return kind == LY_TY_FLOAT_SIZED || (kind >= LY_TY_FFI_FLOAT && kind <= LY_TY_FFI_LONGDOUBLE);
+}
+
+static bool sema_is_bool_kind(ly_type_kind kind) {
+    return kind == LY_TY_BOOL || kind == LY_TY_BOOL_SIZED || kind == LY_TY_FFI_BOOL;
+}
+
+// Returns the type of an argument where it is known without type checking the expression, otherwise 0.
+static ly_type_id sema_argument_type(sema_view* v, ly_scope* scope, ly_syntax_id id) {
+    ly_syntax_node* node = sema_node(v, id);
+    switch (cast(ly_syntax_kind) node->kind) {
+        default: return 0;
+        case LY_SN_EXPR_LITERAL_INTEGER:
+        case LY_SN_EXPR_LITERAL_WIDE_INTEGER: return ly_type_simple(LY_TY_LITERAL_INTEGER);
+        case LY_SN_EXPR_LITERAL_BOOL: return ly_type_simple(LY_TY_LITERAL_BOOL);
+        case LY_SN_EXPR_LITERAL_STRING: return ly_type_simple(LY_TY_LITERAL_STRING);
+        case LY_SN_EXPR_GROUPED: return sema_argument_type(v, scope, node->lhs);
+
+        // an argument passed by reference, as in `f(ref x)`, has the type of what it refers to.
+        case LY_SN_EXPR_UNARY_PREFIX: return node->token_kind == LY_TK_REF ? sema_argument_type(v, scope, node->lhs) : 0;
+
+        case LY_SN_EXPR_NAMEREF: {
+            ly_scope_lookup lookup = sema_find(v->sema, scope, v->atoms[node->lhs]);
+            if (lookup.scope == NULL || lookup.decls.count != 1) return 0;
+
+            ly_decl* decl = ly_sema_decl_get(v->sema, lookup.decls.items[0]);
+            if (decl->kind != LY_DK_BINDING && decl->kind != LY_DK_PARAM) return 0;
+            return decl->state == LY_DS_RESOLVED ? ly_qual_type_id(decl->type) : 0;
+        }
+    }
+}
+
+static ly_conversion sema_conversion(sema_view* v, ly_type_id arg, ly_type_id param) {
+    if (arg == 0) return LY_CONV_OTHER;
+    if (arg == param) return LY_CONV_EXACT;
+
+    ly_type_kind arg_kind = ly_type_get(&v->sema->types, arg)->kind;
+    ly_type_kind param_kind = ly_type_get(&v->sema->types, param)->kind;
+
+    switch (arg_kind) {
+        default: break;
+
+        // a literal is exactly its default type, so `f(1)` prefers `f(int)` over `f(int8)`.
+        case LY_TY_LITERAL_INTEGER: {
+            if (param_kind == LY_TY_INT) return LY_CONV_EXACT;
+            if (sema_is_integer_kind(param_kind) || sema_is_float_kind(param_kind)) return LY_CONV_LITERAL;
+        } break;
+
+        case LY_TY_LITERAL_BOOL: {
+            if (param_kind == LY_TY_BOOL) return LY_CONV_EXACT;
+            if (sema_is_bool_kind(param_kind)) return LY_CONV_LITERAL;
+        } break;
+
+        case LY_TY_LITERAL_STRING: {
+            if (param_kind == LY_TY_POINTER || param_kind == LY_TY_BUFFER || param_kind == LY_TY_SLICE) return LY_CONV_LITERAL;
+        } break;
+    }
+
+    if ((sema_is_integer_kind(arg_kind) && sema_is_integer_kind(param_kind)) || (sema_is_float_kind(arg_kind) && sema_is_float_kind(param_kind))) {
+        return LY_CONV_NUMERIC;
+    }
+
+    return LY_CONV_OTHER;
+}
+
+static bool sema_takes_argument_count(sema_view* v, ly_type_id function, int64 arg_count) {
+    const ly_type* type = ly_type_get(&v->sema->types, function);
+    return arg_count == type->operand || (arg_count > type->operand && type->varargs_kind == LY_VARARGS_C);
+}
+
+// Fills in how each argument converts for a call to `function`, returning false if it cannot take this many arguments.
+static bool sema_candidate_conversions(sema_view* v, ly_type_id function, const ly_type_id* arg_types, int64 arg_count, ly_conversion* out_conversions) {
+    if (!sema_takes_argument_count(v, function, arg_count)) {
+        return false;
+    }
+
+    int64 param_count = ly_type_get(&v->sema->types, function)->operand;
+
+    for (int64 i = 0; i < arg_count; i++) {
+        if (i >= param_count) {
+            out_conversions[i] = LY_CONV_VARARGS;
+            continue;
+        }
+
+        ly_type_id param = ly_qual_type_id(ly_type_function_param(&v->sema->types, function, i).type);
+        out_conversions[i] = sema_conversion(v, arg_types[i], param);
+    }
+
+    return true;
+}
+
+// Returns true if a candidate converts every argument at least as well as another, and at least one better.
+static bool sema_conversions_better(const ly_conversion* lhs, const ly_conversion* rhs, int64 arg_count) {
+    bool is_better = false;
+    for (int64 i = 0; i < arg_count; i++) {
+        if (lhs[i] > rhs[i]) return false;
+        is_better |= lhs[i] < rhs[i];
+    }
+
+    return is_better;
+}
+
+// Collects every function a call to an overload set could reach, continuing the set into enclosing scopes and then the imported modules.
+static void sema_collect_candidates(sema_view* v, ly_scope_lookup lookup, ch_atom name, ly_decl_ids* candidates) {
+    while (lookup.scope != NULL) {
+        for (int64 i = 0; i < lookup.decls.count; i++) {
+            if (ly_sema_decl_get(v->sema, lookup.decls.items[i])->kind != LY_DK_FUNCTION) return;
+        }
+
+        da_push_many(candidates, lookup.decls.items, lookup.decls.count);
+        if (lookup.scope == &v->sema->import_scope) return;
+
+        if (lookup.scope->parent != NULL) {
+            lookup = sema_find(v->sema, lookup.scope->parent, name);
+        } else {
+            lookup = sema_lookup_import(v->sema, name);
+        }
+    }
+}
+
+// Reports a call to a single function which cannot take as many arguments as it was given.
+static void sema_report_argument_count(sema_view* v, ly_syntax_id call, ch_atom name, ly_type_id function, int64 arg_count) {
+    const ly_type* type = ly_type_get(&v->sema->types, function);
+    ch_atom_info name_info = ch_atom_get(&v->sema->atoms, name);
+    ch_diag(v->context, CH_DIAG_ERROR, sema_location(v, call), "'%.*s' takes %s%u argument%s, but %lld were given", cast(int) name_info.length, name_info.text,
+            type->varargs_kind == LY_VARARGS_C ? "at least " : "", type->operand, type->operand == 1 ? "" : "s", cast(long long) arg_count);
+}
+
+// Chooses the function a call to the overload set in `lookup` resolves to, reporting if there is not exactly one best candidate.
+static ly_decl_id sema_resolve_overload(sema_view* v, ly_scope* scope, ly_syntax_id call, ly_scope_lookup lookup) {
+    ly_syntax_node node = *sema_node(v, call);
+    ch_atom name = v->atoms[sema_node(v, node.lhs)->lhs];
+    ly_syntax_list args = ly_syntax_list_get(v->tree, node.rhs);
+
+    ly_type_id arg_type_buffer[SEMA_INLINE_ARG_COUNT];
+    ly_conversion conversion_buffer[2 * SEMA_INLINE_ARG_COUNT];
+
+    bool is_inline = args.count <= SEMA_INLINE_ARG_COUNT;
+    ly_type_id* arg_types = is_inline ? arg_type_buffer : ch_alloc(v->sema->allocator, args.count * cast(int64) sizeof *arg_types);
+    ly_conversion* conversions = is_inline ? conversion_buffer : ch_alloc(v->sema->allocator, 2 * args.count * cast(int64) sizeof *conversions);
+    ly_conversion* candidate_conversions = conversions + args.count;
+
+    for (int64 i = 0; i < args.count; i++) {
+        arg_types[i] = sema_argument_type(v, scope, args.items[i]);
+    }
+
+    ly_decl_ids candidates = {.allocator = v->sema->allocator};
+    ly_decl_id result = ly_overload_cache_find(&v->sema->overloads, lookup.decls.items[0], arg_types, args.count, conversions);
+    if (result != 0) goto defer;
+
+    sema_collect_candidates(v, lookup, name, &candidates);
+
+    ly_decl_id best = 0;
+    int64 viable_count = 0;
+    for (int64 i = 0; i < candidates.count; i++) {
+        ly_type_id function = ly_qual_type_id(ly_sema_decl_get(v->sema, candidates.items[i])->type);
+        // a candidate whose signature is already wrong was reported; guessing around it would only add noise.
+        if (function == LY_TY_POISON) goto defer;
+
+        if (!sema_candidate_conversions(v, function, arg_types, args.count, candidate_conversions)) continue;
+
+        viable_count++;
+        if (best == 0 || sema_conversions_better(candidate_conversions, conversions, args.count)) {
+            best = candidates.items[i];
+            memcpy(conversions, candidate_conversions, cast(usize) args.count * sizeof *conversions);
+        }
+    }
+
+    ch_atom_info name_info = ch_atom_get(&v->sema->atoms, name);
+    if (best == 0) {
+        if (candidates.count == 1) {
+            sema_report_argument_count(v, call, name, ly_qual_type_id(ly_sema_decl_get(v->sema, candidates.items[0])->type), args.count);
+        } else {
+            ch_diag(v->context, CH_DIAG_ERROR, sema_location(v, call), "no overload of '%.*s' takes %lld argument%s", cast(int) name_info.length, name_info.text,
+                    cast(long long) args.count, args.count == 1 ? "" : "s");
+        }
+
+        goto defer;
+    }
+
+    // the best candidate must be better than every other viable one, not merely found last.
+    for (int64 i = 0; i < candidates.count && viable_count > 1; i++) {
+        if (candidates.items[i] == best) continue;
+
+        ly_type_id function = ly_qual_type_id(ly_sema_decl_get(v->sema, candidates.items[i])->type);
+        if (!sema_candidate_conversions(v, function, arg_types, args.count, candidate_conversions)) continue;
+
+        if (!sema_conversions_better(conversions, candidate_conversions, args.count)) {
+            ch_diag(v->context, CH_DIAG_ERROR, sema_location(v, call), "call to '%.*s' is ambiguous", cast(int) name_info.length, name_info.text);
+            goto defer;
+        }
+    }
+
+    ly_overload_cache_add(&v->sema->overloads, lookup.decls.items[0], arg_types, args.count, best, conversions);
+    result = best;
+
+defer:
+    da_free(&candidates);
+    if (!is_inline) {
+        ch_dealloc(v->sema->allocator, arg_types);
+        ch_dealloc(v->sema->allocator, conversions);
+    }
+
+    return result;
+}
+
+// ======================================================================
+// Function bodies
+// ======================================================================
+
+typedef enum sema_action {
+    // analyse the node.
+    SEMA_VISIT,
+    // declare the binding once its initializer has been analysed, so the initializer cannot refer to it.
+    SEMA_DECLARE,
+    SEMA_LEAVE_SCOPE,
+} sema_action;
+
+typedef struct sema_work {
+    ly_syntax_id id;
+    sema_action action;
+} sema_work;
+
+typedef struct sema_works {
+    ch_allocator allocator;
+    sema_work* items;
+    int64 count, capacity;
+} sema_works;
+
+typedef struct sema_scopes {
+    ch_allocator allocator;
+    ly_scope** items;
+    int64 count, capacity;
+} sema_scopes;
+
+// The state of one body job. Scopes are reused as blocks are entered and left, and pending work is kept on an explicit stack
+// so that deeply nested expressions, such as long chains of binary operators, cannot overflow the thread's stack.
+typedef struct sema_body {
+    sema_view v;
+    sema_works work;
+    sema_scopes scopes;
+    // how many of `scopes` are in use; the first is the function's parameter scope.
+    int64 depth;
+    // what the function's parameter scope is in: the module scope, or the scope of a function template's parameters.
+    ly_scope* outer_scope;
+} sema_body;
+
+static ly_scope* sema_body_scope(sema_body* body) {
+    return body->scopes.items[body->depth - 1];
+}
+
+static void sema_body_enter_scope(sema_body* body) {
+    ly_scope* parent = body->depth == 0 ? body->outer_scope : sema_body_scope(body);
+    if (body->depth == body->scopes.count) {
+        ly_scope* scope = ch_alloc(body->v.sema->allocator, sizeof *scope);
+        ly_scope_init(scope, body->v.sema->allocator, parent);
+        da_push(&body->scopes, scope);
+    }
+
+    ly_scope* scope = body->scopes.items[body->depth++];
+    scope->parent = parent;
+    ly_scope_clear(scope);
+}
+
+// Opens the scope of a function's parameters, which nested functions open inside the scope they are declared in.
+static void sema_body_enter_function(sema_body* body, ly_decl_id function) {
+    sema_view* v = &body->v;
+    ly_syntax_node node = *sema_node(v, ly_sema_decl_get(v->sema, function)->syntax);
+
+    ly_type_id function_type = ly_qual_type_id(ly_sema_decl_get(v->sema, function)->type);
+
+    sema_body_enter_scope(body);
+
+    // parameter types were resolved with the signature, so they are taken from it rather than resolved, and reported, again.
+    ly_syntax_list params = ly_syntax_list_get(v->tree, sema_extra(v, node.lhs + 2));
+    for (int64 i = 0; i < params.count; i++) {
+        if (sema_node(v, params.items[i])->token_kind == LY_TK_VARARGS) continue;
+
+        ly_decl_id param = sema_declare(v, sema_body_scope(body), params.items[i]);
+        if (param == 0) continue;
+
+        ly_decl* decl = ly_sema_decl_get(v->sema, param);
+        decl->type = function_type == LY_TY_POISON ? sema_poison() : ly_type_function_param(&v->sema->types, function_type, i).type;
+        decl->state = LY_DS_RESOLVED;
+    }
+}
+
+static void sema_body_push(sema_body* body, ly_syntax_id id, sema_action action) {
+    if (id == 0) return;
+    sema_work work = {id, action};
+    da_push(&body->work, work);
+}
+
+// Pushes the children of a node so that they are visited in order.
+static void sema_body_push_children(sema_body* body, ly_syntax_id id) {
+    ly_syntax_id buffer[16];
+    int64 count = ly_syntax_children(body->v.tree, id, buffer, 16);
+
+    ly_syntax_id* children = buffer;
+    if (count > 16) {
+        children = ch_alloc(body->v.sema->allocator, count * cast(int64) sizeof *children);
+        discard ly_syntax_children(body->v.tree, id, children, count);
+    }
+
+    for (int64 i = count - 1; i >= 0; i--) {
+        sema_body_push(body, children[i], SEMA_VISIT);
+    }
+
+    if (children != buffer) ch_dealloc(body->v.sema->allocator, children);
+}
+
+static void sema_body_visit(sema_body* body, ly_syntax_id id) {
+    sema_view* v = &body->v;
+    ly_syntax_node node = *sema_node(v, id);
+
+    switch (cast(ly_syntax_kind) node.kind) {
+        default: {
+            sema_body_push_children(body, id);
+        } break;
+
+        case LY_SN_EXPR_NAMEREF: {
+            discard sema_lookup(v, sema_body_scope(body), id);
+        } break;
+
+        case LY_SN_TYPE_BUILTIN:
+        case LY_SN_TYPE_POINTER:
+        case LY_SN_TYPE_BUFFER:
+        case LY_SN_TYPE_SLICE:
+        case LY_SN_TYPE_ARRAY:
+        case LY_SN_TYPE_NILABLE:
+        case LY_SN_TYPE_RANGE:
+        case LY_SN_TYPE_MUT: {
+            discard sema_resolve_type(v, sema_body_scope(body), id);
+        } break;
+
+        case LY_SN_EXPR_TEMPLATE: {
+            discard sema_resolve_template(v, sema_body_scope(body), id);
+        } break;
+
+        case LY_SN_EXPR_CALL: {
+            ly_syntax_list args = ly_syntax_list_get(v->tree, node.rhs);
+            for (int64 i = args.count - 1; i >= 0; i--) {
+                sema_body_push(body, args.items[i], SEMA_VISIT);
+            }
+
+            ly_syntax_kind callee_kind = sema_node(v, node.lhs)->kind;
+            if (callee_kind == LY_SN_EXPR_TEMPLATE) {
+                // an instance is a single function, so there is nothing to choose between and only its arity to check.
+                ly_decl_id instance = sema_resolve_template(v, sema_body_scope(body), node.lhs);
+                ly_decl* function = instance != 0 ? ly_sema_decl_get(v->sema, instance) : NULL;
+                if (function == NULL || function->kind != LY_DK_FUNCTION || ly_qual_type_id(function->type) == LY_TY_POISON) break;
+
+                if (!sema_takes_argument_count(v, ly_qual_type_id(function->type), args.count)) {
+                    sema_report_argument_count(v, id, function->name, ly_qual_type_id(function->type), args.count);
+                }
+
+                break;
+            }
+
+            if (callee_kind != LY_SN_EXPR_NAMEREF) {
+                sema_body_push(body, node.lhs, SEMA_VISIT);
+                break;
+            }
+
+            ly_scope_lookup lookup = sema_lookup(v, sema_body_scope(body), node.lhs);
+            if (lookup.scope == NULL) break;
+
+            ly_decl* callee = ly_sema_decl_get(v->sema, lookup.decls.items[0]);
+            if (callee->kind == LY_DK_FUNCTION) {
+                discard sema_resolve_overload(v, sema_body_scope(body), id, lookup);
+            } else if (callee->kind == LY_DK_TEMPLATE) {
+                ch_atom_info name = ch_atom_get(&v->sema->atoms, callee->name);
+                ch_diag(v->context, CH_DIAG_ERROR, sema_location(v, id), "template arguments of '%.*s' cannot be deduced; give them explicitly, as in '%.*s<T>(...)'",
+                        cast(int) name.length, name.text, cast(int) name.length, name.text);
+            }
+        } break;
+
+        case LY_SN_EXPR_CAST: {
+            if (node.lhs != 0) discard sema_resolve_type(v, sema_body_scope(body), node.lhs);
+            sema_body_push(body, node.rhs, SEMA_VISIT);
+        } break;
+
+        case LY_SN_EXPR_CONSTRUCTOR: {
+            discard sema_resolve_type(v, sema_body_scope(body), node.lhs);
+            ly_syntax_list initializers = ly_syntax_list_get(v->tree, node.rhs);
+            for (int64 i = initializers.count - 1; i >= 0; i--) {
+                sema_body_push(body, initializers.items[i], SEMA_VISIT);
+            }
+        } break;
+
+        case LY_SN_STMT_COMPOUND: {
+            sema_body_enter_scope(body);
+            sema_body_push(body, id, SEMA_LEAVE_SCOPE);
+
+            // functions can be called anywhere in the block which declares them, including before their declaration.
+            ly_syntax_list statements = ly_syntax_list_get(v->tree, node.lhs);
+            for (int64 i = 0; i < statements.count; i++) {
+                if (sema_node(v, statements.items[i])->kind != LY_SN_DECL_FUNCTION) continue;
+                ly_decl_id function = sema_declare(v, sema_body_scope(body), statements.items[i]);
+                if (function != 0) sema_resolve_decl(v, sema_body_scope(body), function);
+            }
+
+            sema_body_push_children(body, id);
+        } break;
+
+        case LY_SN_STMT_FOR: {
+            sema_body_enter_scope(body);
+            sema_body_push(body, id, SEMA_LEAVE_SCOPE);
+            sema_body_push_children(body, id);
+        } break;
+
+        case LY_SN_DECL_BINDING: {
+            sema_body_push(body, id, SEMA_DECLARE);
+            sema_body_push(body, sema_extra(v, node.rhs + 1), SEMA_VISIT);
+        } break;
+
+        case LY_SN_DECL_STRUCT:
+        case LY_SN_DECL_ENUM:
+        case LY_SN_DECL_ALIAS: {
+            ly_decl_id decl = sema_declare(v, sema_body_scope(body), id);
+            if (decl == 0) break;
+
+            sema_resolve_decl(v, sema_body_scope(body), decl);
+
+            // a local struct's fields can only be resolved from where it is declared, so it is laid out there.
+            if (node.kind == LY_SN_DECL_STRUCT) {
+                discard sema_struct_layout(v, sema_body_scope(body), ly_qual_type_id(ly_sema_decl_get(v->sema, decl)->type));
+            }
+        } break;
+
+        case LY_SN_DECL_FUNCTION: {
+            // the block declared it on entry; find that declaration again rather than keeping a map for the rare nested function.
+            ly_decl_id function = 0;
+            ly_decl_view overloads = ly_scope_lookup_local(sema_body_scope(body), v->atoms[sema_extra(v, node.lhs + 1)]);
+            for (int64 i = 0; i < overloads.count && function == 0; i++) {
+                ly_decl* overload = ly_sema_decl_get(v->sema, overloads.items[i]);
+                if (overload->tree == v->tree_index && overload->syntax == id) function = overloads.items[i];
+            }
+
+            if (function != 0 && sema_extra(v, node.lhs + 3) != 0) {
+                sema_body_enter_function(body, function);
+                sema_body_push(body, id, SEMA_LEAVE_SCOPE);
+                sema_body_push(body, sema_extra(v, node.lhs + 3), SEMA_VISIT);
+            }
+        } break;
+
+        // the parser reported a template which is not at the top level, and it is never instantiated.
+        case LY_SN_DECL_TEMPLATE:
+        case LY_SN_DECL_IMPORT: break;
+    }
+}
+
+static void sema_body_run(sema_body* body, ly_decl_id function) {
+    sema_view* v = &body->v;
+    ly_syntax_node node = *sema_node(v, ly_sema_decl_get(v->sema, function)->syntax);
+
+    sema_body_enter_function(body, function);
+    sema_body_push(body, sema_extra(v, node.lhs + 3), SEMA_VISIT);
+    while (body->work.count > 0) {
+        sema_work work = body->work.items[--body->work.count];
+        switch (work.action) {
+            case SEMA_VISIT: sema_body_visit(body, work.id); break;
+            case SEMA_LEAVE_SCOPE: body->depth--; break;
+
+            case SEMA_DECLARE: {
+                ly_decl_id binding = sema_declare(v, sema_body_scope(body), work.id);
+                if (binding != 0) sema_resolve_decl(v, sema_body_scope(body), binding);
+            } break;
+        }
+    }
+
+    body->depth = 0;
+}
+
+typedef struct sema_bodies {
+    ly_sema* sema;
+    // one per function, so diagnostics can be merged in declaration order however the jobs were scheduled.
+    ch_context* contexts;
+} sema_bodies;
+
+static void sema_body_job(void* userdata, int64 index) {
+    sema_bodies* bodies = userdata;
+    ly_sema* sema = bodies->sema;
+    ly_sema_function function = sema->functions.items[index];
+
+    sema_body body = {
+        .v = sema_view_of(sema, &bodies->contexts[index], ly_sema_decl_get(sema, function.decl)->tree),
+        .work.allocator = sema->allocator,
+        .scopes.allocator = sema->allocator,
+        .outer_scope = function.scope != NULL ? function.scope : &sema->module_scope,
+    };
+
+    sema_body_run(&body, function.decl);
+
+    for (int64 i = 0; i < body.scopes.count; i++) {
+        ly_scope_deinit(body.scopes.items[i]);
+        ch_dealloc(sema->allocator, body.scopes.items[i]);
+    }
+
+    da_free(&body.scopes);
+    da_free(&body.work);
+}
+
+CHOIR_API void ly_sema_intern_strings(ly_sema* sema) {
+    for (int64 i = 0; i < sema->module->trees.count; i++) {
+        if (sema->tree_atoms[i] != NULL) continue;
+        sema_intern_tree_strings(sema, cast(uint32) i);
+    }
+}
+
+CHOIR_API void ly_sema_analyse(ly_sema* sema, ch_thread_pool* pool) {
+    ly_sema_intern_strings(sema);
+    sema_analyse_declarations(sema);
+
+    int64 function_count = sema->functions.count;
+    sema_bodies bodies = {
+        .sema = sema,
+        .contexts = ch_alloc(sema->allocator, function_count * cast(int64) sizeof(ch_context)),
+    };
+
+    for (int64 i = 0; i < function_count; i++) {
+        ch_context_init(&bodies.contexts[i], sema->context->allocator);
+        bodies.contexts[i].defer_diagnostics = true;
+    }
+
+    ch_thread_pool_run(pool, function_count, sema_body_job, &bodies);
+
+    for (int64 i = 0; i < function_count; i++) {
+        ch_diag_merge(sema->context, &bodies.contexts[i]);
+        ch_context_deinit(&bodies.contexts[i]);
+    }
+
+    ch_dealloc(sema->allocator, bodies.contexts);
+}
@@ -0,0 +1,119 @@
+#include <laye/laye.h>
+#include <string.h>
+
+#define LY_TEMPLATE_CACHE_INITIAL_SLOT_COUNT 64
+
+CHOIR_API void ly_template_cache_init(ly_template_cache* cache, ch_allocator allocator) {
+    *cache = (ly_template_cache){
+        .allocator = allocator,
+        .instances.allocator = allocator,
+        .args.allocator = allocator,
+        .slot_count = LY_TEMPLATE_CACHE_INITIAL_SLOT_COUNT,
+    };
+
+    ch_mutex_init(&cache->mutex, allocator);
+    cache->slots = ch_alloc(allocator, cache->slot_count * cast(int64) sizeof *cache->slots);
+    memset(cache->slots, 0, cast(usize) cache->slot_count * sizeof *cache->slots);
+}
+
+CHOIR_API void ly_template_cache_deinit(ly_template_cache* cache) {
+    ch_dealloc(cache->allocator, cache->slots);
+    da_free(&cache->instances);
+    da_free(&cache->args);
+    ch_mutex_deinit(&cache->mutex);
+    *cache = (ly_template_cache){0};
+}
+
+static uint64 ly_template_cache_hash(ly_decl_id template_decl, const ly_type_id* args, int64 arg_count) {
+    uint64 hash = ch_hash(&template_decl, sizeof template_decl, 0);
+    if (arg_count != 0) {
+        hash = ch_hash(args, arg_count * cast(int64) sizeof *args, hash);
+    }
+
+    return hash;
+}
+
+// Returns the slot holding the instance for these arguments, or the empty slot it would be stored in.
+static uint32* ly_template_cache_probe(ly_template_cache* cache, ly_decl_id template_decl, const ly_type_id* args, int64 arg_count, uint64 hash) {
+    int64 mask = cache->slot_count - 1;
+    for (int64 index = cast(int64)(hash & cast(uint64) mask);; index = (index + 1) & mask) {
+        uint32* slot = &cache->slots[index];
+        if (*slot == 0) {
+            return slot;
+        }
+
+        ly_template_instance* instance = &cache->instances.items[*slot - 1];
+        if (instance->template_decl == template_decl && instance->arg_count == arg_count &&
+            (arg_count == 0 || 0 == memcmp(cache->args.items + instance->args, args, cast(usize) arg_count * sizeof *args))) {
+            return slot;
+        }
+    }
+}
+
+static void ly_template_cache_grow(ly_template_cache* cache) {
+    ch_dealloc(cache->allocator, cache->slots);
+
+    cache->slot_count *= 2;
+    cache->slots = ch_alloc(cache->allocator, cache->slot_count * cast(int64) sizeof *cache->slots);
+    memset(cache->slots, 0, cast(usize) cache->slot_count * sizeof *cache->slots);
+
+    for (int64 i = 0; i < cache->instances.count; i++) {
+        ly_template_instance* instance = &cache->instances.items[i];
+        const ly_type_id* args = cache->args.items + instance->args;
+        uint64 hash = ly_template_cache_hash(instance->template_decl, args, instance->arg_count);
+        *ly_template_cache_probe(cache, instance->template_decl, args, instance->arg_count, hash) = cast(uint32)(i + 1);
+    }
+}
+
+CHOIR_API ly_decl_id ly_template_cache_find(ly_template_cache* cache, ly_decl_id template_decl, const ly_type_id* args, int64 arg_count, bool include_unpublished) {
+    uint64 hash = ly_template_cache_hash(template_decl, args, arg_count);
+
+    ch_mutex_lock(&cache->mutex);
+
+    ly_decl_id instance = 0;
+    uint32 slot = *ly_template_cache_probe(cache, template_decl, args, arg_count, hash);
+    if (slot != 0 && (include_unpublished || slot <= cache->published_count)) {
+        instance = cache->instances.items[slot - 1].instance;
+    }
+
+    ch_mutex_unlock(&cache->mutex);
+    return instance;
+}
+
+CHOIR_API void ly_template_cache_add(ly_template_cache* cache, ly_decl_id template_decl, const ly_type_id* args, int64 arg_count, ly_decl_id instance) {
+    assert(template_decl != 0 && instance != 0 && "template instances need both a template and the declaration instantiated from it");
+
+    uint64 hash = ly_template_cache_hash(template_decl, args, arg_count);
+
+    ch_mutex_lock(&cache->mutex);
+    assert(arg_count >= 0 && cache->args.count + arg_count <= UINT32_MAX && "too many template instances");
+
+    uint32* slot = ly_template_cache_probe(cache, template_decl, args, arg_count, hash);
+    assert(*slot == 0 && "templates are only instantiated once for the same arguments");
+
+    ly_template_instance record = {
+        .template_decl = template_decl,
+        .instance = instance,
+        .args = cast(uint32) cache->args.count,
+        .arg_count = cast(uint32) arg_count,
+    };
+
+    if (arg_count != 0) {
+        da_push_many(&cache->args, args, arg_count);
+    }
+
+    da_push(&cache->instances, record);
+    *slot = cast(uint32) cache->instances.count;
+
+    if (cache->instances.count * 2 > cache->slot_count) {
+        ly_template_cache_grow(cache);
+    }
+
+    ch_mutex_unlock(&cache->mutex);
+}
+
+CHOIR_API void ly_template_cache_publish(ly_template_cache* cache) {
+    ch_mutex_lock(&cache->mutex);
+    cache->published_count = cache->instances.count;
+    ch_mutex_unlock(&cache->mutex);
+}
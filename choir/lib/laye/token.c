@@ -1,11 +1,27 @@
 #include <laye/laye.h>
 
+const uint16 ly_token_kind_classes[LY_TK_COUNT] = {
+#define LY_TOKEN(Name, Classes) [LY_TK_##Name] = (Classes),
+#include <laye/tokens.inc>
+};
+
+#define LY_BINDING_POWER_LEFT(Precedence)  {.left = 2 * (Precedence), .right = 2 * (Precedence) + 1}
+#define LY_BINDING_POWER_RIGHT(Precedence) {.left = 2 * (Precedence) + 1, .right = 2 * (Precedence)}
+
+const ly_binding_power ly_token_kind_binding_powers[LY_TK_COUNT] = {
+#define LY_BINARY_OPERATOR(Name, Precedence, Associativity) [LY_TK_##Name] = LY_BINDING_POWER_##Associativity(Precedence),
+#include <laye/operators.inc>
+};
+
+#undef LY_BINDING_POWER_LEFT
+#undef LY_BINDING_POWER_RIGHT
+
 CHOIR_API const char* ly_token_kind_name_get(ly_token_kind kind) {
     switch (kind) {
         default: return "[unknown Laye source token kind]";
         // clang-format off
-#define LY_TOKEN(Name)   case LY_TK_##Name: return #Name;
-#define LY_TOKEN_MISSING case LY_TK_MISSING: return "MISSING";
+#define LY_TOKEN(Name, Classes) case LY_TK_##Name: return #Name;
+#define LY_TOKEN_MISSING        case LY_TK_MISSING: return "MISSING";
 #include <laye/tokens.inc>
         // clang-format on
     }
@@ -0,0 +1,251 @@
+#include <laye/laye.h>
+#include <string.h>
+
+#define LY_TYPE_INITIAL_SLOT_COUNT 1024
+// 4096 types or 65536 extra words per chunk, and up to 64M types and 1G extra words.
+#define LY_TYPE_CHUNK_SHIFT 12
+#define LY_TYPE_EXTRA_CHUNK_SHIFT 16
+#define LY_TYPE_MAX_CHUNK_COUNT (1 << 14)
+
+static_assert(sizeof(ly_type) == 16, "types should stay small; think twice before growing them");
+static_assert(LY_TY_COUNT <= 256, "type kinds must fit in a ly_type's kind field");
+
+static int64 ly_type_extra_count(const ly_type* type) {
+    switch (type->kind) {
+        default: return 0;
+        case LY_TY_ARRAY:
+        case LY_TY_FUNCTION: return 2 * cast(int64) type->operand;
+        case LY_TY_BUFFER: return (type->flags & LY_TF_TERMINATED) ? 2 : 0;
+    }
+}
+
+// Hashes everything which makes a type distinct: its fields other than where its extra words are, and the extra words themselves.
+static uint64 ly_type_hash(const ly_type* type, const uint32* extra, int64 extra_count) {
+    ly_type key = *type;
+    key.extra = 0;
+
+    uint64 hash = ch_hash(&key, sizeof key, 0);
+    if (extra_count != 0) {
+        hash = ch_hash(extra, extra_count * cast(int64) sizeof *extra, hash);
+    }
+
+    return hash;
+}
+
+static ly_type* ly_type_at(ly_type_store* store, ly_type_id id) {
+    return ch_stable_array_get(&store->types, id);
+}
+
+static uint32* ly_type_extra_at(ly_type_store* store, uint32 index) {
+    return ch_stable_array_get(&store->extra, index);
+}
+
+static bool ly_type_equals(ly_type_store* store, ly_type_id id, const ly_type* type, const uint32* extra, int64 extra_count) {
+    ly_type* existing = ly_type_at(store, id);
+
+    ly_type key = *type;
+    key.extra = existing->extra;
+    if (0 != memcmp(existing, &key, sizeof key)) {
+        return false;
+    }
+
+    return extra_count == 0 || 0 == memcmp(ly_type_extra_at(store, existing->extra), extra, cast(usize) extra_count * sizeof *extra);
+}
+
+static void ly_type_store_insert_slot(ly_type_store* store, ly_type_id id, uint64 hash) {
+    int64 mask = store->slot_count - 1;
+    int64 index = cast(int64)(hash & cast(uint64) mask);
+    while (store->slots[index] != 0) {
+        index = (index + 1) & mask;
+    }
+
+    store->slots[index] = id;
+}
+
+static void ly_type_store_grow(ly_type_store* store) {
+    ch_dealloc(store->allocator, store->slots);
+
+    store->slot_count *= 2;
+    store->slots = ch_alloc(store->allocator, store->slot_count * cast(int64) sizeof *store->slots);
+    memset(store->slots, 0, cast(usize) store->slot_count * sizeof *store->slots);
+
+    for (int64 id = LY_TY_LAST_SIMPLE + 1; id < store->types.count; id++) {
+        ly_type* type = ly_type_at(store, cast(ly_type_id) id);
+        int64 extra_count = ly_type_extra_count(type);
+        uint32* extra = extra_count == 0 ? NULL : ly_type_extra_at(store, type->extra);
+        ly_type_store_insert_slot(store, cast(ly_type_id) id, ly_type_hash(type, extra, extra_count));
+    }
+}
+
+// Returns the id of the type with the given fields and extra words, adding it to the store if it is not already there.
+static ly_type_id ly_type_intern(ly_type_store* store, ly_type type, const uint32* extra, int64 extra_count) {
+    assert(extra_count == ly_type_extra_count(&type) && "wrong number of extra words for type");
+
+    // hashing needs nothing shared, so it is done before taking the lock.
+    uint64 hash = ly_type_hash(&type, extra, extra_count);
+    ly_type_id id = 0;
+
+    ch_mutex_lock(&store->mutex);
+
+    int64 mask = store->slot_count - 1;
+    int64 index = cast(int64)(hash & cast(uint64) mask);
+    for (; store->slots[index] != 0; index = (index + 1) & mask) {
+        if (ly_type_equals(store, store->slots[index], &type, extra, extra_count)) {
+            id = store->slots[index];
+            goto unlock;
+        }
+    }
+
+    assert(store->types.count < (1ll << (32 - LY_TYPE_QUALIFIER_BITS)) && "too many types for a qualified type to hold");
+    assert(store->extra.count + extra_count <= UINT32_MAX && "too many extra words in type store");
+
+    type.extra = extra_count == 0 ? 0 : cast(uint32) ch_stable_array_push(&store->extra, extra, extra_count);
+
+    id = cast(ly_type_id) ch_stable_array_push(&store->types, &type, 1);
+    store->slots[index] = id;
+
+    int64 interned_count = store->types.count - (LY_TY_LAST_SIMPLE + 1);
+    if (interned_count * 2 > store->slot_count) {
+        ly_type_store_grow(store);
+    }
+
+unlock:
+    ch_mutex_unlock(&store->mutex);
+    return id;
+}
+
+CHOIR_API void ly_type_store_init(ly_type_store* store, ch_allocator allocator) {
+    *store = (ly_type_store){
+        .allocator = allocator,
+        .slot_count = LY_TYPE_INITIAL_SLOT_COUNT,
+    };
+
+    ch_mutex_init(&store->mutex, allocator);
+    ch_stable_array_init(&store->types, allocator, sizeof(ly_type), LY_TYPE_CHUNK_SHIFT, LY_TYPE_MAX_CHUNK_COUNT);
+    ch_stable_array_init(&store->extra, allocator, sizeof(uint32), LY_TYPE_EXTRA_CHUNK_SHIFT, LY_TYPE_MAX_CHUNK_COUNT);
+
+    store->slots = ch_alloc(allocator, store->slot_count * cast(int64) sizeof *store->slots);
+    memset(store->slots, 0, cast(usize) store->slot_count * sizeof *store->slots);
+
+    // simple types are never looked up by hash, since their id is already known from their kind.
+    for (int kind = LY_TY_INVALID; kind <= LY_TY_LAST_SIMPLE; kind++) {
+        ly_type type = {.kind = cast(uint8) kind};
+        discard ch_stable_array_push(&store->types, &type, 1);
+    }
+}
+
+CHOIR_API void ly_type_store_deinit(ly_type_store* store) {
+    ch_dealloc(store->allocator, store->slots);
+    ch_stable_array_deinit(&store->types);
+    ch_stable_array_deinit(&store->extra);
+    ch_mutex_deinit(&store->mutex);
+    *store = (ly_type_store){0};
+}
+
+CHOIR_API const ly_type* ly_type_get(ly_type_store* store, ly_type_id id) {
+    assert(id != 0 && "invalid type id");
+    return ly_type_at(store, id);
+}
+
+CHOIR_API ly_type_id ly_type_simple(ly_type_kind kind) {
+    assert(kind != LY_TY_INVALID && kind <= LY_TY_LAST_SIMPLE && "not a simple type kind");
+    return cast(ly_type_id) kind;
+}
+
+CHOIR_API ly_type_id ly_type_sized(ly_type_store* store, ly_type_kind kind, uint32 bit_width) {
+    assert(kind >= LY_TY_BOOL_SIZED && kind <= LY_TY_FLOAT_SIZED && "not a sized type kind");
+    assert(bit_width != 0 && "sized types cannot be zero bits wide");
+    return ly_type_intern(store, (ly_type){.kind = cast(uint8) kind, .operand = bit_width}, NULL, 0);
+}
+
+CHOIR_API ly_type_id ly_type_container(ly_type_store* store, ly_type_kind kind, ly_qual_type element) {
+    assert((kind == LY_TY_POINTER || kind == LY_TY_BUFFER || kind == LY_TY_NILABLE || kind == LY_TY_SLICE || kind == LY_TY_RANGE) && "not a single element container type kind");
+    assert(ly_qual_type_id(element) != 0 && "container types need an element type");
+    return ly_type_intern(store, (ly_type){.kind = cast(uint8) kind, .element = element}, NULL, 0);
+}
+
+CHOIR_API ly_type_id ly_type_buffer_terminated(ly_type_store* store, ly_qual_type element, uint64 terminator) {
+    assert(ly_qual_type_id(element) != 0 && "container types need an element type");
+    uint32 extra[2] = {cast(uint32) terminator, cast(uint32)(terminator >> 32)};
+    return ly_type_intern(store, (ly_type){.kind = LY_TY_BUFFER, .flags = LY_TF_TERMINATED, .element = element}, extra, 2);
+}
+
+CHOIR_API ly_type_id ly_type_array(ly_type_store* store, ly_qual_type element, const uint64* lengths, int64 dimension_count) {
+    assert(ly_qual_type_id(element) != 0 && "container types need an element type");
+    assert(dimension_count > 0 && dimension_count <= UINT32_MAX && "invalid number of array dimensions");
+
+    uint32 extra_buffer[16];
+    uint32* extra = dimension_count * 2 <= 16 ? extra_buffer : ch_alloc(store->allocator, dimension_count * 2 * cast(int64) sizeof *extra);
+    for (int64 i = 0; i < dimension_count; i++) {
+        extra[2 * i] = cast(uint32) lengths[i];
+        extra[2 * i + 1] = cast(uint32)(lengths[i] >> 32);
+    }
+
+    ly_type type = {.kind = LY_TY_ARRAY, .element = element, .operand = cast(uint32) dimension_count};
+    ly_type_id id = ly_type_intern(store, type, extra, dimension_count * 2);
+
+    if (extra != extra_buffer) ch_dealloc(store->allocator, extra);
+    return id;
+}
+
+CHOIR_API ly_type_id ly_type_error_pair(ly_type_store* store, ly_qual_type result, ly_qual_type error) {
+    assert(ly_qual_type_id(result) != 0 && ly_qual_type_id(error) != 0 && "error pairs need both a result and an error type");
+    return ly_type_intern(store, (ly_type){.kind = LY_TY_ERROR_PAIR, .element = result, .operand = error}, NULL, 0);
+}
+
+CHOIR_API ly_type_id ly_type_function(ly_type_store* store, ly_qual_type return_type, const ly_type_param* params, int64 param_count, ly_calling_convention calling_convention, ly_varargs_kind varargs_kind, ly_type_flag flags) {
+    assert(ly_qual_type_id(return_type) != 0 && "functions need a return type");
+    assert(param_count >= 0 && param_count <= UINT32_MAX && "invalid number of parameters");
+
+    uint32 extra_buffer[32];
+    uint32* extra = param_count * 2 <= 32 ? extra_buffer : ch_alloc(store->allocator, param_count * 2 * cast(int64) sizeof *extra);
+    for (int64 i = 0; i < param_count; i++) {
+        assert(ly_qual_type_id(params[i].type) != 0 && "parameters need a type");
+        extra[2 * i] = params[i].type;
+        extra[2 * i + 1] = cast(uint32) params[i].flags;
+    }
+
+    ly_type type = {
+        .kind = LY_TY_FUNCTION,
+        .calling_convention = cast(uint8) calling_convention,
+        .varargs_kind = cast(uint8) varargs_kind,
+        .flags = cast(uint8) flags,
+        .element = return_type,
+        .operand = cast(uint32) param_count,
+    };
+
+    ly_type_id id = ly_type_intern(store, type, extra, param_count * 2);
+
+    if (extra != extra_buffer) ch_dealloc(store->allocator, extra);
+    return id;
+}
+
+CHOIR_API ly_type_id ly_type_nominal(ly_type_store* store, ly_type_kind kind, ly_decl_id decl) {
+    assert((kind == LY_TY_STRUCT || kind == LY_TY_ENUM || kind == LY_TY_TEMPLATE_PARAMETER) && "not a nominal type kind");
+    assert(decl != 0 && "nominal types need a declaration");
+    return ly_type_intern(store, (ly_type){.kind = cast(uint8) kind, .operand = decl}, NULL, 0);
+}
+
+CHOIR_API uint64 ly_type_array_length(ly_type_store* store, ly_type_id array, int64 dimension) {
+    const ly_type* type = ly_type_get(store, array);
+    assert(type->kind == LY_TY_ARRAY && dimension >= 0 && dimension < type->operand && "invalid array dimension");
+
+    const uint32* words = ly_type_extra_at(store, type->extra) + 2 * dimension;
+    return cast(uint64) words[0] | (cast(uint64) words[1] << 32);
+}
+
+CHOIR_API uint64 ly_type_buffer_terminator(ly_type_store* store, ly_type_id buffer) {
+    const ly_type* type = ly_type_get(store, buffer);
+    assert(type->kind == LY_TY_BUFFER && (type->flags & LY_TF_TERMINATED) && "not a terminated buffer type");
+
+    const uint32* words = ly_type_extra_at(store, type->extra);
+    return cast(uint64) words[0] | (cast(uint64) words[1] << 32);
+}
+
+CHOIR_API ly_type_param ly_type_function_param(ly_type_store* store, ly_type_id function, int64 index) {
+    const ly_type* type = ly_type_get(store, function);
+    assert(type->kind == LY_TY_FUNCTION && index >= 0 && index < type->operand && "invalid function parameter");
+
+    const uint32* words = ly_type_extra_at(store, type->extra) + 2 * index;
+    return (ly_type_param){words[0], cast(ly_param_flag) words[1]};
+}
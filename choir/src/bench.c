@@ -0,0 +1,423 @@
+#include <cc/cc.h>
+#include <laye/laye.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifndef BUILD_VERSION
+#    define BUILD_VERSION "<unknown>"
+#endif // BUILD_VERSION
+
+static const char* help_text =
+    "Choir Front End Benchmarks Version %s\n"
+    "\n"
+    "Usage: %s lex [options]\n"
+    "\n"
+    "Options:\n"
+    "  --size <MiB>         Approximate size of each synthetic corpus. Defaults to 16.\n"
+    "  --iterations <N>     Number of times each corpus is lexed. Defaults to 10.\n"
+    "  --trivia             Preserve trivia while lexing.\n"
+    "  --help               Print this help text and exit.\n";
+
+// Forwards to another allocator, counting the calls made through it.
+typedef struct bench_counting_allocator {
+    ch_allocator inner;
+    int64 allocation_count;
+    int64 allocated_bytes;
+} bench_counting_allocator;
+
+typedef struct bench_lex_result {
+    int64 token_count;
+    int64 token_allocation_count;
+    int64 heap_allocation_count;
+    double seconds;
+} bench_lex_result;
+
+typedef struct bench_options {
+    int64 corpus_size;
+    int64 iterations;
+    bool preserve_trivia;
+} bench_options;
+
+static ch_allocator bench_counting_allocator_get(bench_counting_allocator* counter);
+
+static void bench_generate_laye(ch_string* text, int64 size);
+static void bench_generate_c(ch_string* text, int64 size);
+
+static bench_lex_result bench_lex_laye(ch_context* context, ch_source* source, ch_allocator default_allocator, bench_options options);
+static bench_lex_result bench_lex_c(ch_context* context, ch_source* source, ch_allocator default_allocator, bench_options options);
+static void bench_report(const char* name, ch_source* source, bench_options options, bench_lex_result result);
+
+int main(int argc, char** argv) {
+    int result = 0;
+
+    const char* program_name = argv[0];
+    bench_options options = {
+        .corpus_size = 16 * 1024 * 1024,
+        .iterations = 10,
+    };
+
+    if (argc < 2 || 0 != strcmp(argv[1], "lex")) {
+        fprintf(stderr, help_text, BUILD_VERSION, program_name);
+        return 1;
+    }
+
+    for (int i = 2; i < argc; i++) {
+        if (0 == strcmp(argv[i], "--size") && i + 1 < argc) {
+            options.corpus_size = atoll(argv[++i]) * 1024 * 1024;
+        } else if (0 == strcmp(argv[i], "--iterations") && i + 1 < argc) {
+            options.iterations = atoll(argv[++i]);
+        } else if (0 == strcmp(argv[i], "--trivia")) {
+            options.preserve_trivia = true;
+        } else if (0 == strcmp(argv[i], "--help")) {
+            fprintf(stderr, help_text, BUILD_VERSION, program_name);
+            return 0;
+        } else {
+            fprintf(stderr, "%s: unknown option '%s'\n", program_name, argv[i]);
+            return 1;
+        }
+    }
+
+    if (options.corpus_size <= 0 || options.iterations <= 0) {
+        fprintf(stderr, "%s: the corpus size and iteration count must both be positive\n", program_name);
+        return 1;
+    }
+
+    ch_allocator default_allocator = ch_general_purpose_allocator();
+
+    ch_context context = {0};
+    ch_context_init(&context, default_allocator);
+
+    ch_string laye_text = {.allocator = default_allocator};
+    bench_generate_laye(&laye_text, options.corpus_size);
+    ch_source laye_source = {
+        .name = "<synthetic laye>",
+        .text = laye_text.items,
+        .length = laye_text.count - 1,
+    };
+
+    ch_string c_text = {.allocator = default_allocator};
+    bench_generate_c(&c_text, options.corpus_size);
+    ch_source c_source = {
+        .name = "<synthetic c>",
+        .text = c_text.items,
+        .length = c_text.count - 1,
+    };
+
+    bench_report("ly_lex", &laye_source, options, bench_lex_laye(&context, &laye_source, default_allocator, options));
+    bench_report("cc_lex", &c_source, options, bench_lex_c(&context, &c_source, default_allocator, options));
+
+    if (context.has_issued_diagnostics) {
+        fprintf(stderr, "the synthetic corpora should lex without diagnostics\n");
+        return_defer(1);
+    }
+
+defer:;
+    ch_diag_flush(&context);
+    da_free(&laye_text);
+    da_free(&c_text);
+    ch_context_deinit(&context);
+    ch_allocator_deinit(default_allocator);
+    return result;
+}
+
+static double bench_now(void) {
+    struct timespec now = {0};
+    timespec_get(&now, TIME_UTC);
+    return cast(double) now.tv_sec + cast(double) now.tv_nsec / 1e9;
+}
+
+static bench_lex_result bench_lex_laye(ch_context* context, ch_source* source, ch_allocator default_allocator, bench_options options) {
+    bench_lex_result result = {0};
+    ly_lex_flag flags = options.preserve_trivia ? LY_LEX_PRESERVE_TRIVIA : LY_LEX_NONE;
+
+    for (int64 i = 0; i < options.iterations; i++) {
+        bench_counting_allocator heap_counter = {.inner = default_allocator};
+        ch_arena token_arena = {0};
+        ch_arena_init(&token_arena, bench_counting_allocator_get(&heap_counter), 4096 * sizeof(ly_token));
+
+        bench_counting_allocator token_counter = {.inner = ch_arena_allocator(&token_arena)};
+
+        // validation is part of lexing a fresh source, so don't let the first iteration hide it from the rest.
+        source->is_utf8_validated = false;
+
+        double start = bench_now();
+        ly_token* tokens = ly_lex(context, source, bench_counting_allocator_get(&token_counter), flags);
+        result.seconds += bench_now() - start;
+
+        for (ly_token* token = tokens; token != NULL; token = token->next) {
+            result.token_count++;
+        }
+
+        result.token_allocation_count += token_counter.allocation_count;
+        result.heap_allocation_count += heap_counter.allocation_count;
+        ch_arena_deinit(&token_arena);
+    }
+
+    return result;
+}
+
+static bench_lex_result bench_lex_c(ch_context* context, ch_source* source, ch_allocator default_allocator, bench_options options) {
+    bench_lex_result result = {0};
+    cc_lex_flag flags = options.preserve_trivia ? CC_LEX_PRESERVE_TRIVIA : CC_LEX_NONE;
+
+    for (int64 i = 0; i < options.iterations; i++) {
+        bench_counting_allocator heap_counter = {.inner = default_allocator};
+        ch_arena token_arena = {0};
+        ch_arena_init(&token_arena, bench_counting_allocator_get(&heap_counter), 4096 * sizeof(cc_token));
+
+        bench_counting_allocator token_counter = {.inner = ch_arena_allocator(&token_arena)};
+        source->is_utf8_validated = false;
+
+        double start = bench_now();
+        cc_token* tokens = cc_lex(context, source, bench_counting_allocator_get(&token_counter), flags);
+        result.seconds += bench_now() - start;
+
+        for (cc_token* token = tokens; token != NULL; token = token->next) {
+            result.token_count++;
+        }
+
+        result.token_allocation_count += token_counter.allocation_count;
+        result.heap_allocation_count += heap_counter.allocation_count;
+        ch_arena_deinit(&token_arena);
+    }
+
+    return result;
+}
+
+static void bench_report(const char* name, ch_source* source, bench_options options, bench_lex_result result) {
+    double megabytes = cast(double) source->length * cast(double) options.iterations / (1024.0 * 1024.0);
+    double seconds = result.seconds > 0 ? result.seconds : 1e-9;
+    double tokens = result.token_count > 0 ? cast(double) result.token_count : 1;
+
+    printf("%s: %.2f MiB x %lld in %.3fs\n", name, cast(double) source->length / (1024.0 * 1024.0), cast(long long) options.iterations, result.seconds);
+    printf("  %10.2f MiB/s\n", megabytes / seconds);
+    printf("  %10.0f tokens/s (%lld tokens per iteration)\n", tokens / seconds, cast(long long)(result.token_count / options.iterations));
+    printf("  %10.3f token allocations/token\n", cast(double) result.token_allocation_count / tokens);
+    printf("  %10.5f heap allocations/token\n", cast(double) result.heap_allocation_count / tokens);
+}
+
+static void* bench_counting_allocator_alloc(void* self, int64 size) {
+    bench_counting_allocator* counter = self;
+    counter->allocation_count++;
+    counter->allocated_bytes += size;
+    return ch_alloc(counter->inner, size);
+}
+
+static void* bench_counting_allocator_realloc(void* self, void* memory, int64 size) {
+    bench_counting_allocator* counter = self;
+    counter->allocation_count++;
+    counter->allocated_bytes += size;
+    return ch_realloc(counter->inner, memory, size);
+}
+
+static void bench_counting_allocator_dealloc(void* self, void* memory) {
+    bench_counting_allocator* counter = self;
+    ch_dealloc(counter->inner, memory);
+}
+
+static void bench_counting_allocator_deinit(void* self) {
+    bench_counting_allocator* counter = self;
+    discard counter;
+}
+
+static ch_allocator bench_counting_allocator_get(bench_counting_allocator* counter) {
+    return (ch_allocator){
+        .vtable = {
+            .alloc = bench_counting_allocator_alloc,
+            .realloc = bench_counting_allocator_realloc,
+            .dealloc = bench_counting_allocator_dealloc,
+            .deinit = bench_counting_allocator_deinit,
+        },
+        .userdata = counter,
+    };
+}
+
+// The corpora only need to be the same from run to run, not good random numbers.
+static uint64 bench_random_state = 0x9E3779B97F4A7C15ull;
+
+static uint64 bench_random(void) {
+    bench_random_state ^= bench_random_state << 13;
+    bench_random_state ^= bench_random_state >> 7;
+    bench_random_state ^= bench_random_state << 17;
+    return bench_random_state;
+}
+
+static void bench_append(ch_string* text, const char* format, ...) {
+    va_list v;
+
+    va_start(v, format);
+    int length = vsnprintf(NULL, 0, format, v);
+    va_end(v);
+
+    char buffer[1024];
+    assert(length >= 0 && cast(usize) length < sizeof buffer && "bench_append is only meant for short pieces of text");
+
+    va_start(v, format);
+    vsnprintf(buffer, sizeof buffer, format, v);
+    va_end(v);
+
+    da_push_many(text, buffer, length);
+}
+
+static void bench_append_indent(ch_string* text, int depth) {
+    for (int i = 0; i < depth; i++) {
+        bench_append(text, "    ");
+    }
+}
+
+static void bench_append_string_body(ch_string* text, int64 length) {
+    static const char* words[] = {"lorem", "ipsum", "dolor", "sit", "amet", "\\n", "\\t", "\\\"quoted\\\"", "caf\xC3\xA9", "\xE6\x97\xA5\xE6\x9C\xAC"};
+    int64 start = text->count;
+    while (text->count - start < length) {
+        bench_append(text, "%s ", words[bench_random() % (sizeof words / sizeof *words)]);
+    }
+}
+
+static void bench_generate_laye_nested(ch_string* text, int depth, int max_depth) {
+    if (depth == max_depth) {
+        bench_append_indent(text, depth);
+        bench_append(text, "x = x * 31 + (y << 2) - 10#%llu;\n", cast(unsigned long long)(bench_random() % 100000));
+        return;
+    }
+
+    bench_append_indent(text, depth);
+    switch (bench_random() % 3) {
+        default: bench_append(text, "if (x < y and not done) {\n"); break;
+        case 1: bench_append(text, "while (x != y) {\n"); break;
+        case 2: bench_append(text, "for (mut int i = 0; i < %d; i += 1) {\n", depth + 1); break;
+    }
+
+    bench_generate_laye_nested(text, depth + 1, max_depth);
+
+    bench_append_indent(text, depth);
+    bench_append(text, "}\n");
+}
+
+static void bench_generate_laye(ch_string* text, int64 size) {
+    int64 index = 0;
+    while (text->count < size) {
+        bench_append(text, "// item %lld\n", cast(long long) index);
+        switch (index % 4) {
+            default: {
+                // deep nesting
+                bench_append(text, "export int nested_%lld(int x, int y) {\n", cast(long long) index);
+                bench_append(text, "    mut bool done = false;\n");
+                bench_generate_laye_nested(text, 1, 24);
+                bench_append(text, "    return x;\n}\n\n");
+            } break;
+
+            case 1: {
+                // keyword-heavy declarations
+                bench_append(text, "struct record_%lld {\n", cast(long long) index);
+                bench_append(text, "    int32 id;\n    uint64 flags;\n    bool8 enabled;\n    float64 weight;\n    i8[] name;\n");
+                bench_append(text, "}\n\n");
+                bench_append(text, "enum kind_%lld : uint16 { first, second = 2, third, }\n\n", cast(long long) index);
+                bench_append(text, "alias handle_%lld = record_%lld mut*;\n\n", cast(long long) index, cast(long long) index);
+                bench_append(text, "inline discardable int query_%lld(handle_%lld h) {\n", cast(long long) index, cast(long long) index);
+                bench_append(text, "    defer discard sizeof(record_%lld);\n", cast(long long) index);
+                bench_append(text, "    switch (h.id) { case 0: return 1; default: break; }\n");
+                bench_append(text, "    return cast(int) h.flags;\n}\n\n");
+            } break;
+
+            case 2: {
+                // long strings
+                bench_append(text, "global i8[] message_%lld = \"", cast(long long) index);
+                bench_append_string_body(text, 200 + cast(int64)(bench_random() % 800));
+                bench_append(text, "\";\n\n");
+            } break;
+
+            case 3: {
+                // huge numeric tables
+                bench_append(text, "global uint64[256] table_%lld = var {\n", cast(long long) index);
+                for (int i = 0; i < 256; i++) {
+                    uint64 value = bench_random();
+                    switch (i % 4) {
+                        default: bench_append(text, "    %llu,\n", cast(unsigned long long)(value >> 1)); break;
+                        case 1: bench_append(text, "    16#%llX,\n", cast(unsigned long long) value); break;
+                        case 2: bench_append(text, "    2#%s,\n", (value & 1) ? "1010_0101_1111_0000" : "1"); break;
+                        case 3: bench_append(text, "    1_000_%03llu,\n", cast(unsigned long long)(value % 1000)); break;
+                    }
+                }
+                bench_append(text, "};\n\n");
+            } break;
+        }
+
+        index++;
+    }
+
+    da_push(text, '\0');
+}
+
+static void bench_generate_c_nested(ch_string* text, int depth, int max_depth) {
+    if (depth == max_depth) {
+        bench_append_indent(text, depth);
+        bench_append(text, "x = x * 31 + (y << 2) - %lluu;\n", cast(unsigned long long)(bench_random() % 100000));
+        return;
+    }
+
+    bench_append_indent(text, depth);
+    switch (bench_random() % 3) {
+        default: bench_append(text, "if (x < y && !done) {\n"); break;
+        case 1: bench_append(text, "while (x != y) {\n"); break;
+        case 2: bench_append(text, "for (int i = 0; i < %d; i++) {\n", depth + 1); break;
+    }
+
+    bench_generate_c_nested(text, depth + 1, max_depth);
+
+    bench_append_indent(text, depth);
+    bench_append(text, "}\n");
+}
+
+static void bench_generate_c(ch_string* text, int64 size) {
+    bench_append(text, "#include <stdint.h>\n#include <stdbool.h>\n\n");
+
+    int64 index = 0;
+    while (text->count < size) {
+        bench_append(text, "/* item %lld */\n", cast(long long) index);
+        switch (index % 4) {
+            default: {
+                bench_append(text, "int nested_%lld(int x, int y) {\n", cast(long long) index);
+                bench_append(text, "    bool done = false;\n");
+                bench_generate_c_nested(text, 1, 24);
+                bench_append(text, "    return x;\n}\n\n");
+            } break;
+
+            case 1: {
+                bench_append(text, "typedef struct record_%lld {\n", cast(long long) index);
+                bench_append(text, "    int32_t id;\n    unsigned long long flags;\n    _Bool enabled;\n    double weight;\n    const char* name;\n");
+                bench_append(text, "} record_%lld;\n\n", cast(long long) index);
+                bench_append(text, "enum kind_%lld { KIND_%lld_FIRST, KIND_%lld_SECOND = 2, };\n\n", cast(long long) index, cast(long long) index, cast(long long) index);
+                bench_append(text, "static inline int query_%lld(const volatile record_%lld* restrict h) {\n", cast(long long) index, cast(long long) index);
+                bench_append(text, "    switch (h->id) { case 0: return 1; default: break; }\n");
+                bench_append(text, "    return (int)h->flags + (int)sizeof(record_%lld);\n}\n\n", cast(long long) index);
+            } break;
+
+            case 2: {
+                bench_append(text, "static const char message_%lld[] = \"", cast(long long) index);
+                bench_append_string_body(text, 200 + cast(int64)(bench_random() % 800));
+                bench_append(text, "\";\n\n");
+            } break;
+
+            case 3: {
+                bench_append(text, "static const uint64_t table_%lld[256] = {\n", cast(long long) index);
+                for (int i = 0; i < 256; i++) {
+                    uint64 value = bench_random();
+                    switch (i % 4) {
+                        default: bench_append(text, "    %lluull,\n", cast(unsigned long long)(value >> 1)); break;
+                        case 1: bench_append(text, "    0x%llXull,\n", cast(unsigned long long) value); break;
+                        case 2: bench_append(text, "    0b%s,\n", (value & 1) ? "1010010111110000" : "1"); break;
+                        case 3: bench_append(text, "    1'000'%03llu,\n", cast(unsigned long long)(value % 1000)); break;
+                    }
+                }
+                bench_append(text, "};\n\n");
+            } break;
+        }
+
+        index++;
+    }
+
+    da_push(text, '\0');
+}
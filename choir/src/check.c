@@ -0,0 +1,2249 @@
+#include <laye/laye.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef BUILD_VERSION
+#    define BUILD_VERSION "<unknown>"
+#endif // BUILD_VERSION
+
+static const char* help_text =
+    "Choir Front End Checks Version %s\n"
+    "\n"
+    "Usage: %s <check> [<file>...]\n"
+    "\n"
+    "Checks:\n"
+    "  reparse <file>...    Applies small edits at every offset of each Laye file, and checks that updating the tokens\n"
+    "                       and tree with ly_relex and ly_reparse gives the same result as lexing and parsing the edited\n"
+    "                       text from scratch.\n"
+    "  statements           Checks that statements beginning with a type are parsed as declarations, and that those\n"
+    "                       beginning with an expression are not.\n"
+    "  integers             Lexes binary, decimal and hex integer literals around the 8 and 16 digit chunk boundaries,\n"
+    "                       with separators, and around 2^64 and 2^256, and checks each value against one decoded a digit\n"
+    "                       at a time as wide integers are.\n"
+    "  scopes               Declares names in nested scopes, shadowing and overloading them, and checks every lookup\n"
+    "                       against a plain list of what each scope declares.\n"
+    "  types                Builds random types twice over, once from several threads at a time, and checks that equal\n"
+    "                       types always get the same id, and that every id reads back as the type it was built from.\n"
+    "  constants            Evaluates random integer expressions around the edges of 64 and 256 bits and compares each\n"
+    "                       result, overflow and error with the same arithmetic done in wide integers throughout.\n"
+    "  overloads            Checks that the overload cache finds exactly what was added to it, and that every call in a\n"
+    "                       module resolves the same as when it is the only call, and so nothing was cached for it yet.\n"
+    "  layouts              Lays out random structs for every target in targets.inc and compares each size, alignment\n"
+    "                       and field offset with C's rules applied to that target's table.\n"
+    "  modules [path]       Writes a module file to path, or choir-check.mod, imports a few of its declarations and checks\n"
+    "                       that only those, and what their types name, were decoded from the mapped file, which\n"
+    "                       every table, record and name must still point into.\n"
+    "  templates [path]     Instantiates a few templates from many functions and checks each distinct instance is made\n"
+    "                       once, then writes a module file to path, or choir-check-templates.mod, and checks that an\n"
+    "                       importer is given the instances it persisted.\n";
+
+// The edits tried at every offset. Each is either an insertion or the removal of one byte.
+typedef struct check_edit {
+    const char* inserted_text;
+    int64 removed_length;
+} check_edit;
+
+static const check_edit check_edits[] = {
+    {" ", 0},
+    {"x", 0},
+    {"1", 0},
+    {";", 0},
+    {"(", 0},
+    {"{", 0},
+    {"}", 0},
+    {"/*", 0},
+    {"//", 0},
+    {"\"", 0},
+    {"", 1},
+};
+
+typedef struct check_pair {
+    ly_syntax_id lhs;
+    ly_syntax_id rhs;
+} check_pair;
+
+typedef struct check_pairs {
+    ch_allocator allocator;
+    check_pair* items;
+    int64 count, capacity;
+} check_pairs;
+
+// Each check reports its own failures, and returns how many of its cases there were through `out_count`.
+typedef int64 (*check_function)(int argc, char** argv, ch_allocator allocator, int64* out_count);
+
+typedef struct check_command {
+    const char* name;
+    check_function function;
+    const char* what;
+} check_command;
+
+static int64 check_reparse(int argc, char** argv, ch_allocator allocator, int64* out_count);
+static int64 check_statements(int argc, char** argv, ch_allocator allocator, int64* out_count);
+static int64 check_integers(int argc, char** argv, ch_allocator allocator, int64* out_count);
+static int64 check_scopes(int argc, char** argv, ch_allocator allocator, int64* out_count);
+static int64 check_types(int argc, char** argv, ch_allocator allocator, int64* out_count);
+static int64 check_constants(int argc, char** argv, ch_allocator allocator, int64* out_count);
+static int64 check_overloads(int argc, char** argv, ch_allocator allocator, int64* out_count);
+static int64 check_layouts(int argc, char** argv, ch_allocator allocator, int64* out_count);
+static int64 check_modules(int argc, char** argv, ch_allocator allocator, int64* out_count);
+static int64 check_templates(int argc, char** argv, ch_allocator allocator, int64* out_count);
+
+static const check_command check_commands[] = {
+    {"reparse", check_reparse, "files"},
+    {"statements", check_statements, "statements"},
+    {"integers", check_integers, "literals"},
+    {"scopes", check_scopes, "lookups"},
+    {"types", check_types, "types"},
+    {"constants", check_constants, "expressions"},
+    {"overloads", check_overloads, "resolutions"},
+    {"layouts", check_layouts, "structs"},
+    {"modules", check_modules, "declarations"},
+    {"templates", check_templates, "uses"},
+};
+
+int main(int argc, char** argv) {
+    int result = 0;
+
+    const char* program_name = argv[0];
+    const check_command* command = NULL;
+    for (int64 i = 0; argc >= 2 && i < cast(int64)(sizeof check_commands / sizeof check_commands[0]); i++) {
+        if (0 == strcmp(argv[1], check_commands[i].name)) {
+            command = &check_commands[i];
+        }
+    }
+
+    if (command == NULL) {
+        fprintf(stderr, help_text, BUILD_VERSION, program_name);
+        return 1;
+    }
+
+    ch_allocator default_allocator = ch_general_purpose_allocator();
+
+    int64 count = 0;
+    int64 failure_count = command->function(argc - 2, argv + 2, default_allocator, &count);
+    if (failure_count > 0) {
+        fprintf(stderr, "%s: %lld of %lld %s failed\n", command->name, cast(long long) failure_count, cast(long long) count, command->what);
+        return_defer(1);
+    }
+
+    fprintf(stderr, "%s: %lld %s passed\n", command->name, cast(long long) count, command->what);
+
+defer:;
+    ch_allocator_deinit(default_allocator);
+    return result;
+}
+
+// Diagnostics are not compared, only the tokens and trees, so the contexts used here throw theirs away.
+static ly_token* check_lex(ch_source* source, ch_allocator token_allocator, ch_allocator allocator) {
+    ch_context context = {0};
+    ch_context_init(&context, allocator);
+    context.defer_diagnostics = true;
+
+    ly_token* tokens = ly_lex(&context, source, token_allocator, LY_LEX_NONE);
+
+    ch_diag_discard(&context);
+    ch_context_deinit(&context);
+    return tokens;
+}
+
+static void check_parse(ly_syntax_tree* tree, ch_source* source, ch_allocator token_allocator, ch_allocator allocator) {
+    ch_context context = {0};
+    ch_context_init(&context, allocator);
+    context.defer_diagnostics = true;
+
+    ly_lexer lexer = {0};
+    ly_lexer_init(&lexer, &context, source, token_allocator, LY_LEX_NONE);
+    ly_syntax_tree_init(tree, allocator, source);
+    ly_parse(&context, tree, &lexer);
+
+    ch_diag_discard(&context);
+    ch_context_deinit(&context);
+}
+
+// Returns the first token which differs between two lists, or NULL if they match.
+static ly_token* check_tokens_match(ly_token* lhs, ly_token* rhs) {
+    while (lhs != NULL && rhs != NULL) {
+        if (lhs->kind != rhs->kind || lhs->location.offset != rhs->location.offset || lhs->location.length != rhs->location.length) {
+            return lhs;
+        }
+
+        lhs = lhs->next;
+        rhs = rhs->next;
+    }
+
+    return lhs != rhs ? (lhs != NULL ? lhs : rhs) : NULL;
+}
+
+// Returns the first node of `lhs` which differs from its counterpart in `rhs`, or 0 if the trees match.
+static ly_syntax_id check_trees_match(ly_syntax_tree* lhs, ly_syntax_tree* rhs, ch_allocator allocator) {
+    check_pairs stack = {.allocator = allocator};
+    ly_syntax_id lhs_children[64];
+    ly_syntax_id rhs_children[64];
+    ly_syntax_id mismatch = 0;
+
+    da_push(&stack, ((check_pair){lhs->root, rhs->root}));
+    while (stack.count > 0 && mismatch == 0) {
+        check_pair pair = stack.items[--stack.count];
+        ly_syntax_node* lhs_node = ly_syntax_get(lhs, pair.lhs);
+        ly_syntax_node* rhs_node = ly_syntax_get(rhs, pair.rhs);
+
+        if (lhs_node->kind != rhs_node->kind || lhs_node->token_kind != rhs_node->token_kind || lhs_node->flags != rhs_node->flags ||
+            lhs_node->offset != rhs_node->offset || lhs_node->length != rhs_node->length) {
+            mismatch = pair.lhs;
+            break;
+        }
+
+        int64 lhs_count = ly_syntax_children(lhs, pair.lhs, lhs_children, 64);
+        int64 rhs_count = ly_syntax_children(rhs, pair.rhs, rhs_children, 64);
+        if (lhs_count != rhs_count || lhs_count > 64) {
+            // wider nodes than these test files have are only compared by their child count.
+            if (lhs_count != rhs_count) mismatch = pair.lhs;
+            continue;
+        }
+
+        for (int64 i = 0; i < lhs_count; i++) {
+            da_push(&stack, ((check_pair){lhs_children[i], rhs_children[i]}));
+        }
+    }
+
+    da_free(&stack);
+    return mismatch;
+}
+
+static char* check_read_file(const char* path, ch_allocator allocator, int64* out_length) {
+    ch_mapped_file file = {0};
+    if (!ch_file_map(&file, path)) return NULL;
+
+    char* text = ch_alloc(allocator, file.size + 1);
+    if (file.size > 0) memcpy(text, file.data, cast(size_t) file.size);
+    text[file.size] = 0;
+    *out_length = file.size;
+
+    ch_file_unmap(&file);
+    return text;
+}
+
+// Runs one edit both ways, returning false and reporting the difference if they disagree.
+static bool check_reparse_edit(const char* path, ch_source original, ch_source_edit edit, ch_allocator allocator) {
+    bool result = true;
+
+    ch_arena arena = {0};
+    ch_arena_init(&arena, allocator, 64 * 1024);
+    ch_allocator arena_allocator = ch_arena_allocator(&arena);
+
+    ch_source incremental_source = original;
+    ly_token* incremental_tokens = check_lex(&incremental_source, arena_allocator, allocator);
+    ly_syntax_tree incremental_tree = {0};
+    check_parse(&incremental_tree, &incremental_source, arena_allocator, allocator);
+
+    ch_source_apply_edit(&incremental_source, edit, arena_allocator);
+
+    ch_context context = {0};
+    ch_context_init(&context, allocator);
+    context.defer_diagnostics = true;
+    incremental_tokens = ly_relex(&context, &incremental_source, incremental_tokens, edit, arena_allocator, LY_LEX_NONE);
+    ly_reparse(&context, &incremental_tree, incremental_tokens, edit);
+    ch_diag_discard(&context);
+    ch_context_deinit(&context);
+
+    ch_source full_source = {
+        .name = original.name,
+        .text = incremental_source.text,
+        .length = incremental_source.length,
+    };
+
+    ly_token* full_tokens = check_lex(&full_source, arena_allocator, allocator);
+    ly_syntax_tree full_tree = {0};
+    check_parse(&full_tree, &full_source, arena_allocator, allocator);
+
+    const char* edit_text = edit.removed_length > 0 ? "removing a byte" : "inserting";
+    ly_token* token = check_tokens_match(incremental_tokens, full_tokens);
+    if (token != NULL) {
+        fprintf(stderr, "%s: %s '%.*s' at offset %lld: relexed token %s at <%lld:%lld> differs from a full lex\n", path, edit_text, cast(int) edit.inserted_length,
+                edit.inserted_text, cast(long long) edit.offset, ly_token_kind_name_get(token->kind), cast(long long) token->location.offset,
+                cast(long long) token->location.length);
+        return_defer(false);
+    }
+
+    ly_syntax_id node = check_trees_match(&incremental_tree, &full_tree, allocator);
+    if (node != 0) {
+        ly_syntax_node* syntax = ly_syntax_get(&incremental_tree, node);
+        fprintf(stderr, "%s: %s '%.*s' at offset %lld: reparsed %s at <%u:%u> differs from a full parse\n", path, edit_text, cast(int) edit.inserted_length,
+                edit.inserted_text, cast(long long) edit.offset, ly_syntax_kind_name_get(cast(ly_syntax_kind) syntax->kind), syntax->offset, syntax->length);
+        return_defer(false);
+    }
+
+defer:;
+    ly_syntax_tree_deinit(&incremental_tree);
+    ly_syntax_tree_deinit(&full_tree);
+    ch_arena_deinit(&arena);
+    return result;
+}
+
+static bool check_reparse_file(const char* path, ch_allocator default_allocator) {
+    int64 length = 0;
+    char* text = check_read_file(path, default_allocator, &length);
+    if (text == NULL) {
+        fprintf(stderr, "%s: could not read file\n", path);
+        return false;
+    }
+
+    ch_source original = {
+        .name = path,
+        .text = text,
+        .length = length,
+    };
+
+    // only the first disagreement in a file is reported; the rest are usually the same problem again.
+    bool result = true;
+    for (int64 offset = 0; offset <= length && result; offset++) {
+        for (int64 i = 0; i < cast(int64)(sizeof check_edits / sizeof check_edits[0]) && result; i++) {
+            check_edit edit = check_edits[i];
+            if (offset + edit.removed_length > length) continue;
+
+            result = check_reparse_edit(path, original, (ch_source_edit){
+                .offset = offset,
+                .removed_length = edit.removed_length,
+                .inserted_text = edit.inserted_text,
+                .inserted_length = cast(int64) strlen(edit.inserted_text),
+            }, default_allocator);
+        }
+    }
+
+    ch_dealloc(default_allocator, text);
+    return result;
+}
+
+static int64 check_reparse(int argc, char** argv, ch_allocator allocator, int64* out_count) {
+    int64 failure_count = 0;
+    for (int i = 0; i < argc; i++) {
+        if (!check_reparse_file(argv[i], allocator)) {
+            failure_count++;
+        }
+    }
+
+    *out_count = argc;
+    return failure_count;
+}
+
+// ======================================================================
+// Statements
+// ======================================================================
+
+// A statement, and the kinds of the node it should parse to and of that node's first child.
+typedef struct check_statement {
+    const char* text;
+    ly_syntax_kind kind;
+    ly_syntax_kind first_child_kind;
+} check_statement;
+
+static const check_statement check_statement_cases[] = {
+    {"int.. r = 1 + 2 .. 5;", LY_SN_DECL_BINDING, LY_SN_TYPE_RANGE},
+    {"foo.. r = 1 .. 5;", LY_SN_DECL_BINDING, LY_SN_TYPE_RANGE},
+    {"foo.. r;", LY_SN_DECL_BINDING, LY_SN_TYPE_RANGE},
+    {"foo* p = nil;", LY_SN_DECL_BINDING, LY_SN_TYPE_POINTER},
+    {"foo* p;", LY_SN_DECL_BINDING, LY_SN_TYPE_POINTER},
+    {"foo** p = nil;", LY_SN_DECL_BINDING, LY_SN_TYPE_POINTER},
+    {"foo[4]* p;", LY_SN_DECL_BINDING, LY_SN_TYPE_POINTER},
+    {"int* p = nil;", LY_SN_DECL_BINDING, LY_SN_TYPE_POINTER},
+    {"foo f;", LY_SN_DECL_BINDING, LY_SN_EXPR_NAMEREF},
+    {"foo[4] xs;", LY_SN_DECL_BINDING, LY_SN_TYPE_ARRAY},
+    {"foo* get() { return nil; }", LY_SN_DECL_FUNCTION, LY_SN_TYPE_POINTER},
+    {"foo* get(int n);", LY_SN_DECL_FUNCTION, LY_SN_TYPE_POINTER},
+    {"foo* get(foo* other);", LY_SN_DECL_FUNCTION, LY_SN_TYPE_POINTER},
+    {"foo.. get(ref foo f);", LY_SN_DECL_FUNCTION, LY_SN_TYPE_RANGE},
+    {"a * 2;", LY_SN_STMT_EXPR, LY_SN_EXPR_BINARY},
+    {"a * b + c;", LY_SN_STMT_EXPR, LY_SN_EXPR_BINARY},
+    {"a * *b + 1;", LY_SN_STMT_EXPR, LY_SN_EXPR_BINARY},
+    {"a * b(c) + 1;", LY_SN_STMT_EXPR, LY_SN_EXPR_BINARY},
+    {"a * b(c);", LY_SN_STMT_EXPR, LY_SN_EXPR_BINARY},
+    {"x = a * b(c * d);", LY_SN_STMT_ASSIGN, LY_SN_EXPR_NAMEREF},
+    {"x = a * b;", LY_SN_STMT_ASSIGN, LY_SN_EXPR_NAMEREF},
+    {"a .. 5;", LY_SN_STMT_EXPR, LY_SN_EXPR_BINARY},
+    {"a .. b + 1;", LY_SN_STMT_EXPR, LY_SN_EXPR_BINARY},
+    {"*p = 0;", LY_SN_STMT_ASSIGN, LY_SN_EXPR_UNARY_PREFIX},
+};
+
+static bool check_statement_parse(check_statement statement, ch_allocator allocator) {
+    bool result = true;
+
+    char text[256];
+    int length = snprintf(text, sizeof text, "void f() {\n    %s\n}\n", statement.text);
+    assert(length > 0 && length < cast(int) sizeof text && "statement check case is too long");
+
+    ch_source source = {
+        .name = "<statement>",
+        .text = text,
+        .length = length,
+    };
+
+    ch_arena arena = {0};
+    ch_arena_init(&arena, allocator, 16 * 1024);
+
+    ch_context context = {0};
+    ch_context_init(&context, allocator);
+    context.defer_diagnostics = true;
+
+    ly_lexer lexer = {0};
+    ly_lexer_init(&lexer, &context, &source, ch_arena_allocator(&arena), LY_LEX_NONE);
+
+    ly_syntax_tree tree = {0};
+    ly_syntax_tree_init(&tree, allocator, &source);
+    ly_parse(&context, &tree, &lexer);
+
+    if (context.queued_diagnostics.count > 0) {
+        fprintf(stderr, "statements: '%s' has syntax errors\n", statement.text);
+        return_defer(false);
+    }
+
+    // the module holds `f`, whose children are its return type and body, and the statement is the first in the body.
+    ly_syntax_id children[4];
+    ly_syntax_id node = tree.root;
+    int64 path[3] = {0, 1, 0};
+    for (int64 i = 0; i < 3 && node != 0; i++) {
+        int64 count = ly_syntax_children(&tree, node, children, 4);
+        node = path[i] < count ? children[path[i]] : 0;
+    }
+
+    ly_syntax_kind kind = node != 0 ? cast(ly_syntax_kind) ly_syntax_get(&tree, node)->kind : LY_SN_NONE;
+    ly_syntax_kind first_child_kind = LY_SN_NONE;
+    if (node != 0 && ly_syntax_children(&tree, node, children, 4) > 0) {
+        first_child_kind = cast(ly_syntax_kind) ly_syntax_get(&tree, children[0])->kind;
+    }
+
+    if (kind != statement.kind || first_child_kind != statement.first_child_kind) {
+        fprintf(stderr, "statements: '%s' parsed as %s of %s, expected %s of %s\n", statement.text, ly_syntax_kind_name_get(kind), ly_syntax_kind_name_get(first_child_kind),
+                ly_syntax_kind_name_get(statement.kind), ly_syntax_kind_name_get(statement.first_child_kind));
+        return_defer(false);
+    }
+
+defer:;
+    ch_diag_discard(&context);
+    ch_context_deinit(&context);
+    ly_syntax_tree_deinit(&tree);
+    ch_arena_deinit(&arena);
+    return result;
+}
+
+static int64 check_statements(int argc, char** argv, ch_allocator allocator, int64* out_count) {
+    int64 failure_count = 0;
+    int64 count = cast(int64)(sizeof check_statement_cases / sizeof check_statement_cases[0]);
+    for (int64 i = 0; i < count; i++) {
+        if (!check_statement_parse(check_statement_cases[i], allocator)) {
+            failure_count++;
+        }
+    }
+
+    *out_count = count;
+    return failure_count;
+}
+
+// ======================================================================
+// Integer literals
+// ======================================================================
+
+// The radices the lexer decodes eight digits at a time, each with the prefix it is written with and a run of its digits to cut literals
+// from; every run starts with a nonzero digit and mixes cases where letters are digits.
+typedef struct check_radix {
+    int radix;
+    const char* prefix;
+    const char* digits;
+    char max_digit;
+    // enough digits to overflow 256 bits.
+    int64 max_length;
+} check_radix;
+
+static const check_radix check_radices[] = {
+    {2, "2#", "1011001110001111", '1', 258},
+    {10, "", "9081726354", '9', 80},
+    {16, "16#", "fEdCbA9876543210", 'f', 66},
+};
+
+// Values either side of where the fast path gives up, and either side of the widest literal.
+static const char* check_integer_edges[] = {
+    "9223372036854775807",
+    "9223372036854775808",
+    "18446744073709551615",
+    "18446744073709551616",
+    "18446744073709551617",
+    "18_446_744_073_709_551_615",
+    "18_446_744_073_709_551_616",
+    "16#7FFF_FFFF_FFFF_FFFF",
+    "16#8000_0000_0000_0000",
+    "16#FFFF_FFFF_FFFF_FFFF",
+    "16#1_0000_0000_0000_0000",
+    "16#1_0000_0000_0000_0001",
+    "115792089237316195423570985008687907853269984665640564039457584007913129639935",
+    "115792089237316195423570985008687907853269984665640564039457584007913129639936",
+    "0",
+    "0_0",
+    "2#0",
+    "16#0000_0000_0000_0000_0001",
+};
+
+static int check_digit_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'z') return c - 'a' + 10;
+    return c - 'A' + 10;
+}
+
+// Lexes one literal and checks it against the value its digits have when multiplied in one at a time, or against an overflow error
+// when that value does not fit in 256 bits.
+static bool check_integer_literal(const char* text, ch_allocator allocator) {
+    bool result = true;
+
+    int radix = 10;
+    const char* digits = text;
+    const char* hash = strchr(text, '#');
+    if (hash != NULL) {
+        radix = atoi(text);
+        digits = hash + 1;
+    }
+
+    ch_wide_int expected = {0};
+    bool is_too_large = false;
+    for (const char* c = digits; *c != 0 && !is_too_large; c++) {
+        if (*c == '_') continue;
+        is_too_large = !ch_wide_int_mul_add(&expected, cast(uint32) radix, cast(uint32) check_digit_value(*c));
+    }
+
+    bool is_wide = expected.words[0] > INT64_MAX;
+    for (int64 i = 1; i < CH_WIDE_INT_WORDS; i++) {
+        is_wide |= expected.words[i] != 0;
+    }
+
+    ch_source source = {
+        .name = "<literal>",
+        .text = text,
+        .length = cast(int64) strlen(text),
+    };
+
+    ch_arena arena = {0};
+    ch_arena_init(&arena, allocator, 4096);
+
+    ch_context context = {0};
+    ch_context_init(&context, allocator);
+    context.defer_diagnostics = true;
+
+    ly_token* token = ly_lex(&context, &source, ch_arena_allocator(&arena), LY_LEX_NONE);
+    int64 error_count = context.queued_diagnostics.count;
+
+    if (token->kind != LY_TK_LITERAL_INTEGER || token->location.length != source.length || token->next == NULL || token->next->kind != LY_TK_EOF) {
+        fprintf(stderr, "integers: '%s' is not lexed as a single integer literal\n", text);
+        return_defer(false);
+    }
+
+    if (is_too_large) {
+        if (error_count != 1) {
+            fprintf(stderr, "integers: '%s' does not fit in %d bits, but %lld errors were reported for it\n", text, CH_WIDE_INT_WORDS * 64, cast(long long) error_count);
+            return_defer(false);
+        }
+
+        return_defer(true);
+    }
+
+    if (error_count != 0) {
+        fprintf(stderr, "integers: '%s' has errors\n", text);
+        return_defer(false);
+    }
+
+    if (token->is_wide_integer != is_wide) {
+        fprintf(stderr, "integers: '%s' is lexed as a %s integer, expected a %s one\n", text, token->is_wide_integer ? "wide" : "64-bit", is_wide ? "wide" : "64-bit");
+        return_defer(false);
+    }
+
+    bool is_equal = is_wide ? 0 == memcmp(token->wide_integer_value, &expected, sizeof expected) : cast(uint64) token->integer_value == expected.words[0];
+    if (!is_equal) {
+        uint64 low_word = is_wide ? token->wide_integer_value->words[0] : cast(uint64) token->integer_value;
+        fprintf(stderr, "integers: '%s' is lexed with a low word of %llu, expected %llu\n", text, cast(unsigned long long) low_word, cast(unsigned long long) expected.words[0]);
+        return_defer(false);
+    }
+
+defer:;
+    ch_diag_discard(&context);
+    ch_context_deinit(&context);
+    ch_arena_deinit(&arena);
+    return result;
+}
+
+// Writes a literal of `length` digits to `buffer`, taking them from `digits` in turn, or all `max_digit` if that is not 0, with a
+// separator after every `separator_step` digits if that is not 0, and after the `separator_at`th digit if that is not 0.
+static void check_integer_build(char* buffer, const check_radix* radix, int64 length, char max_digit, int64 separator_step, int64 separator_at) {
+    int64 position = cast(int64) strlen(radix->prefix);
+    memcpy(buffer, radix->prefix, cast(usize) position);
+
+    int64 pattern_length = cast(int64) strlen(radix->digits);
+    for (int64 i = 0; i < length; i++) {
+        if (i > 0 && ((separator_step != 0 && i % separator_step == 0) || i == separator_at)) {
+            buffer[position++] = '_';
+        }
+
+        buffer[position++] = max_digit != 0 ? max_digit : radix->digits[i % pattern_length];
+    }
+
+    buffer[position] = 0;
+}
+
+static int64 check_integers(int argc, char** argv, ch_allocator allocator, int64* out_count) {
+    int64 count = 0;
+    int64 failure_count = 0;
+
+    for (int64 i = 0; i < cast(int64)(sizeof check_integer_edges / sizeof check_integer_edges[0]); i++) {
+        count++;
+        if (!check_integer_literal(check_integer_edges[i], allocator)) failure_count++;
+    }
+
+    static const int64 separator_steps[] = {0, 1, 3, 4, 7, 8};
+
+    // every length up to past 256 bits, so both sides of each 8 digit chunk, and of 2^64 and 2^256, are covered.
+    char buffer[1024];
+    for (int64 r = 0; r < cast(int64)(sizeof check_radices / sizeof check_radices[0]); r++) {
+        const check_radix* radix = &check_radices[r];
+        for (int64 length = 1; length <= radix->max_length; length++) {
+            for (int64 s = 0; s < cast(int64)(sizeof separator_steps / sizeof separator_steps[0]); s++) {
+                for (int64 is_max = 0; is_max < 2; is_max++) {
+                    check_integer_build(buffer, radix, length, is_max ? radix->max_digit : 0, separator_steps[s], 0);
+                    count++;
+                    if (!check_integer_literal(buffer, allocator)) failure_count++;
+                }
+            }
+
+            // a single separator at each place in the first two chunks, which moves where the chunks start.
+            for (int64 at = 1; at < length && at <= 17; at++) {
+                check_integer_build(buffer, radix, length, 0, 0, at);
+                count++;
+                if (!check_integer_literal(buffer, allocator)) failure_count++;
+            }
+        }
+    }
+
+    *out_count = count;
+    return failure_count;
+}
+
+// ======================================================================
+// Scopes
+// ======================================================================
+
+#define CHECK_SCOPE_DEPTH 4
+#define CHECK_SCOPE_NAMES 64
+#define CHECK_SCOPE_MAX_DECLS 256
+
+// What one scope declares under one name, kept the plainest way there is.
+typedef struct check_scope_model_entry {
+    ly_decl_id decls[CHECK_SCOPE_MAX_DECLS];
+    int64 count;
+    bool is_overload_set;
+} check_scope_model_entry;
+
+typedef struct check_scope_model {
+    check_scope_model_entry entries[CHECK_SCOPE_DEPTH][CHECK_SCOPE_NAMES];
+} check_scope_model;
+
+static uint64 check_random(uint64* state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+// The same rules as `ly_scope_add`, applied to the model.
+static bool check_scope_model_add(check_scope_model_entry* entry, ly_decl_id decl, bool is_overloadable) {
+    for (int64 i = 0; i < entry->count; i++) {
+        if (entry->decls[i] == decl) return true;
+    }
+
+    if (entry->count > 0 && (!is_overloadable || !entry->is_overload_set)) {
+        *entry = (check_scope_model_entry){.decls = {decl}, .count = 1, .is_overload_set = is_overloadable};
+        return false;
+    }
+
+    if (entry->count == 0) entry->is_overload_set = is_overloadable;
+    entry->decls[entry->count++] = decl;
+    return true;
+}
+
+// Looks a name up from the scope at `depth` both ways, returning false and reporting the difference if they disagree.
+static bool check_scope_lookup(ly_scope* scopes, check_scope_model* model, ch_atom* names, int64 depth, int64 name) {
+    ly_scope_lookup lookup = ly_scope_lookup_name(&scopes[depth], names[name]);
+
+    int64 expected_depth = depth;
+    while (expected_depth >= 0 && model->entries[expected_depth][name].count == 0) {
+        expected_depth--;
+    }
+
+    ly_scope* expected_scope = expected_depth >= 0 ? &scopes[expected_depth] : NULL;
+    check_scope_model_entry* expected = expected_depth >= 0 ? &model->entries[expected_depth][name] : NULL;
+
+    bool is_match = lookup.scope == expected_scope;
+    if (is_match && expected != NULL) {
+        is_match = lookup.decls.count == expected->count && lookup.is_overload_set == expected->is_overload_set &&
+                   0 == memcmp(lookup.decls.items, expected->decls, cast(usize) expected->count * sizeof(ly_decl_id));
+    }
+
+    // looking in the one scope alone only finds what that scope declares.
+    ly_decl_view local = ly_scope_lookup_local(&scopes[depth], names[name]);
+    is_match &= local.count == model->entries[depth][name].count;
+
+    if (!is_match) {
+        fprintf(stderr, "scopes: looking up name %lld from depth %lld found %lld declarations at depth %lld, expected %lld at depth %lld\n", cast(long long) name,
+                cast(long long) depth, cast(long long) lookup.decls.count, lookup.scope != NULL ? cast(long long)(lookup.scope - scopes) : -1LL,
+                expected != NULL ? cast(long long) expected->count : 0LL, cast(long long) expected_depth);
+    }
+
+    return is_match;
+}
+
+static int64 check_scopes(int argc, char** argv, ch_allocator allocator, int64* out_count) {
+    int64 count = 0;
+    int64 failure_count = 0;
+
+    ch_atom_table atoms = {0};
+    ch_atom_table_init(&atoms, allocator);
+
+    ch_atom names[CHECK_SCOPE_NAMES];
+    for (int64 i = 0; i < CHECK_SCOPE_NAMES; i++) {
+        char name[16];
+        int length = snprintf(name, sizeof name, "name%lld", cast(long long) i);
+        names[i] = ch_atom_intern(&atoms, name, length);
+    }
+
+    ly_scope scopes[CHECK_SCOPE_DEPTH];
+    for (int64 i = 0; i < CHECK_SCOPE_DEPTH; i++) {
+        ly_scope_init(&scopes[i], allocator, i > 0 ? &scopes[i - 1] : NULL);
+    }
+
+    check_scope_model* model = ch_alloc(allocator, sizeof *model);
+    memset(model, 0, sizeof *model);
+
+    // names are drawn from a small pool so that they are declared again, shadowed and overloaded often, and overload sets grow well
+    // past what is stored inline. now and then a scope is cleared, as a function's scopes are between bodies.
+    uint64 random = 0x2545F4914F6CDD1Dull;
+    ly_decl_id next_decl = 1;
+    for (int64 step = 0; step < 20000 && failure_count == 0; step++) {
+        int64 depth = cast(int64)(check_random(&random) % CHECK_SCOPE_DEPTH);
+        int64 name = cast(int64)(check_random(&random) % CHECK_SCOPE_NAMES);
+        bool is_overloadable = check_random(&random) % 8 != 0;
+
+        check_scope_model_entry* entry = &model->entries[depth][name];
+        if (step % 5000 == 4999) {
+            ly_scope_clear(&scopes[depth]);
+            memset(model->entries[depth], 0, sizeof model->entries[depth]);
+            continue;
+        }
+
+        // sometimes a declaration is added to the set it is already in.
+        ly_decl_id decl = next_decl;
+        if (entry->count > 0 && check_random(&random) % 8 == 0) {
+            decl = entry->decls[check_random(&random) % cast(uint64) entry->count];
+        } else {
+            next_decl++;
+        }
+
+        if (entry->count == CHECK_SCOPE_MAX_DECLS && entry->is_overload_set && is_overloadable) continue;
+
+        bool expected = check_scope_model_add(entry, decl, is_overloadable);
+        count++;
+        if (ly_scope_add(&scopes[depth], names[name], decl, is_overloadable) != expected) {
+            fprintf(stderr, "scopes: declaring name %lld at depth %lld should%s have conflicted\n", cast(long long) name, cast(long long) depth, expected ? " not" : "");
+            failure_count++;
+        }
+
+        for (int64 d = 0; d < CHECK_SCOPE_DEPTH && failure_count == 0; d++) {
+            count++;
+            if (!check_scope_lookup(scopes, model, names, d, name)) failure_count++;
+        }
+
+        // every so often everything is looked up again, in case an add disturbed another entry, as growing the table or the overflow would.
+        for (int64 n = 0; n < CHECK_SCOPE_NAMES && step % 500 == 0 && failure_count == 0; n++) {
+            for (int64 d = 0; d < CHECK_SCOPE_DEPTH && failure_count == 0; d++) {
+                count++;
+                if (!check_scope_lookup(scopes, model, names, d, n)) failure_count++;
+            }
+        }
+    }
+
+    // a name no scope declares, and the absent name, are found nowhere.
+    ch_atom undeclared = ch_atom_intern(&atoms, "undeclared", 10);
+    for (int64 i = 0; i < 2; i++) {
+        count++;
+        ly_scope_lookup lookup = ly_scope_lookup_name(&scopes[CHECK_SCOPE_DEPTH - 1], i == 0 ? undeclared : 0);
+        if (lookup.scope != NULL || lookup.decls.count != 0) {
+            fprintf(stderr, "scopes: the %s name was found\n", i == 0 ? "undeclared" : "absent");
+            failure_count++;
+        }
+    }
+
+    ch_dealloc(allocator, model);
+    for (int64 i = 0; i < CHECK_SCOPE_DEPTH; i++) {
+        ly_scope_deinit(&scopes[i]);
+    }
+
+    ch_atom_table_deinit(&atoms);
+
+    *out_count = count;
+    return failure_count;
+}
+
+// ======================================================================
+// Types
+// ======================================================================
+
+#define CHECK_TYPE_COUNT      20000
+#define CHECK_TYPE_JOB_COUNT  8
+#define CHECK_TYPE_JOB_TYPES  2000
+#define CHECK_TYPE_MAX_DEPTH  3
+
+// Each type is also written out as text, in a form where two types are the same exactly when their text is.
+typedef struct check_type_entry {
+    int64 text_begin;
+    int64 text_length;
+    ly_qual_type type;
+} check_type_entry;
+
+typedef struct check_type_entries {
+    ch_allocator allocator;
+    check_type_entry* items;
+    int64 count, capacity;
+} check_type_entries;
+
+typedef struct check_type_jobs {
+    ly_type_store* store;
+    ly_qual_type* types;
+} check_type_jobs;
+
+static void check_text_append(ch_string* text, const char* format, ...) {
+    if (text == NULL) return;
+
+    char buffer[64];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(buffer, sizeof buffer, format, args);
+    va_end(args);
+
+    assert(length >= 0 && length < cast(int) sizeof buffer && "check text too long");
+    if (length > 0) da_push_many(text, buffer, length);
+}
+
+// The choices are kept few, so that most types are built more than once.
+static ly_qual_type check_type_build(ly_type_store* store, uint64* random, int64 depth, ch_string* text) {
+    static const uint32 bit_widths[] = {1, 8, 32, 64, 128};
+    static const ly_type_kind containers[] = {LY_TY_POINTER, LY_TY_BUFFER, LY_TY_NILABLE, LY_TY_SLICE, LY_TY_RANGE};
+    static const ly_type_kind nominals[] = {LY_TY_STRUCT, LY_TY_ENUM, LY_TY_TEMPLATE_PARAMETER};
+
+    ly_type_qualifier qualifiers = check_random(random) % 4 == 0 ? LY_TQ_MUTABLE : LY_TQ_NONE;
+    check_text_append(text, "%s", qualifiers & LY_TQ_MUTABLE ? "mut " : "");
+
+    uint64 choice = depth >= CHECK_TYPE_MAX_DEPTH ? check_random(random) % 3 : check_random(random) % 9;
+    ly_type_id id = 0;
+    switch (choice) {
+        case 0: {
+            ly_type_kind kind = cast(ly_type_kind)(1 + check_random(random) % LY_TY_LAST_SIMPLE);
+            check_text_append(text, "s%d", cast(int) kind);
+            id = ly_type_simple(kind);
+        } break;
+
+        case 1: {
+            ly_type_kind kind = cast(ly_type_kind)(LY_TY_BOOL_SIZED + check_random(random) % 4);
+            uint32 bit_width = bit_widths[check_random(random) % (sizeof bit_widths / sizeof bit_widths[0])];
+            check_text_append(text, "z%d:%u", cast(int) kind, bit_width);
+            id = ly_type_sized(store, kind, bit_width);
+        } break;
+
+        case 2: {
+            ly_type_kind kind = nominals[check_random(random) % (sizeof nominals / sizeof nominals[0])];
+            ly_decl_id decl = cast(ly_decl_id)(1 + check_random(random) % 4);
+            check_text_append(text, "n%d:%u", cast(int) kind, cast(unsigned) decl);
+            id = ly_type_nominal(store, kind, decl);
+        } break;
+
+        case 3:
+        case 4: {
+            ly_type_kind kind = containers[check_random(random) % (sizeof containers / sizeof containers[0])];
+            check_text_append(text, "c%d(", cast(int) kind);
+            ly_qual_type element = check_type_build(store, random, depth + 1, text);
+            check_text_append(text, ")");
+            id = ly_type_container(store, kind, element);
+        } break;
+
+        case 5: {
+            uint64 terminator = check_random(random) % 2 == 0 ? 0 : UINT64_MAX;
+            check_text_append(text, "t%llu(", cast(unsigned long long) terminator);
+            ly_qual_type element = check_type_build(store, random, depth + 1, text);
+            check_text_append(text, ")");
+            id = ly_type_buffer_terminated(store, element, terminator);
+        } break;
+
+        case 6: {
+            uint64 lengths[3];
+            int64 dimension_count = cast(int64)(1 + check_random(random) % 3);
+            check_text_append(text, "a[");
+            for (int64 i = 0; i < dimension_count; i++) {
+                // a length past 32 bits would be cut in half if only the low word were compared.
+                lengths[i] = check_random(random) % 2 == 0 ? 1 + check_random(random) % 3 : (1ull << 32) + 1;
+                check_text_append(text, "%llu,", cast(unsigned long long) lengths[i]);
+            }
+
+            check_text_append(text, "](");
+            ly_qual_type element = check_type_build(store, random, depth + 1, text);
+            check_text_append(text, ")");
+            id = ly_type_array(store, element, lengths, dimension_count);
+        } break;
+
+        case 7: {
+            check_text_append(text, "e(");
+            ly_qual_type result = check_type_build(store, random, depth + 1, text);
+            check_text_append(text, ",");
+            ly_qual_type error = check_type_build(store, random, depth + 1, text);
+            check_text_append(text, ")");
+            id = ly_type_error_pair(store, result, error);
+        } break;
+
+        case 8: {
+            ly_calling_convention calling_convention = cast(ly_calling_convention)(check_random(random) % 2 == 0 ? LY_CC_LAYE : LY_CC_CDECL);
+            ly_varargs_kind varargs_kind = cast(ly_varargs_kind)(check_random(random) % 3);
+            ly_type_flag flags = check_random(random) % 2 == 0 ? LY_TF_NONE : LY_TF_DISCARDABLE;
+            check_text_append(text, "f%d,%d,%d(", cast(int) calling_convention, cast(int) varargs_kind, cast(int) flags);
+            ly_qual_type return_type = check_type_build(store, random, depth + 1, text);
+
+            ly_type_param params[3];
+            int64 param_count = cast(int64)(check_random(random) % 4);
+            for (int64 i = 0; i < param_count; i++) {
+                params[i].flags = check_random(random) % 3 == 0 ? LY_PF_REF : LY_PF_NONE;
+                check_text_append(text, ";p%d ", cast(int) params[i].flags);
+                params[i].type = check_type_build(store, random, depth + 1, text);
+            }
+
+            check_text_append(text, ")");
+            id = ly_type_function(store, return_type, params, param_count, calling_convention, varargs_kind, flags);
+        } break;
+    }
+
+    return ly_qual_type_make(id, qualifiers);
+}
+
+// Writes a type out again from what the store kept of it, which must give back the text it was built from.
+static void check_type_describe(ly_type_store* store, ly_qual_type qual_type, ch_string* text) {
+    check_text_append(text, "%s", ly_qual_type_qualifiers(qual_type) & LY_TQ_MUTABLE ? "mut " : "");
+
+    ly_type_id id = ly_qual_type_id(qual_type);
+    const ly_type* type = ly_type_get(store, id);
+    switch (type->kind) {
+        default: {
+            check_text_append(text, "s%d", cast(int) type->kind);
+        } break;
+
+        case LY_TY_BOOL_SIZED:
+        case LY_TY_INT_SIZED:
+        case LY_TY_UINT_SIZED:
+        case LY_TY_FLOAT_SIZED: {
+            check_text_append(text, "z%d:%u", cast(int) type->kind, cast(unsigned) type->operand);
+        } break;
+
+        case LY_TY_STRUCT:
+        case LY_TY_ENUM:
+        case LY_TY_TEMPLATE_PARAMETER: {
+            check_text_append(text, "n%d:%u", cast(int) type->kind, cast(unsigned) type->operand);
+        } break;
+
+        case LY_TY_POINTER:
+        case LY_TY_BUFFER:
+        case LY_TY_NILABLE:
+        case LY_TY_SLICE:
+        case LY_TY_RANGE: {
+            if (type->flags & LY_TF_TERMINATED) {
+                check_text_append(text, "t%llu(", cast(unsigned long long) ly_type_buffer_terminator(store, id));
+            } else {
+                check_text_append(text, "c%d(", cast(int) type->kind);
+            }
+
+            check_type_describe(store, type->element, text);
+            check_text_append(text, ")");
+        } break;
+
+        case LY_TY_ARRAY: {
+            check_text_append(text, "a[");
+            for (int64 i = 0; i < cast(int64) type->operand; i++) {
+                check_text_append(text, "%llu,", cast(unsigned long long) ly_type_array_length(store, id, i));
+            }
+
+            check_text_append(text, "](");
+            check_type_describe(store, type->element, text);
+            check_text_append(text, ")");
+        } break;
+
+        case LY_TY_ERROR_PAIR: {
+            check_text_append(text, "e(");
+            check_type_describe(store, type->element, text);
+            check_text_append(text, ",");
+            check_type_describe(store, cast(ly_qual_type) type->operand, text);
+            check_text_append(text, ")");
+        } break;
+
+        case LY_TY_FUNCTION: {
+            check_text_append(text, "f%d,%d,%d(", cast(int) type->calling_convention, cast(int) type->varargs_kind, cast(int) type->flags);
+            check_type_describe(store, type->element, text);
+            for (int64 i = 0; i < cast(int64) type->operand; i++) {
+                ly_type_param param = ly_type_function_param(store, id, i);
+                check_text_append(text, ";p%d ", cast(int) param.flags);
+                check_type_describe(store, param.type, text);
+            }
+
+            check_text_append(text, ")");
+        } break;
+    }
+}
+
+static const char* check_type_entry_text;
+
+static int check_type_entry_compare_text(const void* lhs, const void* rhs) {
+    const check_type_entry* a = lhs;
+    const check_type_entry* b = rhs;
+    int64 length = a->text_length < b->text_length ? a->text_length : b->text_length;
+    int order = memcmp(check_type_entry_text + a->text_begin, check_type_entry_text + b->text_begin, cast(usize) length);
+    if (order != 0) return order;
+    return (a->text_length > b->text_length) - (a->text_length < b->text_length);
+}
+
+static int check_type_entry_compare_type(const void* lhs, const void* rhs) {
+    const check_type_entry* a = lhs;
+    const check_type_entry* b = rhs;
+    return (a->type > b->type) - (a->type < b->type);
+}
+
+// Every job builds the same types, in the same order, into one store at the same time.
+static void check_type_job(void* userdata, int64 index) {
+    check_type_jobs* jobs = userdata;
+    uint64 random = 0x9E3779B97F4A7C15ull;
+    for (int64 i = 0; i < CHECK_TYPE_JOB_TYPES; i++) {
+        jobs->types[index * CHECK_TYPE_JOB_TYPES + i] = check_type_build(jobs->store, &random, 0, NULL);
+    }
+}
+
+static int64 check_types(int argc, char** argv, ch_allocator allocator, int64* out_count) {
+    int64 failure_count = 0;
+
+    ly_type_store store = {0};
+    ly_type_store_init(&store, allocator);
+
+    ch_string text = {.allocator = allocator};
+    ch_string description = {.allocator = allocator};
+    check_type_entries entries = {.allocator = allocator};
+
+    uint64 random = 0x9E3779B97F4A7C15ull;
+    for (int64 i = 0; i < CHECK_TYPE_COUNT; i++) {
+        int64 text_begin = text.count;
+        ly_qual_type type = check_type_build(&store, &random, 0, &text);
+        da_push(&entries, ((check_type_entry){text_begin, text.count - text_begin, type}));
+
+        description.count = 0;
+        check_type_describe(&store, type, &description);
+        if (description.count != text.count - text_begin || 0 != memcmp(description.items, text.items + text_begin, cast(usize) description.count)) {
+            fprintf(stderr, "types: %.*s was read back as %.*s\n", cast(int)(text.count - text_begin), text.items + text_begin, cast(int) description.count, description.items);
+            failure_count++;
+        }
+    }
+
+    // the same types built from many threads at once into a fresh store must still come out once each, whichever thread built them first.
+    ly_type_store shared_store = {0};
+    ly_type_store_init(&shared_store, allocator);
+
+    check_type_jobs jobs = {
+        .store = &shared_store,
+        .types = ch_alloc(allocator, CHECK_TYPE_JOB_COUNT * CHECK_TYPE_JOB_TYPES * cast(int64) sizeof(ly_qual_type)),
+    };
+
+    ch_thread_pool pool = {0};
+    ch_thread_pool_init(&pool, allocator, 4);
+    ch_thread_pool_run(&pool, CHECK_TYPE_JOB_COUNT, check_type_job, &jobs);
+    ch_thread_pool_deinit(&pool);
+
+    for (int64 i = 0; i < CHECK_TYPE_JOB_TYPES; i++) {
+        description.count = 0;
+        check_type_describe(&shared_store, jobs.types[i], &description);
+
+        for (int64 job = 1; job < CHECK_TYPE_JOB_COUNT; job++) {
+            if (jobs.types[job * CHECK_TYPE_JOB_TYPES + i] != jobs.types[i]) {
+                fprintf(stderr, "types: %.*s was built as both %u and %u from different threads\n", cast(int) description.count, description.items,
+                        cast(unsigned) jobs.types[i], cast(unsigned) jobs.types[job * CHECK_TYPE_JOB_TYPES + i]);
+                failure_count++;
+                break;
+            }
+        }
+
+        check_type_entry* expected = &entries.items[i];
+        if (description.count != expected->text_length || 0 != memcmp(description.items, text.items + expected->text_begin, cast(usize) description.count)) {
+            fprintf(stderr, "types: %.*s was built from other threads as %.*s\n", cast(int) expected->text_length, text.items + expected->text_begin,
+                    cast(int) description.count, description.items);
+            failure_count++;
+        }
+    }
+
+    ch_dealloc(allocator, jobs.types);
+    ly_type_store_deinit(&shared_store);
+
+    // equal texts must have been given equal types, and since each type reads back as its text, distinct texts were given distinct types.
+    check_type_entry_text = text.items;
+    qsort(entries.items, cast(usize) entries.count, sizeof *entries.items, check_type_entry_compare_text);
+    int64 distinct_count = entries.count > 0 ? 1 : 0;
+    for (int64 i = 1; i < entries.count; i++) {
+        if (0 != check_type_entry_compare_text(&entries.items[i - 1], &entries.items[i])) {
+            distinct_count++;
+        } else if (entries.items[i - 1].type != entries.items[i].type) {
+            fprintf(stderr, "types: %.*s was built as both %u and %u\n", cast(int) entries.items[i].text_length, text.items + entries.items[i].text_begin,
+                    cast(unsigned) entries.items[i - 1].type, cast(unsigned) entries.items[i].type);
+            failure_count++;
+        }
+    }
+
+    qsort(entries.items, cast(usize) entries.count, sizeof *entries.items, check_type_entry_compare_type);
+    int64 distinct_type_count = entries.count > 0 ? 1 : 0;
+    for (int64 i = 1; i < entries.count; i++) {
+        distinct_type_count += entries.items[i - 1].type != entries.items[i].type;
+    }
+
+    if (distinct_count != distinct_type_count) {
+        fprintf(stderr, "types: %lld distinct types were given %lld distinct ids\n", cast(long long) distinct_count, cast(long long) distinct_type_count);
+        failure_count++;
+    }
+
+    da_free(&entries);
+    da_free(&description);
+    da_free(&text);
+    ly_type_store_deinit(&store);
+
+    *out_count = CHECK_TYPE_COUNT + CHECK_TYPE_JOB_COUNT * CHECK_TYPE_JOB_TYPES;
+    return failure_count;
+}
+
+// ======================================================================
+// Constants
+// ======================================================================
+
+#define CHECK_CONSTANT_COUNT     20000
+#define CHECK_CONSTANT_MAX_DEPTH 4
+// longer than either of the evaluator's fixed stacks, but within how deeply the parser nests.
+#define CHECK_CONSTANT_CHAIN_LENGTH 200
+
+typedef enum check_constant_status {
+    CHECK_CONSTANT_OK,
+    CHECK_CONSTANT_OVERFLOW,
+    CHECK_CONSTANT_DIVISION_BY_ZERO,
+    CHECK_CONSTANT_SHIFT_OUT_OF_RANGE,
+} check_constant_status;
+
+// The diagnostic each status is reported with, found by a part of its message.
+static const char* check_constant_messages[] = {
+    [CHECK_CONSTANT_OK] = "",
+    [CHECK_CONSTANT_OVERFLOW] = "overflows",
+    [CHECK_CONSTANT_DIVISION_BY_ZERO] = "division by zero",
+    [CHECK_CONSTANT_SHIFT_OUT_OF_RANGE] = "shift count",
+};
+
+// What an expression should evaluate to: the first error in evaluation order, or its value.
+typedef struct check_constant_result {
+    check_constant_status status;
+    ch_wide_int value;
+} check_constant_result;
+
+static const char* check_constant_operators[] = {"+", "-", "*", "/", "%", "&", "|", "~", "<<", ">>"};
+
+static const int64 check_constant_shift_counts[] = {0, 1, 31, 32, 63, 64, 65, 127, 200, 255, 256, 1000};
+
+static void check_constant_literal(ch_string* text, ch_wide_int value) {
+    int64 top = CH_WIDE_INT_WORDS - 1;
+    while (top > 0 && value.words[top] == 0) {
+        top--;
+    }
+
+    check_text_append(text, "16#%llx", cast(unsigned long long) value.words[top]);
+    for (int64 i = top - 1; i >= 0; i--) {
+        check_text_append(text, "%016llx", cast(unsigned long long) value.words[i]);
+    }
+}
+
+// A literal near an edge: small, or one either side of a power of two where the 64-bit path overflows or a 256-bit value does.
+static ch_wide_int check_constant_edge(uint64* random) {
+    static const int64 powers[] = {31, 32, 62, 63, 64, 127, 128, 254, 255};
+
+    if (check_random(random) % 3 == 0) {
+        return ch_wide_int_from_uint64(check_random(random) % 8);
+    }
+
+    // built bit by bit, since 2^255 is not a signed 256-bit value and wide arithmetic would refuse it.
+    int64 power = powers[check_random(random) % (sizeof powers / sizeof powers[0])];
+    ch_wide_int value = {0};
+    value.words[power / 64] = 1ull << (power % 64);
+    switch (check_random(random) % 3) {
+        case 0: {
+            value.words[power / 64] -= 1;
+            for (int64 i = 0; i < power / 64; i++) {
+                value.words[i] = UINT64_MAX;
+            }
+        } break;
+
+        case 1: value.words[0] |= 1; break;
+        default: break;
+    }
+
+    return value;
+}
+
+static check_constant_result check_constant_apply(const char* op, check_constant_result lhs, check_constant_result rhs) {
+    if (lhs.status != CHECK_CONSTANT_OK) return lhs;
+    if (rhs.status != CHECK_CONSTANT_OK) return rhs;
+
+    check_constant_result result = {0};
+    ch_wide_int a = lhs.value, b = rhs.value;
+    if (0 == strcmp(op, "<<") || 0 == strcmp(op, ">>")) {
+        int64 count;
+        if (!ch_wide_int_to_int64(b, &count) || count < 0 || count >= CH_WIDE_INT_WORDS * 64) {
+            result.status = CHECK_CONSTANT_SHIFT_OUT_OF_RANGE;
+        } else if (op[0] == '<') {
+            result.status = ch_wide_int_shl(a, count, &result.value) ? CHECK_CONSTANT_OK : CHECK_CONSTANT_OVERFLOW;
+        } else {
+            result.value = ch_wide_int_shr(a, count);
+        }
+    } else if (0 == strcmp(op, "/") || 0 == strcmp(op, "%")) {
+        ch_wide_int quotient, remainder;
+        if (ch_wide_int_compare(b, ch_wide_int_from_uint64(0)) == 0) {
+            result.status = CHECK_CONSTANT_DIVISION_BY_ZERO;
+        } else if (!ch_wide_int_div_rem(a, b, &quotient, &remainder) && op[0] == '/') {
+            result.status = CHECK_CONSTANT_OVERFLOW;
+        } else {
+            result.value = op[0] == '/' ? quotient : remainder;
+        }
+    } else if (op[0] == '&' || op[0] == '|' || op[0] == '~') {
+        result.value = op[0] == '&' ? ch_wide_int_and(a, b) : op[0] == '|' ? ch_wide_int_or(a, b) : ch_wide_int_xor(a, b);
+    } else {
+        bool fits = op[0] == '+' ? ch_wide_int_add(a, b, &result.value) : op[0] == '-' ? ch_wide_int_sub(a, b, &result.value) : ch_wide_int_mul(a, b, &result.value);
+        result.status = fits ? CHECK_CONSTANT_OK : CHECK_CONSTANT_OVERFLOW;
+    }
+
+    return result;
+}
+
+// Writes out a random expression, fully parenthesised, and works out what it should evaluate to without ever taking the 64-bit path.
+static check_constant_result check_constant_build(uint64* random, int64 depth, ch_string* text) {
+    uint64 choice = depth >= CHECK_CONSTANT_MAX_DEPTH ? 0 : check_random(random) % 4;
+    if (choice == 0) {
+        // negated often, so that the most negative values and -1 meet in division.
+        bool is_negated = check_random(random) % 3 == 0;
+        ch_wide_int value = check_constant_edge(random);
+        check_text_append(text, "%s", is_negated ? "-" : "");
+        check_constant_literal(text, value);
+
+        // literals are unsigned, so one using the top bit does not fit a signed constant.
+        check_constant_result result = {ch_wide_int_is_negative(value) ? CHECK_CONSTANT_OVERFLOW : CHECK_CONSTANT_OK, value};
+        if (is_negated && result.status == CHECK_CONSTANT_OK) {
+            result.status = ch_wide_int_negate(value, &result.value) ? CHECK_CONSTANT_OK : CHECK_CONSTANT_OVERFLOW;
+        }
+
+        return result;
+    }
+
+    if (choice == 1) {
+        const char* op = check_random(random) % 2 == 0 ? "-" : "~";
+        check_text_append(text, "%s(", op);
+        check_constant_result operand = check_constant_build(random, depth + 1, text);
+        check_text_append(text, ")");
+
+        if (operand.status != CHECK_CONSTANT_OK) return operand;
+        if (op[0] == '~') return (check_constant_result){CHECK_CONSTANT_OK, ch_wide_int_not(operand.value)};
+
+        check_constant_result result = {0};
+        result.status = ch_wide_int_negate(operand.value, &result.value) ? CHECK_CONSTANT_OK : CHECK_CONSTANT_OVERFLOW;
+        return result;
+    }
+
+    const char* op = check_constant_operators[check_random(random) % (sizeof check_constant_operators / sizeof check_constant_operators[0])];
+    check_text_append(text, "(");
+    check_constant_result lhs = check_constant_build(random, depth + 1, text);
+    check_text_append(text, " %s ", op);
+
+    check_constant_result rhs;
+    if (op[0] == '<' || op[0] == '>') {
+        int64 count = check_constant_shift_counts[check_random(random) % (sizeof check_constant_shift_counts / sizeof check_constant_shift_counts[0])];
+        check_text_append(text, "%lld", cast(long long) count);
+        rhs = (check_constant_result){CHECK_CONSTANT_OK, ch_wide_int_from_int64(count)};
+    } else {
+        rhs = check_constant_build(random, depth + 1, text);
+    }
+
+    check_text_append(text, ")");
+    return check_constant_apply(op, lhs, rhs);
+}
+
+static bool check_constant_evaluate(ch_string* text, check_constant_result expected, ch_allocator allocator) {
+    bool result = true;
+
+    ch_string source_text = {.allocator = allocator};
+    check_text_append(&source_text, "void f() {\n    ");
+    da_push_many(&source_text, text->items, text->count);
+    check_text_append(&source_text, ";\n}\n");
+
+    ch_source source = {
+        .name = "<constant>",
+        .text = source_text.items,
+        .length = source_text.count,
+    };
+
+    ch_arena arena = {0};
+    ch_arena_init(&arena, allocator, 16 * 1024);
+
+    ch_context context = {0};
+    ch_context_init(&context, allocator);
+    context.defer_diagnostics = true;
+
+    ly_lexer lexer = {0};
+    ly_lexer_init(&lexer, &context, &source, ch_arena_allocator(&arena), LY_LEX_NONE);
+
+    ly_syntax_tree tree = {0};
+    ly_syntax_tree_init(&tree, allocator, &source);
+    ly_parse(&context, &tree, &lexer);
+
+    // the module holds `f`, whose children are its return type and body; the expression is the only child of the body's first statement.
+    ly_syntax_id children[4];
+    ly_syntax_id node = tree.root;
+    int64 path[4] = {0, 1, 0, 0};
+    for (int64 i = 0; i < 4 && node != 0; i++) {
+        int64 count = ly_syntax_children(&tree, node, children, 4);
+        node = path[i] < count ? children[path[i]] : 0;
+    }
+
+    if (context.queued_diagnostics.count > 0 || node == 0) {
+        fprintf(stderr, "constants: '%.*s' has syntax errors\n", cast(int) text->count, text->items);
+        return_defer(false);
+    }
+
+    ly_constant constant = {0};
+    bool is_constant = ly_constant_evaluate(&context, allocator, &tree, node, NULL, NULL, &constant);
+
+    if (expected.status != CHECK_CONSTANT_OK) {
+        const char* message = check_constant_messages[expected.status];
+        if (is_constant || context.queued_diagnostics.count != 1 || strstr(context.queued_diagnostics.items[0].message, message) == NULL) {
+            fprintf(stderr, "constants: '%.*s' should have been reported as '%s'\n", cast(int) text->count, text->items, message);
+            return_defer(false);
+        }
+
+        return_defer(true);
+    }
+
+    if (!is_constant || constant.kind != LY_CK_INTEGER) {
+        fprintf(stderr, "constants: '%.*s' should have been an integer constant\n", cast(int) text->count, text->items);
+        return_defer(false);
+    }
+
+    // the value must match, and be kept in 64 bits exactly when it fits in them.
+    int64 small;
+    bool fits = ch_wide_int_to_int64(expected.value, &small);
+    ch_wide_int value = constant.integer.is_wide ? constant.integer.wide : ch_wide_int_from_int64(constant.integer.value);
+    if (ch_wide_int_compare(value, expected.value) != 0 || constant.integer.is_wide == fits) {
+        fprintf(stderr, "constants: '%.*s' evaluated to a%s value which is wrong\n", cast(int) text->count, text->items, constant.integer.is_wide ? " wide" : " 64-bit");
+        return_defer(false);
+    }
+
+defer:;
+    ch_diag_discard(&context);
+    ch_context_deinit(&context);
+    ly_syntax_tree_deinit(&tree);
+    ch_arena_deinit(&arena);
+    da_free(&source_text);
+    return result;
+}
+
+static int64 check_constants(int argc, char** argv, ch_allocator allocator, int64* out_count) {
+    int64 failure_count = 0;
+    ch_string text = {.allocator = allocator};
+
+    uint64 random = 0xD1B54A32D192ED03ull;
+    for (int64 i = 0; i < CHECK_CONSTANT_COUNT; i++) {
+        text.count = 0;
+        check_constant_result expected = check_constant_build(&random, 0, &text);
+        if (!check_constant_evaluate(&text, expected, allocator)) {
+            failure_count++;
+        }
+    }
+
+    // long chains of sums which pass the 64-bit edge partway: one flat, which is nested to the left and deepens the evaluator's work,
+    // and one nested to the right, which deepens its values; either outgrows the evaluator's fixed stacks.
+    for (int64 is_nested = 0; is_nested < 2; is_nested++) {
+        text.count = 0;
+        check_constant_result expected = {CHECK_CONSTANT_OK, ch_wide_int_from_uint64(0)};
+        for (int64 i = 0; i < CHECK_CONSTANT_CHAIN_LENGTH; i++) {
+            check_text_append(&text, is_nested ? "(16#7fffffffffffffff + " : "16#7fffffffffffffff + ");
+            expected = check_constant_apply("+", expected, (check_constant_result){CHECK_CONSTANT_OK, ch_wide_int_from_int64(INT64_MAX)});
+        }
+
+        check_text_append(&text, "0");
+        for (int64 i = 0; i < CHECK_CONSTANT_CHAIN_LENGTH && is_nested; i++) {
+            check_text_append(&text, ")");
+        }
+
+        if (!check_constant_evaluate(&text, expected, allocator)) {
+            failure_count++;
+        }
+    }
+
+    da_free(&text);
+
+    *out_count = CHECK_CONSTANT_COUNT + 2;
+    return failure_count;
+}
+
+// ======================================================================
+// Analysis
+// ======================================================================
+
+// A module of a single file, parsed and analysed, for the checks which look at what sema made of it.
+// Diagnostics are kept in `context` for the check to count.
+typedef struct check_analysis {
+    ch_source source;
+    ch_arena token_arena;
+    ch_context context;
+    ly_syntax_tree tree;
+    ly_module module;
+    ly_sema sema;
+} check_analysis;
+
+// `import`, if not NULL, is a module file the module can import.
+static void check_analysis_init(check_analysis* analysis, const char* name, ch_string* text, const ch_target* target, ly_module_file* import, ch_allocator allocator) {
+    *analysis = (check_analysis){
+        .source = {
+            .name = name,
+            .text = text->items,
+            .length = text->count,
+        },
+        .module.trees.allocator = allocator,
+    };
+
+    ch_arena_init(&analysis->token_arena, allocator, 16 * 1024);
+    ch_context_init(&analysis->context, allocator);
+    analysis->context.defer_diagnostics = true;
+    if (target != NULL) analysis->context.target = target;
+
+    ly_lexer lexer = {0};
+    ly_lexer_init(&lexer, &analysis->context, &analysis->source, ch_arena_allocator(&analysis->token_arena), LY_LEX_NONE);
+
+    ly_syntax_tree_init(&analysis->tree, allocator, &analysis->source);
+    ly_parse(&analysis->context, &analysis->tree, &lexer);
+    da_push(&analysis->module.trees, &analysis->tree);
+
+    // the function bodies are analysed on this thread alone, in declaration order.
+    ch_thread_pool pool = {0};
+    ch_thread_pool_init(&pool, allocator, 1);
+
+    ly_sema_init(&analysis->sema, &analysis->context, &analysis->module, allocator);
+    if (import != NULL) ly_sema_add_import(&analysis->sema, import);
+    ly_sema_analyse(&analysis->sema, &pool);
+
+    ch_thread_pool_deinit(&pool);
+}
+
+static void check_analysis_deinit(check_analysis* analysis) {
+    ly_sema_deinit(&analysis->sema);
+    da_free(&analysis->module.trees);
+    ly_syntax_tree_deinit(&analysis->tree);
+    ch_diag_discard(&analysis->context);
+    ch_context_deinit(&analysis->context);
+    ch_arena_deinit(&analysis->token_arena);
+}
+
+// ======================================================================
+// Overloads
+// ======================================================================
+
+#define CHECK_OVERLOAD_CACHE_COUNT 20000
+#define CHECK_OVERLOAD_SET_COUNT   8
+#define CHECK_OVERLOAD_MAX_ARGS    3
+#define CHECK_OVERLOAD_CALL_COUNT  200
+
+// Every overload of `f`; resolutions are compared by where the chosen overload is declared, which is the same in each module built from this.
+static const char* check_overload_declarations =
+    "void f(int a) {}\n"
+    "void f(int8 a) {}\n"
+    "void f(bool a) {}\n"
+    "void f(int a, int b) {}\n"
+    "void f(int32 a, int b) {}\n"
+    "void f(int16 a, int16 b) {}\n"
+    "void f(int8 a, bool b, int8 c) {}\n"
+    "void main() {\n"
+    "    int a = 1;\n"
+    "    int8 b = 1;\n"
+    "    int32 c = 1;\n"
+    "    bool d = true;\n"
+    "    int16 e = 1;\n";
+
+static const char* check_overload_args[] = {"a", "b", "c", "d", "e", "1", "true"};
+
+// One resolution found in a cache, by the text of its argument types and where its chosen overload is declared.
+typedef struct check_overload_resolution {
+    ch_string arg_types;
+    int64 chosen_offset;
+} check_overload_resolution;
+
+typedef struct check_overload_resolutions {
+    ch_allocator allocator;
+    check_overload_resolution* items;
+    int64 count, capacity;
+} check_overload_resolutions;
+
+// What a module's overload cache holds, which can be compared with another module's since it does not depend on either's ids.
+static void check_overload_resolutions_get(check_analysis* analysis, check_overload_resolutions* out_resolutions, ch_allocator allocator) {
+    ly_overload_cache* cache = &analysis->sema.overloads;
+    for (int64 i = 0; i < cache->resolutions.count; i++) {
+        ly_overload_resolution* resolution = &cache->resolutions.items[i];
+        check_overload_resolution result = {.arg_types.allocator = allocator};
+        for (uint32 j = 0; j < resolution->arg_count; j++) {
+            check_text_append(&result.arg_types, "%s", j == 0 ? "" : ", ");
+            check_type_describe(&analysis->sema.types, ly_qual_type_make(cache->words.items[resolution->args + j], LY_TQ_NONE), &result.arg_types);
+        }
+
+        ly_decl* chosen = ly_sema_decl_get(&analysis->sema, resolution->chosen);
+        result.chosen_offset = ly_syntax_location(&analysis->tree, chosen->syntax).offset;
+        da_push(out_resolutions, result);
+    }
+}
+
+static void check_overload_resolutions_free(check_overload_resolutions* resolutions) {
+    for (int64 i = 0; i < resolutions->count; i++) {
+        da_free(&resolutions->items[i].arg_types);
+    }
+
+    da_free(resolutions);
+}
+
+// Adds and finds random resolutions, checking each find against a plain list of everything added so far.
+static int64 check_overload_cache(ch_allocator allocator) {
+    int64 failure_count = 0;
+
+    ly_overload_cache cache = {0};
+    ly_overload_cache_init(&cache, allocator);
+
+    typedef struct check_overload_model {
+        ly_decl_id overload_set;
+        ly_type_id arg_types[CHECK_OVERLOAD_MAX_ARGS];
+        int64 arg_count;
+        ly_decl_id chosen;
+        ly_conversion conversions[CHECK_OVERLOAD_MAX_ARGS];
+    } check_overload_model;
+
+    check_overload_model* model = ch_alloc(allocator, CHECK_OVERLOAD_CACHE_COUNT * cast(int64) sizeof *model);
+    int64 model_count = 0;
+
+    // argument types are drawn from a few, so that the same tuple is looked up often, in the same set and in others.
+    uint64 random = 0xA0761D6478BD642Full;
+    for (int64 step = 0; step < CHECK_OVERLOAD_CACHE_COUNT && failure_count == 0; step++) {
+        check_overload_model key = {
+            .overload_set = cast(ly_decl_id)(1 + check_random(&random) % CHECK_OVERLOAD_SET_COUNT),
+            .arg_count = cast(int64)(check_random(&random) % (CHECK_OVERLOAD_MAX_ARGS + 1)),
+        };
+
+        for (int64 i = 0; i < key.arg_count; i++) {
+            key.arg_types[i] = cast(ly_type_id)(1 + check_random(&random) % 6);
+        }
+
+        check_overload_model* expected = NULL;
+        for (int64 i = 0; i < model_count && expected == NULL; i++) {
+            if (model[i].overload_set == key.overload_set && model[i].arg_count == key.arg_count &&
+                0 == memcmp(model[i].arg_types, key.arg_types, cast(usize) key.arg_count * sizeof *key.arg_types)) {
+                expected = &model[i];
+            }
+        }
+
+        ly_conversion conversions[CHECK_OVERLOAD_MAX_ARGS] = {0};
+        ly_decl_id chosen = ly_overload_cache_find(&cache, key.overload_set, key.arg_types, key.arg_count, conversions);
+        if (chosen != (expected != NULL ? expected->chosen : 0) ||
+            (expected != NULL && 0 != memcmp(conversions, expected->conversions, cast(usize) key.arg_count * sizeof *conversions))) {
+            fprintf(stderr, "overloads: finding %lld arguments in set %u gave %u, expected %u\n", cast(long long) key.arg_count, cast(unsigned) key.overload_set,
+                    cast(unsigned) chosen, expected != NULL ? cast(unsigned) expected->chosen : 0u);
+            failure_count++;
+        }
+
+        // a resolution is added again now and then, as another thread which resolved the same call would; the first one added is kept.
+        if (expected == NULL || check_random(&random) % 4 == 0) {
+            key.chosen = cast(ly_decl_id)(1 + check_random(&random) % 1000);
+            for (int64 i = 0; i < key.arg_count; i++) {
+                key.conversions[i] = cast(ly_conversion)(check_random(&random) % (LY_CONV_VARARGS + 1));
+            }
+
+            ly_overload_cache_add(&cache, key.overload_set, key.arg_types, key.arg_count, key.chosen, key.conversions);
+            if (expected == NULL) model[model_count++] = key;
+        }
+    }
+
+    if (cache.resolutions.count != model_count) {
+        fprintf(stderr, "overloads: the cache holds %lld resolutions, expected %lld\n", cast(long long) cache.resolutions.count, cast(long long) model_count);
+        failure_count++;
+    }
+
+    ch_dealloc(allocator, model);
+    ly_overload_cache_deinit(&cache);
+    return failure_count;
+}
+
+// Analyses a module with many calls, most of them resolved from the cache, and the same module with each call on its own, where the
+// cache starts out empty; every call must resolve to the same overload, or fail the same way, in both.
+static int64 check_overload_calls(ch_allocator allocator) {
+    int64 failure_count = 0;
+
+    ch_string calls[CHECK_OVERLOAD_CALL_COUNT];
+    ch_string text = {.allocator = allocator};
+    da_push_many(&text, check_overload_declarations, cast(int64) strlen(check_overload_declarations));
+
+    uint64 random = 0xE7037ED1A0B428DBull;
+    for (int64 i = 0; i < CHECK_OVERLOAD_CALL_COUNT; i++) {
+        calls[i] = (ch_string){.allocator = allocator};
+        check_text_append(&calls[i], "    f(");
+
+        int64 arg_count = cast(int64)(check_random(&random) % (CHECK_OVERLOAD_MAX_ARGS + 1));
+        for (int64 j = 0; j < arg_count; j++) {
+            const char* arg = check_overload_args[check_random(&random) % (sizeof check_overload_args / sizeof check_overload_args[0])];
+            check_text_append(&calls[i], "%s%s", j == 0 ? "" : ", ", arg);
+        }
+
+        check_text_append(&calls[i], ");\n");
+        da_push_many(&text, calls[i].items, calls[i].count);
+    }
+
+    check_text_append(&text, "}\n");
+
+    check_analysis all = {0};
+    check_analysis_init(&all, "<overloads>", &text, NULL, NULL, allocator);
+
+    check_overload_resolutions cached = {.allocator = allocator};
+    check_overload_resolutions_get(&all, &cached, allocator);
+
+    int64 resolved_count = 0;
+    int64 diagnostic_count = 0;
+    for (int64 i = 0; i < CHECK_OVERLOAD_CALL_COUNT; i++) {
+        ch_string single_text = {.allocator = allocator};
+        da_push_many(&single_text, check_overload_declarations, cast(int64) strlen(check_overload_declarations));
+        da_push_many(&single_text, calls[i].items, calls[i].count);
+        check_text_append(&single_text, "}\n");
+
+        check_analysis single = {0};
+        check_analysis_init(&single, "<overload>", &single_text, NULL, NULL, allocator);
+        diagnostic_count += single.context.queued_diagnostics.count;
+
+        check_overload_resolutions uncached = {.allocator = allocator};
+        check_overload_resolutions_get(&single, &uncached, allocator);
+
+        for (int64 j = 0; j < uncached.count; j++) {
+            check_overload_resolution* expected = &uncached.items[j];
+            check_overload_resolution* found = NULL;
+            for (int64 k = 0; k < cached.count && found == NULL; k++) {
+                if (cached.items[k].arg_types.count == expected->arg_types.count &&
+                    0 == memcmp(cached.items[k].arg_types.items, expected->arg_types.items, cast(usize) expected->arg_types.count)) {
+                    found = &cached.items[k];
+                }
+            }
+
+            resolved_count++;
+            if (found == NULL || found->chosen_offset != expected->chosen_offset) {
+                fprintf(stderr, "overloads: '%.*s' resolved differently when it was the only call\n", cast(int)(calls[i].count - 6), calls[i].items + 4);
+                failure_count++;
+            }
+        }
+
+        check_overload_resolutions_free(&uncached);
+        check_analysis_deinit(&single);
+        da_free(&single_text);
+    }
+
+    // calls which failed to resolve are never cached, so each reports again; and since every resolution comes from some call, there must
+    // be no more of them than there were distinct calls.
+    if (all.context.queued_diagnostics.count != diagnostic_count) {
+        fprintf(stderr, "overloads: the calls reported %lld problems together, but %lld one at a time\n", cast(long long) all.context.queued_diagnostics.count,
+                cast(long long) diagnostic_count);
+        failure_count++;
+    }
+
+    if (cached.count >= resolved_count) {
+        fprintf(stderr, "overloads: %lld calls resolved to %lld cached resolutions, so nothing was found in the cache\n", cast(long long) resolved_count,
+                cast(long long) cached.count);
+        failure_count++;
+    }
+
+    check_overload_resolutions_free(&cached);
+    check_analysis_deinit(&all);
+    for (int64 i = 0; i < CHECK_OVERLOAD_CALL_COUNT; i++) {
+        da_free(&calls[i]);
+    }
+
+    da_free(&text);
+    return failure_count;
+}
+
+static int64 check_overloads(int argc, char** argv, ch_allocator allocator, int64* out_count) {
+    int64 failure_count = check_overload_cache(allocator);
+    failure_count += check_overload_calls(allocator);
+
+    *out_count = CHECK_OVERLOAD_CACHE_COUNT + CHECK_OVERLOAD_CALL_COUNT;
+    return failure_count;
+}
+
+// ======================================================================
+// Layouts
+// ======================================================================
+
+#define CHECK_LAYOUT_STRUCT_COUNT 40
+#define CHECK_LAYOUT_MAX_FIELDS   6
+// a pointer followed by a length, which is how a slice is laid out.
+#define CHECK_LAYOUT_SLICE -2
+
+// Each target's table, read from targets.inc rather than through `ch_target_find`, so that both are checked.
+typedef struct check_layout_target {
+    const char* name;
+    bool is_char_signed;
+    ch_layout layouts[CH_TT_COUNT];
+} check_layout_target;
+
+static const check_layout_target check_layout_targets[] = {
+#define CH_TARGET(Name, IsCharSigned) {Name, IsCharSigned, {
+#define CH_TARGET_TYPE(Type, Size, Align) [CH_TT_##Type] = {Size, Align},
+#define CH_TARGET_END }},
+#include <choir/targets.inc>
+};
+
+// A type a field can have, and where its layout comes from: one of the target's types, repeated `count` times for an array,
+// or a layout which is the same on every target.
+typedef struct check_layout_type {
+    const char* text;
+    int target_type;
+    int64 count;
+    ch_layout layout;
+} check_layout_type;
+
+static const check_layout_type check_layout_types[] = {
+    {"bool", -1, 1, {1, 1}},
+    {"int8", -1, 1, {1, 1}},
+    {"int16", -1, 1, {2, 2}},
+    {"int24", -1, 1, {3, 4}},
+    {"int32", -1, 1, {4, 4}},
+    {"int64", -1, 1, {8, 8}},
+    {"int8?", -1, 1, {2, 1}},
+    {"int16[3]", -1, 1, {6, 2}},
+    {"int", CH_TT_SIZE, 1, {0}},
+    {"int*", CH_TT_POINTER, 1, {0}},
+    {"int32?*", CH_TT_POINTER, 1, {0}},
+    {"int[]", CHECK_LAYOUT_SLICE, 1, {0}},
+    {"__builtin_ffi_bool", CH_TT_C_BOOL, 1, {0}},
+    {"__builtin_ffi_char", CH_TT_C_CHAR, 1, {0}},
+    {"__builtin_ffi_short", CH_TT_C_SHORT, 1, {0}},
+    {"__builtin_ffi_int", CH_TT_C_INT, 1, {0}},
+    {"__builtin_ffi_long", CH_TT_C_LONG, 1, {0}},
+    {"__builtin_ffi_longlong", CH_TT_C_LONG_LONG, 1, {0}},
+    {"__builtin_ffi_float", CH_TT_C_FLOAT, 1, {0}},
+    {"__builtin_ffi_double", CH_TT_C_DOUBLE, 1, {0}},
+    {"__builtin_ffi_long_double", CH_TT_C_LONG_DOUBLE, 1, {0}},
+    {"__builtin_ffi_long_double[3]", CH_TT_C_LONG_DOUBLE, 3, {0}},
+    {"__builtin_ffi_long[2][2]", CH_TT_C_LONG, 4, {0}},
+};
+
+// What a random struct should come out as.
+typedef struct check_layout_struct {
+    ch_layout layout;
+    ch_size offsets[CHECK_LAYOUT_MAX_FIELDS];
+    int64 field_count;
+} check_layout_struct;
+
+static ch_size check_layout_align(ch_size size, ch_align align) {
+    return (size + align - 1) / align * align;
+}
+
+static ch_layout check_layout_type_get(const check_layout_target* target, const check_layout_type* type) {
+    if (type->target_type == -1) return type->layout;
+
+    if (type->target_type == CHECK_LAYOUT_SLICE) {
+        ch_layout pointer = target->layouts[CH_TT_POINTER], length = target->layouts[CH_TT_SIZE];
+        ch_align align = pointer.align > length.align ? pointer.align : length.align;
+        return (ch_layout){check_layout_align(check_layout_align(pointer.size, length.align) + length.size, align), align};
+    }
+
+    ch_layout layout = target->layouts[type->target_type];
+    return (ch_layout){layout.size * type->count, layout.align};
+}
+
+// Writes out random structs, each field of one of the types above or of an earlier struct, and lays each out by C's rules.
+static void check_layout_structs(const check_layout_target* target, uint64* random, ch_string* text, check_layout_struct* structs) {
+    for (int64 i = 0; i < CHECK_LAYOUT_STRUCT_COUNT; i++) {
+        check_layout_struct* expected = &structs[i];
+        *expected = (check_layout_struct){
+            .layout = {0, 1},
+            .field_count = cast(int64)(1 + check_random(random) % CHECK_LAYOUT_MAX_FIELDS),
+        };
+
+        check_text_append(text, "struct s%lld {\n", cast(long long) i);
+        for (int64 j = 0; j < expected->field_count; j++) {
+            ch_layout field;
+            if (i > 0 && check_random(random) % 4 == 0) {
+                int64 nested = cast(int64)(check_random(random) % cast(uint64) i);
+                check_text_append(text, "    s%lld f%lld;\n", cast(long long) nested, cast(long long) j);
+                field = structs[nested].layout;
+            } else {
+                const check_layout_type* type = &check_layout_types[check_random(random) % (sizeof check_layout_types / sizeof check_layout_types[0])];
+                check_text_append(text, "    %s f%lld;\n", type->text, cast(long long) j);
+                field = check_layout_type_get(target, type);
+            }
+
+            expected->offsets[j] = check_layout_align(expected->layout.size, field.align);
+            expected->layout.size = expected->offsets[j] + field.size;
+            if (field.align > expected->layout.align) expected->layout.align = field.align;
+        }
+
+        expected->layout.size = check_layout_align(expected->layout.size, expected->layout.align);
+        check_text_append(text, "}\n\n");
+    }
+}
+
+static int64 check_layout_target_structs(const check_layout_target* expected_target, ch_allocator allocator) {
+    int64 failure_count = 0;
+
+    const ch_target* target = ch_target_find(expected_target->name);
+    if (target == NULL || target->is_char_signed != expected_target->is_char_signed ||
+        0 != memcmp(target->layouts, expected_target->layouts, sizeof target->layouts)) {
+        fprintf(stderr, "layouts: target '%s' is not the one in targets.inc\n", expected_target->name);
+        return CHECK_LAYOUT_STRUCT_COUNT;
+    }
+
+    ch_string text = {.allocator = allocator};
+    check_layout_struct structs[CHECK_LAYOUT_STRUCT_COUNT];
+    uint64 random = 0x8EBC6AF09C88C6E3ull;
+    check_layout_structs(expected_target, &random, &text, structs);
+
+    check_analysis analysis = {0};
+    check_analysis_init(&analysis, "<layouts>", &text, target, NULL, allocator);
+    if (analysis.context.queued_diagnostics.count > 0) {
+        fprintf(stderr, "layouts: the structs for '%s' have errors: %s\n", target->name, analysis.context.queued_diagnostics.items[0].message);
+        failure_count = CHECK_LAYOUT_STRUCT_COUNT;
+    }
+
+    for (int64 i = 0; i < CHECK_LAYOUT_STRUCT_COUNT && failure_count == 0; i++) {
+        char name[32];
+        int length = snprintf(name, sizeof name, "s%lld", cast(long long) i);
+
+        ch_atom atom = 0;
+        ly_decl_view decls = {0};
+        if (ch_atom_find(&analysis.sema.atoms, name, length, &atom)) {
+            decls = ly_scope_lookup_local(&analysis.sema.module_scope, atom);
+        }
+
+        const ly_struct_layout* layout = NULL;
+        if (decls.count == 1) {
+            layout = ly_sema_struct_layout(&analysis.sema, ly_qual_type_id(ly_sema_decl_get(&analysis.sema, decls.items[0])->type));
+        }
+
+        check_layout_struct* expected = &structs[i];
+        bool is_match = layout != NULL && layout->layout.size == expected->layout.size && layout->layout.align == expected->layout.align &&
+                        layout->field_count == expected->field_count;
+        for (int64 j = 0; is_match && j < expected->field_count; j++) {
+            is_match = layout->fields[j].offset == expected->offsets[j];
+        }
+
+        if (!is_match) {
+            fprintf(stderr, "layouts: %s on '%s' was laid out as %lld bytes aligned to %lld, expected %lld aligned to %lld\n", name, target->name,
+                    layout != NULL ? cast(long long) layout->layout.size : -1LL, layout != NULL ? cast(long long) layout->layout.align : -1LL,
+                    cast(long long) expected->layout.size, cast(long long) expected->layout.align);
+            failure_count++;
+        }
+    }
+
+    check_analysis_deinit(&analysis);
+    da_free(&text);
+    return failure_count;
+}
+
+static int64 check_layouts(int argc, char** argv, ch_allocator allocator, int64* out_count) {
+    int64 failure_count = 0;
+    int64 target_count = cast(int64)(sizeof check_layout_targets / sizeof check_layout_targets[0]);
+    for (int64 i = 0; i < target_count; i++) {
+        failure_count += check_layout_target_structs(&check_layout_targets[i], allocator);
+    }
+
+    *out_count = target_count * CHECK_LAYOUT_STRUCT_COUNT;
+    return failure_count;
+}
+
+// ======================================================================
+// Modules
+// ======================================================================
+
+#define CHECK_MODULE_STRUCT_COUNT 64
+
+// What the importing module uses: `s3` and `get5` by name, `s9` through the signature of `get5`, and both overloads of `put`.
+static const char* check_module_importer =
+    "import lib;\n"
+    "\n"
+    "void main() {\n"
+    "    s3 value;\n"
+    "    get5(nil, 1);\n"
+    "    put(1);\n"
+    "}\n";
+
+static const char* check_module_used[] = {"s3", "get5", "s9", "put"};
+
+// Decodes the declarations of a name from the file, and checks each against the declaration the library's own analysis has for it.
+static bool check_module_find(ly_module_file* file, check_analysis* library, const char* name) {
+    uint32 first = 0;
+    int64 count = ly_module_file_find(file, name, cast(int64) strlen(name), &first);
+
+    ch_atom atom = 0;
+    ly_decl_view decls = {0};
+    if (ch_atom_find(&library->sema.atoms, name, cast(int64) strlen(name), &atom)) {
+        decls = ly_scope_lookup_local(&library->sema.module_scope, atom);
+    }
+
+    if (count != decls.count) {
+        fprintf(stderr, "modules: found %lld declarations of '%s', expected %lld\n", cast(long long) count, name, cast(long long) decls.count);
+        return false;
+    }
+
+    for (int64 i = 0; i < count; i++) {
+        const ly_module_decl* record = ly_module_file_decl(file, first + cast(uint32) i);
+        if (record == NULL || record->name_length != strlen(name) || 0 != memcmp(file->strings + record->name, name, record->name_length)) {
+            fprintf(stderr, "modules: declaration %lld of '%s' has the wrong name\n", cast(long long) i, name);
+            return false;
+        }
+
+        ly_decl* decl = ly_sema_decl_get(&library->sema, decls.items[i]);
+        if (record->kind != decl->kind) {
+            fprintf(stderr, "modules: declaration %lld of '%s' has the wrong kind\n", cast(long long) i, name);
+            return false;
+        }
+
+        // a struct's layout and fields are stored with it, and must read back as what the library computed.
+        const ly_struct_layout* layout = record->kind == LY_DK_STRUCT ? ly_sema_struct_layout(&library->sema, ly_qual_type_id(decl->type)) : NULL;
+        if (layout == NULL) continue;
+
+        bool is_match = record->layout.size == layout->layout.size && record->layout.align == layout->layout.align && record->field_count == layout->field_count;
+        for (int64 j = 0; is_match && j < layout->field_count; j++) {
+            const ly_module_field* field = ly_module_file_field(file, record->fields + cast(uint32) j);
+            is_match = field != NULL && field->offset == layout->fields[j].offset;
+        }
+
+        if (!is_match) {
+            fprintf(stderr, "modules: the layout of '%s' did not read back as it was written\n", name);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static bool check_module_in_mapping(ly_module_file* file, const void* pointer, int64 size) {
+    const char* begin = file->mapping.data;
+    const char* at = pointer;
+    return size == 0 || (at >= begin && size <= file->mapping.size && at - begin <= file->mapping.size - size);
+}
+
+// Nothing in an open module file is copied out of its mapping: every table, and every record and name a lookup returns, points into it.
+static bool check_module_zero_copy(ly_module_file* file) {
+    bool is_mapped = check_module_in_mapping(file, file->name, file->name_length) && check_module_in_mapping(file, file->target, file->target_length) &&
+                     check_module_in_mapping(file, file->symbols, file->symbol_count * cast(int64) sizeof *file->symbols) &&
+                     check_module_in_mapping(file, file->strings, file->string_size) &&
+                     check_module_in_mapping(file, file->decls, file->decl_count * cast(int64) sizeof *file->decls) &&
+                     check_module_in_mapping(file, file->fields, file->field_count * cast(int64) sizeof *file->fields) &&
+                     check_module_in_mapping(file, file->types, file->type_count * cast(int64) sizeof *file->types) &&
+                     check_module_in_mapping(file, file->extra, file->extra_count * cast(int64) sizeof *file->extra);
+
+    for (int64 i = 0; is_mapped && i < file->symbol_count; i++) {
+        const ly_module_symbol* symbol = &file->symbols[i];
+        const ly_module_decl* record = ly_module_file_decl(file, cast(uint32) i);
+        is_mapped = record == &file->decls[i] && check_module_in_mapping(file, file->strings + symbol->name, symbol->name_length) &&
+                    check_module_in_mapping(file, file->strings + record->name, record->name_length);
+    }
+
+    for (int64 i = 0; is_mapped && i < file->field_count; i++) {
+        is_mapped = ly_module_file_field(file, cast(uint32) i) == &file->fields[i];
+    }
+
+    // type 0 is no type, and is never stored.
+    for (int64 i = 1; is_mapped && i < file->type_count; i++) {
+        is_mapped = ly_module_file_type(file, cast(uint32) i) == &file->types[i];
+    }
+
+    if (!is_mapped) {
+        fprintf(stderr, "modules: the module file was copied out of its mapping\n");
+    }
+
+    return is_mapped;
+}
+
+static int64 check_modules(int argc, char** argv, ch_allocator allocator, int64* out_count) {
+    int64 result = 0;
+    int64 failure_count = 0;
+    *out_count = 1;
+    const char* path = argc > 0 ? argv[0] : "choir-check.mod";
+
+    ch_string text = {.allocator = allocator};
+    check_text_append(&text, "module lib;\n\n");
+    for (int64 i = 0; i < CHECK_MODULE_STRUCT_COUNT; i++) {
+        check_text_append(&text, "struct s%lld {\n    int8 tag;\n    int value;\n    s%lld* next;\n}\n\n", cast(long long) i, cast(long long) i);
+        check_text_append(&text, "int get%lld(s%lld* s, int value) {\n    return value;\n}\n\n", cast(long long) i, cast(long long)((i + 4) % CHECK_MODULE_STRUCT_COUNT));
+    }
+
+    check_text_append(&text, "void put(int value) {}\nvoid put(bool value) {}\n");
+
+    check_analysis library = {0};
+    check_analysis_init(&library, "<lib>", &text, NULL, NULL, allocator);
+
+    ly_module_file file = {0};
+    bool is_open = false;
+    if (library.context.queued_diagnostics.count > 0) {
+        fprintf(stderr, "modules: the library has errors: %s\n", library.context.queued_diagnostics.items[0].message);
+        return_defer(1);
+    } else if (!ly_module_file_write(&library.sema, "lib", path) || !(is_open = ly_module_file_open(&file, path))) {
+        fprintf(stderr, "modules: could not write and open '%s'\n", path);
+        return_defer(1);
+    }
+
+    if (!check_module_zero_copy(&file)) failure_count++;
+
+    // every declaration the library exports is found by name, once each, with the kind and layout it was written with.
+    int64 found_count = 0;
+    for (int64 i = 0; i < library.sema.module_decls.count && failure_count == 0; i++) {
+        ly_decl* decl = ly_sema_decl_get(&library.sema, library.sema.module_decls.items[i]);
+        ch_atom_info name = ch_atom_get(&library.sema.atoms, decl->name);
+
+        char buffer[32];
+        assert(name.length < cast(int64) sizeof buffer && "library names are short");
+        memcpy(buffer, name.text, cast(usize) name.length);
+        buffer[name.length] = '\0';
+
+        if (!check_module_find(&file, &library, buffer)) failure_count++;
+        found_count++;
+    }
+
+    uint32 first = 0;
+    if (ly_module_file_find(&file, "missing", 7, &first) != 0) {
+        fprintf(stderr, "modules: found a declaration the library does not have\n");
+        failure_count++;
+    }
+
+    // an importer decodes the declarations it names, and those their types name, and nothing else.
+    ch_string importer_text = {.allocator = allocator};
+    da_push_many(&importer_text, check_module_importer, cast(int64) strlen(check_module_importer));
+
+    check_analysis importer = {0};
+    check_analysis_init(&importer, "<importer>", &importer_text, NULL, &file, allocator);
+    if (importer.context.queued_diagnostics.count > 0) {
+        fprintf(stderr, "modules: the importer has errors: %s\n", importer.context.queued_diagnostics.items[0].message);
+        failure_count++;
+    }
+
+    bool is_used[CHECK_MODULE_STRUCT_COUNT * 2 + 2] = {0};
+    assert(file.decl_count <= cast(int64)(sizeof is_used / sizeof is_used[0]) && "the library exports more than it declares");
+    for (int64 i = 0; i < cast(int64)(sizeof check_module_used / sizeof check_module_used[0]); i++) {
+        int64 count = ly_module_file_find(&file, check_module_used[i], cast(int64) strlen(check_module_used[i]), &first);
+        for (int64 j = 0; j < count; j++) {
+            is_used[first + j] = true;
+        }
+    }
+
+    ly_sema_import* import = &importer.sema.imports.items[0];
+    for (int64 i = 0; i < file.decl_count && import->decls != NULL; i++) {
+        if ((import->decls[i] != 0) != is_used[i]) {
+            fprintf(stderr, "modules: declaration %.*s was%s decoded\n", cast(int) file.decls[i].name_length, file.strings + file.decls[i].name,
+                    is_used[i] ? " not" : "");
+            failure_count++;
+        }
+    }
+
+    if (import->decls == NULL) {
+        fprintf(stderr, "modules: the importer decoded nothing\n");
+        failure_count++;
+    }
+
+    check_analysis_deinit(&importer);
+    da_free(&importer_text);
+
+    *out_count = found_count + file.decl_count;
+    result = failure_count;
+
+defer:
+    if (is_open) ly_module_file_close(&file);
+    remove(path);
+    check_analysis_deinit(&library);
+    da_free(&text);
+    return result;
+}
+
+// ======================================================================
+// Templates
+// ======================================================================
+
+#define CHECK_TEMPLATE_FUNCTION_COUNT 48
+
+// The arguments each `get` instantiates `box` with; equal arguments must give the same instance, and so the same type, in every function.
+static const char* check_template_args[] = {"int", "int8", "bool", "int16*", "box<int>", "pair<int8, bool>"};
+
+static const char* check_template_declarations =
+    "module lib;\n"
+    "\n"
+    "template<T>\n"
+    "struct box {\n"
+    "    T value;\n"
+    "    box<T>* next;\n"
+    "}\n"
+    "\n"
+    "template<A, B>\n"
+    "struct pair {\n"
+    "    A a;\n"
+    "    B b;\n"
+    "}\n"
+    "\n"
+    "struct box_int {\n"
+    "    int value;\n"
+    "    box_int* next;\n"
+    "}\n"
+    "\n"
+    "template<T>\n"
+    "T id(T t) {\n"
+    "    return t;\n"
+    "}\n"
+    "\n";
+
+// The struct type `box` is instantiated with in the return type of a library function `get`.
+static ly_type_id check_template_box_type(check_analysis* analysis, int64 index) {
+    char name[32];
+    int length = snprintf(name, sizeof name, "get%lld", cast(long long) index);
+
+    ch_atom atom = 0;
+    ly_decl_view decls = {0};
+    if (ch_atom_find(&analysis->sema.atoms, name, length, &atom)) {
+        decls = ly_scope_lookup_local(&analysis->sema.module_scope, atom);
+    }
+
+    if (decls.count != 1) return 0;
+
+    ly_decl* decl = ly_sema_decl_get(&analysis->sema, decls.items[0]);
+    const ly_type* function = ly_type_get(&analysis->sema.types, ly_qual_type_id(decl->type));
+    const ly_type* pointer = ly_type_get(&analysis->sema.types, ly_qual_type_id(function->element));
+    return pointer->kind == LY_TY_POINTER ? ly_qual_type_id(pointer->element) : 0;
+}
+
+// Analyses a library whose functions instantiate the same few templates over and over, checking that each distinct instantiation is made
+// once and is laid out as the struct written by hand, then imports it into a module which names the same instances and must be given the
+// ones the library persisted, and which cannot instantiate any others.
+static int64 check_templates(int argc, char** argv, ch_allocator allocator, int64* out_count) {
+    int64 result = 0;
+    int64 failure_count = 0;
+    *out_count = 0;
+    const char* path = argc > 0 ? argv[0] : "choir-check-templates.mod";
+
+    int64 arg_indices[CHECK_TEMPLATE_FUNCTION_COUNT];
+    bool is_arg_used[sizeof check_template_args / sizeof check_template_args[0]] = {0};
+
+    ch_string text = {.allocator = allocator};
+    da_push_many(&text, check_template_declarations, cast(int64) strlen(check_template_declarations));
+
+    // the first function always uses `box<int>`, which is compared with `box_int` below.
+    uint64 random = 0x8EBC6AF09C88C6E3ull;
+    for (int64 i = 0; i < CHECK_TEMPLATE_FUNCTION_COUNT; i++) {
+        arg_indices[i] = i == 0 ? 0 : cast(int64)(check_random(&random) % (sizeof check_template_args / sizeof check_template_args[0]));
+        is_arg_used[arg_indices[i]] = true;
+
+        const char* arg = check_template_args[arg_indices[i]];
+        check_text_append(&text, "box<%s>* get%lld(box<%s>* b) {\n", arg, cast(long long) i, arg);
+        check_text_append(&text, "    return id<box<%s>*>(b);\n}\n\n", arg);
+    }
+
+    // every `box` argument, `box<int>` again if it is nested in an argument, `pair<int8, bool>` if it is one, and `box<T>`, which `box`
+    // itself names; and `id` once for each `box` pointer type.
+    int64 box_count = 0;
+    for (int64 i = 0; i < cast(int64)(sizeof is_arg_used / sizeof is_arg_used[0]); i++) {
+        if (is_arg_used[i]) box_count++;
+    }
+
+    int64 expected_instance_count = 2 * box_count + 1 + (is_arg_used[4] && !is_arg_used[0] ? 1 : 0) + (is_arg_used[5] ? 1 : 0);
+
+    check_analysis library = {0};
+    check_analysis_init(&library, "<lib>", &text, NULL, NULL, allocator);
+
+    ly_module_file file = {0};
+    bool is_open = false;
+    if (library.context.queued_diagnostics.count > 0) {
+        fprintf(stderr, "templates: the library has errors: %s\n", library.context.queued_diagnostics.items[0].message);
+        return_defer(1);
+    }
+
+    for (int64 i = 0; i < CHECK_TEMPLATE_FUNCTION_COUNT; i++) {
+        ly_type_id type = check_template_box_type(&library, i);
+        for (int64 j = 0; j < i; j++) {
+            if ((type == check_template_box_type(&library, j)) != (arg_indices[i] == arg_indices[j])) {
+                fprintf(stderr, "templates: box<%s> in get%lld and box<%s> in get%lld are %s types\n", check_template_args[arg_indices[i]], cast(long long) i,
+                        check_template_args[arg_indices[j]], cast(long long) j, arg_indices[i] == arg_indices[j] ? "different" : "the same");
+                failure_count++;
+            }
+        }
+    }
+
+    if (library.sema.templates.instances.count != expected_instance_count) {
+        fprintf(stderr, "templates: the library made %lld instances, expected %lld\n", cast(long long) library.sema.templates.instances.count,
+                cast(long long) expected_instance_count);
+        failure_count++;
+    }
+
+    ch_atom box_int_name = 0;
+    ch_layout box_layout = {0};
+    ch_layout box_int_layout = {0};
+    ly_decl_view box_int_decls = {0};
+    if (ch_atom_find(&library.sema.atoms, "box_int", 7, &box_int_name)) {
+        box_int_decls = ly_scope_lookup_local(&library.sema.module_scope, box_int_name);
+    }
+
+    if (box_int_decls.count != 1 || !ly_sema_type_layout(&library.sema, check_template_box_type(&library, 0), &box_layout) ||
+        !ly_sema_type_layout(&library.sema, ly_qual_type_id(ly_sema_decl_get(&library.sema, box_int_decls.items[0])->type), &box_int_layout) ||
+        0 != memcmp(&box_layout, &box_int_layout, sizeof box_layout)) {
+        fprintf(stderr, "templates: box<int> is not laid out as box_int is\n");
+        failure_count++;
+    }
+
+    if (!ly_module_file_write(&library.sema, "lib", path) || !(is_open = ly_module_file_open(&file, path))) {
+        fprintf(stderr, "templates: could not write and open '%s'\n", path);
+        return_defer(failure_count + 1);
+    }
+
+    // passing the importer's own `box<...>` to the library's `get` only type checks if both name the instance the library persisted.
+    ch_string importer_text = {.allocator = allocator};
+    check_text_append(&importer_text, "import lib;\n\nvoid main() {\n");
+    for (int64 i = 0; i < CHECK_TEMPLATE_FUNCTION_COUNT; i++) {
+        check_text_append(&importer_text, "    box<%s> v%lld;\n", check_template_args[arg_indices[i]], cast(long long) i);
+        check_text_append(&importer_text, "    var r%lld = get%lld(&v%lld);\n", cast(long long) i, cast(long long) i, cast(long long) i);
+    }
+
+    check_text_append(&importer_text, "    box<uint8> missing;\n}\n");
+
+    check_analysis importer = {0};
+    check_analysis_init(&importer, "<importer>", &importer_text, NULL, &file, allocator);
+    if (importer.context.queued_diagnostics.count != 1) {
+        fprintf(stderr, "templates: the importer reported %lld problems, expected only the missing box<uint8>\n",
+                cast(long long) importer.context.queued_diagnostics.count);
+        for (int64 i = 0; i < importer.context.queued_diagnostics.count; i++) {
+            fprintf(stderr, "  %s\n", importer.context.queued_diagnostics.items[i].message);
+        }
+
+        failure_count++;
+    }
+
+    if (importer.sema.templates.instances.count != 0) {
+        fprintf(stderr, "templates: the importer instantiated %lld imported templates itself\n", cast(long long) importer.sema.templates.instances.count);
+        failure_count++;
+    }
+
+    check_analysis_deinit(&importer);
+    da_free(&importer_text);
+
+    *out_count = 2 * CHECK_TEMPLATE_FUNCTION_COUNT;
+    result = failure_count;
+
+defer:
+    if (is_open) ly_module_file_close(&file);
+    remove(path);
+    check_analysis_deinit(&library);
+    da_free(&text);
+    return result;
+}
@@ -1,61 +1,560 @@
 #include <laye/laye.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
+#if defined(_WIN32)
+#    include <direct.h>
+#else
+#    include <sys/stat.h>
+#endif
+
+#define LAYEC_MAX_MODULE_DIRECTORIES 64
+
 #ifndef BUILD_VERSION
 #    define BUILD_VERSION "<unknown>"
 #endif // BUILD_VERSION
 
 static const char* help_text =
-    "Laye Module Compiler Version %s\n";
+    "Laye Module Compiler Version %s\n"
+    "\n"
+    "Usage: %s [options] <files...>\n"
+    "\n"
+    "Options:\n"
+    "  --help               Print this help text and exit.\n"
+    "  --version            Print version information and exit.\n"
+    "  -o <path>            The module file to write.\n"
+    "  -L <path>            Search this directory for the module files of imports. May be given more than once.\n"
+    "  -j <count>           The number of threads to use. Defaults to the number of processors.\n"
+    "  --cache-dir <path>   Reuse the syntax trees of unchanged files from this directory, and cache new ones there.\n"
+    "  --lex                Stop after lexing.\n"
+    "  --parse              Stop after parsing.\n"
+    "  --tokens             Print the tokens of each file.\n"
+    "  --ast                Print the syntax tree of each file.\n"
+    "  --release-sources    Free source text and tokens once their names are interned, before semantic analysis.\n";
+
+typedef struct layec_options {
+    const char* program_name;
+    const char* output_file;
+    const char* cache_directory;
+    int64 thread_count;
+    bool lex_only;
+    bool parse_only;
+    bool print_tokens;
+    bool print_ast;
+    bool release_sources;
+
+    const char* module_directories[LAYEC_MAX_MODULE_DIRECTORIES];
+    int64 module_directory_count;
+
+    const char** input_files;
+    int64 input_file_count;
+} layec_options;
+
+// Everything a single module source owns, so that each one can be worked on from its own thread.
+typedef struct layec_file {
+    const char* path;
+    ch_source source;
+    char* text;
+
+    // diagnostics are deferred here and merged into the main context in file order once every job is done.
+    ch_context context;
+    ch_arena token_arena;
+    ly_token* tokens;
+    // the syntax tree and everything it grows are allocated from this arena, which only the file's job touches.
+    ch_arena syntax_arena;
+    ly_syntax_tree tree;
+    // when the tree was loaded from the syntax cache, its nodes live in this mapping instead.
+    ch_mapped_file syntax_cache;
+} layec_file;
+
+typedef struct layec_module {
+    ch_allocator allocator;
+    const layec_options* options;
+    layec_file* files;
+    int64 file_count;
+} layec_module;
 
+// the module files opened for the module's imports, which must stay open until analysis is done with them.
+typedef struct layec_imports {
+    ch_allocator allocator;
+    ly_module_file** items;
+    int64 count, capacity;
+} layec_imports;
+
+static bool parse_args(int argc, char** argv, layec_options* options);
+static void make_directory(const char* path);
+static void parse_file_job(void* userdata, int64 index);
 static void print_tokens(ch_context* context, ly_token* tokens);
+static void print_ast(ly_syntax_tree* tree, ch_allocator allocator);
+static void release_sources(layec_module* module);
+static void open_imports(const layec_options* options, ly_module* laye_module, layec_imports* imports);
+static char* module_name(ly_module* laye_module, ch_allocator allocator);
 
 int main(int argc, char** argv) {
     int result = 0;
 
+    layec_options options = {0};
+    if (!parse_args(argc, argv, &options)) {
+        return 1;
+    }
+
     ch_allocator default_allocator = ch_general_purpose_allocator();
 
     ch_context context = {0};
     ch_context_init(&context, default_allocator);
 
-    ch_diag(&context, CH_DIAG_NOTE, CH_NOLOC, "this is a test");
-    ch_diag(&context, CH_DIAG_WARN, CH_NOLOC, "this is a test");
-    ch_diag(&context, CH_DIAG_ERROR, CH_NOLOC, "this is a test");
+    ch_thread_pool pool = {0};
+    ch_thread_pool_init(&pool, default_allocator, options.thread_count);
+
+    layec_module module = {
+        .allocator = default_allocator,
+        .options = &options,
+        .files = ch_alloc(default_allocator, options.input_file_count * cast(int64) sizeof(layec_file)),
+        .file_count = options.input_file_count,
+    };
+
+    for (int64 i = 0; i < module.file_count; i++) {
+        layec_file* file = &module.files[i];
+        *file = (layec_file){
+            .path = options.input_files[i],
+        };
+
+        ch_context_init(&file->context, default_allocator);
+        file->context.defer_diagnostics = true;
+        ch_arena_init(&file->token_arena, default_allocator, 4096 * sizeof(ly_token));
+        ch_arena_init(&file->syntax_arena, default_allocator, 4096 * sizeof(ly_syntax_node));
+    }
+
+    if (options.cache_directory != NULL) {
+        make_directory(options.cache_directory);
+    }
+
+    ch_thread_pool_run(&pool, module.file_count, parse_file_job, &module);
+
+    // once every job is done the trees are only read, so they can be handed to sema from here.
+    ly_module laye_module = {
+        .trees.allocator = default_allocator,
+    };
+
+    layec_imports imports = {
+        .allocator = default_allocator,
+    };
+
+    char* name = NULL;
+
+    for (int64 i = 0; i < module.file_count; i++) {
+        layec_file* file = &module.files[i];
+        if (file->tree.root != 0) {
+            da_push(&laye_module.trees, &file->tree);
+        }
+    }
+
+    bool has_errors = false;
+    for (int64 i = 0; i < module.file_count; i++) {
+        layec_file* file = &module.files[i];
+        for (int64 j = 0; j < file->context.queued_diagnostics.count; j++) {
+            has_errors |= file->context.queued_diagnostics.items[j].kind >= CH_DIAG_ERROR;
+        }
+
+        ch_diag_merge(&context, &file->context);
+
+        if (options.print_tokens && file->tokens != NULL) {
+            print_tokens(&context, file->tokens);
+        }
+
+        if (options.print_ast && file->tree.root != 0) {
+            print_ast(&file->tree, default_allocator);
+        }
+    }
+
+    ch_diag_flush(&context);
+
+    if (has_errors) {
+        return_defer(1);
+    }
+
+    if (options.lex_only || options.parse_only) {
+        return_defer(0);
+    }
+
+    ch_context sema_context = {0};
+    ch_context_init(&sema_context, default_allocator);
+    sema_context.defer_diagnostics = true;
+
+    open_imports(&options, &laye_module, &imports);
+    name = module_name(&laye_module, default_allocator);
+
+    ly_sema sema;
+    ly_sema_init(&sema, &sema_context, &laye_module, default_allocator);
+    for (int64 i = 0; i < imports.count; i++) {
+        ly_sema_add_import(&sema, imports.items[i]);
+    }
+
+    // once sema has interned every name, analysis only reads nodes and locations, so nothing reads the text or tokens again.
+    // a diagnostic which wants to show the text reloads it from the file.
+    ly_sema_intern_strings(&sema);
+    if (options.release_sources) {
+        release_sources(&module);
+    }
+
+    ly_sema_analyse(&sema, &pool);
+
+    for (int64 i = 0; i < sema_context.queued_diagnostics.count; i++) {
+        has_errors |= sema_context.queued_diagnostics.items[i].kind >= CH_DIAG_ERROR;
+    }
+
+    ch_diag_merge(&context, &sema_context);
+    ch_diag_flush(&context);
 
-    ch_arena token_arena = {0};
-    ch_arena_init(&token_arena, default_allocator, 4096 * sizeof(ly_token));
-    ch_allocator token_arena_allocator = ch_arena_allocator(&token_arena);
+    if (!has_errors && options.output_file != NULL && !ly_module_file_write(&sema, name, options.output_file)) {
+        fprintf(stderr, "%s: could not write module file '%s'\n", options.program_name, options.output_file);
+        has_errors = true;
+    }
 
-    ch_source source = {0};
-    source.name = "test_file";
-    source.text = "+ - * /";
-    source.length = cast(int64) strlen(source.text);
+    ly_sema_deinit(&sema);
+    ch_context_deinit(&sema_context);
 
-    ly_token* tokens = ly_lex(&context, &source, token_arena_allocator, LY_LEX_PRESERVE_TRIVIA);
-    print_tokens(&context, tokens);
+    if (has_errors) {
+        return_defer(1);
+    }
 
 defer:
-    ch_allocator_deinit(token_arena_allocator);
+    for (int64 i = 0; i < imports.count; i++) {
+        ly_module_file_close(imports.items[i]);
+        ch_dealloc(default_allocator, imports.items[i]);
+    }
+
+    da_free(&imports);
+    ch_dealloc(default_allocator, name);
+    da_free(&laye_module.trees);
+    for (int64 i = 0; i < module.file_count; i++) {
+        layec_file* file = &module.files[i];
+        ch_file_unmap(&file->syntax_cache);
+        ch_arena_deinit(&file->syntax_arena);
+        ch_arena_deinit(&file->token_arena);
+        ch_context_deinit(&file->context);
+        ch_dealloc(default_allocator, file->text);
+    }
+
+    ch_dealloc(default_allocator, module.files);
+    ch_thread_pool_deinit(&pool);
     ch_context_deinit(&context);
     ch_allocator_deinit(default_allocator);
     return result;
 }
 
-static void print_trivia(ch_context* context, ly_token* trivia) {
-    while (trivia != NULL) {
-        ch_diag(context, CH_DIAG_NOTE, trivia->location, "%s", ly_token_kind_name_get(trivia->kind));
-        trivia = trivia->next;
+static bool parse_args(int argc, char** argv, layec_options* options) {
+    options->program_name = argv[0];
+    options->thread_count = ch_processor_count();
+    options->input_files = cast(const char**) argv + 1;
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        if (0 == strcmp(arg, "--help")) {
+            fprintf(stderr, help_text, BUILD_VERSION, options->program_name);
+            exit(0);
+        } else if (0 == strcmp(arg, "--version")) {
+            fprintf(stderr, "Laye Module Compiler Version %s\n", BUILD_VERSION);
+            exit(0);
+        } else if (0 == strcmp(arg, "-o")) {
+            if (++i >= argc) {
+                fprintf(stderr, "%s: argument to '-o' is missing\n", options->program_name);
+                return false;
+            }
+
+            options->output_file = argv[i];
+        } else if (0 == strcmp(arg, "--cache-dir")) {
+            if (++i >= argc) {
+                fprintf(stderr, "%s: argument to '--cache-dir' is missing\n", options->program_name);
+                return false;
+            }
+
+            options->cache_directory = argv[i];
+        } else if (0 == strcmp(arg, "-L")) {
+            if (++i >= argc) {
+                fprintf(stderr, "%s: argument to '-L' is missing\n", options->program_name);
+                return false;
+            }
+
+            if (options->module_directory_count == LAYEC_MAX_MODULE_DIRECTORIES) {
+                fprintf(stderr, "%s: too many module directories\n", options->program_name);
+                return false;
+            }
+
+            options->module_directories[options->module_directory_count++] = argv[i];
+        } else if (0 == strcmp(arg, "-j")) {
+            if (++i >= argc || atoll(argv[i]) <= 0) {
+                fprintf(stderr, "%s: '-j' expects a positive thread count\n", options->program_name);
+                return false;
+            }
+
+            options->thread_count = atoll(argv[i]);
+        } else if (0 == strcmp(arg, "--lex")) {
+            options->lex_only = true;
+        } else if (0 == strcmp(arg, "--parse")) {
+            options->parse_only = true;
+        } else if (0 == strcmp(arg, "--tokens")) {
+            options->print_tokens = true;
+        } else if (0 == strcmp(arg, "--ast")) {
+            options->print_ast = true;
+        } else if (0 == strcmp(arg, "--release-sources")) {
+            options->release_sources = true;
+        } else if (arg[0] == '-' && arg[1] != '\0') {
+            fprintf(stderr, "%s: unknown option '%s'\n", options->program_name, arg);
+            return false;
+        } else {
+            // input files are compacted to the front of argv, keeping them in the order they were given.
+            options->input_files[options->input_file_count++] = arg;
+        }
+    }
+
+    if (options->input_file_count == 0) {
+        fprintf(stderr, "%s: no input files\n", options->program_name);
+        return false;
+    }
+
+    return true;
+}
+
+static void make_directory(const char* path) {
+    // failing here is fine; the cache is then simply not written.
+#if defined(_WIN32)
+    discard _mkdir(path);
+#else
+    discard mkdir(path, 0777);
+#endif
+}
+
+static char* read_file(const char* path, ch_allocator allocator, int64* out_length) {
+    FILE* stream = fopen(path, "rb");
+    if (stream == NULL) {
+        return NULL;
+    }
+
+    char* text = NULL;
+    if (0 != fseek(stream, 0, SEEK_END)) goto failed;
+
+    long length = ftell(stream);
+    if (length < 0 || 0 != fseek(stream, 0, SEEK_SET)) goto failed;
+
+    text = ch_alloc(allocator, cast(int64) length + 1);
+    if (cast(usize) length != fread(text, 1, cast(usize) length, stream)) goto failed;
+
+    text[length] = 0;
+    *out_length = length;
+
+    fclose(stream);
+    return text;
+
+failed:;
+    ch_dealloc(allocator, text);
+    fclose(stream);
+    return NULL;
+}
+
+static void parse_file_job(void* userdata, int64 index) {
+    layec_module* module = userdata;
+    layec_file* file = &module->files[index];
+
+    int64 length = 0;
+    file->text = read_file(file->path, module->allocator, &length);
+    if (file->text == NULL) {
+        ch_diag(&file->context, CH_DIAG_ERROR, CH_NOLOC, "could not read file '%s'", file->path);
+        return;
+    }
+
+    file->source = (ch_source){
+        .name = file->path,
+        .text = file->text,
+        .length = length,
+    };
+
+    const layec_options* options = module->options;
+    ch_allocator syntax_allocator = ch_arena_allocator(&file->syntax_arena);
+
+    // a cached tree comes without tokens, so the cache is not used when they are wanted.
+    bool use_cache = options->cache_directory != NULL && !options->lex_only && !options->print_tokens;
+    uint64 cache_key = 0;
+    char* cache_path = NULL;
+
+    if (use_cache) {
+        cache_key = ly_syntax_cache_key(&file->source, BUILD_VERSION);
+
+        int64 cache_path_length = cast(int64) strlen(options->cache_directory) + 32;
+        cache_path = ch_alloc(module->allocator, cache_path_length);
+        discard snprintf(cache_path, cast(usize) cache_path_length, "%s/%016llx.lysyntax", options->cache_directory, cast(unsigned long long) cache_key);
+
+        if (ly_syntax_cache_read(&file->tree, syntax_allocator, &file->source, cache_key, cache_path, &file->syntax_cache)) {
+            ch_dealloc(module->allocator, cache_path);
+            return;
+        }
+    }
+
+    ch_allocator token_allocator = ch_arena_allocator(&file->token_arena);
+    if (options->lex_only) {
+        file->tokens = ly_lex(&file->context, &file->source, token_allocator, LY_LEX_NONE);
+        return;
+    }
+
+    ly_lexer lexer = {0};
+    ly_lexer_init(&lexer, &file->context, &file->source, token_allocator, LY_LEX_NONE);
+    ly_syntax_tree_init(&file->tree, syntax_allocator, &file->source);
+    ly_parse(&file->context, &file->tree, &lexer);
+
+    if (options->print_tokens) {
+        // the parser has already reported everything the lexer had to say, so a second lex only for printing stays quiet.
+        ch_context token_context = {0};
+        ch_context_init(&token_context, module->allocator);
+        token_context.defer_diagnostics = true;
+        file->tokens = ly_lex(&token_context, &file->source, token_allocator, LY_LEX_NONE);
+        ch_diag_discard(&token_context);
+        ch_context_deinit(&token_context);
+    }
+
+    // only trees without diagnostics are cached, since loading one from the cache reports nothing.
+    // a cache which cannot be written to only costs the time it would have saved.
+    if (use_cache && file->context.queued_diagnostics.count == 0) {
+        discard ly_syntax_cache_write(&file->tree, cache_key, cache_path);
+    }
+
+    ch_dealloc(module->allocator, cache_path);
+}
+
+static void release_sources(layec_module* module) {
+    for (int64 i = 0; i < module->file_count; i++) {
+        layec_file* file = &module->files[i];
+        if (file->text == NULL) continue;
+
+        ly_syntax_tree_release_strings(&file->tree);
+
+        // left empty rather than torn down, so cleanup can treat every file the same.
+        ch_arena_deinit(&file->token_arena);
+        ch_arena_init(&file->token_arena, module->allocator, 4096 * sizeof(ly_token));
+        file->tokens = NULL;
+
+        ch_source_release(&file->source);
+        ch_dealloc(module->allocator, file->text);
+        file->text = NULL;
+    }
+}
+
+static bool is_import_open(layec_imports* imports, ly_syntax_string name) {
+    for (int64 i = 0; i < imports->count; i++) {
+        ly_module_file* file = imports->items[i];
+        if (file->name_length == name.length && 0 == memcmp(file->name, name.text, cast(usize) name.length)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Maps the module file of every module imported at the top level, from the first module directory which has one.
+// Nothing in the file is read here beyond its header; sema decodes the declarations it uses as it finds them. A module which is not found is
+// left for sema to report where it is imported.
+static void open_imports(const layec_options* options, ly_module* laye_module, layec_imports* imports) {
+    for (int64 i = 0; i < laye_module->trees.count; i++) {
+        ly_syntax_tree* tree = laye_module->trees.items[i];
+        ly_syntax_list decls = ly_syntax_list_get(tree, ly_syntax_get(tree, tree->root)->lhs);
+        for (int64 j = 0; j < decls.count; j++) {
+            ly_syntax_node* node = ly_syntax_get(tree, decls.items[j]);
+            if (node->kind != LY_SN_DECL_IMPORT || node->lhs == 0) continue;
+
+            ly_syntax_string name = ly_syntax_string_get(tree, node->lhs);
+            if (is_import_open(imports, name)) continue;
+
+            for (int64 k = 0; k < options->module_directory_count; k++) {
+                int64 path_length = cast(int64) strlen(options->module_directories[k]) + name.length + 6;
+                char* path = ch_alloc(imports->allocator, path_length);
+                discard snprintf(path, cast(usize) path_length, "%s/%.*s.mod", options->module_directories[k], cast(int) name.length, name.text);
+
+                ly_module_file* file = ch_alloc(imports->allocator, sizeof *file);
+                bool is_open = ly_module_file_open(file, path);
+                ch_dealloc(imports->allocator, path);
+
+                if (is_open) {
+                    da_push(imports, file);
+                    break;
+                }
+
+                ch_dealloc(imports->allocator, file);
+            }
+        }
     }
 }
 
+// Returns the name the module declares in its first file which names it, or the name of a program module if none does.
+static char* module_name(ly_module* laye_module, ch_allocator allocator) {
+    ly_syntax_string name = {.text = ".program", .length = 8};
+    for (int64 i = 0; i < laye_module->trees.count; i++) {
+        ly_syntax_tree* tree = laye_module->trees.items[i];
+        uint32 module_name = ly_syntax_get(tree, tree->root)->rhs;
+        if (module_name != 0) {
+            name = ly_syntax_string_get(tree, module_name);
+            break;
+        }
+    }
+
+    char* result = ch_alloc(allocator, name.length + 1);
+    memcpy(result, name.text, cast(usize) name.length);
+    result[name.length] = '\0';
+    return result;
+}
+
 static void print_tokens(ch_context* context, ly_token* tokens) {
     while (tokens != NULL) {
-        ch_diag(context, CH_DIAG_WARN, tokens->location, "%s", ly_token_kind_name_get(tokens->kind));
-        ch_diag(context, CH_DIAG_NOTE, CH_NOLOC, "leading:");
-        print_trivia(context, tokens->leading_trivia);
-        ch_diag(context, CH_DIAG_NOTE, CH_NOLOC, "trailing:");
-        print_trivia(context, tokens->trailing_trivia);
+        ch_diag(context, CH_DIAG_NOTE, tokens->location, "%s", ly_token_kind_name_get(tokens->kind));
         tokens = tokens->next;
     }
 }
+
+typedef struct ast_entry {
+    ly_syntax_id id;
+    int64 depth;
+} ast_entry;
+
+typedef struct ast_stack {
+    ch_allocator allocator;
+    ast_entry* items;
+    int64 count, capacity;
+} ast_stack;
+
+// Trees of long operator chains are as deep as the chain is long, so they are walked with an explicit stack.
+static void print_ast(ly_syntax_tree* tree, ch_allocator allocator) {
+    ast_stack stack = {.allocator = allocator};
+    ly_syntax_id children[16];
+
+    fprintf(stdout, "%s\n", tree->source->name);
+    da_push(&stack, ((ast_entry){tree->root, 1}));
+
+    while (stack.count > 0) {
+        ast_entry entry = stack.items[--stack.count];
+        ly_syntax_node* node = ly_syntax_get(tree, entry.id);
+
+        fprintf(stdout, "%*s%s", cast(int)(2 * entry.depth), "", ly_syntax_kind_name_get(node->kind));
+        if (node->token_kind != LY_TK_MISSING) {
+            fprintf(stdout, " %s", ly_token_kind_name_get(node->token_kind));
+        }
+
+        fprintf(stdout, " <%u:%u>\n", node->offset, node->length);
+
+        int64 child_count = ly_syntax_children(tree, entry.id, children, 16);
+        ly_syntax_id* items = children;
+        if (child_count > 16) {
+            items = ch_alloc(allocator, child_count * cast(int64) sizeof *items);
+            discard ly_syntax_children(tree, entry.id, items, child_count);
+        }
+
+        // pushed in reverse so the children come off the stack in source order.
+        for (int64 i = child_count - 1; i >= 0; i--) {
+            da_push(&stack, ((ast_entry){items[i], entry.depth + 1}));
+        }
+
+        if (items != children) {
+            ch_dealloc(allocator, items);
+        }
+    }
+
+    da_free(&stack);
+}
@@ -26,6 +26,8 @@
 #define PINK_EXECUTABLE_FILE  "pink"
 #define PENG_EXECUTABLE_FILE  "peng"
 #define SCORE_EXECUTABLE_FILE "score"
+#define BENCH_EXECUTABLE_FILE "choir-bench"
+#define CHECK_EXECUTABLE_FILE "choir-check"
 
 #if defined(NOBCONFIG_MISSING)
 #    error No nob configuration has been specified. Please copy the relevant config file from the config directory for your platform and toolchain into the appropriate 'nob_config.<PLATFORM>.h' file.
@@ -46,6 +48,7 @@ static bool build_object_files(const char* source_root, source_paths* sources, N
 
 const char* identify_source_root();
 
+static int bench(int argc, char** argv);
 static int build(int argc, char** argv);
 static int clean(int argc, char** argv);
 static int fuzz(int argc, char** argv);
@@ -62,13 +65,25 @@ static bool build_laye(const char* source_root);
 static bool build_layec(const char* source_root);
 static bool build_peng(const char* source_root);
 static bool build_score(const char* source_root);
+static bool build_bench(const char* source_root);
+static bool build_check(const char* source_root);
 
 static source_paths libchoir_files[] = {
     {"lib/choir/alloc.c", ODIR "/choir-alloc.o"},
     {"lib/choir/arena.c", ODIR "/choir-arena.o"},
+    {"lib/choir/atom.c", ODIR "/choir-atom.o"},
     {"lib/choir/context.c", ODIR "/choir-context.o"},
     {"lib/choir/diag.c", ODIR "/choir-diag.o"},
+    {"lib/choir/file.c", ODIR "/choir-file.o"},
     {"lib/choir/gpalloc.c", ODIR "/choir-gpalloc.o"},
+    {"lib/choir/hash.c", ODIR "/choir-hash.o"},
+    {"lib/choir/pool.c", ODIR "/choir-pool.o"},
+    {"lib/choir/source.c", ODIR "/choir-source.o"},
+    {"lib/choir/stable.c", ODIR "/choir-stable.o"},
+    {"lib/choir/target.c", ODIR "/choir-target.o"},
+    {"lib/choir/utf8.c", ODIR "/choir-utf8.o"},
+    {"lib/choir/wideint.c", ODIR "/choir-wideint.o"},
+    {"lib/choir/xid.c", ODIR "/choir-xid.o"},
     {0},
 };
 
@@ -86,6 +101,14 @@ static source_paths liblaye_files[] = {
     {"lib/laye/lex.c", ODIR "/laye-lex.o"},
     {"lib/laye/ast.c", ODIR "/laye-ast.o"},
     {"lib/laye/parse.c", ODIR "/laye-parse.o"},
+    {"lib/laye/cache.c", ODIR "/laye-cache.o"},
+    {"lib/laye/scope.c", ODIR "/laye-scope.o"},
+    {"lib/laye/constant.c", ODIR "/laye-constant.o"},
+    {"lib/laye/overload.c", ODIR "/laye-overload.o"},
+    {"lib/laye/template.c", ODIR "/laye-template.o"},
+    {"lib/laye/layout.c", ODIR "/laye-layout.o"},
+    {"lib/laye/module.c", ODIR "/laye-module.o"},
+    {"lib/laye/type.c", ODIR "/laye-type.o"},
     {"lib/laye/sema.c", ODIR "/laye-sema.o"},
     {0},
 };
@@ -130,10 +153,35 @@ static source_paths score_files[] = {
     {0},
 };
 
+static source_paths bench_files[] = {
+    {"src/bench.c", ODIR "/bench.o"},
+    {0},
+};
+
+static source_paths check_files[] = {
+    {"src/check.c", ODIR "/check.o"},
+    {0},
+};
+
+// The choir-check checks which bring their own cases, rather than running over the test files.
+static const char* check_self_contained[] = {
+    "statements",
+    "integers",
+    "scopes",
+    "types",
+    "constants",
+    "overloads",
+    "layouts",
+    "modules",
+    "templates",
+    NULL,
+};
+
 static const char* all_headers[] = {
     "include/choir/choir.h",
     "include/choir/config.h",
     "include/choir/macros.h",
+    "include/choir/targets.inc",
 
     "include/cc/cc.h",
     "include/cc/std.inc",
@@ -141,6 +189,8 @@ static const char* all_headers[] = {
 
     "include/laye/laye.h",
     "include/laye/macros.h",
+    "include/laye/operators.inc",
+    "include/laye/syntax.inc",
     "include/laye/tokens.inc",
 
     NULL,
@@ -155,7 +205,10 @@ int main(int argc, char** argv) {
 
     if (argc > 0) {
         const char* command = argv[0];
-        if (0 == strcmp(command, "clean")) {
+        if (0 == strcmp(command, "bench")) {
+            (void)nob_shift_args(&argc, &argv);
+            nob_return_defer(bench(argc, argv));
+        } else if (0 == strcmp(command, "clean")) {
             (void)nob_shift_args(&argc, &argv);
             nob_return_defer(clean(argc, argv));
         } else if (0 == strcmp(command, "fuzz")) {
@@ -350,6 +403,70 @@ defer:;
     return result;
 }
 
+static bool build_bench(const char* source_root) {
+    bool result = true;
+
+    const char* libchoir_file = NULL;
+    if (!build_libchoir(source_root, &libchoir_file)) {
+        nob_return_defer(false);
+    }
+
+    const char* libpink_file = NULL;
+    if (!build_libpink(source_root, &libpink_file)) {
+        nob_return_defer(false);
+    }
+
+    const char* liblaye_file = NULL;
+    if (!build_liblaye(source_root, &liblaye_file)) {
+        nob_return_defer(false);
+    }
+
+    Nob_File_Paths bench_input_paths = {0};
+    if (!build_object_files(source_root, bench_files, &bench_input_paths)) {
+        nob_return_defer(false);
+    }
+
+    nob_da_append(&bench_input_paths, libchoir_file);
+    nob_da_append(&bench_input_paths, libpink_file);
+    nob_da_append(&bench_input_paths, liblaye_file);
+    const char* benchfile = ODIR "/" BENCH_EXECUTABLE_FILE EXE_EXT;
+    if (!link_executable(bench_input_paths, benchfile)) {
+        nob_return_defer(false);
+    }
+
+defer:;
+    return result;
+}
+
+static bool build_check(const char* source_root) {
+    bool result = true;
+
+    const char* libchoir_file = NULL;
+    if (!build_libchoir(source_root, &libchoir_file)) {
+        nob_return_defer(false);
+    }
+
+    const char* liblaye_file = NULL;
+    if (!build_liblaye(source_root, &liblaye_file)) {
+        nob_return_defer(false);
+    }
+
+    Nob_File_Paths check_input_paths = {0};
+    if (!build_object_files(source_root, check_files, &check_input_paths)) {
+        nob_return_defer(false);
+    }
+
+    nob_da_append(&check_input_paths, libchoir_file);
+    nob_da_append(&check_input_paths, liblaye_file);
+    const char* checkfile = ODIR "/" CHECK_EXECUTABLE_FILE EXE_EXT;
+    if (!link_executable(check_input_paths, checkfile)) {
+        nob_return_defer(false);
+    }
+
+defer:;
+    return result;
+}
+
 static int build(int argc, char** argv) {
     int result = 0;
 
@@ -377,6 +494,40 @@ defer:;
     return result;
 }
 
+static int bench(int argc, char** argv) {
+    int result = 0;
+
+    if (argc == 0) {
+        nob_log(NOB_ERROR, "Usage: nob bench lex [options]");
+        nob_return_defer(1);
+    }
+
+    nob_log(NOB_INFO, "Benchmarking...");
+
+    if (!nob_mkdir_if_not_exists(ODIR)) {
+        nob_return_defer(1);
+    }
+
+    const char* source_root = identify_source_root();
+    if (!build_bench(source_root)) {
+        nob_return_defer(1);
+    }
+
+    Nob_Cmd cmd = {0};
+    nob_cmd_append(&cmd, ODIR "/" BENCH_EXECUTABLE_FILE EXE_EXT);
+    nob_da_append_many(&cmd, argv, argc);
+
+    if (!nob_cmd_run_sync(cmd)) {
+        nob_cmd_free(cmd);
+        nob_return_defer(1);
+    }
+
+    nob_cmd_free(cmd);
+
+defer:;
+    return result;
+}
+
 static int clean(int argc, char** argv) {
     int result = 0;
 
@@ -416,6 +567,44 @@ static int test(int argc, char** argv) {
 
     nob_log(NOB_INFO, "Testing...");
 
+    if (!nob_mkdir_if_not_exists(ODIR)) {
+        nob_return_defer(1);
+    }
+
+    const char* source_root = identify_source_root();
+    if (!build_check(source_root)) {
+        nob_return_defer(1);
+    }
+
+    const char* laye_test_dir = nob_temp_sprintf("%s/../test/laye", source_root);
+    Nob_File_Paths laye_tests = {0};
+    if (!nob_read_entire_dir(laye_test_dir, &laye_tests)) {
+        nob_return_defer(1);
+    }
+
+    Nob_Cmd cmd = {0};
+    nob_cmd_append(&cmd, ODIR "/" CHECK_EXECUTABLE_FILE EXE_EXT, "reparse");
+    for (size_t i = 0; i < laye_tests.count; i++) {
+        if (!nob_sv_end_with(nob_sv_from_cstr(laye_tests.items[i]), ".laye")) continue;
+        nob_cmd_append(&cmd, nob_temp_sprintf("%s/%s", laye_test_dir, laye_tests.items[i]));
+    }
+
+    if (!nob_cmd_run_sync(cmd)) {
+        nob_cmd_free(cmd);
+        nob_return_defer(1);
+    }
+
+    for (size_t i = 0; check_self_contained[i] != NULL; i++) {
+        cmd.count = 0;
+        nob_cmd_append(&cmd, ODIR "/" CHECK_EXECUTABLE_FILE EXE_EXT, check_self_contained[i]);
+        if (!nob_cmd_run_sync(cmd)) {
+            nob_cmd_free(cmd);
+            nob_return_defer(1);
+        }
+    }
+
+    nob_cmd_free(cmd);
+
 defer:;
     return result;
 }